@@ -17,18 +17,49 @@ static BOOL DnsCacheInitialized = FALSE;
 #define DnsCacheLock()          do { EnterCriticalSection(&DnsCache.Lock); } while (0)
 #define DnsCacheUnlock()        do { LeaveCriticalSection(&DnsCache.Lock); } while (0)
 
+/* Case-insensitive FNV-1a of the name. All the types of a name share a
+ * bucket so that they can be removed together. */
+static
+ULONG
+DnsIntCacheHashName(LPCWSTR Name)
+{
+    ULONG Hash = 2166136261UL;
+
+    while (*Name)
+    {
+        Hash ^= towlower(*Name++);
+        Hash *= 16777619UL;
+    }
+
+    return Hash & (DNS_CACHE_HASH_SIZE - 1);
+}
+
+static
+BOOL
+DnsIntCacheIsExpired(PRESOLVER_CACHE_ENTRY CacheEntry, DWORD dwCurrentTime)
+{
+    return !CacheEntry->bPermanent &&
+           (LONG)(dwCurrentTime - CacheEntry->dwExpireTime) >= 0;
+}
+
 VOID
 DnsIntCacheInitialize(VOID)
 {
+    ULONG i;
+
     DPRINT("DnsIntCacheInitialize()\n");
 
     /* Check if we're initialized */
     if (DnsCacheInitialized)
         return;
 
-    /* Initialize the cache lock and namespace list */
+    /* Initialize the cache lock, the hash table and the LRU list */
     InitializeCriticalSection((LPCRITICAL_SECTION)&DnsCache.Lock);
-    InitializeListHead(&DnsCache.RecordList);
+    for (i = 0; i < DNS_CACHE_HASH_SIZE; i++)
+        InitializeListHead(&DnsCache.HashTable[i]);
+    InitializeListHead(&DnsCache.LruList);
+    DnsCache.EntryCount = 0;
+    DnsCache.NextPurgeTime = GetCurrentTimeInSeconds() + DNS_CACHE_PURGE_INTERVAL;
     DnsCacheInitialized = TRUE;
 }
 
@@ -41,53 +72,109 @@ DnsIntCacheFree(VOID)
     if (!DnsCacheInitialized)
         return;
 
-    if (!DnsCache.RecordList.Flink)
-        return;
-
-    DnsIntCacheFlush();
+    DnsIntCacheFlush(TRUE);
 
     DeleteCriticalSection(&DnsCache.Lock);
     DnsCacheInitialized = FALSE;
 }
- 
+
 VOID
 DnsIntCacheRemoveEntryItem(PRESOLVER_CACHE_ENTRY CacheEntry)
 {
     DPRINT("DnsIntCacheRemoveEntryItem(%p)\n", CacheEntry);
 
-    /* Remove the entry from the list */
+    /* Remove the entry from the lists */
     RemoveEntryList(&CacheEntry->CacheLink);
- 
+    if (!CacheEntry->bPermanent)
+    {
+        RemoveEntryList(&CacheEntry->LruLink);
+        DnsCache.EntryCount--;
+    }
+
     /* Free record */
-    DnsRecordListFree(CacheEntry->Record, DnsFreeRecordList);
+    if (CacheEntry->Record)
+        DnsRecordListFree(CacheEntry->Record, DnsFreeRecordList);
 
     /* Delete us */
     HeapFree(GetProcessHeap(), 0, CacheEntry);
 }
 
+/* Drops the expired entries, every DNS_CACHE_PURGE_INTERVAL at most.
+ * Called with the cache locked. */
+static
+VOID
+DnsIntCachePurge(DWORD dwCurrentTime)
+{
+    PLIST_ENTRY Entry;
+    PRESOLVER_CACHE_ENTRY CacheEntry;
+
+    if ((LONG)(dwCurrentTime - DnsCache.NextPurgeTime) < 0)
+        return;
+
+    DnsCache.NextPurgeTime = dwCurrentTime + DNS_CACHE_PURGE_INTERVAL;
+
+    Entry = DnsCache.LruList.Flink;
+    while (Entry != &DnsCache.LruList)
+    {
+        CacheEntry = CONTAINING_RECORD(Entry, RESOLVER_CACHE_ENTRY, LruLink);
+        Entry = Entry->Flink;
+
+        if (DnsIntCacheIsExpired(CacheEntry, dwCurrentTime))
+            DnsIntCacheRemoveEntryItem(CacheEntry);
+    }
+}
+
+/* Called with the cache locked */
+static
+PRESOLVER_CACHE_ENTRY
+DnsIntCacheFindEntry(
+    LPCWSTR Name,
+    WORD wType)
+{
+    PLIST_ENTRY Bucket, NextEntry;
+    PRESOLVER_CACHE_ENTRY CacheEntry;
+
+    Bucket = &DnsCache.HashTable[DnsIntCacheHashName(Name)];
+
+    for (NextEntry = Bucket->Flink; NextEntry != Bucket; NextEntry = NextEntry->Flink)
+    {
+        CacheEntry = CONTAINING_RECORD(NextEntry, RESOLVER_CACHE_ENTRY, CacheLink);
+
+        if (CacheEntry->wType == wType && _wcsicmp(CacheEntry->pszName, Name) == 0)
+            return CacheEntry;
+    }
+
+    return NULL;
+}
+
 VOID
-DnsIntCacheFlush(VOID)
+DnsIntCacheFlush(BOOL bFlushPermanent)
 {
     PLIST_ENTRY Entry;
     PRESOLVER_CACHE_ENTRY CacheEntry;
+    ULONG i;
 
-    DPRINT("DnsIntCacheFlush()\n");
+    DPRINT("DnsIntCacheFlush(%d)\n", bFlushPermanent);
 
     /* Lock the cache */
     DnsCacheLock();
 
     /* Loop every entry */
-    Entry = DnsCache.RecordList.Flink;
-    while (Entry != &DnsCache.RecordList)
+    for (i = 0; i < DNS_CACHE_HASH_SIZE; i++)
     {
-        /* Get this entry */
-        CacheEntry = CONTAINING_RECORD(Entry, RESOLVER_CACHE_ENTRY, CacheLink);
+        Entry = DnsCache.HashTable[i].Flink;
+        while (Entry != &DnsCache.HashTable[i])
+        {
+            /* Get this entry */
+            CacheEntry = CONTAINING_RECORD(Entry, RESOLVER_CACHE_ENTRY, CacheLink);
 
-        /* Remove it from list */
-        DnsIntCacheRemoveEntryItem(CacheEntry);
+            /* Move to the next entry */
+            Entry = Entry->Flink;
 
-        /* Move to the next entry */
-        Entry = DnsCache.RecordList.Flink;
+            /* Remove it from list, the hosts file entries only when asked to */
+            if (bFlushPermanent || !CacheEntry->bPermanent)
+                DnsIntCacheRemoveEntryItem(CacheEntry);
+        }
     }
 
     /* Unlock the cache */
@@ -101,9 +188,9 @@ DnsIntCacheGetEntryByName(
     DWORD dwFlags,
     PDNS_RECORDW *Record)
 {
-    DNS_STATUS Status = DNS_INFO_NO_RECORDS;
+    DNS_STATUS Status = DNS_CACHE_MISS;
     PRESOLVER_CACHE_ENTRY CacheEntry;
-    PLIST_ENTRY NextEntry;
+    DWORD dwCurrentTime;
 
     DPRINT("DnsIntCacheGetEntryByName(%S %hu 0x%lx %p)\n",
            Name, wType, dwFlags, Record);
@@ -111,26 +198,41 @@ DnsIntCacheGetEntryByName(
     /* Assume failure */
     *Record = NULL;
 
+    dwCurrentTime = GetCurrentTimeInSeconds();
+
     /* Lock the cache */
     DnsCacheLock();
 
-    /* Match the Id with all the entries in the List */
-    NextEntry = DnsCache.RecordList.Flink;
-    while (NextEntry != &DnsCache.RecordList)
+    DnsIntCachePurge(dwCurrentTime);
+
+    CacheEntry = DnsIntCacheFindEntry(Name, wType);
+    if (CacheEntry && DnsIntCacheIsExpired(CacheEntry, dwCurrentTime))
     {
-        /* Get the Current Entry */
-        CacheEntry = CONTAINING_RECORD(NextEntry, RESOLVER_CACHE_ENTRY, CacheLink);
+        /* Too old, it gets queried again */
+        DnsIntCacheRemoveEntryItem(CacheEntry);
+        CacheEntry = NULL;
+    }
 
-        /* Check if this is the Catalog Entry ID we want */
-        if (_wcsicmp(CacheEntry->Record->pName, Name) == 0)
+    if (CacheEntry)
+    {
+        /* Now the most recently used */
+        if (!CacheEntry->bPermanent)
+        {
+            RemoveEntryList(&CacheEntry->LruLink);
+            InsertTailList(&DnsCache.LruList, &CacheEntry->LruLink);
+        }
+
+        if (CacheEntry->Record)
         {
             /* Copy the entry and return it */
             *Record = DnsRecordSetCopyEx(CacheEntry->Record, DnsCharSetUnicode, DnsCharSetUnicode);
-            Status = ERROR_SUCCESS;
-            break;
+            Status = *Record ? ERROR_SUCCESS : ERROR_OUTOFMEMORY;
+        }
+        else
+        {
+            /* The name or the record is known not to exist */
+            Status = CacheEntry->Status;
         }
-
-        NextEntry = NextEntry->Flink;
     }
 
     /* Release the cache */
@@ -144,30 +246,28 @@ DnsIntCacheRemoveEntryByName(LPCWSTR Name)
 {
     BOOL Ret = FALSE;
     PRESOLVER_CACHE_ENTRY CacheEntry;
-    PLIST_ENTRY NextEntry;
+    PLIST_ENTRY Bucket, NextEntry;
 
     DPRINT("DnsIntCacheRemoveEntryByName(%S)\n", Name);
 
     /* Lock the cache */
     DnsCacheLock();
 
-    /* Match the Id with all the entries in the List */
-    NextEntry = DnsCache.RecordList.Flink;
-    while (NextEntry != &DnsCache.RecordList)
+    /* Every type of the name is in the same bucket */
+    Bucket = &DnsCache.HashTable[DnsIntCacheHashName(Name)];
+    NextEntry = Bucket->Flink;
+    while (NextEntry != Bucket)
     {
         /* Get the Current Entry */
         CacheEntry = CONTAINING_RECORD(NextEntry, RESOLVER_CACHE_ENTRY, CacheLink);
+        NextEntry = NextEntry->Flink;
 
-        /* Check if this is the Catalog Entry ID we want */
-        if (_wcsicmp(CacheEntry->Record->pName, Name) == 0)
+        if (_wcsicmp(CacheEntry->pszName, Name) == 0)
         {
             /* Remove the entry */
             DnsIntCacheRemoveEntryItem(CacheEntry);
             Ret = TRUE;
-            break;
         }
-
-        NextEntry = NextEntry->Flink;
     }
 
     /* Release the cache */
@@ -177,33 +277,120 @@ DnsIntCacheRemoveEntryByName(LPCWSTR Name)
     return Ret;
 }
 
+static
 VOID
-DnsIntCacheAddEntry(PDNS_RECORDW Record)
+DnsIntCacheInsertEntry(
+    LPCWSTR Name,
+    WORD wType,
+    PDNS_RECORDW Record,
+    DNS_STATUS Status,
+    DWORD dwTtl,
+    BOOL bPermanent)
 {
-    PRESOLVER_CACHE_ENTRY Entry;
+    PRESOLVER_CACHE_ENTRY Entry, OldEntry;
+    PRESOLVER_CACHE_ENTRY LruEntry;
+    SIZE_T NameSize;
+    DWORD dwCurrentTime;
+
+    /* The name is stored right behind the entry */
+    NameSize = (wcslen(Name) + 1) * sizeof(WCHAR);
+    Entry = (PRESOLVER_CACHE_ENTRY)HeapAlloc(GetProcessHeap(), 0, sizeof(*Entry) + NameSize);
+    if (!Entry)
+        return;
+
+    Entry->pszName = (PWSTR)(Entry + 1);
+    CopyMemory(Entry->pszName, Name, NameSize);
+    Entry->wType = wType;
+    Entry->bPermanent = bPermanent;
+    Entry->Status = Status;
+    Entry->Record = NULL;
 
-    DPRINT("DnsIntCacheAddEntry(%p)\n", Record);
+    if (Record)
+    {
+        Entry->Record = DnsRecordSetCopyEx(Record, DnsCharSetUnicode, DnsCharSetUnicode);
+        if (!Entry->Record)
+        {
+            HeapFree(GetProcessHeap(), 0, Entry);
+            return;
+        }
+    }
 
-    DPRINT("Name: %S\n", Record->pName);
-    DPRINT("TTL: %lu\n", Record->dwTtl);
+    dwCurrentTime = GetCurrentTimeInSeconds();
+    Entry->dwExpireTime = dwCurrentTime + min(dwTtl, DNS_CACHE_MAX_TTL);
 
     /* Lock the cache */
     DnsCacheLock();
 
-    /* Match the Id with all the entries in the List */
-    Entry = (PRESOLVER_CACHE_ENTRY)HeapAlloc(GetProcessHeap(), 0, sizeof(*Entry));
-    if (!Entry)
+    DnsIntCachePurge(dwCurrentTime);
+
+    /* A newer answer replaces the old one, but the hosts file has the
+     * final say and its first line for a name wins */
+    OldEntry = DnsIntCacheFindEntry(Name, wType);
+    if (OldEntry && OldEntry->bPermanent)
+    {
+        DnsCacheUnlock();
+        if (Entry->Record)
+            DnsRecordListFree(Entry->Record, DnsFreeRecordList);
+        HeapFree(GetProcessHeap(), 0, Entry);
         return;
+    }
+    if (OldEntry)
+        DnsIntCacheRemoveEntryItem(OldEntry);
 
-    Entry->Record = DnsRecordSetCopyEx(Record, DnsCharSetUnicode, DnsCharSetUnicode);
+    /* Insert it to our lists */
+    InsertTailList(&DnsCache.HashTable[DnsIntCacheHashName(Name)], &Entry->CacheLink);
+    if (!bPermanent)
+    {
+        InsertTailList(&DnsCache.LruList, &Entry->LruLink);
+        DnsCache.EntryCount++;
 
-    /* Insert it to our List */
-    InsertTailList(&DnsCache.RecordList, &Entry->CacheLink);
+        /* Make room by dropping the least recently used ones */
+        while (DnsCache.EntryCount > DNS_CACHE_MAX_ENTRIES)
+        {
+            LruEntry = CONTAINING_RECORD(DnsCache.LruList.Flink, RESOLVER_CACHE_ENTRY, LruLink);
+            DnsIntCacheRemoveEntryItem(LruEntry);
+        }
+    }
 
     /* Release the cache */
     DnsCacheUnlock();
 }
 
+VOID
+DnsIntCacheAddEntry(
+    LPCWSTR Name,
+    WORD wType,
+    PDNS_RECORDW Record,
+    BOOL bPermanent)
+{
+    PDNS_RECORDW CurrentRecord;
+    DWORD dwTtl = DNS_CACHE_MAX_TTL;
+
+    DPRINT("DnsIntCacheAddEntry(%S %hu %p %d)\n", Name, wType, Record, bPermanent);
+
+    /* The set lives as long as its shortest lived record */
+    for (CurrentRecord = Record; CurrentRecord; CurrentRecord = CurrentRecord->pNext)
+        dwTtl = min(dwTtl, CurrentRecord->dwTtl);
+
+    DPRINT("TTL: %lu\n", dwTtl);
+
+    if (dwTtl == 0 && !bPermanent)
+        return;
+
+    DnsIntCacheInsertEntry(Name, wType, Record, ERROR_SUCCESS, dwTtl, bPermanent);
+}
+
+VOID
+DnsIntCacheAddNegativeEntry(
+    LPCWSTR Name,
+    WORD wType,
+    DNS_STATUS Status)
+{
+    DPRINT("DnsIntCacheAddNegativeEntry(%S %hu %lu)\n", Name, wType, Status);
+
+    DnsIntCacheInsertEntry(Name, wType, NULL, Status, DNS_CACHE_NEGATIVE_TTL, FALSE);
+}
+
 DNS_STATUS
 DnsIntCacheGetEntries(
     _Out_ DNS_CACHE_ENTRY **ppCacheEntries)
@@ -211,52 +398,62 @@ DnsIntCacheGetEntries(
     PRESOLVER_CACHE_ENTRY CacheEntry;
     PLIST_ENTRY NextEntry;
     PDNS_CACHE_ENTRY pLastEntry = NULL, pNewEntry;
+    DNS_STATUS Status = ERROR_SUCCESS;
+    DWORD dwCurrentTime;
+    ULONG i;
+
+    dwCurrentTime = GetCurrentTimeInSeconds();
 
     /* Lock the cache */
     DnsCacheLock();
 
     *ppCacheEntries = NULL;
 
-    NextEntry = DnsCache.RecordList.Flink;
-    while (NextEntry != &DnsCache.RecordList)
+    for (i = 0; i < DNS_CACHE_HASH_SIZE && Status == ERROR_SUCCESS; i++)
     {
-        /* Get the Current Entry */
-        CacheEntry = CONTAINING_RECORD(NextEntry, RESOLVER_CACHE_ENTRY, CacheLink);
-
-        DPRINT("1 %S %lu\n", CacheEntry->Record->pName, CacheEntry->Record->wType);
-        if (CacheEntry->Record->pNext)
-        {
-            DPRINT("2 %S %lu\n", CacheEntry->Record->pNext->pName, CacheEntry->Record->pNext->wType);
-        }
-
-        pNewEntry = midl_user_allocate(sizeof(DNS_CACHE_ENTRY));
-        if (pNewEntry == NULL)
-        {
-            return ERROR_OUTOFMEMORY;
-        }
-
-        pNewEntry->pszName = midl_user_allocate((wcslen(CacheEntry->Record->pName) + 1) * sizeof(WCHAR));
-        if (pNewEntry->pszName == NULL)
+        for (NextEntry = DnsCache.HashTable[i].Flink;
+             NextEntry != &DnsCache.HashTable[i];
+             NextEntry = NextEntry->Flink)
         {
-            return ERROR_OUTOFMEMORY;
+            /* Get the Current Entry */
+            CacheEntry = CONTAINING_RECORD(NextEntry, RESOLVER_CACHE_ENTRY, CacheLink);
+
+            /* Don't show what would not be returned any more */
+            if (DnsIntCacheIsExpired(CacheEntry, dwCurrentTime))
+                continue;
+
+            DPRINT("%S %hu\n", CacheEntry->pszName, CacheEntry->wType);
+
+            pNewEntry = midl_user_allocate(sizeof(DNS_CACHE_ENTRY));
+            if (pNewEntry == NULL)
+            {
+                Status = ERROR_OUTOFMEMORY;
+                break;
+            }
+
+            pNewEntry->pszName = midl_user_allocate((wcslen(CacheEntry->pszName) + 1) * sizeof(WCHAR));
+            if (pNewEntry->pszName == NULL)
+            {
+                midl_user_free(pNewEntry);
+                Status = ERROR_OUTOFMEMORY;
+                break;
+            }
+
+            wcscpy(pNewEntry->pszName, CacheEntry->pszName);
+            pNewEntry->wType1 = CacheEntry->wType;
+            pNewEntry->wType2 = 0;
+            pNewEntry->wFlags = 0;
+
+            if (pLastEntry == NULL)
+                *ppCacheEntries = pNewEntry;
+            else
+                pLastEntry->pNext = pNewEntry;
+            pLastEntry = pNewEntry;
         }
-
-        wcscpy(pNewEntry->pszName, CacheEntry->Record->pName);
-        pNewEntry->wType1 = CacheEntry->Record->wType;
-        pNewEntry->wType2 = 0;
-        pNewEntry->wFlags = 0;
-
-        if (pLastEntry == NULL)
-            *ppCacheEntries = pNewEntry;
-        else
-            pLastEntry->pNext = pNewEntry;
-        pLastEntry = pNewEntry;
-
-        NextEntry = NextEntry->Flink;
     }
 
     /* Release the cache */
     DnsCacheUnlock();
 
-    return ERROR_SUCCESS;
+    return Status;
 }
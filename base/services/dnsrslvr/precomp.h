@@ -3,6 +3,7 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <wchar.h>
 
 #define WIN32_NO_STATUS
 #define _INC_WINDOWS
@@ -24,15 +25,34 @@
 
 #include <strsafe.h>
 
+#define DNS_CACHE_HASH_SIZE         1024    /* Buckets, a power of two */
+#define DNS_CACHE_MAX_ENTRIES       4096    /* Not counting the hosts file */
+#define DNS_CACHE_MAX_TTL           86400   /* Seconds */
+#define DNS_CACHE_NEGATIVE_TTL      300     /* Seconds */
+#define DNS_CACHE_PURGE_INTERVAL    60      /* Seconds */
+
+/* DnsIntCacheGetEntryByName result for a name that is not cached. Unlike
+ * DNS_INFO_NO_RECORDS, it can't be the answer of a negative entry. */
+#define DNS_CACHE_MISS              ERROR_NOT_FOUND
+
 typedef struct _RESOLVER_CACHE_ENTRY
 {
-    LIST_ENTRY CacheLink;
+    LIST_ENTRY CacheLink;       /* Hash bucket */
+    LIST_ENTRY LruLink;         /* Not used for permanent entries */
+    PWSTR pszName;
+    WORD wType;
+    BOOL bPermanent;            /* From the hosts file, never expires */
+    DWORD dwExpireTime;         /* In seconds, see GetCurrentTimeInSeconds */
+    DNS_STATUS Status;          /* Negative answer when there is no record */
     PDNS_RECORDW Record;
 } RESOLVER_CACHE_ENTRY, *PRESOLVER_CACHE_ENTRY;
 
 typedef struct _RESOLVER_CACHE
 {
-    LIST_ENTRY RecordList;
+    LIST_ENTRY HashTable[DNS_CACHE_HASH_SIZE];
+    LIST_ENTRY LruList;         /* Least recently used first */
+    ULONG EntryCount;           /* Entries on the LRU list */
+    DWORD NextPurgeTime;
     CRITICAL_SECTION Lock;
 } RESOLVER_CACHE, *PRESOLVER_CACHE;
 
@@ -42,7 +62,7 @@ typedef struct _RESOLVER_CACHE
 VOID DnsIntCacheInitialize(VOID);
 VOID DnsIntCacheRemoveEntryItem(PRESOLVER_CACHE_ENTRY CacheEntry);
 VOID DnsIntCacheFree(VOID);
-VOID DnsIntCacheFlush(VOID);
+VOID DnsIntCacheFlush(BOOL bFlushPermanent);
 
 DNS_STATUS
 DnsIntCacheGetEntryByName(
@@ -51,7 +71,19 @@ DnsIntCacheGetEntryByName(
     DWORD dwFlags,
     PDNS_RECORDW *Record);
 
-VOID DnsIntCacheAddEntry(PDNS_RECORDW Record);
+VOID
+DnsIntCacheAddEntry(
+    LPCWSTR Name,
+    WORD wType,
+    PDNS_RECORDW Record,
+    BOOL bPermanent);
+
+VOID
+DnsIntCacheAddNegativeEntry(
+    LPCWSTR Name,
+    WORD wType,
+    DNS_STATUS Status);
+
 BOOL DnsIntCacheRemoveEntryByName(LPCWSTR Name);
 
 DNS_STATUS
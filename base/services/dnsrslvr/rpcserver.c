@@ -65,7 +65,7 @@ R_ResolverFlushCache(
     DPRINT("R_ResolverFlushCache()\n");
 
     // FIXME Should store (and flush) entries by server handle
-    DnsIntCacheFlush();
+    DnsIntCacheFlush(FALSE);
     return ERROR_SUCCESS;
 }
 
@@ -108,6 +108,8 @@ R_ResolverQuery(
                                            wType,
                                            dwFlags,
                                            ppResultRecords);
+        if (Status == DNS_CACHE_MISS)
+            Status = DNS_INFO_NO_RECORDS;
     }
     else
     {
@@ -116,7 +118,7 @@ R_ResolverQuery(
                                            wType,
                                            dwFlags,
                                            ppResultRecords);
-        if (Status == DNS_INFO_NO_RECORDS)
+        if (Status == DNS_CACHE_MISS)
         {
             DPRINT("DNS query!\n");
             Status = Query_Main(pszName,
@@ -126,7 +128,14 @@ R_ResolverQuery(
             if (Status == ERROR_SUCCESS)
             {
                 DPRINT("DNS query successful!\n");
-                DnsIntCacheAddEntry(*ppResultRecords);
+                DnsIntCacheAddEntry(pszName, wType, *ppResultRecords, FALSE);
+            }
+            else if (Status == DNS_ERROR_RCODE_NAME_ERROR ||
+                     Status == DNS_INFO_NO_RECORDS)
+            {
+                /* The server said there is no such name or record,
+                 * remember it for a while. Other failures may not last. */
+                DnsIntCacheAddNegativeEntry(pszName, wType, Status);
             }
         }
     }
@@ -56,4 +56,15 @@
 @ cdecl mbedtls_sha512_starts(ptr long)
 @ cdecl mbedtls_sha512_update(ptr ptr long)
 @ cdecl mbedtls_sha512_finish(ptr ptr)
-@ cdecl mbedtls_sha512_free(ptr)
\ No newline at end of file
+@ cdecl mbedtls_sha512_free(ptr)
+@ cdecl mbedtls_aes_init(ptr)
+@ cdecl mbedtls_aes_setkey_enc(ptr ptr long)
+@ cdecl mbedtls_aes_setkey_dec(ptr ptr long)
+@ cdecl mbedtls_aes_crypt_ecb(ptr long ptr ptr)
+@ cdecl mbedtls_aes_crypt_cbc(ptr long long ptr ptr ptr)
+@ cdecl mbedtls_aes_free(ptr)
+@ cdecl mbedtls_gcm_init(ptr)
+@ cdecl mbedtls_gcm_setkey(ptr long ptr long)
+@ cdecl mbedtls_gcm_crypt_and_tag(ptr long long ptr long ptr long ptr ptr long ptr)
+@ cdecl mbedtls_gcm_auth_decrypt(ptr long ptr long ptr long ptr long ptr ptr)
+@ cdecl mbedtls_gcm_free(ptr)
@@ -330,6 +330,7 @@
 330 stdcall NtReleaseMutant(long ptr)
 331 stdcall NtReleaseSemaphore(long long ptr)
 332 stdcall NtRemoveIoCompletion(ptr ptr ptr ptr ptr)
+@ stdcall NtRemoveIoCompletionEx(ptr ptr long ptr ptr long)
 333 stdcall NtRemoveProcessDebug(ptr ptr)
 334 stdcall NtRenameKey(ptr ptr)
 335 stdcall NtReplaceKey(ptr long ptr)
@@ -919,6 +920,7 @@
 913 stdcall RtlUnicodeToMultiByteN(ptr long ptr ptr long)
 914 stdcall RtlUnicodeToMultiByteSize(ptr ptr long)
 915 stdcall RtlUnicodeToOemN(ptr long ptr ptr long)
+@ stdcall RtlUnicodeToUTF8N(ptr long ptr ptr long)
 916 stdcall RtlUniform(ptr)
 917 stdcall RtlUnlockBootStatusData(ptr)
 918 stdcall RtlUnlockHeap(long)
@@ -937,6 +939,7 @@
 930 stdcall RtlUpperChar(long)
 931 stdcall RtlUpperString(ptr ptr)
 932 stdcall RtlUsageHeap(ptr long ptr)
+@ stdcall RtlUTF8ToUnicodeN(ptr long ptr ptr long)
 933 stdcall RtlValidAcl(ptr)
 934 stdcall RtlValidRelativeSecurityDescriptor(ptr long long)
 935 stdcall RtlValidSecurityDescriptor(ptr)
@@ -1175,6 +1178,7 @@
 1167 stdcall ZwReleaseMutant(long ptr) NtReleaseMutant
 1168 stdcall ZwReleaseSemaphore(long long ptr) NtReleaseSemaphore
 1169 stdcall ZwRemoveIoCompletion(ptr ptr ptr ptr ptr) NtRemoveIoCompletion
+@ stdcall ZwRemoveIoCompletionEx(ptr ptr long ptr ptr long) NtRemoveIoCompletionEx
 1170 stdcall ZwRemoveProcessDebug(ptr ptr) NtRemoveProcessDebug
 1171 stdcall ZwRenameKey(ptr ptr) NtRenameKey
 1172 stdcall ZwReplaceKey(ptr long ptr) NtReplaceKey
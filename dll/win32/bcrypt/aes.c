@@ -0,0 +1,232 @@
+/*
+ * PROJECT:     ReactOS bcrypt
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     AES in ECB, CBC and GCM modes
+ *
+ * The AES-NI kernels are used when the CPU has them, mbedtls otherwise.
+ * GCM runs on top of the counter mode and GHASH kernels in the first case.
+ */
+
+#include <ntstatus.h>
+#define WIN32_NO_STATUS
+#include <windef.h>
+#include <winbase.h>
+#include <string.h>
+
+#include "bcrypt_internal.h"
+
+#ifdef BCRYPT_HAVE_AESNI
+#include <intrin.h>
+
+/* 0 not checked yet, 1 no AES-NI, 2 AES-NI */
+static LONG aesni_state;
+
+static BOOL aesni_available(void)
+{
+    int regs[4];
+    LONG state = aesni_state;
+
+    if (!state)
+    {
+        /* AES-NI is ECX bit 25 of leaf 1, PCLMULQDQ bit 1, SSSE3 bit 9 */
+        __cpuid( regs, 0 );
+        state = 1;
+        if (regs[0] >= 1)
+        {
+            __cpuid( regs, 1 );
+            if ((regs[2] & (1 << 25)) && (regs[2] & (1 << 1)) && (regs[2] & (1 << 9)))
+                state = 2;
+        }
+        aesni_state = state;
+    }
+    return state == 2;
+}
+#endif
+
+NTSTATUS aes_key_init( struct aes_key *key, const UCHAR *secret, ULONG size )
+{
+    if (size != 16 && size != 24 && size != 32) return STATUS_INVALID_PARAMETER;
+
+    mbedtls_aes_init( &key->enc );
+    mbedtls_aes_init( &key->dec );
+    mbedtls_gcm_init( &key->gcm );
+    if (mbedtls_aes_setkey_enc( &key->enc, secret, size * 8 ) ||
+        mbedtls_aes_setkey_dec( &key->dec, secret, size * 8 ) ||
+        mbedtls_gcm_setkey( &key->gcm, MBEDTLS_CIPHER_ID_AES, secret, size * 8 ))
+    {
+        aes_key_free( key );
+        return STATUS_INTERNAL_ERROR;
+    }
+
+    key->hw = FALSE;
+    key->rounds = key->enc.nr;
+#ifdef BCRYPT_HAVE_AESNI
+    if (aesni_available())
+    {
+        memcpy( key->enc_rk, key->enc.rk, (key->rounds + 1) * AES_BLOCK_SIZE );
+        memcpy( key->dec_rk, key->dec.rk, (key->rounds + 1) * AES_BLOCK_SIZE );
+        aesni_init_ghash( key );
+        key->hw = TRUE;
+    }
+#endif
+    return STATUS_SUCCESS;
+}
+
+void aes_key_free( struct aes_key *key )
+{
+    mbedtls_aes_free( &key->enc );
+    mbedtls_aes_free( &key->dec );
+    mbedtls_gcm_free( &key->gcm );
+    SecureZeroMemory( key->enc_rk, sizeof(key->enc_rk) );
+    SecureZeroMemory( key->dec_rk, sizeof(key->dec_rk) );
+    SecureZeroMemory( key->ghash_h, sizeof(key->ghash_h) );
+}
+
+/* The sizes below are multiples of the block size, the caller checked */
+
+void aes_encrypt_ecb( struct aes_key *key, const UCHAR *input, UCHAR *output, ULONG size )
+{
+#ifdef BCRYPT_HAVE_AESNI
+    if (key->hw)
+    {
+        aesni_encrypt_ecb( key, input, output, size / AES_BLOCK_SIZE );
+        return;
+    }
+#endif
+    for (; size; size -= AES_BLOCK_SIZE)
+    {
+        mbedtls_aes_crypt_ecb( &key->enc, MBEDTLS_AES_ENCRYPT, input, output );
+        input += AES_BLOCK_SIZE;
+        output += AES_BLOCK_SIZE;
+    }
+}
+
+void aes_decrypt_ecb( struct aes_key *key, const UCHAR *input, UCHAR *output, ULONG size )
+{
+#ifdef BCRYPT_HAVE_AESNI
+    if (key->hw)
+    {
+        aesni_decrypt_ecb( key, input, output, size / AES_BLOCK_SIZE );
+        return;
+    }
+#endif
+    for (; size; size -= AES_BLOCK_SIZE)
+    {
+        mbedtls_aes_crypt_ecb( &key->dec, MBEDTLS_AES_DECRYPT, input, output );
+        input += AES_BLOCK_SIZE;
+        output += AES_BLOCK_SIZE;
+    }
+}
+
+void aes_encrypt_cbc( struct aes_key *key, UCHAR *iv, const UCHAR *input, UCHAR *output, ULONG size )
+{
+#ifdef BCRYPT_HAVE_AESNI
+    if (key->hw)
+    {
+        aesni_encrypt_cbc( key, iv, input, output, size / AES_BLOCK_SIZE );
+        return;
+    }
+#endif
+    mbedtls_aes_crypt_cbc( &key->enc, MBEDTLS_AES_ENCRYPT, size, iv, input, output );
+}
+
+void aes_decrypt_cbc( struct aes_key *key, UCHAR *iv, const UCHAR *input, UCHAR *output, ULONG size )
+{
+#ifdef BCRYPT_HAVE_AESNI
+    if (key->hw)
+    {
+        aesni_decrypt_cbc( key, iv, input, output, size / AES_BLOCK_SIZE );
+        return;
+    }
+#endif
+    mbedtls_aes_crypt_cbc( &key->dec, MBEDTLS_AES_DECRYPT, size, iv, input, output );
+}
+
+#ifdef BCRYPT_HAVE_AESNI
+/*
+ * Computes the GCM tag over the authenticated data and the ciphertext and
+ * returns the counter block the payload starts at.
+ */
+static void gcm_tag_hw( struct aes_key *key, const UCHAR *nonce, const UCHAR *auth, ULONG auth_size,
+                        const UCHAR *cipher, ULONG size, UCHAR *counter, UCHAR *tag )
+{
+    UCHAR state[AES_BLOCK_SIZE], lengths[AES_BLOCK_SIZE], ek0[AES_BLOCK_SIZE];
+    ULONGLONG bits;
+    int i;
+
+    /* J0 is the nonce followed by a counter of 1 */
+    memcpy( counter, nonce, GCM_NONCE_SIZE );
+    counter[12] = counter[13] = counter[14] = 0;
+    counter[15] = 1;
+    aesni_encrypt_ecb( key, counter, ek0, 1 );
+    counter[15] = 2;
+
+    memset( state, 0, sizeof(state) );
+    aesni_ghash( key, state, auth, auth_size );
+    aesni_ghash( key, state, cipher, size );
+
+    /* Both lengths in bits, big endian */
+    bits = (ULONGLONG)auth_size * 8;
+    for (i = 7; i >= 0; i--, bits >>= 8) lengths[i] = (UCHAR)bits;
+    bits = (ULONGLONG)size * 8;
+    for (i = 15; i >= 8; i--, bits >>= 8) lengths[i] = (UCHAR)bits;
+    aesni_ghash( key, state, lengths, sizeof(lengths) );
+
+    for (i = 0; i < AES_BLOCK_SIZE; i++) tag[i] = state[i] ^ ek0[i];
+}
+#endif
+
+NTSTATUS aes_encrypt_gcm( struct aes_key *key, const UCHAR *nonce, const UCHAR *auth, ULONG auth_size,
+                          const UCHAR *input, UCHAR *output, ULONG size, UCHAR *tag, ULONG tag_size )
+{
+#ifdef BCRYPT_HAVE_AESNI
+    UCHAR counter[AES_BLOCK_SIZE], full_tag[AES_BLOCK_SIZE];
+
+    if (key->hw)
+    {
+        /* J0 + 1 onwards encrypts the payload, the tag covers the result */
+        memcpy( counter, nonce, GCM_NONCE_SIZE );
+        counter[12] = counter[13] = counter[14] = 0;
+        counter[15] = 2;
+        aesni_crypt_ctr32( key, counter, input, output, size );
+
+        gcm_tag_hw( key, nonce, auth, auth_size, output, size, counter, full_tag );
+        memcpy( tag, full_tag, tag_size );
+        return STATUS_SUCCESS;
+    }
+#endif
+    if (mbedtls_gcm_crypt_and_tag( &key->gcm, MBEDTLS_GCM_ENCRYPT, size, nonce, GCM_NONCE_SIZE,
+                                   auth, auth_size, input, output, tag_size, tag ))
+        return STATUS_INTERNAL_ERROR;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS aes_decrypt_gcm( struct aes_key *key, const UCHAR *nonce, const UCHAR *auth, ULONG auth_size,
+                          const UCHAR *input, UCHAR *output, ULONG size, const UCHAR *tag, ULONG tag_size )
+{
+#ifdef BCRYPT_HAVE_AESNI
+    UCHAR counter[AES_BLOCK_SIZE], full_tag[AES_BLOCK_SIZE], diff = 0;
+    ULONG i;
+
+    if (key->hw)
+    {
+        /* Check the tag before anything gets decrypted */
+        gcm_tag_hw( key, nonce, auth, auth_size, input, size, counter, full_tag );
+        for (i = 0; i < tag_size; i++) diff |= full_tag[i] ^ tag[i];
+        if (diff) return STATUS_AUTH_TAG_MISMATCH;
+
+        aesni_crypt_ctr32( key, counter, input, output, size );
+        return STATUS_SUCCESS;
+    }
+#endif
+    switch (mbedtls_gcm_auth_decrypt( &key->gcm, size, nonce, GCM_NONCE_SIZE, auth, auth_size,
+                                      tag, tag_size, input, output ))
+    {
+    case 0:
+        return STATUS_SUCCESS;
+    case MBEDTLS_ERR_GCM_AUTH_FAILED:
+        return STATUS_AUTH_TAG_MISMATCH;
+    default:
+        return STATUS_INTERNAL_ERROR;
+    }
+}
@@ -0,0 +1,388 @@
+/*
+ * PROJECT:     ReactOS bcrypt
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     AES-NI and PCLMULQDQ kernels for AES and GHASH
+ *
+ * Everything in here needs AES-NI, PCLMULQDQ and SSSE3; aes.c checks for
+ * them before calling in. The round keys are the ones mbedtls expanded, which
+ * are laid out the way AESENC and AESDEC want them.
+ */
+
+#include <windef.h>
+#include <string.h>
+
+#include "bcrypt_internal.h"
+
+#if defined(__GNUC__)
+
+/* The vector builtins keep us away from the SSE headers */
+typedef long long v128 __attribute__((__vector_size__(16), __may_alias__));
+typedef int v4si_t __attribute__((__vector_size__(16)));
+typedef char v16qi_t __attribute__((__vector_size__(16)));
+
+static inline v128 load128( const void *p ) { v128 v; memcpy( &v, p, sizeof(v) ); return v; }
+static inline void store128( void *p, v128 v ) { memcpy( p, &v, sizeof(v) ); }
+
+#define xor128(a, b)        ((a) ^ (b))
+#define or128(a, b)         ((a) | (b))
+#define zero128()           ((v128){ 0, 0 })
+#define aesenc(a, k)        __builtin_ia32_aesenc128( (a), (k) )
+#define aesenclast(a, k)    __builtin_ia32_aesenclast128( (a), (k) )
+#define aesdec(a, k)        __builtin_ia32_aesdec128( (a), (k) )
+#define aesdeclast(a, k)    __builtin_ia32_aesdeclast128( (a), (k) )
+#define clmul(a, b, i)      __builtin_ia32_pclmulqdq128( (a), (b), (i) )
+#define shl32(a, n)         ((v128)__builtin_ia32_pslldi128( (v4si_t)(a), (n) ))
+#define shr32(a, n)         ((v128)__builtin_ia32_psrldi128( (v4si_t)(a), (n) ))
+#define shl128(a, n)        __builtin_ia32_pslldqi128( (a), (n) * 8 )
+#define shr128(a, n)        __builtin_ia32_psrldqi128( (a), (n) * 8 )
+#define add32(a, b)         ((v128)((v4si_t)(a) + (v4si_t)(b)))
+#define bswap128(a)         ((v128)__builtin_ia32_pshufb128( (v16qi_t)(a), \
+                                (v16qi_t){ 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 } ))
+#define one32()             ((v128)(v4si_t){ 1, 0, 0, 0 })
+
+#else /* _MSC_VER */
+
+#include <emmintrin.h>
+
+extern __m128i _mm_loadu_si128(__m128i const *);
+extern void _mm_storeu_si128(__m128i *, __m128i);
+extern __m128i _mm_xor_si128(__m128i, __m128i);
+extern __m128i _mm_or_si128(__m128i, __m128i);
+extern __m128i _mm_add_epi32(__m128i, __m128i);
+extern __m128i _mm_slli_epi32(__m128i, int);
+extern __m128i _mm_srli_epi32(__m128i, int);
+extern __m128i _mm_slli_si128(__m128i, int);
+extern __m128i _mm_srli_si128(__m128i, int);
+extern __m128i _mm_set_epi32(int, int, int, int);
+extern __m128i _mm_set_epi8(char, char, char, char, char, char, char, char,
+                            char, char, char, char, char, char, char, char);
+extern __m128i _mm_shuffle_epi8(__m128i, __m128i);
+extern __m128i _mm_aesenc_si128(__m128i, __m128i);
+extern __m128i _mm_aesenclast_si128(__m128i, __m128i);
+extern __m128i _mm_aesdec_si128(__m128i, __m128i);
+extern __m128i _mm_aesdeclast_si128(__m128i, __m128i);
+extern __m128i _mm_clmulepi64_si128(__m128i, __m128i, const int);
+
+typedef __m128i v128;
+
+#define load128(p)          _mm_loadu_si128( (const __m128i *)(p) )
+#define store128(p, v)      _mm_storeu_si128( (__m128i *)(p), (v) )
+#define xor128(a, b)        _mm_xor_si128( (a), (b) )
+#define or128(a, b)         _mm_or_si128( (a), (b) )
+#define zero128()           _mm_setzero_si128()
+#define aesenc(a, k)        _mm_aesenc_si128( (a), (k) )
+#define aesenclast(a, k)    _mm_aesenclast_si128( (a), (k) )
+#define aesdec(a, k)        _mm_aesdec_si128( (a), (k) )
+#define aesdeclast(a, k)    _mm_aesdeclast_si128( (a), (k) )
+#define clmul(a, b, i)      _mm_clmulepi64_si128( (a), (b), (i) )
+#define shl32(a, n)         _mm_slli_epi32( (a), (n) )
+#define shr32(a, n)         _mm_srli_epi32( (a), (n) )
+#define shl128(a, n)        _mm_slli_si128( (a), (n) )
+#define shr128(a, n)        _mm_srli_si128( (a), (n) )
+#define add32(a, b)         _mm_add_epi32( (a), (b) )
+#define bswap128(a)         _mm_shuffle_epi8( (a), _mm_set_epi8( 0, 1, 2, 3, 4, 5, 6, 7, \
+                                                                 8, 9, 10, 11, 12, 13, 14, 15 ) )
+#define one32()             _mm_set_epi32( 0, 0, 0, 1 )
+
+#endif
+
+/* Independent blocks in flight to hide the AESENC latency, as registers allow */
+#if defined(__x86_64__) || defined(_M_AMD64)
+#define AESNI_LANES 8
+#else
+#define AESNI_LANES 4
+#endif
+
+static inline void load_round_keys( const UCHAR *rk, ULONG rounds, v128 *k )
+{
+    ULONG i;
+
+    for (i = 0; i <= rounds; i++) k[i] = load128( rk + i * AES_BLOCK_SIZE );
+}
+
+static inline v128 encrypt_block( const v128 *k, ULONG rounds, v128 b )
+{
+    ULONG i;
+
+    b = xor128( b, k[0] );
+    for (i = 1; i < rounds; i++) b = aesenc( b, k[i] );
+    return aesenclast( b, k[rounds] );
+}
+
+static inline v128 decrypt_block( const v128 *k, ULONG rounds, v128 b )
+{
+    ULONG i;
+
+    b = xor128( b, k[0] );
+    for (i = 1; i < rounds; i++) b = aesdec( b, k[i] );
+    return aesdeclast( b, k[rounds] );
+}
+
+static inline void encrypt_lanes( const v128 *k, ULONG rounds, v128 *b )
+{
+    ULONG i, j;
+
+    for (j = 0; j < AESNI_LANES; j++) b[j] = xor128( b[j], k[0] );
+    for (i = 1; i < rounds; i++)
+        for (j = 0; j < AESNI_LANES; j++) b[j] = aesenc( b[j], k[i] );
+    for (j = 0; j < AESNI_LANES; j++) b[j] = aesenclast( b[j], k[rounds] );
+}
+
+static inline void decrypt_lanes( const v128 *k, ULONG rounds, v128 *b )
+{
+    ULONG i, j;
+
+    for (j = 0; j < AESNI_LANES; j++) b[j] = xor128( b[j], k[0] );
+    for (i = 1; i < rounds; i++)
+        for (j = 0; j < AESNI_LANES; j++) b[j] = aesdec( b[j], k[i] );
+    for (j = 0; j < AESNI_LANES; j++) b[j] = aesdeclast( b[j], k[rounds] );
+}
+
+void aesni_encrypt_ecb( const struct aes_key *key, const UCHAR *input, UCHAR *output, ULONG blocks )
+{
+    v128 k[AES_MAX_ROUNDS + 1], b[AESNI_LANES];
+    ULONG j;
+
+    load_round_keys( key->enc_rk, key->rounds, k );
+
+    for (; blocks >= AESNI_LANES; blocks -= AESNI_LANES)
+    {
+        for (j = 0; j < AESNI_LANES; j++) b[j] = load128( input + j * AES_BLOCK_SIZE );
+        encrypt_lanes( k, key->rounds, b );
+        for (j = 0; j < AESNI_LANES; j++) store128( output + j * AES_BLOCK_SIZE, b[j] );
+        input += AESNI_LANES * AES_BLOCK_SIZE;
+        output += AESNI_LANES * AES_BLOCK_SIZE;
+    }
+
+    for (; blocks; blocks--)
+    {
+        store128( output, encrypt_block( k, key->rounds, load128( input ) ) );
+        input += AES_BLOCK_SIZE;
+        output += AES_BLOCK_SIZE;
+    }
+}
+
+void aesni_decrypt_ecb( const struct aes_key *key, const UCHAR *input, UCHAR *output, ULONG blocks )
+{
+    v128 k[AES_MAX_ROUNDS + 1], b[AESNI_LANES];
+    ULONG j;
+
+    load_round_keys( key->dec_rk, key->rounds, k );
+
+    for (; blocks >= AESNI_LANES; blocks -= AESNI_LANES)
+    {
+        for (j = 0; j < AESNI_LANES; j++) b[j] = load128( input + j * AES_BLOCK_SIZE );
+        decrypt_lanes( k, key->rounds, b );
+        for (j = 0; j < AESNI_LANES; j++) store128( output + j * AES_BLOCK_SIZE, b[j] );
+        input += AESNI_LANES * AES_BLOCK_SIZE;
+        output += AESNI_LANES * AES_BLOCK_SIZE;
+    }
+
+    for (; blocks; blocks--)
+    {
+        store128( output, decrypt_block( k, key->rounds, load128( input ) ) );
+        input += AES_BLOCK_SIZE;
+        output += AES_BLOCK_SIZE;
+    }
+}
+
+void aesni_encrypt_cbc( const struct aes_key *key, UCHAR *iv, const UCHAR *input, UCHAR *output, ULONG blocks )
+{
+    v128 k[AES_MAX_ROUNDS + 1], c;
+
+    load_round_keys( key->enc_rk, key->rounds, k );
+
+    /* Each block depends on the previous one, nothing to interleave */
+    c = load128( iv );
+    for (; blocks; blocks--)
+    {
+        c = encrypt_block( k, key->rounds, xor128( c, load128( input ) ) );
+        store128( output, c );
+        input += AES_BLOCK_SIZE;
+        output += AES_BLOCK_SIZE;
+    }
+    store128( iv, c );
+}
+
+void aesni_decrypt_cbc( const struct aes_key *key, UCHAR *iv, const UCHAR *input, UCHAR *output, ULONG blocks )
+{
+    v128 k[AES_MAX_ROUNDS + 1], b[AESNI_LANES], c[AESNI_LANES], prev;
+    ULONG j;
+
+    load_round_keys( key->dec_rk, key->rounds, k );
+
+    /* Decryption has no such dependency; input and output may overlap, so load first */
+    prev = load128( iv );
+    for (; blocks >= AESNI_LANES; blocks -= AESNI_LANES)
+    {
+        for (j = 0; j < AESNI_LANES; j++) b[j] = c[j] = load128( input + j * AES_BLOCK_SIZE );
+        decrypt_lanes( k, key->rounds, b );
+        store128( output, xor128( b[0], prev ) );
+        for (j = 1; j < AESNI_LANES; j++) store128( output + j * AES_BLOCK_SIZE, xor128( b[j], c[j - 1] ) );
+        prev = c[AESNI_LANES - 1];
+        input += AESNI_LANES * AES_BLOCK_SIZE;
+        output += AESNI_LANES * AES_BLOCK_SIZE;
+    }
+
+    for (; blocks; blocks--)
+    {
+        c[0] = load128( input );
+        store128( output, xor128( decrypt_block( k, key->rounds, c[0] ), prev ) );
+        prev = c[0];
+        input += AES_BLOCK_SIZE;
+        output += AES_BLOCK_SIZE;
+    }
+    store128( iv, prev );
+}
+
+/*
+ * Counter mode with the 32-bit big endian increment of GCM. The counter is
+ * kept byte reversed so that its low word is a plain little endian lane.
+ */
+void aesni_crypt_ctr32( const struct aes_key *key, UCHAR *counter, const UCHAR *input, UCHAR *output, ULONG size )
+{
+    v128 k[AES_MAX_ROUNDS + 1], b[AESNI_LANES], ctr, one = one32();
+    UCHAR pad[AES_BLOCK_SIZE];
+    ULONG i, j;
+
+    load_round_keys( key->enc_rk, key->rounds, k );
+    ctr = bswap128( load128( counter ) );
+
+    for (; size >= AESNI_LANES * AES_BLOCK_SIZE; size -= AESNI_LANES * AES_BLOCK_SIZE)
+    {
+        for (j = 0; j < AESNI_LANES; j++)
+        {
+            b[j] = bswap128( ctr );
+            ctr = add32( ctr, one );
+        }
+        encrypt_lanes( k, key->rounds, b );
+        for (j = 0; j < AESNI_LANES; j++)
+            store128( output + j * AES_BLOCK_SIZE, xor128( b[j], load128( input + j * AES_BLOCK_SIZE ) ) );
+        input += AESNI_LANES * AES_BLOCK_SIZE;
+        output += AESNI_LANES * AES_BLOCK_SIZE;
+    }
+
+    for (; size >= AES_BLOCK_SIZE; size -= AES_BLOCK_SIZE)
+    {
+        b[0] = encrypt_block( k, key->rounds, bswap128( ctr ) );
+        ctr = add32( ctr, one );
+        store128( output, xor128( b[0], load128( input ) ) );
+        input += AES_BLOCK_SIZE;
+        output += AES_BLOCK_SIZE;
+    }
+
+    if (size)
+    {
+        store128( pad, encrypt_block( k, key->rounds, bswap128( ctr ) ) );
+        ctr = add32( ctr, one );
+        for (i = 0; i < size; i++) output[i] = input[i] ^ pad[i];
+    }
+
+    store128( counter, bswap128( ctr ) );
+}
+
+/*
+ * GF(2^128) multiplication on byte reflected operands, after Intel's
+ * "Carry-Less Multiplication and Its Usage for Computing the GCM Mode".
+ * The 256-bit products are summed first, so that several blocks share one
+ * reduction.
+ */
+static inline void ghash_mul_acc( v128 a, v128 b, v128 *lo, v128 *hi )
+{
+    v128 mid;
+
+    mid = xor128( clmul( a, b, 0x10 ), clmul( a, b, 0x01 ) );
+    *lo = xor128( *lo, xor128( clmul( a, b, 0x00 ), shl128( mid, 8 ) ) );
+    *hi = xor128( *hi, xor128( clmul( a, b, 0x11 ), shr128( mid, 8 ) ) );
+}
+
+static inline v128 ghash_reduce( v128 lo, v128 hi )
+{
+    v128 t7, t8, t9;
+
+    /* Shift the product left by one bit, it was computed on reflected values */
+    t7 = shr32( lo, 31 );
+    t8 = shr32( hi, 31 );
+    lo = shl32( lo, 1 );
+    hi = shl32( hi, 1 );
+    t9 = shr128( t7, 12 );
+    t8 = shl128( t8, 4 );
+    t7 = shl128( t7, 4 );
+    lo = or128( lo, t7 );
+    hi = or128( or128( hi, t8 ), t9 );
+
+    /* Reduce modulo x^128 + x^7 + x^2 + x + 1 */
+    t7 = xor128( xor128( shl32( lo, 31 ), shl32( lo, 30 ) ), shl32( lo, 25 ) );
+    t8 = shr128( t7, 4 );
+    t7 = shl128( t7, 12 );
+    lo = xor128( lo, t7 );
+    t9 = xor128( xor128( shr32( lo, 1 ), shr32( lo, 2 ) ), shr32( lo, 7 ) );
+    t9 = xor128( t9, t8 );
+    lo = xor128( lo, t9 );
+    return xor128( hi, lo );
+}
+
+static inline v128 ghash_mul( v128 a, v128 b )
+{
+    v128 lo = zero128(), hi = zero128();
+
+    ghash_mul_acc( a, b, &lo, &hi );
+    return ghash_reduce( lo, hi );
+}
+
+void aesni_init_ghash( struct aes_key *key )
+{
+    v128 k[AES_MAX_ROUNDS + 1], h1, h2, h3, h4;
+
+    /* The hash key is the encrypted zero block */
+    load_round_keys( key->enc_rk, key->rounds, k );
+    h1 = bswap128( encrypt_block( k, key->rounds, zero128() ) );
+    h2 = ghash_mul( h1, h1 );
+    h3 = ghash_mul( h2, h1 );
+    h4 = ghash_mul( h3, h1 );
+
+    store128( key->ghash_h, h1 );
+    store128( key->ghash_h + AES_BLOCK_SIZE, h2 );
+    store128( key->ghash_h + 2 * AES_BLOCK_SIZE, h3 );
+    store128( key->ghash_h + 3 * AES_BLOCK_SIZE, h4 );
+}
+
+/* Hashes data into state, zero padding the last block */
+void aesni_ghash( const struct aes_key *key, UCHAR *state, const UCHAR *data, ULONG size )
+{
+    v128 h1, h2, h3, h4, y, lo, hi;
+    UCHAR pad[AES_BLOCK_SIZE];
+
+    h1 = load128( key->ghash_h );
+    h2 = load128( key->ghash_h + AES_BLOCK_SIZE );
+    h3 = load128( key->ghash_h + 2 * AES_BLOCK_SIZE );
+    h4 = load128( key->ghash_h + 3 * AES_BLOCK_SIZE );
+    y = bswap128( load128( state ) );
+
+    /* Y' = (Y + X0) * H^4 + X1 * H^3 + X2 * H^2 + X3 * H */
+    for (; size >= 4 * AES_BLOCK_SIZE; size -= 4 * AES_BLOCK_SIZE)
+    {
+        lo = hi = zero128();
+        ghash_mul_acc( xor128( y, bswap128( load128( data ) ) ), h4, &lo, &hi );
+        ghash_mul_acc( bswap128( load128( data + AES_BLOCK_SIZE ) ), h3, &lo, &hi );
+        ghash_mul_acc( bswap128( load128( data + 2 * AES_BLOCK_SIZE ) ), h2, &lo, &hi );
+        ghash_mul_acc( bswap128( load128( data + 3 * AES_BLOCK_SIZE ) ), h1, &lo, &hi );
+        y = ghash_reduce( lo, hi );
+        data += 4 * AES_BLOCK_SIZE;
+    }
+
+    for (; size >= AES_BLOCK_SIZE; size -= AES_BLOCK_SIZE)
+    {
+        y = ghash_mul( xor128( y, bswap128( load128( data ) ) ), h1 );
+        data += AES_BLOCK_SIZE;
+    }
+
+    if (size)
+    {
+        memset( pad, 0, sizeof(pad) );
+        memcpy( pad, data, size );
+        y = ghash_mul( xor128( y, bswap128( load128( pad ) ) ), h1 );
+    }
+
+    store128( state, bswap128( y ) );
+}
@@ -0,0 +1,61 @@
+/*
+ * PROJECT:     ReactOS bcrypt
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Internal symmetric cipher definitions
+ */
+
+#ifndef __BCRYPT_INTERNAL_H
+#define __BCRYPT_INTERNAL_H
+
+#include <mbedtls/aes.h>
+#include <mbedtls/gcm.h>
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_AMD64)
+#define BCRYPT_HAVE_AESNI
+#endif
+
+#define AES_BLOCK_SIZE 16
+#define AES_MAX_ROUNDS 14
+
+#define GCM_NONCE_SIZE   12
+#define GCM_MIN_TAG_SIZE 12
+#define GCM_MAX_TAG_SIZE 16
+
+struct aes_key
+{
+    /* Software path, also the source of the expanded round keys */
+    mbedtls_aes_context enc;
+    mbedtls_aes_context dec;
+    mbedtls_gcm_context gcm;
+
+    /* Copies for the AES-NI kernels, used when hw is set */
+    BOOL  hw;
+    ULONG rounds;
+    UCHAR enc_rk[(AES_MAX_ROUNDS + 1) * AES_BLOCK_SIZE];
+    UCHAR dec_rk[(AES_MAX_ROUNDS + 1) * AES_BLOCK_SIZE];
+    UCHAR ghash_h[4 * AES_BLOCK_SIZE];    /* H^1 to H^4, byte reflected */
+};
+
+NTSTATUS aes_key_init( struct aes_key *key, const UCHAR *secret, ULONG size );
+void aes_key_free( struct aes_key *key );
+void aes_encrypt_ecb( struct aes_key *key, const UCHAR *input, UCHAR *output, ULONG size );
+void aes_decrypt_ecb( struct aes_key *key, const UCHAR *input, UCHAR *output, ULONG size );
+void aes_encrypt_cbc( struct aes_key *key, UCHAR *iv, const UCHAR *input, UCHAR *output, ULONG size );
+void aes_decrypt_cbc( struct aes_key *key, UCHAR *iv, const UCHAR *input, UCHAR *output, ULONG size );
+NTSTATUS aes_encrypt_gcm( struct aes_key *key, const UCHAR *nonce, const UCHAR *auth, ULONG auth_size,
+                          const UCHAR *input, UCHAR *output, ULONG size, UCHAR *tag, ULONG tag_size );
+NTSTATUS aes_decrypt_gcm( struct aes_key *key, const UCHAR *nonce, const UCHAR *auth, ULONG auth_size,
+                          const UCHAR *input, UCHAR *output, ULONG size, const UCHAR *tag, ULONG tag_size );
+
+#ifdef BCRYPT_HAVE_AESNI
+/* aesni.c, only to be called when the CPU has AES-NI, PCLMULQDQ and SSSE3 */
+void aesni_init_ghash( struct aes_key *key );
+void aesni_encrypt_ecb( const struct aes_key *key, const UCHAR *input, UCHAR *output, ULONG blocks );
+void aesni_decrypt_ecb( const struct aes_key *key, const UCHAR *input, UCHAR *output, ULONG blocks );
+void aesni_encrypt_cbc( const struct aes_key *key, UCHAR *iv, const UCHAR *input, UCHAR *output, ULONG blocks );
+void aesni_decrypt_cbc( const struct aes_key *key, UCHAR *iv, const UCHAR *input, UCHAR *output, ULONG blocks );
+void aesni_crypt_ctr32( const struct aes_key *key, UCHAR *counter, const UCHAR *input, UCHAR *output, ULONG size );
+void aesni_ghash( const struct aes_key *key, UCHAR *state, const UCHAR *data, ULONG size );
+#endif
+
+#endif /* __BCRYPT_INTERNAL_H */
@@ -31,6 +31,8 @@
 #include <wine/unicode.h>
 #include <wine/library.h>
 
+#include "bcrypt_internal.h"
+
 #ifdef SONAME_LIBMBEDTLS
 #include <mbedtls/md.h>
 #include <mbedtls/md5.h>
@@ -254,6 +256,7 @@ NTSTATUS WINAPI BCryptEnumAlgorithms(ULONG dwAlgOperations, ULONG *pAlgCount,
 
 #define MAGIC_ALG  (('A' << 24) | ('L' << 16) | ('G' << 8) | '0')
 #define MAGIC_HASH (('H' << 24) | ('A' << 16) | ('S' << 8) | 'H')
+#define MAGIC_KEY  (('K' << 24) | ('E' << 16) | ('Y' << 8) | '0')
 struct object
 {
     ULONG magic;
@@ -261,6 +264,7 @@ struct object
 
 enum alg_id
 {
+    ALG_ID_AES,
     ALG_ID_MD5,
     ALG_ID_RNG,
     ALG_ID_SHA1,
@@ -273,6 +277,7 @@ static const struct {
     ULONG hash_length;
     const WCHAR *alg_name;
 } alg_props[] = {
+    /* ALG_ID_AES    */ {  0, BCRYPT_AES_ALGORITHM },
     /* ALG_ID_MD5    */ { 16, BCRYPT_MD5_ALGORITHM },
     /* ALG_ID_RNG    */ {  0, BCRYPT_RNG_ALGORITHM },
     /* ALG_ID_SHA1   */ { 20, BCRYPT_SHA1_ALGORITHM },
@@ -281,13 +286,29 @@ static const struct {
     /* ALG_ID_SHA512 */ { 64, BCRYPT_SHA512_ALGORITHM }
 };
 
+enum mode_id
+{
+    MODE_ID_ECB,
+    MODE_ID_CBC,
+    MODE_ID_GCM
+};
+
 struct algorithm
 {
     struct object hdr;
     enum alg_id   id;
+    enum mode_id  mode;
     BOOL hmac;
 };
 
+struct key
+{
+    struct object  hdr;
+    enum alg_id    alg_id;
+    enum mode_id   mode;
+    struct aes_key aes;
+};
+
 NTSTATUS WINAPI BCryptGenRandom(BCRYPT_ALG_HANDLE handle, UCHAR *buffer, ULONG count, ULONG flags)
 {
     const DWORD supported_flags = BCRYPT_USE_SYSTEM_PREFERRED_RNG;
@@ -345,7 +366,8 @@ NTSTATUS WINAPI BCryptOpenAlgorithmProvider( BCRYPT_ALG_HANDLE *handle, LPCWSTR
         return STATUS_NOT_IMPLEMENTED;
     }
 
-    if (!strcmpW( id, BCRYPT_SHA1_ALGORITHM )) alg_id = ALG_ID_SHA1;
+    if (!strcmpW( id, BCRYPT_AES_ALGORITHM )) alg_id = ALG_ID_AES;
+    else if (!strcmpW( id, BCRYPT_SHA1_ALGORITHM )) alg_id = ALG_ID_SHA1;
     else if (!strcmpW( id, BCRYPT_MD5_ALGORITHM )) alg_id = ALG_ID_MD5;
     else if (!strcmpW( id, BCRYPT_RNG_ALGORITHM )) alg_id = ALG_ID_RNG;
     else if (!strcmpW( id, BCRYPT_SHA256_ALGORITHM )) alg_id = ALG_ID_SHA256;
@@ -365,6 +387,7 @@ NTSTATUS WINAPI BCryptOpenAlgorithmProvider( BCRYPT_ALG_HANDLE *handle, LPCWSTR
     if (!(alg = HeapAlloc( GetProcessHeap(), 0, sizeof(*alg) ))) return STATUS_NO_MEMORY;
     alg->hdr.magic = MAGIC_ALG;
     alg->id        = alg_id;
+    alg->mode      = MODE_ID_CBC;
     alg->hmac      = flags & BCRYPT_ALG_HANDLE_HMAC_FLAG;
 
     *handle = alg;
@@ -851,6 +874,7 @@ static NTSTATUS hmac_finish( struct hash *hash, UCHAR *output, ULONG size )
 }
 #endif
 
+#define OBJECT_LENGTH_AES       654
 #define OBJECT_LENGTH_MD5       274
 #define OBJECT_LENGTH_SHA1      278
 #define OBJECT_LENGTH_SHA256    286
@@ -882,17 +906,70 @@ static NTSTATUS generic_alg_property( enum alg_id id, const WCHAR *prop, UCHAR *
     return STATUS_NOT_IMPLEMENTED;
 }
 
-static NTSTATUS get_alg_property( enum alg_id id, const WCHAR *prop, UCHAR *buf, ULONG size, ULONG *ret_size )
+static const WCHAR *mode_names[] = {
+    /* MODE_ID_ECB */ BCRYPT_CHAIN_MODE_ECB,
+    /* MODE_ID_CBC */ BCRYPT_CHAIN_MODE_CBC,
+    /* MODE_ID_GCM */ BCRYPT_CHAIN_MODE_GCM
+};
+
+static NTSTATUS copy_property( const void *value, ULONG value_size, UCHAR *buf, ULONG size, ULONG *ret_size )
+{
+    *ret_size = value_size;
+    if (size < value_size)
+        return STATUS_BUFFER_TOO_SMALL;
+    if (buf)
+        memcpy( buf, value, value_size );
+    return STATUS_SUCCESS;
+}
+
+/* Properties shared by AES algorithm and key handles */
+static NTSTATUS get_aes_property( enum mode_id mode, const WCHAR *prop, UCHAR *buf, ULONG size, ULONG *ret_size )
+{
+    if (!strcmpW( prop, BCRYPT_BLOCK_LENGTH ))
+    {
+        ULONG value = AES_BLOCK_SIZE;
+        return copy_property( &value, sizeof(value), buf, size, ret_size );
+    }
+    if (!strcmpW( prop, BCRYPT_CHAINING_MODE ))
+    {
+        return copy_property( mode_names[mode], (strlenW(mode_names[mode]) + 1) * sizeof(WCHAR),
+                              buf, size, ret_size );
+    }
+    if (!strcmpW( prop, BCRYPT_KEY_LENGTHS ))
+    {
+        BCRYPT_KEY_LENGTHS_STRUCT lengths = { 128, 256, 64 };
+        return copy_property( &lengths, sizeof(lengths), buf, size, ret_size );
+    }
+    if (!strcmpW( prop, BCRYPT_AUTH_TAG_LENGTH ))
+    {
+        BCRYPT_AUTH_TAG_LENGTHS_STRUCT lengths = { GCM_MIN_TAG_SIZE, GCM_MAX_TAG_SIZE, 1 };
+        if (mode != MODE_ID_GCM) return STATUS_NOT_SUPPORTED;
+        return copy_property( &lengths, sizeof(lengths), buf, size, ret_size );
+    }
+
+    FIXME( "unsupported aes property %s\n", debugstr_w(prop) );
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS get_alg_property( const struct algorithm *alg, const WCHAR *prop, UCHAR *buf, ULONG size, ULONG *ret_size )
 {
     NTSTATUS status;
     ULONG value;
 
-    status = generic_alg_property( id, prop, buf, size, ret_size );
+    status = generic_alg_property( alg->id, prop, buf, size, ret_size );
     if (status != STATUS_NOT_IMPLEMENTED)
         return status;
 
-    switch (id)
+    switch (alg->id)
     {
+    case ALG_ID_AES:
+        if (!strcmpW( prop, BCRYPT_OBJECT_LENGTH ))
+        {
+            value = OBJECT_LENGTH_AES;
+            break;
+        }
+        return get_aes_property( alg->mode, prop, buf, size, ret_size );
+
     case ALG_ID_MD5:
         if (!strcmpW( prop, BCRYPT_OBJECT_LENGTH ))
         {
@@ -944,7 +1021,7 @@ static NTSTATUS get_alg_property( enum alg_id id, const WCHAR *prop, UCHAR *buf,
         return STATUS_NOT_IMPLEMENTED;
 
     default:
-        FIXME( "unsupported algorithm %u\n", id );
+        FIXME( "unsupported algorithm %u\n", alg->id );
         return STATUS_NOT_IMPLEMENTED;
     }
 
@@ -983,13 +1060,18 @@ NTSTATUS WINAPI BCryptGetProperty( BCRYPT_HANDLE handle, LPCWSTR prop, UCHAR *bu
     case MAGIC_ALG:
     {
         const struct algorithm *alg = (const struct algorithm *)object;
-        return get_alg_property( alg->id, prop, buffer, count, res );
+        return get_alg_property( alg, prop, buffer, count, res );
     }
     case MAGIC_HASH:
     {
         const struct hash *hash = (const struct hash *)object;
         return get_hash_property( hash->alg_id, prop, buffer, count, res );
     }
+    case MAGIC_KEY:
+    {
+        const struct key *key = (const struct key *)object;
+        return get_aes_property( key->mode, prop, buffer, count, res );
+    }
     default:
         WARN( "unknown magic %08x\n", object->magic );
         return STATUS_INVALID_HANDLE;
@@ -1119,6 +1201,294 @@ NTSTATUS WINAPI BCryptHash( BCRYPT_ALG_HANDLE algorithm, UCHAR *secret, ULONG se
     return BCryptDestroyHash( handle );
 }
 
+static NTSTATUS set_mode_property( enum mode_id *mode, const WCHAR *prop, UCHAR *value, ULONG size )
+{
+    if (!strcmpW( prop, BCRYPT_CHAINING_MODE ))
+    {
+        if (!value) return STATUS_INVALID_PARAMETER;
+        if (!strncmpW( (WCHAR *)value, BCRYPT_CHAIN_MODE_ECB, size / sizeof(WCHAR) )) *mode = MODE_ID_ECB;
+        else if (!strncmpW( (WCHAR *)value, BCRYPT_CHAIN_MODE_CBC, size / sizeof(WCHAR) )) *mode = MODE_ID_CBC;
+        else if (!strncmpW( (WCHAR *)value, BCRYPT_CHAIN_MODE_GCM, size / sizeof(WCHAR) )) *mode = MODE_ID_GCM;
+        else
+        {
+            FIXME( "unsupported mode %s\n", debugstr_wn((WCHAR *)value, size / sizeof(WCHAR)) );
+            return STATUS_NOT_SUPPORTED;
+        }
+        return STATUS_SUCCESS;
+    }
+
+    FIXME( "unsupported property %s\n", debugstr_w(prop) );
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+NTSTATUS WINAPI BCryptSetProperty( BCRYPT_HANDLE handle, LPCWSTR prop, UCHAR *value, ULONG size, ULONG flags )
+{
+    struct object *object = handle;
+
+    TRACE( "%p, %s, %p, %u, %08x\n", handle, debugstr_w(prop), value, size, flags );
+
+    if (!object) return STATUS_INVALID_HANDLE;
+    if (!prop) return STATUS_INVALID_PARAMETER;
+
+    switch (object->magic)
+    {
+    case MAGIC_ALG:
+    {
+        struct algorithm *alg = (struct algorithm *)object;
+        if (alg->id != ALG_ID_AES)
+        {
+            FIXME( "unsupported algorithm %u\n", alg->id );
+            return STATUS_NOT_IMPLEMENTED;
+        }
+        return set_mode_property( &alg->mode, prop, value, size );
+    }
+    case MAGIC_KEY:
+    {
+        struct key *key = (struct key *)object;
+        return set_mode_property( &key->mode, prop, value, size );
+    }
+    default:
+        WARN( "unknown magic %08x\n", object->magic );
+        return STATUS_INVALID_HANDLE;
+    }
+}
+
+NTSTATUS WINAPI BCryptGenerateSymmetricKey( BCRYPT_ALG_HANDLE algorithm, BCRYPT_KEY_HANDLE *handle,
+                                            UCHAR *object, ULONG object_len, UCHAR *secret, ULONG secret_len,
+                                            ULONG flags )
+{
+    struct algorithm *alg = algorithm;
+    struct key *key;
+    NTSTATUS status;
+
+    TRACE( "%p, %p, %p, %u, %p, %u, %08x\n", algorithm, handle, object, object_len, secret, secret_len, flags );
+
+    if (!alg || alg->hdr.magic != MAGIC_ALG) return STATUS_INVALID_HANDLE;
+    if (alg->id != ALG_ID_AES)
+    {
+        FIXME( "algorithm %u not supported\n", alg->id );
+        return STATUS_NOT_SUPPORTED;
+    }
+    if (!handle || !secret) return STATUS_INVALID_PARAMETER;
+    if (object) FIXME( "ignoring object buffer\n" );
+
+    if (!(key = HeapAlloc( GetProcessHeap(), 0, sizeof(*key) ))) return STATUS_NO_MEMORY;
+    key->hdr.magic = MAGIC_KEY;
+    key->alg_id    = alg->id;
+    key->mode      = alg->mode;
+
+    status = aes_key_init( &key->aes, secret, secret_len );
+    if (status != STATUS_SUCCESS)
+    {
+        HeapFree( GetProcessHeap(), 0, key );
+        return status;
+    }
+
+    *handle = key;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS WINAPI BCryptDestroyKey( BCRYPT_KEY_HANDLE handle )
+{
+    struct key *key = handle;
+
+    TRACE( "%p\n", handle );
+
+    if (!key || key->hdr.magic != MAGIC_KEY) return STATUS_INVALID_HANDLE;
+    aes_key_free( &key->aes );
+    key->hdr.magic = 0;
+    HeapFree( GetProcessHeap(), 0, key );
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS check_auth_info( const BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO *auth_info )
+{
+    if (!auth_info) return STATUS_INVALID_PARAMETER;
+    if (!auth_info->pbNonce || auth_info->cbNonce != GCM_NONCE_SIZE) return STATUS_INVALID_PARAMETER;
+    if (!auth_info->pbTag || auth_info->cbTag < GCM_MIN_TAG_SIZE || auth_info->cbTag > GCM_MAX_TAG_SIZE)
+        return STATUS_INVALID_PARAMETER;
+    if (auth_info->cbAuthData && !auth_info->pbAuthData) return STATUS_INVALID_PARAMETER;
+    if (auth_info->dwFlags & BCRYPT_AUTH_MODE_CHAIN_CALLS_FLAG)
+    {
+        FIXME( "chained calls not supported\n" );
+        return STATUS_NOT_SUPPORTED;
+    }
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS WINAPI BCryptEncrypt( BCRYPT_KEY_HANDLE handle, UCHAR *input, ULONG input_len, void *padding,
+                               UCHAR *iv, ULONG iv_len, UCHAR *output, ULONG output_len, ULONG *ret_len,
+                               ULONG flags )
+{
+    struct key *key = handle;
+    UCHAR last[AES_BLOCK_SIZE];
+    ULONG full, needed, pad;
+    NTSTATUS status;
+
+    TRACE( "%p, %p, %u, %p, %p, %u, %p, %u, %p, %08x\n", handle, input, input_len, padding, iv, iv_len,
+           output, output_len, ret_len, flags );
+
+    if (!key || key->hdr.magic != MAGIC_KEY) return STATUS_INVALID_HANDLE;
+    if (!ret_len || (input_len && !input)) return STATUS_INVALID_PARAMETER;
+    if (flags & ~BCRYPT_BLOCK_PADDING)
+    {
+        FIXME( "flags %08x not implemented\n", flags );
+        return STATUS_NOT_IMPLEMENTED;
+    }
+
+    if (key->mode == MODE_ID_GCM)
+    {
+        BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO *auth_info = padding;
+
+        if (flags & BCRYPT_BLOCK_PADDING) return STATUS_INVALID_PARAMETER;
+        if ((status = check_auth_info( auth_info ))) return status;
+
+        *ret_len = input_len;
+        if (!output) return STATUS_SUCCESS;
+        if (output_len < input_len) return STATUS_BUFFER_TOO_SMALL;
+
+        return aes_encrypt_gcm( &key->aes, auth_info->pbNonce, auth_info->pbAuthData, auth_info->cbAuthData,
+                                input, output, input_len, auth_info->pbTag, auth_info->cbTag );
+    }
+
+    if (key->mode == MODE_ID_CBC && (!iv || iv_len != AES_BLOCK_SIZE)) return STATUS_INVALID_PARAMETER;
+
+    /* Padding always adds something, a full block if the input is aligned */
+    full = input_len & ~(AES_BLOCK_SIZE - 1);
+    if (flags & BCRYPT_BLOCK_PADDING)
+        needed = full + AES_BLOCK_SIZE;
+    else if (full != input_len)
+        return STATUS_INVALID_BUFFER_SIZE;
+    else
+        needed = input_len;
+
+    *ret_len = needed;
+    if (!output) return STATUS_SUCCESS;
+    if (output_len < needed) return STATUS_BUFFER_TOO_SMALL;
+
+    if (flags & BCRYPT_BLOCK_PADDING)
+    {
+        /* Take the tail before the full blocks land on it */
+        pad = AES_BLOCK_SIZE - (input_len - full);
+        memcpy( last, input + full, input_len - full );
+        memset( last + input_len - full, pad, pad );
+    }
+
+    if (key->mode == MODE_ID_ECB)
+    {
+        aes_encrypt_ecb( &key->aes, input, output, full );
+        if (flags & BCRYPT_BLOCK_PADDING) aes_encrypt_ecb( &key->aes, last, output + full, AES_BLOCK_SIZE );
+    }
+    else
+    {
+        aes_encrypt_cbc( &key->aes, iv, input, output, full );
+        if (flags & BCRYPT_BLOCK_PADDING) aes_encrypt_cbc( &key->aes, iv, last, output + full, AES_BLOCK_SIZE );
+    }
+
+    SecureZeroMemory( last, sizeof(last) );
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS WINAPI BCryptDecrypt( BCRYPT_KEY_HANDLE handle, UCHAR *input, ULONG input_len, void *padding,
+                               UCHAR *iv, ULONG iv_len, UCHAR *output, ULONG output_len, ULONG *ret_len,
+                               ULONG flags )
+{
+    struct key *key = handle;
+    UCHAR last[AES_BLOCK_SIZE], cipher[AES_BLOCK_SIZE];
+    ULONG full, needed, pad, i;
+    NTSTATUS status;
+
+    TRACE( "%p, %p, %u, %p, %p, %u, %p, %u, %p, %08x\n", handle, input, input_len, padding, iv, iv_len,
+           output, output_len, ret_len, flags );
+
+    if (!key || key->hdr.magic != MAGIC_KEY) return STATUS_INVALID_HANDLE;
+    if (!ret_len || (input_len && !input)) return STATUS_INVALID_PARAMETER;
+    if (flags & ~BCRYPT_BLOCK_PADDING)
+    {
+        FIXME( "flags %08x not implemented\n", flags );
+        return STATUS_NOT_IMPLEMENTED;
+    }
+
+    if (key->mode == MODE_ID_GCM)
+    {
+        BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO *auth_info = padding;
+
+        if (flags & BCRYPT_BLOCK_PADDING) return STATUS_INVALID_PARAMETER;
+        if ((status = check_auth_info( auth_info ))) return status;
+
+        *ret_len = input_len;
+        if (!output) return STATUS_SUCCESS;
+        if (output_len < input_len) return STATUS_BUFFER_TOO_SMALL;
+
+        return aes_decrypt_gcm( &key->aes, auth_info->pbNonce, auth_info->pbAuthData, auth_info->cbAuthData,
+                                input, output, input_len, auth_info->pbTag, auth_info->cbTag );
+    }
+
+    if (key->mode == MODE_ID_CBC && (!iv || iv_len != AES_BLOCK_SIZE)) return STATUS_INVALID_PARAMETER;
+    if (input_len & (AES_BLOCK_SIZE - 1)) return STATUS_INVALID_BUFFER_SIZE;
+
+    /* Without an output buffer the padding is unknown, so report the upper bound */
+    *ret_len = input_len;
+    if (!output) return STATUS_SUCCESS;
+
+    if (!(flags & BCRYPT_BLOCK_PADDING))
+    {
+        if (output_len < input_len) return STATUS_BUFFER_TOO_SMALL;
+        if (key->mode == MODE_ID_ECB) aes_decrypt_ecb( &key->aes, input, output, input_len );
+        else aes_decrypt_cbc( &key->aes, iv, input, output, input_len );
+        return STATUS_SUCCESS;
+    }
+
+    if (!input_len) return STATUS_INVALID_PARAMETER;
+
+    /* Decrypt the last block on its own first, it tells how much output there is */
+    full = input_len - AES_BLOCK_SIZE;
+    memcpy( cipher, input + full, AES_BLOCK_SIZE );
+    aes_decrypt_ecb( &key->aes, cipher, last, AES_BLOCK_SIZE );
+    if (key->mode == MODE_ID_CBC)
+    {
+        const UCHAR *prev = full ? input + full - AES_BLOCK_SIZE : iv;
+        for (i = 0; i < AES_BLOCK_SIZE; i++) last[i] ^= prev[i];
+    }
+
+    pad = last[AES_BLOCK_SIZE - 1];
+    if (!pad || pad > AES_BLOCK_SIZE)
+    {
+        SecureZeroMemory( last, sizeof(last) );
+        return STATUS_INVALID_PARAMETER;
+    }
+    for (i = AES_BLOCK_SIZE - pad; i < AES_BLOCK_SIZE; i++)
+    {
+        if (last[i] != pad)
+        {
+            SecureZeroMemory( last, sizeof(last) );
+            return STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    needed = input_len - pad;
+    *ret_len = needed;
+    if (output_len < needed)
+    {
+        SecureZeroMemory( last, sizeof(last) );
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    if (key->mode == MODE_ID_ECB)
+    {
+        aes_decrypt_ecb( &key->aes, input, output, full );
+    }
+    else
+    {
+        aes_decrypt_cbc( &key->aes, iv, input, output, full );
+        memcpy( iv, cipher, AES_BLOCK_SIZE );
+    }
+    memcpy( output + full, last, AES_BLOCK_SIZE - pad );
+
+    SecureZeroMemory( last, sizeof(last) );
+    return STATUS_SUCCESS;
+}
+
 BOOL WINAPI DllMain( HINSTANCE hinst, DWORD reason, LPVOID reserved )
 {
     switch (reason)
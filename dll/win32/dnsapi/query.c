@@ -577,12 +577,14 @@ Query_Main(LPCWSTR Name,
     PFIXED_INFO network_info;
     ULONG network_info_blen = 0;
     DWORD network_info_result;
+    DWORD CurrentTime;
     PIP_ADDR_STRING pip;
     IP4_ADDRESS Address;
     struct in_addr addr;
     PCHAR HostWithDomainName;
     PCHAR AnsiName;
     size_t NameLen = 0;
+    DNS_STATUS Status;
 
     if (Name == NULL)
         return ERROR_INVALID_PARAMETER;
@@ -634,6 +636,7 @@ Query_Main(LPCWSTR Name,
             (*QueryResultSet)->Flags.S.Section = DnsSectionAnswer;
             (*QueryResultSet)->Flags.S.CharSet = DnsCharSetUnicode;
             (*QueryResultSet)->Data.A.IpAddress = Address;
+            (*QueryResultSet)->dwTtl = 0;
 
             (*QueryResultSet)->pName = (LPSTR)xstrsave(Name);
 
@@ -707,6 +710,7 @@ Query_Main(LPCWSTR Name,
             (*QueryResultSet)->Flags.S.Section = DnsSectionAnswer;
             (*QueryResultSet)->Flags.S.CharSet = DnsCharSetUnicode;
             (*QueryResultSet)->Data.A.IpAddress = Address;
+            (*QueryResultSet)->dwTtl = 0;
 
             (*QueryResultSet)->pName = (LPSTR)DnsCToW(HostWithDomainName);
 
@@ -801,6 +805,11 @@ Query_Main(LPCWSTR Name,
                 (*QueryResultSet)->Flags.S.CharSet = DnsCharSetUnicode;
                 (*QueryResultSet)->Data.A.IpAddress = answer->rrs.addr->addr.inet.sin_addr.s_addr;
 
+                /* adns gives the time the answer expires at, in seconds since 1970 */
+                CurrentTime = GetCurrentTimeInSeconds();
+                (*QueryResultSet)->dwTtl = (answer->expires > (time_t)CurrentTime) ?
+                                           (DWORD)(answer->expires - CurrentTime) : 0;
+
                 adns_finish(astate);
 
                 (*QueryResultSet)->pName = (LPSTR)xstrsave(Name);
@@ -810,13 +819,23 @@ Query_Main(LPCWSTR Name,
 
             if (NULL == answer || adns_s_prohibitedcname != answer->status || NULL == answer->cname)
             {
+                /* Only a server answer tells the name or record doesn't
+                 * exist, failing to get one (timeout, SERVFAIL...) may not
+                 * last */
+                if (answer && answer->status == adns_s_nxdomain)
+                    Status = DNS_ERROR_RCODE_NAME_ERROR;
+                else if (answer && answer->status == adns_s_nodata)
+                    Status = DNS_INFO_NO_RECORDS;
+                else
+                    Status = ERROR_FILE_NOT_FOUND;
+
                 adns_finish(astate);
 
                 if (CurrentName != AnsiName)
                     RtlFreeHeap(RtlGetProcessHeap(), 0, CurrentName);
 
                 RtlFreeHeap(RtlGetProcessHeap(), 0, AnsiName);
-                return ERROR_FILE_NOT_FOUND;
+                return Status;
             }
 
             if (CurrentName != AnsiName)
@@ -19,9 +19,188 @@
 DEBUG_CHANNEL(kernel32file);
 #endif
 
+/* Chunks grow with the file, so that large copies keep the disks busy */
+#define COPY_MIN_CHUNK          0x10000
+#define COPY_MAX_CHUNK          0x100000
+#define COPY_MAX_BUFFERS        4
+
+/* Minimum time between two CALLBACK_CHUNK_FINISHED notifications, in ms */
+#define COPY_PROGRESS_INTERVAL  100
+
+typedef enum _COPY_BUFFER_STATE
+{
+    CopyBufferIdle,
+    CopyBufferReading,
+    CopyBufferWriting
+} COPY_BUFFER_STATE;
+
+typedef struct _COPY_BUFFER
+{
+    COPY_BUFFER_STATE State;
+    HANDLE Event;
+    IO_STATUS_BLOCK IoStatusBlock;
+    LARGE_INTEGER Offset;
+    ULONG Length;
+    PUCHAR Data;
+} COPY_BUFFER, *PCOPY_BUFFER;
+
 /* FUNCTIONS ****************************************************************/
 
+static NTSTATUS
+CopyProgress(
+    LPPROGRESS_ROUTINE  *lpProgressRoutine,
+    LPVOID              lpData,
+    LARGE_INTEGER       SourceFileSize,
+    LARGE_INTEGER       BytesCopied,
+    DWORD               CallbackReason,
+    HANDLE              FileHandleSource,
+    HANDLE              FileHandleDest,
+    BOOL                *KeepDest
+)
+{
+    DWORD ProgressResult;
+
+    ProgressResult = (**lpProgressRoutine)(SourceFileSize,
+                                           BytesCopied,
+                                           SourceFileSize,
+                                           BytesCopied,
+                                           0,
+                                           CallbackReason,
+                                           FileHandleSource,
+                                           FileHandleDest,
+                                           lpData);
+    switch (ProgressResult)
+    {
+    case PROGRESS_CANCEL:
+        TRACE("Progress callback requested cancel\n");
+        return STATUS_REQUEST_ABORTED;
+    case PROGRESS_STOP:
+        TRACE("Progress callback requested stop\n");
+        *KeepDest = TRUE;
+        return STATUS_REQUEST_ABORTED;
+    case PROGRESS_QUIET:
+        *lpProgressRoutine = NULL;
+        break;
+    case PROGRESS_CONTINUE:
+    default:
+        break;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS
+CopyStartRead(
+    HANDLE              FileHandleSource,
+    PCOPY_BUFFER        Buffer,
+    ULONG               ChunkSize,
+    PLARGE_INTEGER      NextOffset,
+    PLARGE_INTEGER      ReadLimit
+)
+{
+    NTSTATUS errCode;
+
+    Buffer->Offset.QuadPart = NextOffset->QuadPart;
+    errCode = NtReadFile(FileHandleSource,
+                         Buffer->Event,
+                         NULL,
+                         NULL,
+                         &Buffer->IoStatusBlock,
+                         Buffer->Data,
+                         ChunkSize,
+                         &Buffer->Offset,
+                         NULL);
+    if (NT_SUCCESS(errCode))
+    {
+        /* Pending or not, completion signals the event */
+        Buffer->State = CopyBufferReading;
+        NextOffset->QuadPart += ChunkSize;
+        errCode = STATUS_SUCCESS;
+    }
+    else if (STATUS_END_OF_FILE == errCode)
+    {
+        /* Nothing is left to read from here on */
+        ReadLimit->QuadPart = min(ReadLimit->QuadPart, Buffer->Offset.QuadPart);
+        errCode = STATUS_SUCCESS;
+    }
+    else
+    {
+        WARN("Error 0x%08x reading from source\n", errCode);
+    }
+
+    return errCode;
+}
+
+static NTSTATUS
+CopyStartWrite(
+    HANDLE              FileHandleDest,
+    PCOPY_BUFFER        Buffer,
+    ULONG               SectorSize
+)
+{
+    NTSTATUS errCode;
+    ULONG WriteLength;
+
+    /* Unbuffered writes cover whole sectors, the end of file is trimmed afterwards */
+    WriteLength = Buffer->Length;
+    if (SectorSize != 0)
+    {
+        WriteLength = (WriteLength + SectorSize - 1) & ~(SectorSize - 1);
+    }
+
+    errCode = NtWriteFile(FileHandleDest,
+                          Buffer->Event,
+                          NULL,
+                          NULL,
+                          &Buffer->IoStatusBlock,
+                          Buffer->Data,
+                          WriteLength,
+                          &Buffer->Offset,
+                          NULL);
+    if (NT_SUCCESS(errCode))
+    {
+        Buffer->State = CopyBufferWriting;
+        errCode = STATUS_SUCCESS;
+    }
+    else
+    {
+        WARN("Error 0x%08x writing to dest\n", errCode);
+    }
+
+    return errCode;
+}
+
+static ULONG
+CopyGetSectorSize(
+    HANDLE FileHandleDest
+)
+{
+    NTSTATUS errCode;
+    IO_STATUS_BLOCK IoStatusBlock;
+    FILE_FS_SIZE_INFORMATION FileFsSize;
+
+    errCode = NtQueryVolumeInformationFile(FileHandleDest,
+                                           &IoStatusBlock,
+                                           &FileFsSize,
+                                           sizeof(FILE_FS_SIZE_INFORMATION),
+                                           FileFsSizeInformation);
+    if (!NT_SUCCESS(errCode) ||
+        FileFsSize.BytesPerSector == 0 ||
+        FileFsSize.BytesPerSector > COPY_MIN_CHUNK ||
+        (FileFsSize.BytesPerSector & (FileFsSize.BytesPerSector - 1)) != 0)
+    {
+        /* A page covers any sector size we are likely to meet */
+        return PAGE_SIZE;
+    }
 
+    return FileFsSize.BytesPerSector;
+}
+
+/*
+ * Both handles are asynchronous. Every buffer alternates between a read
+ * from the source and a write of the same range to the dest, so up to
+ * COPY_MAX_BUFFERS requests are in flight and reads overlap the writes.
+ */
 static NTSTATUS
 CopyLoop (
     HANDLE			FileHandleSource,
@@ -30,135 +209,260 @@ CopyLoop (
     LPPROGRESS_ROUTINE	lpProgressRoutine,
     LPVOID			lpData,
     BOOL			*pbCancel,
+    BOOL                 NoBuffering,
     BOOL                 *KeepDest
 )
 {
-    NTSTATUS errCode;
+    NTSTATUS errCode, Status;
     IO_STATUS_BLOCK IoStatusBlock;
+    FILE_ALLOCATION_INFORMATION FileAllocation;
+    FILE_END_OF_FILE_INFORMATION FileEndOfFile;
+    COPY_BUFFER Buffers[COPY_MAX_BUFFERS];
+    PCOPY_BUFFER Buffer;
     UCHAR *lpBuffer = NULL;
-    SIZE_T RegionSize = 0x10000;
-    LARGE_INTEGER BytesCopied;
-    DWORD CallbackReason;
-    DWORD ProgressResult;
-    BOOL EndOfFileFound;
+    SIZE_T RegionSize;
+    LONGLONG Chunks;
+    ULONG ChunkSize, BufferCount, SectorSize, Pending, i;
+    LARGE_INTEGER BytesCopied, NextOffset, ReadLimit;
+    DWORD LastProgress, Now;
 
     *KeepDest = FALSE;
+
+    /* Spread the file over the buffers, in whole chunks */
+    Chunks = (SourceFileSize.QuadPart / COPY_MAX_BUFFERS + COPY_MIN_CHUNK - 1) & ~((LONGLONG)COPY_MIN_CHUNK - 1);
+    ChunkSize = (ULONG)max(COPY_MIN_CHUNK, min(COPY_MAX_CHUNK, Chunks));
+    Chunks = (SourceFileSize.QuadPart + ChunkSize - 1) / ChunkSize;
+    BufferCount = (ULONG)max(1, min(COPY_MAX_BUFFERS, Chunks));
+
+    RegionSize = (SIZE_T)ChunkSize * BufferCount;
     errCode = NtAllocateVirtualMemory(NtCurrentProcess(),
                                       (PVOID *)&lpBuffer,
                                       0,
                                       &RegionSize,
                                       MEM_RESERVE | MEM_COMMIT,
                                       PAGE_READWRITE);
+    if (!NT_SUCCESS(errCode))
+    {
+        TRACE("Error 0x%08x allocating buffer of %lu bytes\n", errCode, RegionSize);
+        return errCode;
+    }
 
+    for (i = 0; i < BufferCount; i++)
+    {
+        Buffers[i].State = CopyBufferIdle;
+        Buffers[i].Data = lpBuffer + (SIZE_T)i * ChunkSize;
+        errCode = NtCreateEvent(&Buffers[i].Event,
+                                EVENT_ALL_ACCESS,
+                                NULL,
+                                NotificationEvent,
+                                FALSE);
+        if (!NT_SUCCESS(errCode))
+        {
+            TRACE("Error 0x%08x creating event\n", errCode);
+            BufferCount = i;
+            break;
+        }
+    }
+
+    SectorSize = 0;
     if (NT_SUCCESS(errCode))
     {
-        BytesCopied.QuadPart = 0;
-        EndOfFileFound = FALSE;
-        CallbackReason = CALLBACK_STREAM_SWITCH;
-        while (! EndOfFileFound &&
-                NT_SUCCESS(errCode) &&
-                (NULL == pbCancel || ! *pbCancel))
+        if (NoBuffering)
         {
+            SectorSize = CopyGetSectorSize(FileHandleDest);
+        }
+
+        /* Have the dest allocated in one go rather than grown by every write */
+        if (SourceFileSize.QuadPart != 0)
+        {
+            FileAllocation.AllocationSize.QuadPart = SourceFileSize.QuadPart;
+            Status = NtSetInformationFile(FileHandleDest,
+                                          &IoStatusBlock,
+                                          &FileAllocation,
+                                          sizeof(FILE_ALLOCATION_INFORMATION),
+                                          FileAllocationInformation);
+            if (!NT_SUCCESS(Status))
+            {
+                TRACE("Status 0x%08x pre-allocating dest\n", Status);
+            }
+        }
+    }
+
+    BytesCopied.QuadPart = 0;
+    NextOffset.QuadPart = 0;
+    ReadLimit.QuadPart = MAXLONGLONG;
+    LastProgress = GetTickCount();
+
+    if (NT_SUCCESS(errCode) && NULL != lpProgressRoutine)
+    {
+        errCode = CopyProgress(&lpProgressRoutine,
+                               lpData,
+                               SourceFileSize,
+                               BytesCopied,
+                               CALLBACK_STREAM_SWITCH,
+                               FileHandleSource,
+                               FileHandleDest,
+                               KeepDest);
+    }
+
+    if (NT_SUCCESS(errCode) && NULL != pbCancel && *pbCancel)
+    {
+        TRACE("User requested cancel\n");
+        errCode = STATUS_REQUEST_ABORTED;
+    }
+
+    /* Get a read going in every buffer */
+    Pending = 0;
+    for (i = 0; i < BufferCount && NT_SUCCESS(errCode); i++)
+    {
+        if (NextOffset.QuadPart >= ReadLimit.QuadPart)
+            break;
+
+        errCode = CopyStartRead(FileHandleSource,
+                                &Buffers[i],
+                                ChunkSize,
+                                &NextOffset,
+                                &ReadLimit);
+        if (Buffers[i].State != CopyBufferIdle)
+            Pending++;
+    }
+
+    /* Reap the buffers round robin, the oldest request is the most likely to be done */
+    for (i = 0; Pending != 0; i = (i + 1) % BufferCount)
+    {
+        Buffer = &Buffers[i];
+        if (Buffer->State == CopyBufferIdle)
+            continue;
+
+        NtWaitForSingleObject(Buffer->Event, FALSE, NULL);
+        Status = Buffer->IoStatusBlock.Status;
+        Pending--;
+
+        if (Buffer->State == CopyBufferReading)
+        {
+            Buffer->State = CopyBufferIdle;
+
+            /* After a failure, only wait for what is still in flight */
+            if (!NT_SUCCESS(errCode))
+                continue;
+
+            if (STATUS_END_OF_FILE == Status ||
+                (NT_SUCCESS(Status) && Buffer->IoStatusBlock.Information == 0))
+            {
+                ReadLimit.QuadPart = min(ReadLimit.QuadPart, Buffer->Offset.QuadPart);
+                continue;
+            }
+
+            if (!NT_SUCCESS(Status))
+            {
+                WARN("Error 0x%08x reading from source\n", Status);
+                errCode = Status;
+                continue;
+            }
+
+            /* Data beyond a short read belongs to a file that grew meanwhile */
+            if (Buffer->Offset.QuadPart >= ReadLimit.QuadPart)
+                continue;
+
+            Buffer->Length = (ULONG)Buffer->IoStatusBlock.Information;
+            if (Buffer->Length < ChunkSize)
+            {
+                ReadLimit.QuadPart = min(ReadLimit.QuadPart, Buffer->Offset.QuadPart + Buffer->Length);
+            }
+
+            if (NULL != pbCancel && *pbCancel)
+            {
+                TRACE("User requested cancel\n");
+                errCode = STATUS_REQUEST_ABORTED;
+                continue;
+            }
+
+            errCode = CopyStartWrite(FileHandleDest, Buffer, SectorSize);
+        }
+        else
+        {
+            Buffer->State = CopyBufferIdle;
+
+            if (!NT_SUCCESS(errCode))
+                continue;
+
+            if (!NT_SUCCESS(Status))
+            {
+                WARN("Error 0x%08x writing to dest\n", Status);
+                errCode = Status;
+                continue;
+            }
+
+            BytesCopied.QuadPart += Buffer->Length;
+
+            /* Report at most every COPY_PROGRESS_INTERVAL, and always the last chunk */
             if (NULL != lpProgressRoutine)
             {
-                ProgressResult = (*lpProgressRoutine)(SourceFileSize,
-                                                      BytesCopied,
-                                                      SourceFileSize,
-                                                      BytesCopied,
-                                                      0,
-                                                      CallbackReason,
-                                                      FileHandleSource,
-                                                      FileHandleDest,
-                                                      lpData);
-                switch (ProgressResult)
+                Now = GetTickCount();
+                if (Now - LastProgress >= COPY_PROGRESS_INTERVAL ||
+                    BytesCopied.QuadPart >= SourceFileSize.QuadPart)
                 {
-                case PROGRESS_CANCEL:
-                    TRACE("Progress callback requested cancel\n");
-                    errCode = STATUS_REQUEST_ABORTED;
-                    break;
-                case PROGRESS_STOP:
-                    TRACE("Progress callback requested stop\n");
-                    errCode = STATUS_REQUEST_ABORTED;
-                    *KeepDest = TRUE;
-                    break;
-                case PROGRESS_QUIET:
-                    lpProgressRoutine = NULL;
-                    break;
-                case PROGRESS_CONTINUE:
-                default:
-                    break;
+                    LastProgress = Now;
+                    errCode = CopyProgress(&lpProgressRoutine,
+                                           lpData,
+                                           SourceFileSize,
+                                           BytesCopied,
+                                           CALLBACK_CHUNK_FINISHED,
+                                           FileHandleSource,
+                                           FileHandleDest,
+                                           KeepDest);
+                    if (!NT_SUCCESS(errCode))
+                        continue;
                 }
-                CallbackReason = CALLBACK_CHUNK_FINISHED;
             }
-            if (NT_SUCCESS(errCode))
+
+            if (NULL != pbCancel && *pbCancel)
             {
-                errCode = NtReadFile(FileHandleSource,
-                                     NULL,
-                                     NULL,
-                                     NULL,
-                                     (PIO_STATUS_BLOCK)&IoStatusBlock,
-                                     lpBuffer,
-                                     RegionSize,
-                                     NULL,
-                                     NULL);
-                /* With sync read, 0 length + status success mean EOF:
-                 * https://msdn.microsoft.com/en-us/library/windows/desktop/aa365467(v=vs.85).aspx
-                 */
-                if (NT_SUCCESS(errCode) && IoStatusBlock.Information == 0)
-                {
-                    errCode = STATUS_END_OF_FILE;
-                }
-                if (NT_SUCCESS(errCode) && (NULL == pbCancel || ! *pbCancel))
-                {
-                    errCode = NtWriteFile(FileHandleDest,
-                                          NULL,
-                                          NULL,
-                                          NULL,
-                                          (PIO_STATUS_BLOCK)&IoStatusBlock,
-                                          lpBuffer,
-                                          IoStatusBlock.Information,
-                                          NULL,
-                                          NULL);
-                    if (NT_SUCCESS(errCode))
-                    {
-                        BytesCopied.QuadPart += IoStatusBlock.Information;
-                    }
-                    else
-                    {
-                        WARN("Error 0x%08x reading writing to dest\n", errCode);
-                    }
-                }
-                else if (!NT_SUCCESS(errCode))
-                {
-                    if (STATUS_END_OF_FILE == errCode)
-                    {
-                        EndOfFileFound = TRUE;
-                        errCode = STATUS_SUCCESS;
-                    }
-                    else
-                    {
-                        WARN("Error 0x%08x reading from source\n", errCode);
-                    }
-                }
+                TRACE("User requested cancel\n");
+                errCode = STATUS_REQUEST_ABORTED;
+                continue;
+            }
+
+            if (NextOffset.QuadPart < ReadLimit.QuadPart)
+            {
+                errCode = CopyStartRead(FileHandleSource,
+                                        Buffer,
+                                        ChunkSize,
+                                        &NextOffset,
+                                        &ReadLimit);
             }
         }
 
-        if (! EndOfFileFound && (NULL != pbCancel && *pbCancel))
+        if (Buffer->State != CopyBufferIdle)
+            Pending++;
+    }
+
+    /* Unbuffered writes went up to the next sector, cut the dest back to size */
+    if (NT_SUCCESS(errCode) && SectorSize != 0 && (BytesCopied.QuadPart & (SectorSize - 1)) != 0)
+    {
+        FileEndOfFile.EndOfFile.QuadPart = BytesCopied.QuadPart;
+        errCode = NtSetInformationFile(FileHandleDest,
+                                       &IoStatusBlock,
+                                       &FileEndOfFile,
+                                       sizeof(FILE_END_OF_FILE_INFORMATION),
+                                       FileEndOfFileInformation);
+        if (!NT_SUCCESS(errCode))
         {
-            TRACE("User requested cancel\n");
-            errCode = STATUS_REQUEST_ABORTED;
+            WARN("Error 0x%08x setting dest end of file\n", errCode);
         }
-
-        NtFreeVirtualMemory(NtCurrentProcess(),
-                            (PVOID *)&lpBuffer,
-                            &RegionSize,
-                            MEM_RELEASE);
     }
-    else
+
+    for (i = 0; i < BufferCount; i++)
     {
-        TRACE("Error 0x%08x allocating buffer of %lu bytes\n", errCode, RegionSize);
+        NtClose(Buffers[i].Event);
     }
 
+    RegionSize = 0;
+    NtFreeVirtualMemory(NtCurrentProcess(),
+                        (PVOID *)&lpBuffer,
+                        &RegionSize,
+                        MEM_RELEASE);
+
     return errCode;
 }
 
@@ -223,7 +527,7 @@ BasepCopyFileExW(IN LPCWSTR lpExistingFileName,
                                    FILE_SHARE_READ | FILE_SHARE_WRITE,
                                    NULL,
                                    OPEN_EXISTING,
-                                   FILE_ATTRIBUTE_NORMAL|FILE_FLAG_NO_BUFFERING,
+                                   FILE_ATTRIBUTE_NORMAL|FILE_FLAG_NO_BUFFERING|FILE_FLAG_OVERLAPPED,
                                    NULL);
     if (INVALID_HANDLE_VALUE != FileHandleSource)
     {
@@ -254,8 +558,9 @@ BasepCopyFileExW(IN LPCWSTR lpExistingFileName,
                                              GENERIC_WRITE,
                                              FILE_SHARE_WRITE,
                                              NULL,
-                                             dwCopyFlags ? CREATE_NEW : CREATE_ALWAYS,
-                                             FileBasic.FileAttributes,
+                                             (dwCopyFlags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
+                                             FileBasic.FileAttributes | FILE_FLAG_OVERLAPPED |
+                                             ((dwCopyFlags & COPY_FILE_NO_BUFFERING) ? FILE_FLAG_NO_BUFFERING : 0),
                                              NULL);
                 if (INVALID_HANDLE_VALUE != FileHandleDest)
                 {
@@ -265,6 +570,7 @@ BasepCopyFileExW(IN LPCWSTR lpExistingFileName,
                                        lpProgressRoutine,
                                        lpData,
                                        pbCancel,
+                                       (dwCopyFlags & COPY_FILE_NO_BUFFERING) != 0,
                                        &KeepDestOnError);
                     if (!NT_SUCCESS(errCode))
                     {
@@ -351,6 +351,42 @@ IntGetCodePageEntry(UINT CodePage)
     return CodePageEntry;
 }
 
+/* Number of characters the UTF-8 conversions check for ASCII at once */
+#define ASCII_BLOCK 16
+
+/**
+ * @name IntIsAsciiBlockA
+ *
+ * Checks whether the next ASCII_BLOCK bytes are all below 0x80.
+ */
+static
+inline
+BOOL
+IntIsAsciiBlockA(LPCSTR String)
+{
+    ULONG Words[ASCII_BLOCK / sizeof(ULONG)];
+
+    RtlCopyMemory(Words, String, sizeof(Words));
+    return ((Words[0] | Words[1] | Words[2] | Words[3]) & 0x80808080) == 0;
+}
+
+/**
+ * @name IntIsAsciiBlockW
+ *
+ * Checks whether the next ASCII_BLOCK wide characters are all below 0x80.
+ */
+static
+inline
+BOOL
+IntIsAsciiBlockW(LPCWSTR String)
+{
+    ULONG Words[ASCII_BLOCK * sizeof(WCHAR) / sizeof(ULONG)];
+
+    RtlCopyMemory(Words, String, sizeof(Words));
+    return ((Words[0] | Words[1] | Words[2] | Words[3] |
+             Words[4] | Words[5] | Words[6] | Words[7]) & 0xFF80FF80) == 0;
+}
+
 /**
  * @name IntMultiByteToWideCharUTF8
  *
@@ -368,10 +404,10 @@ IntMultiByteToWideCharUTF8(DWORD Flags,
                            LPWSTR WideCharString,
                            INT WideCharCount)
 {
-    LPCSTR MbsEnd, MbsPtrSave;
+    LPCSTR MbsEnd, MbsPtrSave, AsciiCheck;
     UCHAR Char, TrailLength;
     WCHAR WideChar;
-    LONG Count;
+    LONG Count, i;
     BOOL CharIsValid, StringIsValid = TRUE;
     const WCHAR InvalidChar = 0xFFFD;
 
@@ -386,8 +422,23 @@ IntMultiByteToWideCharUTF8(DWORD Flags,
     {
         /* validate and count the wide characters */
         MbsEnd = MultiByteString + MultiByteCount;
+        AsciiCheck = MultiByteString;
         for (; MultiByteString < MbsEnd; WideCharCount++)
         {
+            /* Skip over plain ASCII a block at a time, leaving at least one character */
+            while (MultiByteString >= AsciiCheck && MbsEnd - MultiByteString > ASCII_BLOCK)
+            {
+                /* Not only ASCII, go one character at a time past the block */
+                if (!IntIsAsciiBlockA(MultiByteString))
+                {
+                    AsciiCheck = MultiByteString + ASCII_BLOCK;
+                    break;
+                }
+
+                MultiByteString += ASCII_BLOCK;
+                WideCharCount += ASCII_BLOCK;
+            }
+
             Char = *MultiByteString++;
             if (Char < 0x80)
             {
@@ -447,8 +498,28 @@ IntMultiByteToWideCharUTF8(DWORD Flags,
 
     /* convert */
     MbsEnd = MultiByteString + MultiByteCount;
+    AsciiCheck = MultiByteString;
     for (Count = 0; Count < WideCharCount && MultiByteString < MbsEnd; Count++)
     {
+        /* Widen plain ASCII a block at a time, leaving at least one character */
+        while (MultiByteString >= AsciiCheck &&
+               MbsEnd - MultiByteString > ASCII_BLOCK &&
+               WideCharCount - Count > ASCII_BLOCK)
+        {
+            /* Not only ASCII, go one character at a time past the block */
+            if (!IntIsAsciiBlockA(MultiByteString))
+            {
+                AsciiCheck = MultiByteString + ASCII_BLOCK;
+                break;
+            }
+
+            for (i = 0; i < ASCII_BLOCK; i++)
+                WideCharString[i] = (UCHAR)MultiByteString[i];
+            MultiByteString += ASCII_BLOCK;
+            WideCharString += ASCII_BLOCK;
+            Count += ASCII_BLOCK;
+        }
+
         Char = *MultiByteString++;
         if (Char < 0x80)
         {
@@ -854,8 +925,9 @@ IntWideCharToMultiByteUTF8(UINT CodePage,
                            LPCSTR DefaultChar,
                            LPBOOL UsedDefaultChar)
 {
-    INT TempLength;
+    INT TempLength, i;
     DWORD Char;
+    LPCWSTR AsciiCheck = WideCharString;
 
     if (Flags)
     {
@@ -869,6 +941,21 @@ IntWideCharToMultiByteUTF8(UINT CodePage,
         for (TempLength = 0; WideCharCount;
             WideCharCount--, WideCharString++)
         {
+            /* Plain ASCII takes one byte each, leave at least one character */
+            while (WideCharString >= AsciiCheck && WideCharCount > ASCII_BLOCK)
+            {
+                /* Not only ASCII, go one character at a time past the block */
+                if (!IntIsAsciiBlockW(WideCharString))
+                {
+                    AsciiCheck = WideCharString + ASCII_BLOCK;
+                    break;
+                }
+
+                WideCharString += ASCII_BLOCK;
+                WideCharCount -= ASCII_BLOCK;
+                TempLength += ASCII_BLOCK;
+            }
+
             TempLength++;
             if (*WideCharString >= 0x80)
             {
@@ -892,6 +979,25 @@ IntWideCharToMultiByteUTF8(UINT CodePage,
 
     for (TempLength = MultiByteCount; WideCharCount; WideCharCount--, WideCharString++)
     {
+        /* Narrow plain ASCII a block at a time, leaving at least one character */
+        while (WideCharString >= AsciiCheck &&
+               WideCharCount > ASCII_BLOCK && TempLength >= ASCII_BLOCK)
+        {
+            /* Not only ASCII, go one character at a time past the block */
+            if (!IntIsAsciiBlockW(WideCharString))
+            {
+                AsciiCheck = WideCharString + ASCII_BLOCK;
+                break;
+            }
+
+            for (i = 0; i < ASCII_BLOCK; i++)
+                MultiByteString[i] = (CHAR)WideCharString[i];
+            WideCharString += ASCII_BLOCK;
+            MultiByteString += ASCII_BLOCK;
+            WideCharCount -= ASCII_BLOCK;
+            TempLength -= ASCII_BLOCK;
+        }
+
         Char = *WideCharString;
         if (Char < 0x80)
         {
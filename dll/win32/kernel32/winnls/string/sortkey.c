@@ -22,351 +22,248 @@
 #ifdef __REACTOS__
 #define get_char_typeW(x) iswctype((x) >> 8, (x) & 0xFF)
 #endif
-extern unsigned int wine_decompose( WCHAR ch, WCHAR *dst, unsigned int dstlen );
 extern const unsigned int collation_table[];
 
+static inline unsigned int get_collation_element(WCHAR ch)
+{
+    return collation_table[collation_table[ch >> 8] + (ch & 0xff)];
+}
+
+static inline int is_ignored_symbol(int flags, WCHAR ch)
+{
+    return (flags & NORM_IGNORESYMBOLS) && (get_char_typeW(ch) & (C1_PUNCT | C1_SPACE));
+}
+
 /*
- * flags - normalization NORM_* flags
+ * Sort key levels, in key order. Each of them is followed by '\1', apart from
+ * the hyphen/apostrophe weights, which go at the end of key 3. The key ends
+ * with '\0'.
+ */
+#define KEY_UNICODE     0
+#define KEY_DIACRITIC   1
+#define KEY_CASE        2
+#define KEY_CHARACTER   3
+#define KEY_SPECIAL     4
+#define KEY_LEVELS      5
+
+/* Hyphen and apostrophe positions take two base 254 digits from 2 up, so no '\0' */
+#define KEY_MAX_POSITION (254 * 254 - 1)
+
+/*
+ * Stores the bytes that the character at src[pos] adds to the given key level,
+ * and returns their count (up to 4).
  *
- * FIXME: 'variable' flag not handled
+ * 32-bit collation element table format:
+ * unicode weight - high 16 bit, diacritic weight - high 8 bit of low 16 bit,
+ * case weight - high 4 bit of low 8 bit.
  */
-int wine_get_sortkey(int flags, const WCHAR *src, int srclen, char *dst, int dstlen)
+static inline int get_key_bytes(int flags, int level, const WCHAR *src, int pos, unsigned char *key)
 {
-    WCHAR dummy[4]; /* no decomposition is larger than 4 chars */
-    int key_len[4];
-    char *key_ptr[4];
-    const WCHAR *src_save = src;
-    int srclen_save = srclen;
+    WCHAR wch = src[pos];
+    unsigned int ce;
+    int len = 0;
 
-    key_len[0] = key_len[1] = key_len[2] = key_len[3] = 0;
-    for (; srclen; srclen--, src++)
+    /* tests show that win2k skips white space and punctuation characters
+     * for NORM_IGNORESYMBOLS.
+     */
+    if (is_ignored_symbol(flags, wch))
+        return 0;
+
+    /* In word sort hyphens and apostrophes have no weights of their own.
+     * They only break ties, by their position, after all other weights.
+     */
+    if (!(flags & SORT_STRINGSORT) && (wch == '-' || wch == '\''))
     {
-        unsigned int i, decomposed_len = 1;/*wine_decompose(*src, dummy, 4);*/
-        dummy[0] = *src;
-        if (decomposed_len)
-        {
-            for (i = 0; i < decomposed_len; i++)
-            {
-                WCHAR wch = dummy[i];
-                unsigned int ce;
+        if (level != KEY_SPECIAL) return 0;
+        if (pos > KEY_MAX_POSITION) pos = KEY_MAX_POSITION;
+        key[0] = pos / 254 + 2;
+        key[1] = pos % 254 + 2;
+        key[2] = wch;
+        return 3;
+    }
+    if (level == KEY_SPECIAL)
+        return 0;
 
-                /* tests show that win2k just ignores NORM_IGNORENONSPACE,
-                 * and skips white space and punctuation characters for
-                 * NORM_IGNORESYMBOLS.
-                 */
-                if ((flags & NORM_IGNORESYMBOLS) && (get_char_typeW(wch) & (C1_PUNCT | C1_SPACE)))
-                    continue;
+    if (flags & NORM_IGNORECASE) wch = tolowerW(wch);
 
-                if (flags & NORM_IGNORECASE) wch = tolowerW(wch);
+    ce = get_collation_element(wch);
+    if (ce == (unsigned int)-1)
+    {
+        if (level != KEY_UNICODE) return 0;
+        key[len++] = 0xff;
+        key[len++] = 0xfe;
+        if (wch >> 8) key[len++] = wch >> 8;
+        if (wch & 0xff) key[len++] = wch & 0xff;
+        return len;
+    }
 
-                ce = collation_table[collation_table[wch >> 8] + (wch & 0xff)];
-                if (ce != (unsigned int)-1)
-                {
-                    if (ce >> 16) key_len[0] += 2;
-                    if ((ce >> 8) & 0xff) key_len[1]++;
-                    if ((ce >> 4) & 0x0f) key_len[2]++;
-                    if (ce & 1)
-                    {
-                        if (wch >> 8) key_len[3]++;
-                        key_len[3]++;
-                    }
-                }
-                else
-                {
-                    key_len[0] += 2;
-                    if (wch >> 8) key_len[0]++;
-                    if (wch & 0xff) key_len[0]++;
-		}
-            }
+    switch (level)
+    {
+    case KEY_UNICODE:
+        if (ce >> 16)
+        {
+            key[len++] = ce >> 24;
+            key[len++] = (ce >> 16) & 0xff;
         }
+        break;
+    case KEY_DIACRITIC:
+        /* make key 1 start from 2 */
+        if (!(flags & NORM_IGNORENONSPACE) && ((ce >> 8) & 0xff))
+            key[len++] = ((ce >> 8) & 0xff) + 1;
+        break;
+    case KEY_CASE:
+        /* make key 2 start from 2 */
+        if ((ce >> 4) & 0x0f)
+            key[len++] = ((ce >> 4) & 0x0f) + 1;
+        break;
+    case KEY_CHARACTER:
+        /* key 3 is a character code. It tells apart characters of equal
+         * weights, which the table gives to a letter and its accented forms,
+         * so it goes along with the diacritic weights.
+         */
+        if ((ce & 1) && !(flags & NORM_IGNORENONSPACE))
+        {
+            if (wch >> 8) key[len++] = wch >> 8;
+            if (wch & 0xff) key[len++] = wch & 0xff;
+        }
+        break;
+    }
+    return len;
+}
+
+/*
+ * flags - normalization NORM_* flags
+ *
+ * FIXME: 'variable' flag not handled
+ */
+int wine_get_sortkey(int flags, const WCHAR *src, int srclen, char *dst, int dstlen)
+{
+    unsigned char key[4];
+    int level, pos, i, len, key_len = 0;
+    char *key_ptr = dst;
+
+    for (level = 0; level < KEY_LEVELS; level++)
+    {
+        for (pos = 0; pos < srclen; pos++)
+            key_len += get_key_bytes(flags, level, src, pos, key);
+        if (level != KEY_CHARACTER) key_len++;
     }
 
     if (!dstlen) /* compute length */
-        /* 4 * '\1' + 1 * '\0' + key length */
-        return key_len[0] + key_len[1] + key_len[2] + key_len[3] + 4 + 1;
+        /* '\0' + key length */
+        return key_len + 1;
 
-    if (dstlen < key_len[0] + key_len[1] + key_len[2] + key_len[3] + 4 + 1)
+    if (dstlen < key_len + 1)
         return 0; /* overflow */
 
-    src = src_save;
-    srclen = srclen_save;
-
-    key_ptr[0] = dst;
-    key_ptr[1] = key_ptr[0] + key_len[0] + 1;
-    key_ptr[2] = key_ptr[1] + key_len[1] + 1;
-    key_ptr[3] = key_ptr[2] + key_len[2] + 1;
-
-    for (; srclen; srclen--, src++)
+    for (level = 0; level < KEY_LEVELS; level++)
     {
-        unsigned int i, decomposed_len = 1;/*wine_decompose(*src, dummy, 4);*/
-        dummy[0] = *src;
-        if (decomposed_len)
+        for (pos = 0; pos < srclen; pos++)
         {
-            for (i = 0; i < decomposed_len; i++)
-            {
-                WCHAR wch = dummy[i];
-                unsigned int ce;
-
-                /* tests show that win2k just ignores NORM_IGNORENONSPACE,
-                 * and skips white space and punctuation characters for
-                 * NORM_IGNORESYMBOLS.
-                 */
-                if ((flags & NORM_IGNORESYMBOLS) && (get_char_typeW(wch) & (C1_PUNCT | C1_SPACE)))
-                    continue;
-
-                if (flags & NORM_IGNORECASE) wch = tolowerW(wch);
-
-                ce = collation_table[collation_table[wch >> 8] + (wch & 0xff)];
-                if (ce != (unsigned int)-1)
-                {
-                    WCHAR key;
-                    if ((key = ce >> 16))
-                    {
-                        *key_ptr[0]++ = key >> 8;
-                        *key_ptr[0]++ = key & 0xff;
-                    }
-                    /* make key 1 start from 2 */
-                    if ((key = (ce >> 8) & 0xff)) *key_ptr[1]++ = key + 1;
-                    /* make key 2 start from 2 */
-                    if ((key = (ce >> 4) & 0x0f)) *key_ptr[2]++ = key + 1;
-                    /* key 3 is always a character code */
-                    if (ce & 1)
-                    {
-                        if (wch >> 8) *key_ptr[3]++ = wch >> 8;
-                        if (wch & 0xff) *key_ptr[3]++ = wch & 0xff;
-                    }
-                }
-                else
-                {
-                    *key_ptr[0]++ = 0xff;
-                    *key_ptr[0]++ = 0xfe;
-                    if (wch >> 8) *key_ptr[0]++ = wch >> 8;
-                    if (wch & 0xff) *key_ptr[0]++ = wch & 0xff;
-                }
-            }
+            len = get_key_bytes(flags, level, src, pos, key);
+            for (i = 0; i < len; i++) *key_ptr++ = key[i];
         }
+        if (level != KEY_CHARACTER) *key_ptr++ = '\1';
     }
+    *key_ptr = 0;
 
-    *key_ptr[0] = '\1';
-    *key_ptr[1] = '\1';
-    *key_ptr[2] = '\1';
-    *key_ptr[3]++ = '\1';
-    *key_ptr[3] = 0;
-
-    return key_ptr[3] - dst;
+    return key_ptr - dst;
 }
 
-static inline int compare_unicode_weights(int flags, const WCHAR *str1, int len1,
-                                          const WCHAR *str2, int len2)
+/* Walks through the sort key of a string without storing it */
+struct key_walk
+{
+    const WCHAR *str;
+    int len;
+    int level;
+    int pos;
+    unsigned char key[4];
+    int key_len;
+    int key_pos;
+};
+
+static void init_key_walk(struct key_walk *walk, const WCHAR *str, int len)
 {
-    unsigned int ce1, ce2;
-    int ret;
+    walk->str = str;
+    walk->len = len;
+    walk->level = KEY_UNICODE;
+    walk->pos = 0;
+    walk->key_len = walk->key_pos = 0;
+}
 
-    /* 32-bit collation element table format:
-     * unicode weight - high 16 bit, diacritic weight - high 8 bit of low 16 bit,
-     * case weight - high 4 bit of low 8 bit.
-     */
-    while (len1 > 0 && len2 > 0)
+/* Returns the next byte of the key, or -1 past its end */
+static int next_key_byte(int flags, struct key_walk *walk)
+{
+    while (walk->key_pos == walk->key_len)
     {
-        if (flags & NORM_IGNORESYMBOLS)
+        if (walk->level == KEY_LEVELS)
         {
-            int skip = 0;
-            /* FIXME: not tested */
-            if (get_char_typeW(*str1) & (C1_PUNCT | C1_SPACE))
-            {
-                str1++;
-                len1--;
-                skip = 1;
-            }
-            if (get_char_typeW(*str2) & (C1_PUNCT | C1_SPACE))
-            {
-                str2++;
-                len2--;
-                skip = 1;
-            }
-            if (skip) continue;
+            /* the terminating '\0' */
+            walk->level++;
+            return 0;
         }
+        if (walk->level > KEY_LEVELS)
+            return -1;
 
-       /* hyphen and apostrophe are treated differently depending on
-        * whether SORT_STRINGSORT specified or not
-        */
-        if (!(flags & SORT_STRINGSORT))
+        if (walk->pos < walk->len)
         {
-            if (*str1 == '-' || *str1 == '\'')
-            {
-                if (*str2 != '-' && *str2 != '\'')
-                {
-                    str1++;
-                    len1--;
-                    continue;
-                }
-            }
-            else if (*str2 == '-' || *str2 == '\'')
-            {
-                str2++;
-                len2--;
-                continue;
-            }
+            walk->key_len = get_key_bytes(flags, walk->level, walk->str, walk->pos++, walk->key);
+            walk->key_pos = 0;
+            continue;
         }
 
-        ce1 = collation_table[collation_table[*str1 >> 8] + (*str1 & 0xff)];
-        ce2 = collation_table[collation_table[*str2 >> 8] + (*str2 & 0xff)];
-
-        if (ce1 != (unsigned int)-1 && ce2 != (unsigned int)-1)
-            ret = (ce1 >> 16) - (ce2 >> 16);
-        else
-            ret = *str1 - *str2;
-
-        if (ret) return ret;
-
-        str1++;
-        str2++;
-        len1--;
-        len2--;
-    }
-    while (len1 && !*str1)
-    {
-        str1++;
-        len1--;
+        walk->pos = 0;
+        if (walk->level++ != KEY_CHARACTER)
+            return '\1';
     }
-    while (len2 && !*str2)
-    {
-        str2++;
-        len2--;
-    }
-    return len1 - len2;
+    return walk->key[walk->key_pos++];
 }
 
-static inline int compare_diacritic_weights(int flags, const WCHAR *str1, int len1,
-                                            const WCHAR *str2, int len2)
+/*
+ * Compares the sort keys of both strings, byte by byte, building them only as
+ * far as needed. This usually ends within the unicode weights. Identical
+ * characters add the same bytes to a key level, so they are stepped over
+ * without building those.
+ */
+int wine_compare_string(int flags, const WCHAR *str1, int len1,
+                        const WCHAR *str2, int len2)
 {
-    unsigned int ce1, ce2;
-    int ret;
+    struct key_walk walk1, walk2;
+    int byte1, byte2;
 
-    /* 32-bit collation element table format:
-     * unicode weight - high 16 bit, diacritic weight - high 8 bit of low 16 bit,
-     * case weight - high 4 bit of low 8 bit.
-     */
-    while (len1 > 0 && len2 > 0)
+    init_key_walk(&walk1, str1, len1);
+    init_key_walk(&walk2, str2, len2);
+
+    for (;;)
     {
-        if (flags & NORM_IGNORESYMBOLS)
+        if (walk1.key_pos == walk1.key_len && walk2.key_pos == walk2.key_len &&
+            walk1.level == walk2.level && walk1.level < KEY_LEVELS &&
+            (walk1.level != KEY_SPECIAL || walk1.pos == walk2.pos))
         {
-            int skip = 0;
-            /* FIXME: not tested */
-            if (get_char_typeW(*str1) & (C1_PUNCT | C1_SPACE))
-            {
-                str1++;
-                len1--;
-                skip = 1;
-            }
-            if (get_char_typeW(*str2) & (C1_PUNCT | C1_SPACE))
+            int from_start = !walk1.pos && !walk2.pos;
+
+            while (walk1.pos < len1 && walk2.pos < len2 && str1[walk1.pos] == str2[walk2.pos])
             {
-                str2++;
-                len2--;
-                skip = 1;
+                walk1.pos++;
+                walk2.pos++;
             }
-            if (skip) continue;
-        }
-
-        ce1 = collation_table[collation_table[*str1 >> 8] + (*str1 & 0xff)];
-        ce2 = collation_table[collation_table[*str2 >> 8] + (*str2 & 0xff)];
-
-        if (ce1 != (unsigned int)-1 && ce2 != (unsigned int)-1)
-            ret = ((ce1 >> 8) & 0xff) - ((ce2 >> 8) & 0xff);
-        else
-            ret = *str1 - *str2;
-
-        if (ret) return ret;
-
-        str1++;
-        str2++;
-        len1--;
-        len2--;
-    }
-    while (len1 && !*str1)
-    {
-        str1++;
-        len1--;
-    }
-    while (len2 && !*str2)
-    {
-        str2++;
-        len2--;
-    }
-    return len1 - len2;
-}
 
-static inline int compare_case_weights(int flags, const WCHAR *str1, int len1,
-                                       const WCHAR *str2, int len2)
-{
-    unsigned int ce1, ce2;
-    int ret;
+            /* Identical strings have identical keys */
+            if (from_start && walk1.pos == len1 && walk2.pos == len2)
+                return 0;
 
-    /* 32-bit collation element table format:
-     * unicode weight - high 16 bit, diacritic weight - high 8 bit of low 16 bit,
-     * case weight - high 4 bit of low 8 bit.
-     */
-    while (len1 > 0 && len2 > 0)
-    {
-        if (flags & NORM_IGNORESYMBOLS)
-        {
-            int skip = 0;
-            /* FIXME: not tested */
-            if (get_char_typeW(*str1) & (C1_PUNCT | C1_SPACE))
-            {
-                str1++;
-                len1--;
-                skip = 1;
-            }
-            if (get_char_typeW(*str2) & (C1_PUNCT | C1_SPACE))
+            /* Nothing separates the special weights from key 3 */
+            if (walk1.level == KEY_CHARACTER && walk1.pos == len1 && walk2.pos == len2)
             {
-                str2++;
-                len2--;
-                skip = 1;
+                walk1.level = walk2.level = KEY_SPECIAL;
+                walk1.pos = walk2.pos = 0;
+                continue;
             }
-            if (skip) continue;
         }
 
-        ce1 = collation_table[collation_table[*str1 >> 8] + (*str1 & 0xff)];
-        ce2 = collation_table[collation_table[*str2 >> 8] + (*str2 & 0xff)];
-
-        if (ce1 != (unsigned int)-1 && ce2 != (unsigned int)-1)
-            ret = ((ce1 >> 4) & 0x0f) - ((ce2 >> 4) & 0x0f);
-        else
-            ret = *str1 - *str2;
-
-        if (ret) return ret;
-
-        str1++;
-        str2++;
-        len1--;
-        len2--;
-    }
-    while (len1 && !*str1)
-    {
-        str1++;
-        len1--;
-    }
-    while (len2 && !*str2)
-    {
-        str2++;
-        len2--;
-    }
-    return len1 - len2;
-}
-
-int wine_compare_string(int flags, const WCHAR *str1, int len1,
-                        const WCHAR *str2, int len2)
-{
-    int ret;
-
-    ret = compare_unicode_weights(flags, str1, len1, str2, len2);
-    if (!ret)
-    {
-        if (!(flags & NORM_IGNORENONSPACE))
-            ret = compare_diacritic_weights(flags, str1, len1, str2, len2);
-        if (!ret && !(flags & NORM_IGNORECASE))
-            ret = compare_case_weights(flags, str1, len1, str2, len2);
+        byte1 = next_key_byte(flags, &walk1);
+        byte2 = next_key_byte(flags, &walk2);
+        if (byte1 != byte2) return byte1 - byte2;
+        if (byte1 < 0) return 0;
     }
-    return ret;
 }
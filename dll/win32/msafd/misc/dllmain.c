@@ -815,6 +815,9 @@ ok:
     NtClose((HANDLE)Handle);
     NtClose(SockEvent);
 
+    /* Poll sets may have it registered, or get its handle value again */
+    InterlockedIncrement(&SockCloseGeneration);
+
     if( Socket->SharedDataHandle != INVALID_HANDLE_VALUE )
     {
         /* It is a duplicated socket, so unmap the memory */
@@ -1069,14 +1072,12 @@ WSPSelect(IN int nfds,
           IN const struct timeval *timeout OPTIONAL,
           OUT LPINT lpErrno)
 {
-    IO_STATUS_BLOCK     IOSB;
     PAFD_POLL_INFO      PollInfo;
     NTSTATUS            Status;
     ULONG               HandleCount;
     ULONG               PollBufferSize;
     PVOID               PollBuffer;
     ULONG               i, j = 0, x;
-    HANDLE              SockEvent;
     LARGE_INTEGER       Timeout;
     PSOCKET_INFORMATION Socket;
     SOCKET              Handle;
@@ -1146,21 +1147,6 @@ WSPSelect(IN int nfds,
                      Timeout.u.LowPart);
     }
 
-    Status = NtCreateEvent(&SockEvent,
-                           EVENT_ALL_ACCESS,
-                           NULL,
-                           SynchronizationEvent,
-                           FALSE);
-
-    if(!NT_SUCCESS(Status))
-    {
-        if (lpErrno)
-            *lpErrno = WSAEFAULT;
-
-        ERR("NtCreateEvent failed, 0x%08x\n", Status);
-        return SOCKET_ERROR;
-    }
-
     /* Allocate */
     PollBuffer = HeapAlloc(GlobalHeap, 0, PollBufferSize);
 
@@ -1168,7 +1154,6 @@ WSPSelect(IN int nfds,
     {
         if (lpErrno)
             *lpErrno = WSAEFAULT;
-        NtClose(SockEvent);
         return SOCKET_ERROR;
     }
 
@@ -1176,10 +1161,6 @@ WSPSelect(IN int nfds,
 
     RtlZeroMemory( PollInfo, PollBufferSize );
 
-    /* Number of handles for AFD to Check */
-    PollInfo->Exclusive = FALSE;
-    PollInfo->Timeout = Timeout;
-
     for (i = 0; i < selectfds.fd_count; i++)
     {
         PollInfo->Handles[i].Handle = selectfds.fd_array[i];
@@ -1197,7 +1178,6 @@ WSPSelect(IN int nfds,
                 ERR("Error while counting readfds %ld > %ld\n", j, HandleCount);
                 if (lpErrno) *lpErrno = WSAEFAULT;
                 HeapFree(GlobalHeap, 0, PollBuffer);
-                NtClose(SockEvent);
                 return SOCKET_ERROR;
             }
             Socket = GetSocketStructure(readfds->fd_array[i]);
@@ -1206,7 +1186,6 @@ WSPSelect(IN int nfds,
                 ERR("Invalid socket handle provided in readfds %d\n", readfds->fd_array[i]);
                 if (lpErrno) *lpErrno = WSAENOTSOCK;
                 HeapFree(GlobalHeap, 0, PollBuffer);
-                NtClose(SockEvent);
                 return SOCKET_ERROR;
             }
             PollInfo->Handles[j].Events |= AFD_EVENT_RECEIVE |
@@ -1232,7 +1211,6 @@ WSPSelect(IN int nfds,
                 ERR("Error while counting writefds %ld > %ld\n", j, HandleCount);
                 if (lpErrno) *lpErrno = WSAEFAULT;
                 HeapFree(GlobalHeap, 0, PollBuffer);
-                NtClose(SockEvent);
                 return SOCKET_ERROR;
             }
             Socket = GetSocketStructure(writefds->fd_array[i]);
@@ -1241,7 +1219,6 @@ WSPSelect(IN int nfds,
                 ERR("Invalid socket handle provided in writefds %d\n", writefds->fd_array[i]);
                 if (lpErrno) *lpErrno = WSAENOTSOCK;
                 HeapFree(GlobalHeap, 0, PollBuffer);
-                NtClose(SockEvent);
                 return SOCKET_ERROR;
             }
             PollInfo->Handles[j].Handle = writefds->fd_array[i];
@@ -1264,7 +1241,6 @@ WSPSelect(IN int nfds,
                 ERR("Error while counting exceptfds %ld > %ld\n", j, HandleCount);
                 if (lpErrno) *lpErrno = WSAEFAULT;
                 HeapFree(GlobalHeap, 0, PollBuffer);
-                NtClose(SockEvent);
                 return SOCKET_ERROR;
             }
             Socket = GetSocketStructure(exceptfds->fd_array[i]);
@@ -1273,7 +1249,6 @@ WSPSelect(IN int nfds,
                 TRACE("Invalid socket handle provided in exceptfds %d\n", exceptfds->fd_array[i]);
                 if (lpErrno) *lpErrno = WSAENOTSOCK;
                 HeapFree(GlobalHeap, 0, PollBuffer);
-                NtClose(SockEvent);
                 return SOCKET_ERROR;
             }
             PollInfo->Handles[j].Handle = exceptfds->fd_array[i];
@@ -1284,29 +1259,9 @@ WSPSelect(IN int nfds,
         }
     }
 
-    PollInfo->HandleCount = HandleCount;
-    PollBufferSize = FIELD_OFFSET(AFD_POLL_INFO, Handles) + PollInfo->HandleCount * sizeof(AFD_HANDLE);
-
-    /* Send IOCTL */
-    Status = NtDeviceIoControlFile((HANDLE)PollInfo->Handles[0].Handle,
-                                   SockEvent,
-                                   NULL,
-                                   NULL,
-                                   &IOSB,
-                                   IOCTL_AFD_SELECT,
-                                   PollInfo,
-                                   PollBufferSize,
-                                   PollInfo,
-                                   PollBufferSize);
-
-    TRACE("DeviceIoControlFile => %x\n", Status);
-
-    /* Wait for Completion */
-    if (Status == STATUS_PENDING)
-    {
-        WaitForSingleObject(SockEvent, INFINITE);
-        Status = IOSB.Status;
-    }
+    /* Wait on a poll set, which keeps these sockets registered for the
+     * next select on them */
+    Status = SockPollSetWait(PollInfo->Handles, HandleCount, &Timeout, PollInfo);
 
     /* Clear the Structures */
     if( readfds )
@@ -1332,7 +1287,6 @@ WSPSelect(IN int nfds,
                 TRACE("Invalid socket handle found %d\n", Handle);
                 if (lpErrno) *lpErrno = WSAENOTSOCK;
                 HeapFree(GlobalHeap, 0, PollBuffer);
-                NtClose(SockEvent);
                 return SOCKET_ERROR;
             }
             switch (Events & x)
@@ -1387,11 +1341,10 @@ WSPSelect(IN int nfds,
     }
 
     HeapFree( GlobalHeap, 0, PollBuffer );
-    NtClose( SockEvent );
 
     if( lpErrno )
     {
-        switch( IOSB.Status )
+        switch( Status )
         {
             case STATUS_SUCCESS:
             case STATUS_TIMEOUT:
@@ -2486,6 +2439,7 @@ WSPIoctl(IN  SOCKET Handle,
                 GUID ConnectExGUID = WSAID_CONNECTEX;
                 GUID DisconnectExGUID = WSAID_DISCONNECTEX;
                 GUID GetAcceptExSockaddrsGUID = WSAID_GETACCEPTEXSOCKADDRS;
+                GUID PollGUID = WSAID_ROS_POLL;
 
                 if (IsEqualGUID(&AcceptExGUID, lpvInBuffer))
                 {
@@ -2515,6 +2469,13 @@ WSPIoctl(IN  SOCKET Handle,
                     Errno = NO_ERROR;
                     Ret = NO_ERROR;
                 }
+                else if (IsEqualGUID(&PollGUID, lpvInBuffer))
+                {
+                    *((PVOID *)lpvOutBuffer) = WSPPoll;
+                    cbRet = sizeof(PVOID);
+                    Errno = NO_ERROR;
+                    Ret = NO_ERROR;
+                }
                 else
                 {
                     ERR("Querying unknown extension function: %x\n", ((GUID*)lpvInBuffer)->Data1);
@@ -4051,6 +4012,9 @@ DllMain(HANDLE hInstDll,
         /* Initialize the lock that protects our socket list */
         InitializeCriticalSection(&SocketListLock);
 
+        /* And the pool of poll sets */
+        SockInitializePollSets();
+
         TRACE("MSAFD.DLL has been loaded\n");
 
         break;
@@ -4066,6 +4030,9 @@ DllMain(HANDLE hInstDll,
         /* Delete the socket list lock */
         DeleteCriticalSection(&SocketListLock);
 
+        /* Close the poll sets */
+        SockDestroyPollSets();
+
         break;
     }
 
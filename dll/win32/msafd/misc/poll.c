@@ -0,0 +1,557 @@
+/*
+ * COPYRIGHT:   See COPYING in the top level directory
+ * PROJECT:     ReactOS Ancillary Function Driver DLL
+ * FILE:        dll/win32/msafd/misc/poll.c
+ * PURPOSE:     Select and poll through AFD poll sets
+ */
+
+/* WSAPOLLFD is a Vista type */
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x600
+
+#include <msafd.h>
+#include <stdlib.h>
+
+/*
+ * A poll set lives on an AFD control channel, which keeps the sockets
+ * registered between waits. The set remembers what it registered, so a
+ * caller waiting on the same sockets again only sends the ones that
+ * changed. AFD allows a single waiter per set, so sets are taken from a
+ * pool for the duration of a wait.
+ */
+typedef struct _SOCK_POLL_SET
+{
+    struct _SOCK_POLL_SET *Next;
+    HANDLE Channel;
+    HANDLE Event;
+    LONG Generation;            /* SockCloseGeneration of the last update */
+    ULONG Count;                /* Handles registered */
+    ULONG Size;                 /* Room in Registered and Wanted */
+    PAFD_HANDLE Registered;     /* Sorted by handle */
+    PAFD_HANDLE Wanted;
+    PAFD_POLL_INFO Update;      /* Room for 2 * Size handles */
+} SOCK_POLL_SET, *PSOCK_POLL_SET;
+
+/* Bumped by every close, since the handle of a closed socket may be
+ * registered in a set, or reused by a new socket */
+LONG SockCloseGeneration;
+
+static PSOCK_POLL_SET SockPollSetPool;
+static CRITICAL_SECTION SockPollSetLock;
+
+#define SOCK_POLL_HANGUP_EVENTS (AFD_EVENT_DISCONNECT | AFD_EVENT_ABORT | AFD_EVENT_CLOSE)
+
+static
+int
+__cdecl
+SockCompareHandles(const void *First,
+                   const void *Second)
+{
+    SOCKET FirstHandle = ((const AFD_HANDLE *)First)->Handle;
+    SOCKET SecondHandle = ((const AFD_HANDLE *)Second)->Handle;
+
+    return (FirstHandle > SecondHandle) - (FirstHandle < SecondHandle);
+}
+
+static
+NTSTATUS
+SockOpenPollSetChannel(PSOCK_POLL_SET Set)
+{
+    UNICODE_STRING DeviceName = RTL_CONSTANT_STRING(L"\\Device\\Afd\\PollSet");
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK IoStatus;
+
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &DeviceName,
+                               OBJ_CASE_INSENSITIVE,
+                               NULL,
+                               NULL);
+
+    /* Without an EA, AFD makes this a control channel rather than a socket */
+    return NtCreateFile(&Set->Channel,
+                        GENERIC_READ | GENERIC_WRITE | SYNCHRONIZE,
+                        &ObjectAttributes,
+                        &IoStatus,
+                        NULL,
+                        0,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE,
+                        FILE_OPEN_IF,
+                        0,
+                        NULL,
+                        0);
+}
+
+/* Closing the channel drops everything registered on it */
+static
+NTSTATUS
+SockResetPollSet(PSOCK_POLL_SET Set)
+{
+    NtClose(Set->Channel);
+    Set->Channel = NULL;
+    Set->Count = 0;
+
+    return SockOpenPollSetChannel(Set);
+}
+
+static
+VOID
+SockFreePollSet(PSOCK_POLL_SET Set)
+{
+    if (Set->Channel) NtClose(Set->Channel);
+    if (Set->Event) NtClose(Set->Event);
+    if (Set->Registered) HeapFree(GlobalHeap, 0, Set->Registered);
+    if (Set->Wanted) HeapFree(GlobalHeap, 0, Set->Wanted);
+    if (Set->Update) HeapFree(GlobalHeap, 0, Set->Update);
+    HeapFree(GlobalHeap, 0, Set);
+}
+
+static
+PSOCK_POLL_SET
+SockAcquirePollSet(VOID)
+{
+    PSOCK_POLL_SET Set;
+    NTSTATUS Status;
+
+    EnterCriticalSection(&SockPollSetLock);
+    Set = SockPollSetPool;
+    if (Set) SockPollSetPool = Set->Next;
+    LeaveCriticalSection(&SockPollSetLock);
+
+    if (Set) return Set;
+
+    Set = HeapAlloc(GlobalHeap, HEAP_ZERO_MEMORY, sizeof(*Set));
+    if (!Set) return NULL;
+
+    Status = NtCreateEvent(&Set->Event,
+                           EVENT_ALL_ACCESS,
+                           NULL,
+                           SynchronizationEvent,
+                           FALSE);
+    if (NT_SUCCESS(Status))
+        Status = SockOpenPollSetChannel(Set);
+
+    if (!NT_SUCCESS(Status))
+    {
+        ERR("Failed to create a poll set, 0x%08x\n", Status);
+        SockFreePollSet(Set);
+        return NULL;
+    }
+
+    Set->Generation = SockCloseGeneration;
+    return Set;
+}
+
+static
+VOID
+SockReleasePollSet(PSOCK_POLL_SET Set)
+{
+    /* A set that lost its channel is of no use anymore */
+    if (!Set->Channel)
+    {
+        SockFreePollSet(Set);
+        return;
+    }
+
+    EnterCriticalSection(&SockPollSetLock);
+    Set->Next = SockPollSetPool;
+    SockPollSetPool = Set;
+    LeaveCriticalSection(&SockPollSetLock);
+}
+
+static
+BOOLEAN
+SockGrowPollSet(PSOCK_POLL_SET Set,
+                ULONG Size)
+{
+    PVOID Buffer;
+
+    if (Size <= Set->Size) return TRUE;
+
+    if (Size > (MAXLONG - sizeof(AFD_POLL_INFO)) / (2 * sizeof(AFD_HANDLE)))
+        return FALSE;
+
+    /* The registered handles have to survive */
+    if (Set->Registered)
+        Buffer = HeapReAlloc(GlobalHeap, 0, Set->Registered, Size * sizeof(AFD_HANDLE));
+    else
+        Buffer = HeapAlloc(GlobalHeap, 0, Size * sizeof(AFD_HANDLE));
+    if (!Buffer) return FALSE;
+    Set->Registered = Buffer;
+
+    Buffer = HeapAlloc(GlobalHeap, 0, Size * sizeof(AFD_HANDLE));
+    if (!Buffer) return FALSE;
+    if (Set->Wanted) HeapFree(GlobalHeap, 0, Set->Wanted);
+    Set->Wanted = Buffer;
+
+    Buffer = HeapAlloc(GlobalHeap, 0, sizeof(AFD_POLL_INFO) + 2 * Size * sizeof(AFD_HANDLE));
+    if (!Buffer) return FALSE;
+    if (Set->Update) HeapFree(GlobalHeap, 0, Set->Update);
+    Set->Update = Buffer;
+
+    Set->Size = Size;
+    return TRUE;
+}
+
+static
+NTSTATUS
+SockPollSetIoctl(PSOCK_POLL_SET Set,
+                 ULONG IoControlCode,
+                 PAFD_POLL_INFO PollInfo,
+                 ULONG InputLength,
+                 ULONG OutputLength)
+{
+    IO_STATUS_BLOCK IoStatus;
+    NTSTATUS Status;
+
+    Status = NtDeviceIoControlFile(Set->Channel,
+                                   Set->Event,
+                                   NULL,
+                                   NULL,
+                                   &IoStatus,
+                                   IoControlCode,
+                                   PollInfo,
+                                   InputLength,
+                                   OutputLength ? PollInfo : NULL,
+                                   OutputLength);
+    if (Status == STATUS_PENDING)
+    {
+        NtWaitForSingleObject(Set->Event, FALSE, NULL);
+        Status = IoStatus.Status;
+    }
+
+    return Status;
+}
+
+/* Puts the handles that differ between Registered and Wanted in Update */
+static
+ULONG
+SockDiffPollSet(PSOCK_POLL_SET Set,
+                ULONG WantedCount)
+{
+    PAFD_HANDLE Registered = Set->Registered;
+    PAFD_HANDLE Wanted = Set->Wanted;
+    PAFD_HANDLE Update = Set->Update->Handles;
+    ULONG i = 0, j = 0, Count = 0;
+
+    while (i < Set->Count || j < WantedCount)
+    {
+        if (j == WantedCount ||
+            (i < Set->Count && Registered[i].Handle < Wanted[j].Handle))
+        {
+            /* No longer wanted, events of 0 remove it */
+            Update[Count].Handle = Registered[i++].Handle;
+            Update[Count].Events = 0;
+            Update[Count++].Status = STATUS_SUCCESS;
+        }
+        else if (i == Set->Count || Wanted[j].Handle < Registered[i].Handle)
+        {
+            /* New one */
+            Update[Count++] = Wanted[j++];
+        }
+        else
+        {
+            /* Registered already, only send it if its events changed */
+            if (Registered[i].Events != Wanted[j].Events)
+                Update[Count++] = Wanted[j];
+            i++;
+            j++;
+        }
+    }
+
+    return Count;
+}
+
+/* Registers exactly the given handles in the set */
+static
+NTSTATUS
+SockUpdatePollSet(PSOCK_POLL_SET Set,
+                  PAFD_HANDLE Handles,
+                  ULONG HandleCount)
+{
+    LONG Generation = SockCloseGeneration;
+    ULONG WantedCount, UpdateCount, i;
+    BOOLEAN Retried = FALSE;
+    PAFD_HANDLE Swap;
+    NTSTATUS Status;
+
+    /* Sort them, merging handles given more than once */
+    RtlCopyMemory(Set->Wanted, Handles, HandleCount * sizeof(AFD_HANDLE));
+    qsort(Set->Wanted, HandleCount, sizeof(AFD_HANDLE), SockCompareHandles);
+    Set->Wanted[0].Status = STATUS_SUCCESS;
+    for (i = 1, WantedCount = 1; i < HandleCount; i++)
+    {
+        if (Set->Wanted[i].Handle == Set->Wanted[WantedCount - 1].Handle)
+        {
+            Set->Wanted[WantedCount - 1].Events |= Set->Wanted[i].Events;
+        }
+        else
+        {
+            Set->Wanted[WantedCount] = Set->Wanted[i];
+            Set->Wanted[WantedCount++].Status = STATUS_SUCCESS;
+        }
+    }
+
+    /* What is registered can't be trusted after a close, start over */
+    if (Set->Generation != Generation)
+    {
+        Status = SockResetPollSet(Set);
+        if (!NT_SUCCESS(Status)) return Status;
+    }
+
+    for (;;)
+    {
+        UpdateCount = SockDiffPollSet(Set, WantedCount);
+        if (!UpdateCount) break;
+
+        Set->Update->Timeout.QuadPart = 0;
+        Set->Update->HandleCount = UpdateCount;
+        Set->Update->Exclusive = FALSE;
+        Status = SockPollSetIoctl(Set,
+                                  IOCTL_AFD_POLL_SET_UPDATE,
+                                  Set->Update,
+                                  FIELD_OFFSET(AFD_POLL_INFO, Handles[UpdateCount]),
+                                  0);
+        if (NT_SUCCESS(Status)) break;
+
+        /* AFD stops at the first bad handle, so what is registered is
+         * unknown now. A socket being removed may have been closed under
+         * us, try again once with the wanted ones only. */
+        if (Retried || !Set->Count)
+        {
+            if (NT_SUCCESS(SockResetPollSet(Set)))
+                Set->Generation = Generation;
+            return Status;
+        }
+
+        Status = SockResetPollSet(Set);
+        if (!NT_SUCCESS(Status)) return Status;
+        Retried = TRUE;
+    }
+
+    Swap = Set->Registered;
+    Set->Registered = Set->Wanted;
+    Set->Wanted = Swap;
+    Set->Count = WantedCount;
+    Set->Generation = Generation;
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+SockInitializePollSets(VOID)
+{
+    InitializeCriticalSection(&SockPollSetLock);
+}
+
+VOID
+SockDestroyPollSets(VOID)
+{
+    PSOCK_POLL_SET Set;
+
+    while (SockPollSetPool)
+    {
+        Set = SockPollSetPool;
+        SockPollSetPool = Set->Next;
+        SockFreePollSet(Set);
+    }
+
+    DeleteCriticalSection(&SockPollSetLock);
+}
+
+/*
+ * Waits for events on the given handles. PollInfo must have room for
+ * HandleCount handles, and may hold the given handles. It receives the
+ * handles with events pending and these events.
+ */
+NTSTATUS
+SockPollSetWait(IN PAFD_HANDLE Handles,
+                IN ULONG HandleCount,
+                IN PLARGE_INTEGER Timeout,
+                OUT PAFD_POLL_INFO PollInfo)
+{
+    PSOCK_POLL_SET Set;
+    NTSTATUS Status;
+
+    ASSERT(HandleCount != 0);
+
+    Set = SockAcquirePollSet();
+    if (!Set)
+    {
+        PollInfo->HandleCount = 0;
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    if (SockGrowPollSet(Set, HandleCount))
+        Status = SockUpdatePollSet(Set, Handles, HandleCount);
+    else
+        Status = STATUS_NO_MEMORY;
+
+    if (NT_SUCCESS(Status))
+    {
+        PollInfo->Timeout = *Timeout;
+        PollInfo->HandleCount = 0;
+        PollInfo->Exclusive = FALSE;
+        Status = SockPollSetIoctl(Set,
+                                  IOCTL_AFD_POLL_SET_WAIT,
+                                  PollInfo,
+                                  FIELD_OFFSET(AFD_POLL_INFO, Handles),
+                                  sizeof(AFD_POLL_INFO) + (HandleCount - 1) * sizeof(AFD_HANDLE));
+    }
+
+    if (!NT_SUCCESS(Status))
+        PollInfo->HandleCount = 0;
+
+    SockReleasePollSet(Set);
+
+    TRACE("Poll set wait of %lu handles => %x, %lu ready\n",
+          HandleCount, Status, PollInfo->HandleCount);
+
+    return Status;
+}
+
+static
+ULONG
+SockPollToAfdEvents(SHORT Events)
+{
+    /* Hang-ups and errors are reported whatever was asked for */
+    ULONG AfdEvents = SOCK_POLL_HANGUP_EVENTS | AFD_EVENT_CONNECT_FAIL;
+
+    if (Events & POLLRDNORM)
+        AfdEvents |= AFD_EVENT_RECEIVE | AFD_EVENT_ACCEPT;
+    if (Events & (POLLRDBAND | POLLPRI))
+        AfdEvents |= AFD_EVENT_OOB_RECEIVE;
+    if (Events & POLLWRNORM)
+        AfdEvents |= AFD_EVENT_SEND | AFD_EVENT_CONNECT;
+
+    return AfdEvents;
+}
+
+static
+SHORT
+SockAfdToPollEvents(ULONG AfdEvents,
+                    SHORT Events)
+{
+    SHORT Result = 0;
+
+    if (AfdEvents & (AFD_EVENT_RECEIVE | AFD_EVENT_ACCEPT))
+        Result |= POLLRDNORM;
+    if (AfdEvents & AFD_EVENT_OOB_RECEIVE)
+        Result |= POLLRDBAND | POLLPRI;
+    if (AfdEvents & (AFD_EVENT_SEND | AFD_EVENT_CONNECT))
+        Result |= POLLWRNORM;
+    if (AfdEvents & SOCK_POLL_HANGUP_EVENTS)
+        Result |= POLLHUP;
+    if (AfdEvents & AFD_EVENT_CONNECT_FAIL)
+        Result |= POLLERR;
+
+    /* A socket given twice gets the events of both */
+    return Result & (Events | POLLHUP | POLLERR);
+}
+
+/*
+ * @implemented
+ */
+INT
+WSPAPI
+WSPPoll(IN OUT LPWSAPOLLFD fdArray,
+        IN ULONG fds,
+        IN INT timeout,
+        OUT LPINT lpErrno)
+{
+    PAFD_POLL_INFO PollInfo;
+    PAFD_HANDLE Handle;
+    AFD_HANDLE Key;
+    LARGE_INTEGER Timeout;
+    ULONG HandleCount = 0, i;
+    NTSTATUS Status;
+    INT Ready = 0;
+
+    TRACE("WSPPoll: %p %lu %d\n", fdArray, fds, timeout);
+
+    if (!fdArray || !fds ||
+        fds > (MAXLONG - sizeof(AFD_POLL_INFO)) / sizeof(AFD_HANDLE))
+    {
+        if (lpErrno) *lpErrno = WSAEINVAL;
+        return SOCKET_ERROR;
+    }
+
+    PollInfo = HeapAlloc(GlobalHeap, 0, sizeof(AFD_POLL_INFO) + fds * sizeof(AFD_HANDLE));
+    if (!PollInfo)
+    {
+        if (lpErrno) *lpErrno = WSAENOBUFS;
+        return SOCKET_ERROR;
+    }
+
+    for (i = 0; i < fds; i++)
+    {
+        fdArray[i].revents = 0;
+
+        /* Negative descriptors are ignored */
+        if (fdArray[i].fd == INVALID_SOCKET) continue;
+
+        if (!GetSocketStructure(fdArray[i].fd))
+        {
+            fdArray[i].revents = POLLNVAL;
+            Ready++;
+            continue;
+        }
+
+        PollInfo->Handles[HandleCount].Handle = fdArray[i].fd;
+        PollInfo->Handles[HandleCount].Events = SockPollToAfdEvents(fdArray[i].events);
+        PollInfo->Handles[HandleCount].Status = STATUS_SUCCESS;
+        HandleCount++;
+    }
+
+    if (!HandleCount)
+    {
+        HeapFree(GlobalHeap, 0, PollInfo);
+        if (lpErrno) *lpErrno = NO_ERROR;
+        return Ready;
+    }
+
+    /* Don't wait when there is something to report already */
+    if (Ready || !timeout)
+    {
+        Timeout.QuadPart = 0;
+    }
+    else if (timeout < 0)
+    {
+        Timeout.u.LowPart = -1;
+        Timeout.u.HighPart = 0x7FFFFFFF;
+    }
+    else
+    {
+        Timeout = RtlEnlargedIntegerMultiply(timeout, -10000);
+    }
+
+    Status = SockPollSetWait(PollInfo->Handles, HandleCount, &Timeout, PollInfo);
+    if (!NT_SUCCESS(Status))
+    {
+        HeapFree(GlobalHeap, 0, PollInfo);
+        return MsafdReturnWithErrno(Status, lpErrno, 0, NULL);
+    }
+
+    /* Look up each descriptor among the ready ones */
+    qsort(PollInfo->Handles, PollInfo->HandleCount, sizeof(AFD_HANDLE), SockCompareHandles);
+
+    for (i = 0; PollInfo->HandleCount && i < fds; i++)
+    {
+        if (fdArray[i].fd == INVALID_SOCKET || fdArray[i].revents) continue;
+
+        Key.Handle = fdArray[i].fd;
+        Handle = bsearch(&Key,
+                         PollInfo->Handles,
+                         PollInfo->HandleCount,
+                         sizeof(AFD_HANDLE),
+                         SockCompareHandles);
+        if (!Handle) continue;
+
+        fdArray[i].revents = SockAfdToPollEvents(Handle->Events, fdArray[i].events);
+        if (fdArray[i].revents) Ready++;
+    }
+
+    HeapFree(GlobalHeap, 0, PollInfo);
+
+    if (lpErrno) *lpErrno = NO_ERROR;
+    return Ready;
+}
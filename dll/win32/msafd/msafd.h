@@ -28,6 +28,7 @@
 #include <tdi.h>
 #include <afd/shared.h>
 #include <mswsock.h>
+#include <winsock/wsppoll.h>
 
 #include <wine/debug.h>
 WINE_DEFAULT_DEBUG_CHANNEL(msafd);
@@ -539,6 +540,36 @@ SockReenableAsyncSelectEvent (
     IN ULONG Event
     );
 
+/* poll.c */
+extern LONG SockCloseGeneration;
+
+VOID
+SockInitializePollSets(
+    VOID
+);
+
+VOID
+SockDestroyPollSets(
+    VOID
+);
+
+NTSTATUS
+SockPollSetWait(
+    IN PAFD_HANDLE Handles,
+    IN ULONG HandleCount,
+    IN PLARGE_INTEGER Timeout,
+    OUT PAFD_POLL_INFO PollInfo
+);
+
+INT
+WSPAPI
+WSPPoll(
+    IN OUT struct pollfd *fdArray,
+    IN ULONG fds,
+    IN INT timeout,
+    OUT LPINT lpErrno
+);
+
 typedef VOID (*PASYNC_COMPLETION_ROUTINE)(PVOID Context, PIO_STATUS_BLOCK IoStatusBlock);
 
 FORCEINLINE
@@ -0,0 +1,314 @@
+/*
+ * COPYRIGHT:   See COPYING in the top level directory
+ * PROJECT:     ReactOS WinSock 2 API
+ * FILE:        dll/win32/ws2_32/src/poll.c
+ * PURPOSE:     Socket Poll Support
+ */
+
+/* INCLUDES ******************************************************************/
+
+/* WSAPOLLFD is a Vista type */
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x600
+
+#include <ws2_32.h>
+#include <wsppoll.h>
+
+#define NDEBUG
+#include <debug.h>
+
+/* DATA **********************************************************************/
+
+#define WS_POLL_READ    (POLLRDNORM)
+#define WS_POLL_EXCEPT  (POLLRDBAND | POLLPRI)
+#define WS_POLL_WRITE   (POLLWRNORM)
+
+/* FUNCTIONS *****************************************************************/
+
+/*
+ * Tells apart the reasons for which select reported a socket as readable:
+ * data (or a connection to accept), the peer closing the connection, or
+ * an error.
+ */
+static
+SHORT
+WsPollGetReadEvents(IN SOCKET Socket,
+                    IN SHORT Events)
+{
+    INT Type, Listening, Length, Result;
+    CHAR Byte;
+
+    /* Only connected stream sockets can hang up */
+    Length = sizeof(Type);
+    if (getsockopt(Socket, SOL_SOCKET, SO_TYPE, (PCHAR)&Type, &Length) == SOCKET_ERROR ||
+        Type != SOCK_STREAM)
+    {
+        return Events & WS_POLL_READ;
+    }
+    Length = sizeof(Listening);
+    if (getsockopt(Socket, SOL_SOCKET, SO_ACCEPTCONN, (PCHAR)&Listening, &Length) == SOCKET_ERROR ||
+        Listening)
+    {
+        return Events & WS_POLL_READ;
+    }
+
+    /* Readable with nothing to read means the peer closed its side */
+    Result = recv(Socket, &Byte, sizeof(Byte), MSG_PEEK);
+    if (Result > 0) return Events & WS_POLL_READ;
+    if (Result == 0) return (Events & WS_POLL_READ) | POLLHUP;
+
+    switch (WSAGetLastError())
+    {
+        case WSAECONNRESET:
+        case WSAECONNABORTED:
+        case WSAENETRESET:
+            return POLLHUP;
+
+        case WSAEWOULDBLOCK:
+            return Events & WS_POLL_READ;
+
+        default:
+            return POLLERR;
+    }
+}
+
+/*
+ * Tells out of band data from a pending error, which select both reports
+ * through the exception set.
+ */
+static
+SHORT
+WsPollGetExceptEvents(IN SOCKET Socket,
+                      IN SHORT Events)
+{
+    INT Error = 0, Length = sizeof(Error);
+
+    if (getsockopt(Socket, SOL_SOCKET, SO_ERROR, (PCHAR)&Error, &Length) == SOCKET_ERROR ||
+        Error != 0)
+    {
+        return POLLERR;
+    }
+
+    return Events & WS_POLL_EXCEPT;
+}
+
+/*
+ * Polls through select, for providers without the poll extension. The
+ * array is turned into sets for it, one allocation with each set large
+ * enough for all.
+ */
+static
+INT
+WsPollSelect(IN OUT LPWSAPOLLFD fdArray,
+             IN ULONG fds,
+             IN INT timeout)
+{
+    PWSSOCKET Socket;
+    LPFD_SET ReadSet, WriteSet, ExceptSet;
+    struct timeval Timeout, *TimeoutPtr = NULL;
+    ULONG SetSize, Waiting = 0, i;
+    INT Status, Ready = 0;
+
+    if (fds > (MAXULONG / 3 - sizeof(fd_set)) / sizeof(SOCKET))
+    {
+        SetLastError(WSAEINVAL);
+        return SOCKET_ERROR;
+    }
+
+    SetSize = FIELD_OFFSET(fd_set, fd_array[fds]);
+    ReadSet = HeapAlloc(WsSockHeap, 0, SetSize * 3);
+    if (!ReadSet)
+    {
+        SetLastError(WSAENOBUFS);
+        return SOCKET_ERROR;
+    }
+    WriteSet = (LPFD_SET)((PCHAR)ReadSet + SetSize);
+    ExceptSet = (LPFD_SET)((PCHAR)WriteSet + SetSize);
+    ReadSet->fd_count = WriteSet->fd_count = ExceptSet->fd_count = 0;
+
+    for (i = 0; i < fds; i++)
+    {
+        fdArray[i].revents = 0;
+
+        /* Negative descriptors are ignored */
+        if (fdArray[i].fd == INVALID_SOCKET) continue;
+
+        /* Make sure it is a socket we know about */
+        Socket = WsSockGetSocket(fdArray[i].fd);
+        if (!Socket)
+        {
+            fdArray[i].revents = POLLNVAL;
+            Ready++;
+            continue;
+        }
+        WsSockDereference(Socket);
+
+        /* Hang-ups and errors of a connection show as readability */
+        if (fdArray[i].events & WS_POLL_READ)
+            ReadSet->fd_array[ReadSet->fd_count++] = fdArray[i].fd;
+        if (fdArray[i].events & WS_POLL_WRITE)
+            WriteSet->fd_array[WriteSet->fd_count++] = fdArray[i].fd;
+        if (fdArray[i].events & WS_POLL_EXCEPT)
+            ExceptSet->fd_array[ExceptSet->fd_count++] = fdArray[i].fd;
+
+        if (fdArray[i].events & (WS_POLL_READ | WS_POLL_WRITE | WS_POLL_EXCEPT))
+            Waiting++;
+    }
+
+    if (!Waiting)
+    {
+        /* Nothing to wait on */
+        HeapFree(WsSockHeap, 0, ReadSet);
+        return Ready;
+    }
+
+    /* Don't wait when there is something to report already */
+    if (Ready)
+    {
+        Timeout.tv_sec = Timeout.tv_usec = 0;
+        TimeoutPtr = &Timeout;
+    }
+    else if (timeout >= 0)
+    {
+        Timeout.tv_sec = timeout / 1000;
+        Timeout.tv_usec = (timeout % 1000) * 1000;
+        TimeoutPtr = &Timeout;
+    }
+
+    Status = select(0, ReadSet, WriteSet, ExceptSet, TimeoutPtr);
+    if (Status == SOCKET_ERROR)
+    {
+        HeapFree(WsSockHeap, 0, ReadSet);
+        return SOCKET_ERROR;
+    }
+
+    for (i = 0; Status && i < fds; i++)
+    {
+        if (fdArray[i].fd == INVALID_SOCKET || fdArray[i].revents) continue;
+
+        if (__WSAFDIsSet(fdArray[i].fd, ReadSet))
+            fdArray[i].revents |= WsPollGetReadEvents(fdArray[i].fd, fdArray[i].events);
+        if (__WSAFDIsSet(fdArray[i].fd, WriteSet))
+            fdArray[i].revents |= (fdArray[i].events & WS_POLL_WRITE);
+        if (__WSAFDIsSet(fdArray[i].fd, ExceptSet))
+            fdArray[i].revents |= WsPollGetExceptEvents(fdArray[i].fd, fdArray[i].events);
+
+        if (fdArray[i].revents) Ready++;
+    }
+
+    HeapFree(WsSockHeap, 0, ReadSet);
+    return Ready;
+}
+
+/*
+ * Returns a socket of the provider all the known sockets of the array
+ * belong to, referenced, or NULL if there is none or several providers.
+ */
+static
+PWSSOCKET
+WsPollGetProviderSocket(IN LPWSAPOLLFD fdArray,
+                        IN ULONG fds)
+{
+    PWSSOCKET Socket, First = NULL;
+    ULONG i;
+
+    for (i = 0; i < fds; i++)
+    {
+        if (fdArray[i].fd == INVALID_SOCKET) continue;
+
+        /* Unknown ones are reported invalid by the provider as well */
+        Socket = WsSockGetSocket(fdArray[i].fd);
+        if (!Socket) continue;
+
+        if (!First)
+        {
+            First = Socket;
+            continue;
+        }
+
+        if (Socket->Provider != First->Provider)
+        {
+            WsSockDereference(Socket);
+            WsSockDereference(First);
+            return NULL;
+        }
+        WsSockDereference(Socket);
+    }
+
+    return First;
+}
+
+/*
+ * @implemented
+ */
+INT
+WSAAPI
+WSAPoll(IN OUT LPWSAPOLLFD fdArray,
+        IN ULONG fds,
+        IN INT timeout)
+{
+    PWSSOCKET Socket;
+    LPWSATHREADID ThreadId;
+    LPFN_WSPPOLL WSPPoll;
+    GUID PollGuid = WSAID_ROS_POLL;
+    DWORD BytesReturned;
+    INT ErrorCode;
+    INT Status;
+
+    DPRINT("WSAPoll: %p %lu %d\n", fdArray, fds, timeout);
+
+    /* Check for WSAStartup */
+    ErrorCode = WsQuickPrologTid(&ThreadId);
+
+    if (ErrorCode != ERROR_SUCCESS)
+    {
+        SetLastError(ErrorCode);
+        return SOCKET_ERROR;
+    }
+
+    if (!fdArray || !fds)
+    {
+        SetLastError(WSAEINVAL);
+        return SOCKET_ERROR;
+    }
+
+    /* Let the provider poll its sockets itself if it can */
+    Socket = WsPollGetProviderSocket(fdArray, fds);
+    if (!Socket)
+        return WsPollSelect(fdArray, fds, timeout);
+
+    Status = Socket->Provider->Service.lpWSPIoctl((SOCKET)Socket->Handle,
+                                                  SIO_GET_EXTENSION_FUNCTION_POINTER,
+                                                  &PollGuid,
+                                                  sizeof(PollGuid),
+                                                  &WSPPoll,
+                                                  sizeof(WSPPoll),
+                                                  &BytesReturned,
+                                                  NULL,
+                                                  NULL,
+                                                  ThreadId,
+                                                  &ErrorCode);
+    if (Status != ERROR_SUCCESS)
+    {
+        WsSockDereference(Socket);
+        return WsPollSelect(fdArray, fds, timeout);
+    }
+
+    /* Make the call, the reference keeps the provider loaded */
+    Status = WSPPoll((struct pollfd *)fdArray, fds, timeout, &ErrorCode);
+
+    /* Deference the Socket Context */
+    WsSockDereference(Socket);
+
+    /* Return Provider Value */
+    if (Status != SOCKET_ERROR)
+        return Status;
+
+    /* If everything seemed fine, then the WSP call failed itself */
+    if (ErrorCode == NO_ERROR)
+        ErrorCode = WSASYSCALLFAILURE;
+
+    /* Return with an error */
+    SetLastError(ErrorCode);
+    return SOCKET_ERROR;
+}
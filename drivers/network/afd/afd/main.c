@@ -367,6 +367,8 @@ AfdCreateSocket(PDEVICE_OBJECT DeviceObject, PIRP Irp,
 
     InitializeListHead( &FCB->DatagramList );
     InitializeListHead( &FCB->PendingConnections );
+    InitializeListHead( &FCB->PollEntries );
+    InitializeListHead( &FCB->PollMembers );
 
     AFD_DbgPrint(MID_TRACE,("%p: Checking command channel\n", FCB));
 
@@ -452,6 +454,8 @@ AfdCleanupSocket(PDEVICE_OBJECT DeviceObject, PIRP Irp,
     }
 
     KillSelectsForFCB( FCB->DeviceExt, FileObject, FALSE );
+    RemovePollSetMembers( FCB );
+    DestroyPollSet( FCB );
 
     return UnlockAndMaybeComplete(FCB, STATUS_SUCCESS, Irp, 0);
 }
@@ -971,6 +975,12 @@ AfdDispatch(PDEVICE_OBJECT DeviceObject, PIRP Irp)
         case IOCTL_AFD_ENUM_NETWORK_EVENTS:
             return AfdEnumEvents( DeviceObject, Irp, IrpSp );
 
+        case IOCTL_AFD_POLL_SET_UPDATE:
+            return AfdPollSetUpdate( DeviceObject, Irp, IrpSp );
+
+        case IOCTL_AFD_POLL_SET_WAIT:
+            return AfdPollSetWait( DeviceObject, Irp, IrpSp );
+
         case IOCTL_AFD_RECV_DATAGRAM:
             return AfdPacketSocketReadData( DeviceObject, Irp, IrpSp );
 
@@ -1267,6 +1277,11 @@ AfdCancelHandler(PDEVICE_OBJECT DeviceObject,
             DbgPrint("WARNING!!! IRP cancellation race could lead to a process hang! (IOCTL_AFD_SELECT)\n");
             return;
 
+        case IOCTL_AFD_POLL_SET_WAIT:
+            CancelPollSetWait(FCB, Irp);
+            SocketStateUnlock(FCB);
+            return;
+
         case IOCTL_AFD_DISCONNECT:
             Function = FUNCTION_DISCONNECT;
             break;
@@ -41,6 +41,8 @@ static VOID CopyBackStatus( PAFD_HANDLE HandleArray,
     }
 }
 
+static VOID TryCompletePollSetWait( PAFD_POLL_SET Set );
+
 VOID ZeroEvents( PAFD_HANDLE HandleArray,
                  UINT HandleCount ) {
     UINT i;
@@ -68,6 +70,8 @@ VOID SignalSocket(
     {
         KeCancelTimer( &Poll->Timer );
         RemoveEntryList( &Poll->ListEntry );
+        for( i = 0; i < Poll->HandleCount; i++ )
+            RemoveEntryList( &Poll->Entries[i].ListEntry );
         ExFreePoolWithTag(Poll, TAG_AFD_ACTIVE_POLL);
     }
 
@@ -127,33 +131,28 @@ VOID KillSelectsForFCB( PAFD_DEVICE_EXTENSION DeviceExt,
                         BOOLEAN OnlyExclusive ) {
     KIRQL OldIrql;
     PLIST_ENTRY ListEntry;
+    PAFD_POLL_ENTRY Entry;
     PAFD_ACTIVE_POLL Poll;
-    PIRP Irp;
     PAFD_POLL_INFO PollReq;
-    PAFD_HANDLE HandleArray;
-    UINT i;
+    PAFD_FCB FCB = FileObject->FsContext;
 
     AFD_DbgPrint(MID_TRACE,("Killing selects that refer to %p\n", FileObject));
 
     KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
 
-    ListEntry = DeviceExt->Polls.Flink;
-    while ( ListEntry != &DeviceExt->Polls ) {
-        Poll = CONTAINING_RECORD(ListEntry, AFD_ACTIVE_POLL, ListEntry);
-        ListEntry = ListEntry->Flink;
-        Irp = Poll->Irp;
-        PollReq = Irp->AssociatedIrp.SystemBuffer;
-        HandleArray = AFD_HANDLES(PollReq);
+    ListEntry = FCB->PollEntries.Flink;
+    while ( ListEntry != &FCB->PollEntries ) {
+        Entry = CONTAINING_RECORD(ListEntry, AFD_POLL_ENTRY, ListEntry);
+        Poll = Entry->Poll;
+        PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
 
-        for( i = 0; i < PollReq->HandleCount; i++ ) {
-            AFD_DbgPrint(MAX_TRACE,("Req: %u, This %p\n",
-                                    HandleArray[i].Handle, FileObject));
-            if( (PVOID)HandleArray[i].Handle == FileObject &&
-                (!OnlyExclusive || (OnlyExclusive && Poll->Exclusive)) ) {
-                ZeroEvents( PollReq->Handles, PollReq->HandleCount );
-                SignalSocket( Poll, NULL, PollReq, STATUS_CANCELLED );
-            }
-        }
+        if( !OnlyExclusive || Poll->Exclusive ) {
+            ZeroEvents( PollReq->Handles, PollReq->HandleCount );
+            SignalSocket( Poll, NULL, PollReq, STATUS_CANCELLED );
+            /* The poll may have had this socket more than once */
+            ListEntry = FCB->PollEntries.Flink;
+        } else
+            ListEntry = ListEntry->Flink;
     }
 
     KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
@@ -189,6 +188,19 @@ AfdSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
         return STATUS_NO_MEMORY;
     }
 
+    /* We are going to queue the poll on their FCBs, they'd better be ours */
+    for( i = 0; i < PollReq->HandleCount; i++ ) {
+        FileObject = (PFILE_OBJECT)AFD_HANDLES(PollReq)[i].Handle;
+        if( FileObject && (FileObject->DeviceObject != DeviceObject ||
+                           !FileObject->FsContext) ) {
+            UnlockHandles( AFD_HANDLES(PollReq), PollReq->HandleCount );
+            Irp->IoStatus.Status = STATUS_INVALID_HANDLE;
+            Irp->IoStatus.Information = 0;
+            IoCompleteRequest( Irp, IO_NETWORK_INCREMENT );
+            return STATUS_INVALID_HANDLE;
+        }
+    }
+
     if( Exclusive ) {
         for( i = 0; i < PollReq->HandleCount; i++ ) {
             if( !AFD_HANDLES(PollReq)[i].Handle ) continue;
@@ -229,13 +241,27 @@ AfdSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
        PAFD_ACTIVE_POLL Poll = NULL;
 
        Poll = ExAllocatePoolWithTag(NonPagedPool,
-                                    sizeof(AFD_ACTIVE_POLL),
+                                    FIELD_OFFSET(AFD_ACTIVE_POLL, Entries) +
+                                    PollReq->HandleCount * sizeof(AFD_POLL_ENTRY),
                                     TAG_AFD_ACTIVE_POLL);
 
        if (Poll){
           Poll->Irp = Irp;
           Poll->DeviceExt = DeviceExt;
           Poll->Exclusive = Exclusive;
+          Poll->HandleCount = PollReq->HandleCount;
+
+          for( i = 0; i < PollReq->HandleCount; i++ ) {
+              Poll->Entries[i].Poll = Poll;
+              if( !AFD_HANDLES(PollReq)[i].Handle ) {
+                  InitializeListHead( &Poll->Entries[i].ListEntry );
+                  continue;
+              }
+
+              FileObject = (PFILE_OBJECT)AFD_HANDLES(PollReq)[i].Handle;
+              FCB = FileObject->FsContext;
+              InsertTailList( &FCB->PollEntries, &Poll->Entries[i].ListEntry );
+          }
 
           KeInitializeTimerEx( &Poll->Timer, NotificationTimer );
 
@@ -406,10 +432,13 @@ static BOOLEAN UpdatePollWithFCB( PAFD_ACTIVE_POLL Poll, PFILE_OBJECT FileObject
 
 VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
     PAFD_ACTIVE_POLL Poll = NULL;
-    PLIST_ENTRY ThePollEnt = NULL;
+    PAFD_POLL_ENTRY Entry;
+    PAFD_POLL_MEMBER Member;
+    PLIST_ENTRY ListEntry;
     PAFD_FCB FCB;
     KIRQL OldIrql;
     PAFD_POLL_INFO PollReq;
+    UINT i;
 
     AFD_DbgPrint(MID_TRACE,("Called: DeviceExt %p FileObject %p\n",
                             DeviceExt, FileObject));
@@ -424,20 +453,37 @@ VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
         return;
     }
 
-    /* Now signal normal select irps */
-    ThePollEnt = DeviceExt->Polls.Flink;
+    /* Now signal the select irps waiting on this socket */
+    ListEntry = FCB->PollEntries.Flink;
 
-    while( ThePollEnt != &DeviceExt->Polls ) {
-        Poll = CONTAINING_RECORD( ThePollEnt, AFD_ACTIVE_POLL, ListEntry );
+    while( ListEntry != &FCB->PollEntries ) {
+        Entry = CONTAINING_RECORD( ListEntry, AFD_POLL_ENTRY, ListEntry );
+        Poll = Entry->Poll;
         PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
+        i = (UINT)(Entry - Poll->Entries);
         AFD_DbgPrint(MID_TRACE,("Checking poll %p\n", Poll));
 
-        if( UpdatePollWithFCB( Poll, FileObject ) ) {
-            ThePollEnt = ThePollEnt->Flink;
+        if( PollReq->Handles[i].Events & FCB->PollState ) {
+            UpdatePollWithFCB( Poll, FileObject );
             AFD_DbgPrint(MID_TRACE,("Signalling socket\n"));
             SignalSocket( Poll, NULL, PollReq, STATUS_SUCCESS );
+            /* The poll may have had this socket more than once */
+            ListEntry = FCB->PollEntries.Flink;
         } else
-            ThePollEnt = ThePollEnt->Flink;
+            ListEntry = ListEntry->Flink;
+    }
+
+    /* And the poll sets it belongs to */
+    for( ListEntry = FCB->PollMembers.Flink;
+         ListEntry != &FCB->PollMembers;
+         ListEntry = ListEntry->Flink ) {
+        Member = CONTAINING_RECORD( ListEntry, AFD_POLL_MEMBER, FcbEntry );
+
+        if( (Member->Events & FCB->PollState) &&
+            IsListEmpty( &Member->ReadyEntry ) ) {
+            InsertTailList( &Member->Set->ReadyList, &Member->ReadyEntry );
+            TryCompletePollSetWait( Member->Set );
+        }
     }
 
     KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
@@ -453,3 +499,389 @@ VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
 
     AFD_DbgPrint(MID_TRACE,("Leaving\n"));
 }
+
+/* * * Poll sets * * */
+
+/* Fills PollReq with up to Capacity ready members. Sockets stay on the
+ * ready list for as long as they have events pending, at the back of it so
+ * that a full buffer doesn't keep returning the same ones.
+ * Called with the device extension lock held. */
+static UINT HarvestPollSet( PAFD_POLL_SET Set, PAFD_POLL_INFO PollReq,
+                            UINT Capacity ) {
+    LIST_ENTRY Reported;
+    PLIST_ENTRY ListEntry;
+    PAFD_POLL_MEMBER Member;
+    PAFD_FCB FCB;
+    ULONG Events;
+    UINT Count = 0;
+
+    InitializeListHead( &Reported );
+
+    while( Count < Capacity && !IsListEmpty( &Set->ReadyList ) ) {
+        ListEntry = RemoveHeadList( &Set->ReadyList );
+        Member = CONTAINING_RECORD( ListEntry, AFD_POLL_MEMBER, ReadyEntry );
+        FCB = Member->FileObject->FsContext;
+
+        Events = Member->Events & FCB->PollState;
+        if( !Events ) {
+            InitializeListHead( &Member->ReadyEntry );
+            continue;
+        }
+
+        PollReq->Handles[Count].Handle = Member->Handle;
+        PollReq->Handles[Count].Events = Events;
+        PollReq->Handles[Count].Status = 0;
+        Count++;
+
+        InsertTailList( &Reported, &Member->ReadyEntry );
+    }
+
+    while( !IsListEmpty( &Reported ) ) {
+        ListEntry = RemoveHeadList( &Reported );
+        InsertTailList( &Set->ReadyList, ListEntry );
+    }
+
+    PollReq->HandleCount = Count;
+
+    return Count;
+}
+
+/* Called with the device extension lock held */
+static VOID CompletePollSetWait( PAFD_POLL_SET Set, NTSTATUS Status ) {
+    PIRP Irp = Set->WaitIrp;
+    PAFD_POLL_INFO PollReq = Irp->AssociatedIrp.SystemBuffer;
+
+    Set->WaitIrp = NULL;
+    KeCancelTimer( &Set->Timer );
+
+    if( !NT_SUCCESS(Status) || Status == STATUS_TIMEOUT )
+        PollReq->HandleCount = 0;
+
+    AFD_DbgPrint(MID_TRACE,("Completing poll set wait %p (%x, %u handles)\n",
+                            Irp, Status, PollReq->HandleCount));
+
+    Irp->IoStatus.Status = Status;
+    Irp->IoStatus.Information =
+        FIELD_OFFSET(AFD_POLL_INFO, Handles) + sizeof(AFD_HANDLE) * PollReq->HandleCount;
+    (void)IoSetCancelRoutine(Irp, NULL);
+    IoCompleteRequest( Irp, IO_NETWORK_INCREMENT );
+}
+
+/* Called with the device extension lock held */
+static VOID TryCompletePollSetWait( PAFD_POLL_SET Set ) {
+    PAFD_POLL_INFO PollReq;
+
+    if( !Set->WaitIrp ) return;
+
+    PollReq = Set->WaitIrp->AssociatedIrp.SystemBuffer;
+    if( HarvestPollSet( Set, PollReq, Set->WaitCapacity ) )
+        CompletePollSetWait( Set, STATUS_SUCCESS );
+}
+
+static KDEFERRED_ROUTINE PollSetTimeout;
+static VOID NTAPI PollSetTimeout( PKDPC Dpc,
+                                  PVOID DeferredContext,
+                                  PVOID SystemArgument1,
+                                  PVOID SystemArgument2 ) {
+    PAFD_POLL_SET Set = DeferredContext;
+    KIRQL OldIrql;
+
+    UNREFERENCED_PARAMETER(Dpc);
+    UNREFERENCED_PARAMETER(SystemArgument1);
+    UNREFERENCED_PARAMETER(SystemArgument2);
+
+    KeAcquireSpinLock( &Set->DeviceExt->Lock, &OldIrql );
+
+    /* The timer is reset by every wait, so a late DPC of an earlier one
+     * finds it unsignalled */
+    if( Set->WaitIrp && KeReadStateTimer( &Set->Timer ) )
+        CompletePollSetWait( Set, STATUS_TIMEOUT );
+
+    KeReleaseSpinLock( &Set->DeviceExt->Lock, OldIrql );
+}
+
+NTSTATUS NTAPI
+AfdPollSetUpdate( PDEVICE_OBJECT DeviceObject, PIRP Irp,
+                  PIO_STACK_LOCATION IrpSp ) {
+    PFILE_OBJECT FileObject = IrpSp->FileObject;
+    PAFD_FCB FCB = FileObject->FsContext;
+    PAFD_DEVICE_EXTENSION DeviceExt = DeviceObject->DeviceExtension;
+    PAFD_POLL_INFO PollReq = Irp->AssociatedIrp.SystemBuffer;
+    ULONG InputLength = IrpSp->Parameters.DeviceIoControl.InputBufferLength;
+    NTSTATUS Status = STATUS_SUCCESS;
+    PAFD_POLL_SET Set;
+    PAFD_POLL_MEMBER Member, NewMember;
+    PFILE_OBJECT SocketObject;
+    PAFD_FCB SocketFCB;
+    PLIST_ENTRY ListEntry;
+    KIRQL OldIrql;
+    UINT i;
+
+    if( !SocketAcquireStateLock( FCB ) ) return LostSocket( Irp );
+
+    if( InputLength < FIELD_OFFSET(AFD_POLL_INFO, Handles) ||
+        PollReq->HandleCount > (InputLength - FIELD_OFFSET(AFD_POLL_INFO, Handles)) /
+                               sizeof(AFD_HANDLE) )
+        return UnlockAndMaybeComplete( FCB, STATUS_INVALID_PARAMETER, Irp, 0 );
+
+    /* Only control channels carry a poll set */
+    if( FCB->TdiDeviceName.Length )
+        return UnlockAndMaybeComplete( FCB, STATUS_INVALID_DEVICE_REQUEST, Irp, 0 );
+
+    if( !FCB->PollSet ) {
+        Set = ExAllocatePoolWithTag( NonPagedPool,
+                                     sizeof(AFD_POLL_SET),
+                                     TAG_AFD_POLL_SET );
+        if( !Set )
+            return UnlockAndMaybeComplete( FCB, STATUS_NO_MEMORY, Irp, 0 );
+
+        InitializeListHead( &Set->Members );
+        InitializeListHead( &Set->ReadyList );
+        Set->WaitIrp = NULL;
+        Set->WaitCapacity = 0;
+        Set->DeviceExt = DeviceExt;
+        KeInitializeTimerEx( &Set->Timer, NotificationTimer );
+        KeInitializeDpc( &Set->TimeoutDpc, PollSetTimeout, Set );
+
+        FCB->PollSet = Set;
+    }
+
+    Set = FCB->PollSet;
+
+    AFD_DbgPrint(MID_TRACE,("Updating poll set %p with %u handles\n",
+                            Set, PollReq->HandleCount));
+
+    for( i = 0; i < PollReq->HandleCount; i++ ) {
+        Status = ObReferenceObjectByHandle( (PVOID)PollReq->Handles[i].Handle,
+                                            FILE_ALL_ACCESS,
+                                            *IoFileObjectType,
+                                            Irp->RequestorMode,
+                                            (PVOID*)&SocketObject,
+                                            NULL );
+        if( !NT_SUCCESS(Status) ) break;
+
+        if( SocketObject->DeviceObject != DeviceObject ||
+            !SocketObject->FsContext ||
+            SocketObject == FileObject ) {
+            ObDereferenceObject( SocketObject );
+            Status = STATUS_INVALID_HANDLE;
+            break;
+        }
+
+        NewMember = NULL;
+        if( PollReq->Handles[i].Events ) {
+            NewMember = ExAllocatePoolWithTag( NonPagedPool,
+                                               sizeof(AFD_POLL_MEMBER),
+                                               TAG_AFD_POLL_MEMBER );
+            if( !NewMember ) {
+                ObDereferenceObject( SocketObject );
+                Status = STATUS_NO_MEMORY;
+                break;
+            }
+        }
+
+        SocketFCB = SocketObject->FsContext;
+        Member = NULL;
+
+        KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
+
+        for( ListEntry = SocketFCB->PollMembers.Flink;
+             ListEntry != &SocketFCB->PollMembers;
+             ListEntry = ListEntry->Flink ) {
+            if( CONTAINING_RECORD( ListEntry, AFD_POLL_MEMBER, FcbEntry )->Set == Set ) {
+                Member = CONTAINING_RECORD( ListEntry, AFD_POLL_MEMBER, FcbEntry );
+                break;
+            }
+        }
+
+        if( Member && !PollReq->Handles[i].Events ) {
+            /* Removal, the member takes its reference with it */
+            RemoveEntryList( &Member->SetEntry );
+            RemoveEntryList( &Member->FcbEntry );
+            RemoveEntryList( &Member->ReadyEntry );
+        } else if( Member ) {
+            /* Already in, keep its reference and the new allocation goes */
+            Member->Events = PollReq->Handles[i].Events;
+            Member->Handle = PollReq->Handles[i].Handle;
+        } else if( NewMember ) {
+            NewMember->Set = Set;
+            NewMember->FileObject = SocketObject;
+            NewMember->Handle = PollReq->Handles[i].Handle;
+            NewMember->Events = PollReq->Handles[i].Events;
+            InitializeListHead( &NewMember->ReadyEntry );
+            InsertTailList( &Set->Members, &NewMember->SetEntry );
+            InsertTailList( &SocketFCB->PollMembers, &NewMember->FcbEntry );
+
+            Member = NewMember;
+            NewMember = NULL;
+            SocketObject = NULL;
+        }
+
+        if( Member && PollReq->Handles[i].Events &&
+            (Member->Events & SocketFCB->PollState) &&
+            IsListEmpty( &Member->ReadyEntry ) ) {
+            InsertTailList( &Set->ReadyList, &Member->ReadyEntry );
+            TryCompletePollSetWait( Set );
+        }
+
+        KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+
+        if( Member && !PollReq->Handles[i].Events ) {
+            ObDereferenceObject( Member->FileObject );
+            ExFreePoolWithTag( Member, TAG_AFD_POLL_MEMBER );
+        }
+
+        if( NewMember ) ExFreePoolWithTag( NewMember, TAG_AFD_POLL_MEMBER );
+        if( SocketObject ) ObDereferenceObject( SocketObject );
+    }
+
+    AFD_DbgPrint(MID_TRACE,("Returning %x\n", Status));
+
+    return UnlockAndMaybeComplete( FCB, Status, Irp, 0 );
+}
+
+NTSTATUS NTAPI
+AfdPollSetWait( PDEVICE_OBJECT DeviceObject, PIRP Irp,
+                PIO_STACK_LOCATION IrpSp ) {
+    PFILE_OBJECT FileObject = IrpSp->FileObject;
+    PAFD_FCB FCB = FileObject->FsContext;
+    PAFD_DEVICE_EXTENSION DeviceExt = DeviceObject->DeviceExtension;
+    PAFD_POLL_INFO PollReq = Irp->AssociatedIrp.SystemBuffer;
+    ULONG InputLength = IrpSp->Parameters.DeviceIoControl.InputBufferLength;
+    ULONG OutputLength = IrpSp->Parameters.DeviceIoControl.OutputBufferLength;
+    LARGE_INTEGER Timeout;
+    PAFD_POLL_SET Set;
+    KIRQL OldIrql;
+    UINT Capacity, Count;
+
+    if( !SocketAcquireStateLock( FCB ) ) return LostSocket( Irp );
+
+    if( InputLength < FIELD_OFFSET(AFD_POLL_INFO, Handles) ||
+        OutputLength < sizeof(AFD_POLL_INFO) )
+        return UnlockAndMaybeComplete( FCB, STATUS_INVALID_PARAMETER, Irp, 0 );
+
+    Set = FCB->PollSet;
+    if( !Set )
+        return UnlockAndMaybeComplete( FCB, STATUS_INVALID_DEVICE_REQUEST, Irp, 0 );
+
+    Timeout = PollReq->Timeout;
+    Capacity = (OutputLength - FIELD_OFFSET(AFD_POLL_INFO, Handles)) / sizeof(AFD_HANDLE);
+
+    KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
+
+    if( Set->WaitIrp ) {
+        KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+        return UnlockAndMaybeComplete( FCB, STATUS_DEVICE_BUSY, Irp, 0 );
+    }
+
+    Count = HarvestPollSet( Set, PollReq, Capacity );
+
+    if( Count || !Timeout.QuadPart ) {
+        KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+        AFD_DbgPrint(MID_TRACE,("Returning %u ready handles\n", Count));
+        return UnlockAndMaybeComplete( FCB, Count ? STATUS_SUCCESS : STATUS_TIMEOUT, Irp,
+                                       FIELD_OFFSET(AFD_POLL_INFO, Handles) +
+                                       sizeof(AFD_HANDLE) * Count );
+    }
+
+    Set->WaitIrp = Irp;
+    Set->WaitCapacity = Capacity;
+    IoMarkIrpPending( Irp );
+    (void)IoSetCancelRoutine(Irp, AfdCancelHandler);
+    KeSetTimer( &Set->Timer, Timeout, &Set->TimeoutDpc );
+
+    KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+
+    SocketStateUnlock( FCB );
+
+    AFD_DbgPrint(MID_TRACE,("Waiting on poll set %p\n", Set));
+
+    return STATUS_PENDING;
+}
+
+/* Called with the state lock of the control channel held */
+VOID CancelPollSetWait( PAFD_FCB FCB, PIRP Irp ) {
+    PAFD_DEVICE_EXTENSION DeviceExt = FCB->DeviceExt;
+    KIRQL OldIrql;
+
+    KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
+
+    if( FCB->PollSet && FCB->PollSet->WaitIrp == Irp )
+        CompletePollSetWait( FCB->PollSet, STATUS_CANCELLED );
+
+    KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+}
+
+/* Called with the state lock of the control channel held */
+VOID DestroyPollSet( PAFD_FCB FCB ) {
+    PAFD_DEVICE_EXTENSION DeviceExt = FCB->DeviceExt;
+    PAFD_POLL_SET Set = FCB->PollSet;
+    PAFD_POLL_MEMBER Member;
+    PLIST_ENTRY ListEntry;
+    LIST_ENTRY Members;
+    KIRQL OldIrql;
+
+    if( !Set ) return;
+
+    InitializeListHead( &Members );
+
+    KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
+
+    if( Set->WaitIrp )
+        CompletePollSetWait( Set, STATUS_CANCELLED );
+
+    while( !IsListEmpty( &Set->Members ) ) {
+        ListEntry = RemoveHeadList( &Set->Members );
+        Member = CONTAINING_RECORD( ListEntry, AFD_POLL_MEMBER, SetEntry );
+        RemoveEntryList( &Member->FcbEntry );
+        RemoveEntryList( &Member->ReadyEntry );
+        InsertTailList( &Members, &Member->SetEntry );
+    }
+
+    FCB->PollSet = NULL;
+
+    KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+
+    /* Make sure the timeout DPC is done with it */
+    KeCancelTimer( &Set->Timer );
+    KeFlushQueuedDpcs();
+
+    while( !IsListEmpty( &Members ) ) {
+        ListEntry = RemoveHeadList( &Members );
+        Member = CONTAINING_RECORD( ListEntry, AFD_POLL_MEMBER, SetEntry );
+        ObDereferenceObject( Member->FileObject );
+        ExFreePoolWithTag( Member, TAG_AFD_POLL_MEMBER );
+    }
+
+    ExFreePoolWithTag( Set, TAG_AFD_POLL_SET );
+}
+
+/* Takes a closing socket out of every poll set it was added to */
+VOID RemovePollSetMembers( PAFD_FCB FCB ) {
+    PAFD_DEVICE_EXTENSION DeviceExt = FCB->DeviceExt;
+    PAFD_POLL_MEMBER Member;
+    PLIST_ENTRY ListEntry;
+    LIST_ENTRY Members;
+    KIRQL OldIrql;
+
+    InitializeListHead( &Members );
+
+    KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
+
+    while( !IsListEmpty( &FCB->PollMembers ) ) {
+        ListEntry = RemoveHeadList( &FCB->PollMembers );
+        Member = CONTAINING_RECORD( ListEntry, AFD_POLL_MEMBER, FcbEntry );
+        RemoveEntryList( &Member->SetEntry );
+        RemoveEntryList( &Member->ReadyEntry );
+        InsertTailList( &Members, &Member->FcbEntry );
+    }
+
+    KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
+
+    while( !IsListEmpty( &Members ) ) {
+        ListEntry = RemoveHeadList( &Members );
+        Member = CONTAINING_RECORD( ListEntry, AFD_POLL_MEMBER, FcbEntry );
+        ObDereferenceObject( Member->FileObject );
+        ExFreePoolWithTag( Member, TAG_AFD_POLL_MEMBER );
+    }
+}
@@ -47,6 +47,8 @@
 #define TAG_AFD_POLL_HANDLE                'hpfA'
 #define TAG_AFD_FCB                        'cffA'
 #define TAG_AFD_ACTIVE_POLL                'pafA'
+#define TAG_AFD_POLL_SET                   'spfA'
+#define TAG_AFD_POLL_MEMBER                'mpfA'
 #define TAG_AFD_EA_INFO                    'aefA'
 #define TAG_AFD_STORED_DATAGRAM            'gsfA'
 #define TAG_AFD_SNMP_ADDRESS_INFO          'asfA'
@@ -113,6 +115,13 @@ typedef struct _AFD_DEVICE_EXTENSION {
     KSPIN_LOCK Lock;
 } AFD_DEVICE_EXTENSION, *PAFD_DEVICE_EXTENSION;
 
+/* One per handle of a select, queued on the FCB of that handle so that a
+ * state change only has to look at the selects waiting on that socket */
+typedef struct _AFD_POLL_ENTRY {
+    LIST_ENTRY ListEntry;
+    struct _AFD_ACTIVE_POLL *Poll;
+} AFD_POLL_ENTRY, *PAFD_POLL_ENTRY;
+
 typedef struct _AFD_ACTIVE_POLL {
     LIST_ENTRY ListEntry;
     PIRP Irp;
@@ -121,8 +130,33 @@ typedef struct _AFD_ACTIVE_POLL {
     KTIMER Timer;
     PKEVENT EventObject;
     BOOLEAN Exclusive;
+    UINT HandleCount;
+    AFD_POLL_ENTRY Entries[1];
 } AFD_ACTIVE_POLL, *PAFD_ACTIVE_POLL;
 
+/* Persistent set of sockets, hanging off a control channel. Sockets are
+ * registered once and the ones with events pending are harvested from the
+ * ready list, as many times as needed */
+typedef struct _AFD_POLL_SET {
+    LIST_ENTRY Members;
+    LIST_ENTRY ReadyList;
+    PIRP WaitIrp;
+    UINT WaitCapacity;
+    PAFD_DEVICE_EXTENSION DeviceExt;
+    KDPC TimeoutDpc;
+    KTIMER Timer;
+} AFD_POLL_SET, *PAFD_POLL_SET;
+
+typedef struct _AFD_POLL_MEMBER {
+    LIST_ENTRY SetEntry;
+    LIST_ENTRY FcbEntry;
+    LIST_ENTRY ReadyEntry; /* Empty when not ready */
+    PAFD_POLL_SET Set;
+    PFILE_OBJECT FileObject;
+    SOCKET Handle;
+    ULONG Events;
+} AFD_POLL_MEMBER, *PAFD_POLL_MEMBER;
+
 typedef struct _IRP_LIST {
     LIST_ENTRY ListEntry;
     PIRP Irp;
@@ -201,6 +235,9 @@ typedef struct _AFD_FCB {
     LIST_ENTRY PendingIrpList[MAX_FUNCTIONS];
     LIST_ENTRY DatagramList;
     LIST_ENTRY PendingConnections;
+    LIST_ENTRY PollEntries;
+    LIST_ENTRY PollMembers;
+    PAFD_POLL_SET PollSet;
 } AFD_FCB, *PAFD_FCB;
 
 /* bind.c */
@@ -328,6 +365,15 @@ AfdEventSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
 NTSTATUS NTAPI
 AfdEnumEvents( PDEVICE_OBJECT DeviceObject, PIRP Irp,
 	       PIO_STACK_LOCATION IrpSp );
+NTSTATUS NTAPI
+AfdPollSetUpdate( PDEVICE_OBJECT DeviceObject, PIRP Irp,
+		  PIO_STACK_LOCATION IrpSp );
+NTSTATUS NTAPI
+AfdPollSetWait( PDEVICE_OBJECT DeviceObject, PIRP Irp,
+		PIO_STACK_LOCATION IrpSp );
+VOID CancelPollSetWait( PAFD_FCB FCB, PIRP Irp );
+VOID DestroyPollSet( PAFD_FCB FCB );
+VOID RemovePollSetMembers( PAFD_FCB FCB );
 VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceObject, PFILE_OBJECT FileObject );
 VOID KillSelectsForFCB( PAFD_DEVICE_EXTENSION DeviceExt,
                         PFILE_OBJECT FileObject, BOOLEAN ExclusiveOnly );
@@ -0,0 +1,59 @@
+/*
+ * COPYRIGHT:   See COPYING in the top level directory
+ * PROJECT:     ReactOS TCP/IP protocol driver
+ * FILE:        include/fibtrie.h
+ * PURPOSE:     Longest prefix match trie for the forward information base
+ */
+
+#pragma once
+
+/* Trie node. Nodes without routes only exist to branch */
+typedef struct _FIB_NODE {
+    struct _FIB_NODE *Parent;     /* Node of the longest shorter prefix */
+    struct _FIB_NODE *Child[2];   /* Longer prefixes, by their next bit */
+    ULONG Prefix;                 /* Network prefix, in host order */
+    ULONG Mask;                   /* Mask of the network prefix */
+    UINT PrefixLength;            /* Number of bits of the mask */
+    PVOID Routes;                 /* Routes to this network, owned by the caller */
+} FIB_NODE, *PFIB_NODE;
+
+typedef PFIB_NODE (*PFIB_ALLOCATE_NODE)(VOID);
+typedef VOID (*PFIB_FREE_NODE)(PFIB_NODE Node);
+
+/* Path compressed binary trie of IPv4 network prefixes */
+typedef struct _FIB_TRIE {
+    PFIB_NODE Root;               /* Node of the shortest prefix */
+    PFIB_ALLOCATE_NODE AllocateNode; /* Routine used to allocate nodes */
+    PFIB_FREE_NODE FreeNode;      /* Routine used to free nodes */
+} FIB_TRIE, *PFIB_TRIE;
+
+VOID FibTrieInitialize(
+    PFIB_TRIE Trie,
+    PFIB_ALLOCATE_NODE AllocateNode,
+    PFIB_FREE_NODE FreeNode);
+
+PFIB_NODE FibTrieInsert(
+    PFIB_TRIE Trie,
+    ULONG Prefix,
+    UINT PrefixLength);
+
+PFIB_NODE FibTrieFind(
+    PFIB_TRIE Trie,
+    ULONG Prefix,
+    UINT PrefixLength);
+
+VOID FibTrieDelete(
+    PFIB_TRIE Trie,
+    PFIB_NODE Node);
+
+VOID FibTrieDestroy(
+    PFIB_TRIE Trie);
+
+PFIB_NODE FibTrieLookup(
+    PFIB_TRIE Trie,
+    ULONG Address);
+
+PFIB_NODE FibTrieNextMatch(
+    PFIB_NODE Node);
+
+/* EOF */
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <neighbor.h>
+#include <fibtrie.h>
 
 
 /* Forward Information Base Entry */
@@ -18,8 +19,20 @@ typedef struct _FIB_ENTRY {
     IP_ADDRESS Netmask;           /* Netmask of network */
     PNEIGHBOR_CACHE_ENTRY Router; /* Pointer to NCE of router to use */
     UINT Metric;                  /* Cost of this route */
+    PFIB_NODE Node;               /* Trie node of the network */
+    struct _FIB_ENTRY *Next;      /* Next route to the same network */
 } FIB_ENTRY, *PFIB_ENTRY;
 
+#define ROUTE_CACHE_SIZE 256      /* Must be a power of two */
+
+/* Route cache entry, read without holding the FIB lock */
+typedef struct _ROUTE_CACHE_ENTRY {
+    volatile LONG Sequence;       /* Odd while the entry is being written */
+    LONG Generation;              /* FIB generation the route was found in */
+    IPv4_RAW_ADDRESS Destination; /* Destination address */
+    PNEIGHBOR_CACHE_ENTRY Router; /* Pointer to NCE of router to use */
+} ROUTE_CACHE_ENTRY, *PROUTE_CACHE_ENTRY;
+
 PFIB_ENTRY RouterAddRoute(
     PIP_ADDRESS NetworkAddress,
     PIP_ADDRESS Netmask,
@@ -45,6 +58,12 @@ NTSTATUS RouterShutdown(
 
 VOID RouterRemoveRoutesForInterface(PIP_INTERFACE Interface);
 
+VOID RouterFlushRouteCache(VOID);
+
+VOID RouterRetireNCE(PNEIGHBOR_CACHE_ENTRY NCE);
+
+VOID RouterFreeRetiredNCEs(VOID);
+
 UINT CountFIBs(PIP_INTERFACE IF);
 
 UINT CopyFIBs( PIP_INTERFACE IF, PFIB_ENTRY Target );
@@ -0,0 +1,213 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Test for IOCTL_AFD_POLL_SET_UPDATE/IOCTL_AFD_POLL_SET_WAIT
+ */
+
+#include "precomp.h"
+
+#define TEST_PORT 27016
+
+static
+NTSTATUS
+OpenControlChannel(
+    _Out_ PHANDLE ChannelHandle)
+{
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK IoStatus;
+    UNICODE_STRING DeviceName = RTL_CONSTANT_STRING(L"\\Device\\Afd\\PollSet");
+
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &DeviceName,
+                               OBJ_CASE_INSENSITIVE,
+                               0,
+                               0);
+
+    /* No EA, so this is a control channel rather than a socket */
+    return NtCreateFile(ChannelHandle,
+                        GENERIC_READ | GENERIC_WRITE | SYNCHRONIZE,
+                        &ObjectAttributes,
+                        &IoStatus,
+                        NULL,
+                        0,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE,
+                        FILE_OPEN_IF,
+                        0,
+                        NULL,
+                        0);
+}
+
+static
+NTSTATUS
+PollSetIoctl(
+    _In_ HANDLE ChannelHandle,
+    _In_ ULONG IoControlCode,
+    _Inout_ PAFD_POLL_INFO PollInfo,
+    _In_ ULONG PollInfoLength)
+{
+    NTSTATUS Status;
+    IO_STATUS_BLOCK IoStatus;
+    HANDLE Event;
+
+    Status = NtCreateEvent(&Event,
+                           EVENT_ALL_ACCESS,
+                           NULL,
+                           NotificationEvent,
+                           FALSE);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    Status = NtDeviceIoControlFile(ChannelHandle,
+                                   Event,
+                                   NULL,
+                                   NULL,
+                                   &IoStatus,
+                                   IoControlCode,
+                                   PollInfo,
+                                   PollInfoLength,
+                                   PollInfo,
+                                   PollInfoLength);
+    if (Status == STATUS_PENDING)
+    {
+        NtWaitForSingleObject(Event, FALSE, NULL);
+        Status = IoStatus.Status;
+    }
+
+    NtClose(Event);
+
+    return Status;
+}
+
+static
+NTSTATUS
+PollSetUpdate(
+    _In_ HANDLE ChannelHandle,
+    _In_ HANDLE SocketHandle,
+    _In_ ULONG Events)
+{
+    AFD_POLL_INFO PollInfo;
+
+    RtlZeroMemory(&PollInfo, sizeof(PollInfo));
+    PollInfo.HandleCount = 1;
+    PollInfo.Handles[0].Handle = (SOCKET)SocketHandle;
+    PollInfo.Handles[0].Events = Events;
+
+    return PollSetIoctl(ChannelHandle, IOCTL_AFD_POLL_SET_UPDATE, &PollInfo, sizeof(PollInfo));
+}
+
+static
+NTSTATUS
+PollSetWait(
+    _In_ HANDLE ChannelHandle,
+    _In_ LONG Milliseconds,
+    _Out_ PAFD_POLL_INFO PollInfo,
+    _In_ ULONG PollInfoLength)
+{
+    RtlZeroMemory(PollInfo, PollInfoLength);
+    PollInfo->Timeout.QuadPart = Int32x32To64(Milliseconds, -10000);
+
+    return PollSetIoctl(ChannelHandle, IOCTL_AFD_POLL_SET_WAIT, PollInfo, PollInfoLength);
+}
+
+START_TEST(pollset)
+{
+    NTSTATUS Status;
+    HANDLE ChannelHandle, ReceiverHandle, SenderHandle;
+    struct sockaddr_in addr;
+    CHAR Buffer[16];
+    struct
+    {
+        AFD_POLL_INFO Info;
+        AFD_HANDLE MoreHandles[3];
+    } Poll;
+
+    Status = OpenControlChannel(&ChannelHandle);
+    ok(Status == STATUS_SUCCESS, "OpenControlChannel failed with %lx\n", Status);
+    if (!NT_SUCCESS(Status))
+        return;
+
+    /* Nothing registered yet */
+    Status = PollSetWait(ChannelHandle, 0, &Poll.Info, sizeof(Poll));
+    if (Status == STATUS_NOT_SUPPORTED || Status == STATUS_INVALID_PARAMETER)
+    {
+        skip("Poll sets are not supported\n");
+        NtClose(ChannelHandle);
+        return;
+    }
+    ok(Status == STATUS_INVALID_DEVICE_REQUEST, "PollSetWait failed with %lx\n", Status);
+
+    Status = AfdCreateSocket(&ReceiverHandle, AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(Status == STATUS_SUCCESS, "AfdCreateSocket failed with %lx\n", Status);
+    Status = AfdCreateSocket(&SenderHandle, AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(Status == STATUS_SUCCESS, "AfdCreateSocket failed with %lx\n", Status);
+
+    /* Only control channels have a poll set */
+    Status = PollSetUpdate(ReceiverHandle, SenderHandle, AFD_EVENT_SEND);
+    ok(Status == STATUS_INVALID_DEVICE_REQUEST, "PollSetUpdate failed with %lx\n", Status);
+    Status = PollSetUpdate(ChannelHandle, ChannelHandle, AFD_EVENT_SEND);
+    ok(Status == STATUS_INVALID_HANDLE, "PollSetUpdate failed with %lx\n", Status);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    addr.sin_port = htons(TEST_PORT);
+
+    Status = AfdBind(ReceiverHandle, (const struct sockaddr *)&addr, sizeof(addr));
+    ok(Status == STATUS_SUCCESS, "AfdBind failed with %lx\n", Status);
+
+    addr.sin_port = htons(0);
+    Status = AfdBind(SenderHandle, (const struct sockaddr *)&addr, sizeof(addr));
+    ok(Status == STATUS_SUCCESS, "AfdBind failed with %lx\n", Status);
+
+    Status = PollSetUpdate(ChannelHandle, ReceiverHandle, AFD_EVENT_RECEIVE);
+    ok(Status == STATUS_SUCCESS, "PollSetUpdate failed with %lx\n", Status);
+    Status = PollSetUpdate(ChannelHandle, SenderHandle, AFD_EVENT_SEND);
+    ok(Status == STATUS_SUCCESS, "PollSetUpdate failed with %lx\n", Status);
+
+    /* A datagram socket is always sendable, and stays reported while it is */
+    Status = PollSetWait(ChannelHandle, 1000, &Poll.Info, sizeof(Poll));
+    ok(Status == STATUS_SUCCESS, "PollSetWait failed with %lx\n", Status);
+    ok(Poll.Info.HandleCount == 1, "HandleCount = %lu\n", Poll.Info.HandleCount);
+    ok(Poll.Info.Handles[0].Handle == (SOCKET)SenderHandle, "Handle = %p\n", (PVOID)Poll.Info.Handles[0].Handle);
+    ok(Poll.Info.Handles[0].Events == AFD_EVENT_SEND, "Events = %lx\n", Poll.Info.Handles[0].Events);
+
+    Status = PollSetWait(ChannelHandle, 0, &Poll.Info, sizeof(Poll));
+    ok(Status == STATUS_SUCCESS, "PollSetWait failed with %lx\n", Status);
+    ok(Poll.Info.HandleCount == 1, "HandleCount = %lu\n", Poll.Info.HandleCount);
+
+    /* Events of 0 remove it */
+    Status = PollSetUpdate(ChannelHandle, SenderHandle, 0);
+    ok(Status == STATUS_SUCCESS, "PollSetUpdate failed with %lx\n", Status);
+
+    Status = PollSetWait(ChannelHandle, 0, &Poll.Info, sizeof(Poll));
+    ok(Status == STATUS_TIMEOUT, "PollSetWait failed with %lx\n", Status);
+    ok(Poll.Info.HandleCount == 0, "HandleCount = %lu\n", Poll.Info.HandleCount);
+
+    Status = PollSetWait(ChannelHandle, 100, &Poll.Info, sizeof(Poll));
+    ok(Status == STATUS_TIMEOUT, "PollSetWait failed with %lx\n", Status);
+    ok(Poll.Info.HandleCount == 0, "HandleCount = %lu\n", Poll.Info.HandleCount);
+
+    /* The receiver becomes ready when the datagram arrives */
+    RtlZeroMemory(Buffer, sizeof(Buffer));
+    addr.sin_port = htons(TEST_PORT);
+    Status = AfdSendTo(SenderHandle, Buffer, sizeof(Buffer), (const struct sockaddr *)&addr, sizeof(addr));
+    ok(Status == STATUS_SUCCESS, "AfdSendTo failed with %lx\n", Status);
+
+    Status = PollSetWait(ChannelHandle, 5000, &Poll.Info, sizeof(Poll));
+    ok(Status == STATUS_SUCCESS, "PollSetWait failed with %lx\n", Status);
+    ok(Poll.Info.HandleCount == 1, "HandleCount = %lu\n", Poll.Info.HandleCount);
+    ok(Poll.Info.Handles[0].Handle == (SOCKET)ReceiverHandle, "Handle = %p\n", (PVOID)Poll.Info.Handles[0].Handle);
+    ok(Poll.Info.Handles[0].Events == AFD_EVENT_RECEIVE, "Events = %lx\n", Poll.Info.Handles[0].Events);
+
+    /* Closing the socket takes it out of the set */
+    NtClose(ReceiverHandle);
+
+    Status = PollSetWait(ChannelHandle, 0, &Poll.Info, sizeof(Poll));
+    ok(Status == STATUS_TIMEOUT, "PollSetWait failed with %lx\n", Status);
+    ok(Poll.Info.HandleCount == 0, "HandleCount = %lu\n", Poll.Info.HandleCount);
+
+    NtClose(SenderHandle);
+    NtClose(ChannelHandle);
+}
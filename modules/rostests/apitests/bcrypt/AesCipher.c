@@ -0,0 +1,377 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Tests for the bcrypt AES modes
+ */
+
+#include <apitest.h>
+
+#include <ntstatus.h>
+#define WIN32_NO_STATUS
+#include <windef.h>
+#include <winbase.h>
+#include <bcrypt.h>
+
+/* NIST GCM test case 4 */
+static const UCHAR GcmKey[16] =
+{
+    0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08
+};
+static const UCHAR GcmNonce[12] =
+{
+    0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88
+};
+static const UCHAR GcmAuth[20] =
+{
+    0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef, 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+    0xab, 0xad, 0xda, 0xd2
+};
+static const UCHAR GcmPlain[60] =
+{
+    0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5, 0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+    0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda, 0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+    0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+    0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57, 0xba, 0x63, 0x7b, 0x39
+};
+static const UCHAR GcmCipher[60] =
+{
+    0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24, 0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+    0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0, 0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+    0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c, 0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+    0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97, 0x3d, 0x58, 0xe0, 0x91
+};
+static const UCHAR GcmTag[16] =
+{
+    0x5b, 0xc9, 0x4f, 0xbc, 0x32, 0x21, 0xa5, 0xdb, 0x94, 0xfa, 0xe9, 0x5a, 0xe7, 0x12, 0x1a, 0x47
+};
+
+/* SP 800-38A F.2.1 */
+static const UCHAR CbcKey[16] =
+{
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static const UCHAR CbcPlain[32] =
+{
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51
+};
+static const UCHAR CbcCipher[32] =
+{
+    0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+    0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee, 0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2
+};
+
+/*
+ * Long enough to go through the parallel AES-NI loops (8 blocks on amd64,
+ * 4 on i386) and the 4-block GHASH loop, with a tail left over. The
+ * plaintext is 0x00, 0x01, ... and the keys and IV are the ones above.
+ */
+#define LONG_BLOCKS     21
+#define LONG_GCM_SIZE   (LONG_BLOCKS * 16 - 3)
+
+static const UCHAR LongEcbCipher[LONG_BLOCKS * 16] =
+{
+    0x50, 0xfe, 0x67, 0xcc, 0x99, 0x6d, 0x32, 0xb6, 0xda, 0x09, 0x37, 0xe9, 0x9b, 0xaf, 0xec, 0x60,
+    0xc8, 0x4a, 0xf0, 0xb6, 0x13, 0x43, 0x5d, 0x5d, 0x91, 0x82, 0x80, 0x1a, 0x9b, 0xd9, 0x32, 0x0b,
+    0x25, 0xf3, 0x3f, 0x02, 0x3d, 0x8e, 0x72, 0x4c, 0x67, 0x50, 0x44, 0xe8, 0x0b, 0x19, 0x34, 0x98,
+    0x5c, 0xe9, 0x9c, 0xa0, 0x2f, 0x4e, 0x97, 0x33, 0xf1, 0x93, 0xbf, 0x28, 0x00, 0x0b, 0xd4, 0x4c,
+    0x57, 0x60, 0x76, 0xa2, 0xe3, 0x95, 0x0d, 0x73, 0xf8, 0xe9, 0xbf, 0x79, 0x4a, 0x7b, 0x5d, 0x95,
+    0xc3, 0x4a, 0xb8, 0x82, 0x08, 0x8b, 0x53, 0x93, 0xda, 0xa9, 0xa6, 0x61, 0xd6, 0x90, 0x34, 0x36,
+    0x6f, 0x8d, 0xb1, 0x3c, 0x3b, 0x46, 0x4e, 0x73, 0xdd, 0xf4, 0xe2, 0x48, 0xed, 0x29, 0x67, 0x93,
+    0x34, 0x59, 0xd4, 0xca, 0x18, 0xc1, 0x99, 0x41, 0xb9, 0x10, 0xae, 0xa3, 0xc3, 0x49, 0x07, 0x77,
+    0x63, 0x71, 0x75, 0xe2, 0x42, 0xb8, 0x65, 0x44, 0x73, 0x36, 0x97, 0x82, 0x7d, 0xa6, 0xde, 0x91,
+    0xf9, 0x6d, 0xd3, 0xe4, 0x27, 0xda, 0xe3, 0xa4, 0xb2, 0xce, 0x36, 0x78, 0xd0, 0xcc, 0xb5, 0xa4,
+    0xc0, 0x23, 0x4d, 0xe8, 0xdb, 0x1f, 0xbe, 0xbb, 0xd9, 0xab, 0xbb, 0xd5, 0xf0, 0x33, 0xc2, 0xa0,
+    0x9f, 0xa5, 0x49, 0xba, 0xf7, 0xdd, 0x51, 0x3b, 0x15, 0x76, 0x22, 0x22, 0xec, 0xfe, 0x31, 0x6e,
+    0x75, 0x8d, 0x4d, 0x38, 0x0b, 0x64, 0x23, 0x7d, 0x30, 0x8d, 0x82, 0xb0, 0xe8, 0x10, 0xc6, 0x5f,
+    0x46, 0x07, 0xcd, 0x68, 0x06, 0x90, 0xe2, 0x6d, 0x9f, 0xba, 0x22, 0x8d, 0x83, 0x69, 0xd7, 0xf1,
+    0xf6, 0xa3, 0x56, 0x9d, 0xea, 0x3c, 0xda, 0x20, 0x8e, 0xb3, 0xd5, 0x79, 0x29, 0x42, 0x61, 0x2b,
+    0xec, 0x8c, 0xdf, 0x73, 0x98, 0x60, 0x7c, 0xb0, 0xf2, 0xd2, 0x16, 0x75, 0xea, 0x9e, 0xa1, 0xe4,
+    0x50, 0xfe, 0x67, 0xcc, 0x99, 0x6d, 0x32, 0xb6, 0xda, 0x09, 0x37, 0xe9, 0x9b, 0xaf, 0xec, 0x60,
+    0xc8, 0x4a, 0xf0, 0xb6, 0x13, 0x43, 0x5d, 0x5d, 0x91, 0x82, 0x80, 0x1a, 0x9b, 0xd9, 0x32, 0x0b,
+    0x25, 0xf3, 0x3f, 0x02, 0x3d, 0x8e, 0x72, 0x4c, 0x67, 0x50, 0x44, 0xe8, 0x0b, 0x19, 0x34, 0x98,
+    0x5c, 0xe9, 0x9c, 0xa0, 0x2f, 0x4e, 0x97, 0x33, 0xf1, 0x93, 0xbf, 0x28, 0x00, 0x0b, 0xd4, 0x4c,
+    0x57, 0x60, 0x76, 0xa2, 0xe3, 0x95, 0x0d, 0x73, 0xf8, 0xe9, 0xbf, 0x79, 0x4a, 0x7b, 0x5d, 0x95
+};
+static const UCHAR LongCbcCipher[LONG_BLOCKS * 16] =
+{
+    0x7d, 0xf7, 0x6b, 0x0c, 0x1a, 0xb8, 0x99, 0xb3, 0x3e, 0x42, 0xf0, 0x47, 0xb9, 0x1b, 0x54, 0x6f,
+    0x1c, 0xaa, 0x80, 0x18, 0xc8, 0x0b, 0x15, 0xb8, 0xe7, 0xae, 0xa8, 0x27, 0x94, 0xad, 0xcb, 0x00,
+    0xbb, 0xc1, 0xe2, 0x95, 0x91, 0x0b, 0x9d, 0xe4, 0xf1, 0x35, 0x8d, 0xcb, 0x42, 0x13, 0xbd, 0xd8,
+    0xee, 0xfa, 0x31, 0x54, 0x21, 0x5f, 0x47, 0x09, 0xaf, 0x46, 0x57, 0x3f, 0xc8, 0xcb, 0x07, 0xb9,
+    0x86, 0x0d, 0xc1, 0xdd, 0x67, 0xdd, 0xfd, 0x95, 0x2b, 0x41, 0xe3, 0xaa, 0x0c, 0xc4, 0x7a, 0x96,
+    0x48, 0x73, 0x85, 0x34, 0xd3, 0x7e, 0x5e, 0x29, 0xae, 0x21, 0x35, 0xaf, 0x75, 0x32, 0xe4, 0x1c,
+    0x14, 0x28, 0xb8, 0x47, 0xec, 0x62, 0x48, 0xfa, 0x03, 0x56, 0x8d, 0x55, 0x16, 0x3a, 0xa8, 0x98,
+    0x85, 0xe7, 0x57, 0xfd, 0x9c, 0x61, 0x99, 0x91, 0x78, 0xf9, 0x6a, 0x3c, 0x78, 0xf2, 0x6b, 0xef,
+    0xff, 0x9a, 0x03, 0x69, 0x1d, 0x10, 0xad, 0x99, 0x2b, 0x32, 0xf6, 0x74, 0xd0, 0x30, 0x94, 0xa6,
+    0x9b, 0x14, 0x87, 0x41, 0x26, 0x56, 0x3f, 0x8f, 0xf0, 0xa3, 0x03, 0x37, 0x8a, 0x36, 0xcb, 0xdd,
+    0x86, 0x1a, 0xa9, 0x23, 0x42, 0x86, 0xfa, 0xc8, 0x75, 0xae, 0xe4, 0x98, 0xd4, 0xf0, 0xaa, 0x1f,
+    0x39, 0x68, 0xad, 0x1a, 0x8d, 0x0b, 0x19, 0x07, 0xb2, 0xb9, 0x70, 0xe5, 0x50, 0x14, 0x60, 0x0b,
+    0x02, 0x0a, 0x1d, 0x3b, 0xd5, 0x9d, 0x55, 0xa9, 0xea, 0xae, 0xf6, 0x7e, 0xe2, 0x05, 0x74, 0x08,
+    0x0b, 0xc9, 0xeb, 0xc7, 0xe2, 0x63, 0x85, 0xcd, 0x4a, 0x63, 0x33, 0xb4, 0x32, 0xf4, 0x28, 0xbf,
+    0xa1, 0x9e, 0x1a, 0x6b, 0xa1, 0xca, 0xad, 0xee, 0xc5, 0x16, 0xae, 0x5b, 0xcf, 0x66, 0x2e, 0x8f,
+    0x13, 0xf5, 0xcb, 0xa1, 0x61, 0x43, 0xbf, 0x2b, 0xe8, 0x2c, 0xaf, 0xc3, 0x6c, 0x65, 0xe8, 0x74,
+    0xac, 0x61, 0x5e, 0x7b, 0x19, 0x9a, 0xf6, 0x3a, 0xf9, 0xda, 0xfa, 0xd6, 0xf7, 0x48, 0x89, 0xfa,
+    0x21, 0x1d, 0x15, 0xe5, 0xc4, 0x01, 0x9d, 0x31, 0x37, 0x3e, 0x92, 0x18, 0xb1, 0x28, 0xcc, 0x21,
+    0xd6, 0xa8, 0x38, 0x30, 0x97, 0xeb, 0xf4, 0xae, 0xfd, 0xc8, 0x78, 0x94, 0x71, 0xa5, 0xe4, 0x94,
+    0x28, 0x2f, 0xc4, 0x49, 0x61, 0xaf, 0x33, 0xaf, 0x66, 0x31, 0x30, 0x84, 0xee, 0x33, 0x1a, 0xc3,
+    0x7f, 0xf7, 0x38, 0x49, 0x70, 0xcd, 0xf0, 0x44, 0xf2, 0x4f, 0x20, 0x12, 0xef, 0xc4, 0xd3, 0x45
+};
+static const UCHAR LongGcmCipher[LONG_GCM_SIZE] =
+{
+    0x9b, 0xb3, 0x2e, 0xe4, 0xdd, 0xf6, 0x74, 0xc6, 0xe6, 0x22, 0x22, 0x79, 0x27, 0x28, 0xfc, 0x09,
+    0x75, 0x1c, 0x9a, 0x6f, 0x2d, 0x23, 0x45, 0x2d, 0x03, 0x94, 0x54, 0x05, 0xbf, 0x80, 0x35, 0x43,
+    0x1d, 0xc8, 0x3a, 0x04, 0xe5, 0x2b, 0xbc, 0x68, 0x7a, 0x69, 0x4e, 0x55, 0xc9, 0x0f, 0x31, 0x0f,
+    0x9a, 0xf8, 0xd4, 0xff, 0xf4, 0x32, 0x7c, 0xf7, 0xbf, 0x02, 0xa1, 0x93, 0x61, 0xad, 0xb5, 0xef,
+    0x9d, 0xe9, 0x25, 0x87, 0x8a, 0xb7, 0xf7, 0xb6, 0xf0, 0xe0, 0xb5, 0x02, 0x86, 0x6d, 0xc5, 0x2e,
+    0x46, 0x89, 0xa6, 0xa2, 0x97, 0x9c, 0x71, 0x68, 0x7b, 0x8e, 0x02, 0x47, 0x9f, 0x2e, 0xba, 0x3e,
+    0x90, 0x7f, 0x3e, 0xdc, 0xc1, 0x4a, 0x26, 0x95, 0x38, 0x65, 0x6d, 0xaf, 0x73, 0x5a, 0x1f, 0x1e,
+    0xb1, 0xcc, 0x86, 0xc6, 0x14, 0x13, 0xf5, 0x07, 0xfc, 0xf3, 0xd0, 0x4d, 0x7a, 0x67, 0xe9, 0x27,
+    0x7e, 0x57, 0x7f, 0x32, 0x6c, 0xbe, 0x22, 0x98, 0xab, 0xf0, 0xbc, 0x20, 0xca, 0xed, 0xab, 0x4f,
+    0x50, 0x27, 0x4e, 0x15, 0xb6, 0xd0, 0x1e, 0xad, 0x0a, 0x4a, 0x62, 0x4f, 0xa7, 0xa4, 0x38, 0xb4,
+    0xd2, 0xcc, 0xe4, 0xb5, 0x09, 0x0c, 0x42, 0x16, 0xa9, 0xee, 0x34, 0x2a, 0x98, 0xaf, 0x88, 0x10,
+    0x31, 0x0d, 0xc9, 0x72, 0x11, 0x7c, 0x81, 0x9e, 0xcb, 0x55, 0x04, 0x39, 0x26, 0x42, 0xe9, 0x9f,
+    0x64, 0x72, 0xc6, 0x3d, 0x5e, 0x54, 0x6f, 0x69, 0x67, 0x0d, 0x0e, 0x6a, 0x63, 0x93, 0x60, 0x7d,
+    0xfe, 0x43, 0x6c, 0xf0, 0xae, 0xa6, 0x65, 0xc0, 0x93, 0x3b, 0x3f, 0xe3, 0x5c, 0x44, 0x7b, 0xe5,
+    0x50, 0x7c, 0x9c, 0x12, 0x6d, 0xf3, 0x3c, 0x41, 0x1f, 0x68, 0x97, 0xd8, 0xa9, 0xae, 0xc4, 0x7c,
+    0x41, 0x61, 0xc8, 0x2a, 0x63, 0x92, 0x00, 0xe7, 0x3e, 0x68, 0xea, 0xd1, 0xf6, 0xd8, 0x5a, 0x93,
+    0x21, 0x60, 0x03, 0x8a, 0xf4, 0x9c, 0xa3, 0xaa, 0x4c, 0x80, 0x06, 0x87, 0x14, 0x8e, 0x2b, 0xe7,
+    0x91, 0x73, 0x68, 0x48, 0x78, 0x19, 0x87, 0x0c, 0x64, 0xfa, 0xa9, 0xeb, 0x65, 0xaa, 0xf6, 0xd2,
+    0xae, 0x39, 0xb9, 0x0b, 0xec, 0x30, 0xae, 0x22, 0x4b, 0x15, 0xf6, 0x6f, 0xa7, 0x55, 0xfa, 0xcb,
+    0xb8, 0x3a, 0x05, 0xc1, 0xce, 0xff, 0x48, 0x03, 0xfc, 0x87, 0x15, 0xc8, 0xf8, 0x80, 0x3e, 0xc2,
+    0x80, 0x78, 0x1e, 0x9f, 0x46, 0xae, 0x18, 0x35, 0x39, 0x1b, 0x1f, 0xd5, 0x06
+};
+static const UCHAR LongGcmTag[16] =
+{
+    0xac, 0x69, 0x3c, 0x00, 0xbe, 0xc0, 0x6f, 0x1a, 0xca, 0x8c, 0x9b, 0xa6, 0x86, 0xc9, 0xce, 0x01
+};
+
+static void FillLongPlain(UCHAR *Plain)
+{
+    ULONG i;
+
+    for (i = 0; i < LONG_BLOCKS * 16; i++) Plain[i] = (UCHAR)i;
+}
+
+static BCRYPT_KEY_HANDLE CreateKey(BCRYPT_ALG_HANDLE Alg, LPCWSTR Mode, const UCHAR *Secret, ULONG Size)
+{
+    BCRYPT_KEY_HANDLE Key = NULL;
+    NTSTATUS Status;
+
+    Status = BCryptSetProperty(Alg, BCRYPT_CHAINING_MODE, (PUCHAR)Mode, (wcslen(Mode) + 1) * sizeof(WCHAR), 0);
+    ok(Status == STATUS_SUCCESS, "BCryptSetProperty returned 0x%lx\n", Status);
+    Status = BCryptGenerateSymmetricKey(Alg, &Key, NULL, 0, (PUCHAR)Secret, Size, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptGenerateSymmetricKey returned 0x%lx\n", Status);
+    return Key;
+}
+
+static void test_Properties(BCRYPT_ALG_HANDLE Alg)
+{
+    BCRYPT_AUTH_TAG_LENGTHS_STRUCT TagLengths;
+    WCHAR Mode[32];
+    ULONG Value, Size;
+    NTSTATUS Status;
+
+    Status = BCryptGetProperty(Alg, BCRYPT_BLOCK_LENGTH, (PUCHAR)&Value, sizeof(Value), &Size, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptGetProperty returned 0x%lx\n", Status);
+    ok(Value == 16, "Block length = %lu\n", Value);
+
+    Status = BCryptSetProperty(Alg, BCRYPT_CHAINING_MODE, (PUCHAR)BCRYPT_CHAIN_MODE_GCM,
+                               sizeof(BCRYPT_CHAIN_MODE_GCM), 0);
+    ok(Status == STATUS_SUCCESS, "BCryptSetProperty returned 0x%lx\n", Status);
+    Status = BCryptGetProperty(Alg, BCRYPT_CHAINING_MODE, (PUCHAR)Mode, sizeof(Mode), &Size, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptGetProperty returned 0x%lx\n", Status);
+    ok(!wcscmp(Mode, BCRYPT_CHAIN_MODE_GCM), "Mode = %ls\n", Mode);
+
+    Status = BCryptGetProperty(Alg, BCRYPT_AUTH_TAG_LENGTH, (PUCHAR)&TagLengths, sizeof(TagLengths), &Size, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptGetProperty returned 0x%lx\n", Status);
+    ok(TagLengths.dwMinLength == 12 && TagLengths.dwMaxLength == 16,
+       "Tag lengths = %lu-%lu\n", TagLengths.dwMinLength, TagLengths.dwMaxLength);
+
+    /* Tags only mean something with GCM */
+    Status = BCryptSetProperty(Alg, BCRYPT_CHAINING_MODE, (PUCHAR)BCRYPT_CHAIN_MODE_CBC,
+                               sizeof(BCRYPT_CHAIN_MODE_CBC), 0);
+    ok(Status == STATUS_SUCCESS, "BCryptSetProperty returned 0x%lx\n", Status);
+    Status = BCryptGetProperty(Alg, BCRYPT_AUTH_TAG_LENGTH, (PUCHAR)&TagLengths, sizeof(TagLengths), &Size, 0);
+    ok(Status == STATUS_NOT_SUPPORTED, "BCryptGetProperty returned 0x%lx\n", Status);
+}
+
+static void test_Ecb(BCRYPT_ALG_HANDLE Alg)
+{
+    BCRYPT_KEY_HANDLE Key;
+    UCHAR Plain[LONG_BLOCKS * 16], Output[LONG_BLOCKS * 16];
+    ULONG Size;
+    NTSTATUS Status;
+
+    Key = CreateKey(Alg, BCRYPT_CHAIN_MODE_ECB, CbcKey, sizeof(CbcKey));
+    if (!Key)
+        return;
+
+    FillLongPlain(Plain);
+    Status = BCryptEncrypt(Key, Plain, sizeof(Plain), NULL, NULL, 0, Output, sizeof(Output), &Size, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptEncrypt returned 0x%lx\n", Status);
+    ok(Size == sizeof(LongEcbCipher), "Size = %lu\n", Size);
+    ok(!memcmp(Output, LongEcbCipher, sizeof(LongEcbCipher)), "Wrong ciphertext\n");
+
+    /* In place this time */
+    Status = BCryptDecrypt(Key, Output, sizeof(Output), NULL, NULL, 0, Output, sizeof(Output), &Size, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptDecrypt returned 0x%lx\n", Status);
+    ok(Size == sizeof(Plain), "Size = %lu\n", Size);
+    ok(!memcmp(Output, Plain, sizeof(Plain)), "Wrong plaintext\n");
+
+    BCryptDestroyKey(Key);
+}
+
+static void test_Cbc(BCRYPT_ALG_HANDLE Alg)
+{
+    BCRYPT_KEY_HANDLE Key;
+    UCHAR Iv[16], Output[48], Plain[LONG_BLOCKS * 16], LongOutput[LONG_BLOCKS * 16];
+    ULONG Size, i;
+    NTSTATUS Status;
+
+    Key = CreateKey(Alg, BCRYPT_CHAIN_MODE_CBC, CbcKey, sizeof(CbcKey));
+    if (!Key)
+        return;
+
+    for (i = 0; i < sizeof(Iv); i++) Iv[i] = i;
+    Status = BCryptEncrypt(Key, (PUCHAR)CbcPlain, sizeof(CbcPlain), NULL, Iv, sizeof(Iv),
+                           Output, sizeof(Output), &Size, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptEncrypt returned 0x%lx\n", Status);
+    ok(Size == sizeof(CbcCipher), "Size = %lu\n", Size);
+    ok(!memcmp(Output, CbcCipher, sizeof(CbcCipher)), "Wrong ciphertext\n");
+    ok(!memcmp(Iv, CbcCipher + 16, sizeof(Iv)), "IV was not updated\n");
+
+    /* Unpadded input has to be whole blocks */
+    Status = BCryptEncrypt(Key, (PUCHAR)CbcPlain, 17, NULL, Iv, sizeof(Iv), Output, sizeof(Output), &Size, 0);
+    ok(Status == STATUS_INVALID_BUFFER_SIZE, "BCryptEncrypt returned 0x%lx\n", Status);
+
+    /* Padding adds a whole block to aligned input */
+    for (i = 0; i < sizeof(Iv); i++) Iv[i] = i;
+    Status = BCryptEncrypt(Key, (PUCHAR)CbcPlain, sizeof(CbcPlain), NULL, Iv, sizeof(Iv),
+                           NULL, 0, &Size, BCRYPT_BLOCK_PADDING);
+    ok(Status == STATUS_SUCCESS, "BCryptEncrypt returned 0x%lx\n", Status);
+    ok(Size == 48, "Size = %lu\n", Size);
+    Status = BCryptEncrypt(Key, (PUCHAR)CbcPlain, sizeof(CbcPlain), NULL, Iv, sizeof(Iv),
+                           Output, sizeof(Output), &Size, BCRYPT_BLOCK_PADDING);
+    ok(Status == STATUS_SUCCESS, "BCryptEncrypt returned 0x%lx\n", Status);
+    ok(!memcmp(Output, CbcCipher, sizeof(CbcCipher)), "Wrong ciphertext\n");
+
+    for (i = 0; i < sizeof(Iv); i++) Iv[i] = i;
+    Status = BCryptDecrypt(Key, Output, 48, NULL, Iv, sizeof(Iv), Output, sizeof(Output), &Size,
+                           BCRYPT_BLOCK_PADDING);
+    ok(Status == STATUS_SUCCESS, "BCryptDecrypt returned 0x%lx\n", Status);
+    ok(Size == sizeof(CbcPlain), "Size = %lu\n", Size);
+    ok(!memcmp(Output, CbcPlain, sizeof(CbcPlain)), "Wrong plaintext\n");
+
+    /* Decryption is done several blocks at a time */
+    FillLongPlain(Plain);
+    for (i = 0; i < sizeof(Iv); i++) Iv[i] = i;
+    Status = BCryptEncrypt(Key, Plain, sizeof(Plain), NULL, Iv, sizeof(Iv),
+                           LongOutput, sizeof(LongOutput), &Size, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptEncrypt returned 0x%lx\n", Status);
+    ok(Size == sizeof(LongCbcCipher), "Size = %lu\n", Size);
+    ok(!memcmp(LongOutput, LongCbcCipher, sizeof(LongCbcCipher)), "Wrong ciphertext\n");
+
+    for (i = 0; i < sizeof(Iv); i++) Iv[i] = i;
+    Status = BCryptDecrypt(Key, LongOutput, sizeof(LongOutput), NULL, Iv, sizeof(Iv),
+                           LongOutput, sizeof(LongOutput), &Size, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptDecrypt returned 0x%lx\n", Status);
+    ok(!memcmp(LongOutput, Plain, sizeof(Plain)), "Wrong plaintext\n");
+    ok(!memcmp(Iv, LongCbcCipher + sizeof(LongCbcCipher) - 16, sizeof(Iv)), "IV was not updated\n");
+
+    BCryptDestroyKey(Key);
+}
+
+static void test_Gcm(BCRYPT_ALG_HANDLE Alg)
+{
+    BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO Info;
+    BCRYPT_KEY_HANDLE Key;
+    UCHAR Output[60], Tag[16], Plain[LONG_BLOCKS * 16], LongOutput[LONG_BLOCKS * 16];
+    ULONG Size;
+    NTSTATUS Status;
+
+    Key = CreateKey(Alg, BCRYPT_CHAIN_MODE_GCM, GcmKey, sizeof(GcmKey));
+    if (!Key)
+        return;
+
+    BCRYPT_INIT_AUTH_MODE_INFO(Info);
+    Info.pbNonce = (PUCHAR)GcmNonce;
+    Info.cbNonce = sizeof(GcmNonce);
+    Info.pbAuthData = (PUCHAR)GcmAuth;
+    Info.cbAuthData = sizeof(GcmAuth);
+    Info.pbTag = Tag;
+    Info.cbTag = sizeof(Tag);
+
+    Status = BCryptEncrypt(Key, (PUCHAR)GcmPlain, sizeof(GcmPlain), &Info, NULL, 0,
+                           Output, sizeof(Output), &Size, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptEncrypt returned 0x%lx\n", Status);
+    ok(Size == sizeof(GcmPlain), "Size = %lu\n", Size);
+    ok(!memcmp(Output, GcmCipher, sizeof(GcmCipher)), "Wrong ciphertext\n");
+    ok(!memcmp(Tag, GcmTag, sizeof(GcmTag)), "Wrong tag\n");
+
+    Status = BCryptDecrypt(Key, Output, sizeof(Output), &Info, NULL, 0, Output, sizeof(Output), &Size, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptDecrypt returned 0x%lx\n", Status);
+    ok(!memcmp(Output, GcmPlain, sizeof(GcmPlain)), "Wrong plaintext\n");
+
+    /* A changed bit anywhere fails the tag */
+    memcpy(Output, GcmCipher, sizeof(GcmCipher));
+    Output[33] ^= 1;
+    Status = BCryptDecrypt(Key, Output, sizeof(Output), &Info, NULL, 0, Output, sizeof(Output), &Size, 0);
+    ok(Status == STATUS_AUTH_TAG_MISMATCH, "BCryptDecrypt returned 0x%lx\n", Status);
+
+    /* Short tags are a prefix of the full one */
+    Info.cbTag = 12;
+    Status = BCryptEncrypt(Key, (PUCHAR)GcmPlain, sizeof(GcmPlain), &Info, NULL, 0,
+                           Output, sizeof(Output), &Size, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptEncrypt returned 0x%lx\n", Status);
+    ok(!memcmp(Tag, GcmTag, 12), "Wrong tag\n");
+
+    Info.cbTag = 8;
+    Status = BCryptEncrypt(Key, (PUCHAR)GcmPlain, sizeof(GcmPlain), &Info, NULL, 0,
+                           Output, sizeof(Output), &Size, 0);
+    ok(Status == STATUS_INVALID_PARAMETER, "BCryptEncrypt returned 0x%lx\n", Status);
+
+    /* Many blocks and a partial one */
+    FillLongPlain(Plain);
+    Info.cbTag = sizeof(Tag);
+    Status = BCryptEncrypt(Key, Plain, LONG_GCM_SIZE, &Info, NULL, 0,
+                           LongOutput, sizeof(LongOutput), &Size, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptEncrypt returned 0x%lx\n", Status);
+    ok(Size == LONG_GCM_SIZE, "Size = %lu\n", Size);
+    ok(!memcmp(LongOutput, LongGcmCipher, sizeof(LongGcmCipher)), "Wrong ciphertext\n");
+    ok(!memcmp(Tag, LongGcmTag, sizeof(LongGcmTag)), "Wrong tag\n");
+
+    Status = BCryptDecrypt(Key, LongOutput, LONG_GCM_SIZE, &Info, NULL, 0,
+                           LongOutput, sizeof(LongOutput), &Size, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptDecrypt returned 0x%lx\n", Status);
+    ok(!memcmp(LongOutput, Plain, LONG_GCM_SIZE), "Wrong plaintext\n");
+
+    memcpy(LongOutput, LongGcmCipher, sizeof(LongGcmCipher));
+    LongOutput[LONG_GCM_SIZE - 1] ^= 0x80;
+    Status = BCryptDecrypt(Key, LongOutput, LONG_GCM_SIZE, &Info, NULL, 0,
+                           LongOutput, sizeof(LongOutput), &Size, 0);
+    ok(Status == STATUS_AUTH_TAG_MISMATCH, "BCryptDecrypt returned 0x%lx\n", Status);
+
+    BCryptDestroyKey(Key);
+}
+
+START_TEST(AesCipher)
+{
+    BCRYPT_ALG_HANDLE Alg;
+    NTSTATUS Status;
+
+    Status = BCryptOpenAlgorithmProvider(&Alg, BCRYPT_AES_ALGORITHM, NULL, 0);
+    ok(Status == STATUS_SUCCESS, "BCryptOpenAlgorithmProvider returned 0x%lx\n", Status);
+    if (Status != STATUS_SUCCESS)
+    {
+        skip("No AES provider\n");
+        return;
+    }
+
+    test_Properties(Alg);
+    test_Ecb(Alg);
+    test_Cbc(Alg);
+    test_Gcm(Alg);
+
+    BCryptCloseAlgorithmProvider(Alg, 0);
+}
@@ -0,0 +1,10 @@
+#define STANDALONE
+#include <apitest.h>
+
+extern void func_AesCipher(void);
+
+const struct test winetest_testlist[] =
+{
+    { "AesCipher", func_AesCipher },
+    { 0, 0 }
+};
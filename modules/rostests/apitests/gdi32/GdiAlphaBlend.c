@@ -0,0 +1,170 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Test for GdiAlphaBlend on 32bpp DIB sections
+ */
+
+#include "precomp.h"
+
+typedef struct _TEST_DIB
+{
+    HDC hdc;
+    HBITMAP hbmp;
+    HGDIOBJ hbmpOld;
+    PBYTE pjBits;
+    LONG cx, cy, lDelta;
+    WORD cBitsPixel;
+} TEST_DIB, *PTEST_DIB;
+
+static
+BOOL
+CreateTestDib(PTEST_DIB Dib, LONG cx, LONG cy, WORD cBitsPixel, ULONG Seed)
+{
+    BITMAPINFO bmi = {{sizeof(BITMAPINFOHEADER), cx, -cy, 1, cBitsPixel, BI_RGB}};
+    LONG i;
+
+    Dib->cx = cx;
+    Dib->cy = cy;
+    Dib->cBitsPixel = cBitsPixel;
+    Dib->lDelta = ((cx * cBitsPixel + 31) / 32) * 4;
+    Dib->hdc = CreateCompatibleDC(NULL);
+    Dib->hbmp = CreateDIBSection(Dib->hdc, &bmi, DIB_RGB_COLORS, (PVOID*)&Dib->pjBits, NULL, 0);
+    if (!Dib->hdc || !Dib->hbmp)
+    {
+        if (Dib->hbmp) DeleteObject(Dib->hbmp);
+        if (Dib->hdc) DeleteDC(Dib->hdc);
+        return FALSE;
+    }
+    Dib->hbmpOld = SelectObject(Dib->hdc, Dib->hbmp);
+
+    for (i = 0; i < Dib->lDelta * cy; i++)
+    {
+        Seed = Seed * 1103515245 + 12345;
+        Dib->pjBits[i] = (BYTE)(Seed >> 16);
+    }
+
+    /* Throw in fully transparent and fully opaque pixels */
+    if (cBitsPixel == 32)
+    {
+        for (i = 0; i < cx * cy; i += 3)
+        {
+            ((PULONG)Dib->pjBits)[i] = (i % 2) ? 0 : ((PULONG)Dib->pjBits)[i] | 0xFF000000;
+        }
+    }
+    return TRUE;
+}
+
+static
+VOID
+DeleteTestDib(PTEST_DIB Dib)
+{
+    SelectObject(Dib->hdc, Dib->hbmpOld);
+    DeleteObject(Dib->hbmp);
+    DeleteDC(Dib->hdc);
+}
+
+static
+ULONG
+GetTestPixel(PTEST_DIB Dib, LONG x, LONG y)
+{
+    PBYTE pj = Dib->pjBits + y * Dib->lDelta + x * (Dib->cBitsPixel / 8);
+
+    if (Dib->cBitsPixel == 24) return pj[0] | (pj[1] << 8) | (pj[2] << 16);
+    return *(PULONG)pj;
+}
+
+/* The per channel blend of the win32k 32bpp DIB code */
+static
+ULONG
+BlendPixel(ULONG Src, ULONG Dst, BLENDFUNCTION Blend, BOOL SrcHasAlpha)
+{
+    ULONG Channel, Alpha, Value, Result = 0;
+    UCHAR SrcChannels[4];
+
+    for (Channel = 0; Channel < 3; Channel++)
+    {
+        SrcChannels[Channel] = (UCHAR)(((Src >> (Channel * 8)) & 0xFF) * Blend.SourceConstantAlpha / 255);
+    }
+    SrcChannels[3] = SrcHasAlpha ? (UCHAR)((Src >> 24) * Blend.SourceConstantAlpha / 255) :
+                                   Blend.SourceConstantAlpha;
+    Alpha = (Blend.AlphaFormat & AC_SRC_ALPHA) ? SrcChannels[3] : Blend.SourceConstantAlpha;
+
+    for (Channel = 0; Channel < 4; Channel++)
+    {
+        Value = ((Dst >> (Channel * 8)) & 0xFF) * (255 - Alpha) / 255 + SrcChannels[Channel];
+        Result |= min(Value, 255) << (Channel * 8);
+    }
+    return Result;
+}
+
+static
+VOID
+Test_Blend(WORD cSrcBitsPixel, BYTE SourceConstantAlpha, BYTE AlphaFormat,
+           LONG xSrc, LONG ySrc, LONG cxSrc, LONG cySrc, LONG cxDst, LONG cyDst)
+{
+    BLENDFUNCTION Blend = { AC_SRC_OVER, 0, SourceConstantAlpha, AlphaFormat };
+    TEST_DIB Src, Dst;
+    PULONG Before;
+    LONG x, y, xs, ys;
+    ULONG Expected, Mismatches = 0;
+    BOOL ret;
+
+    if (!CreateTestDib(&Src, 40, 30, cSrcBitsPixel, 1))
+    {
+        skip("Failed to create the source DIB\n");
+        return;
+    }
+    if (!CreateTestDib(&Dst, 70, 50, 32, 2))
+    {
+        skip("Failed to create the destination DIB\n");
+        DeleteTestDib(&Src);
+        return;
+    }
+
+    Before = HeapAlloc(GetProcessHeap(), 0, Dst.lDelta * Dst.cy);
+    if (!Before)
+    {
+        skip("Out of memory\n");
+        DeleteTestDib(&Dst);
+        DeleteTestDib(&Src);
+        return;
+    }
+    CopyMemory(Before, Dst.pjBits, Dst.lDelta * Dst.cy);
+
+    ret = GdiAlphaBlend(Dst.hdc, 3, 2, cxDst, cyDst, Src.hdc, xSrc, ySrc, cxSrc, cySrc, Blend);
+    ok(ret, "GdiAlphaBlend failed for %ubpp 0x%02x/%u %ldx%ld -> %ldx%ld\n",
+       cSrcBitsPixel, SourceConstantAlpha, AlphaFormat, cxSrc, cySrc, cxDst, cyDst);
+
+    for (y = 0; y < cyDst; y++)
+    {
+        ys = ySrc + y * cySrc / cyDst;
+        for (x = 0; x < cxDst; x++)
+        {
+            xs = xSrc + x * cxSrc / cxDst;
+            Expected = BlendPixel(GetTestPixel(&Src, xs, ys), Before[(2 + y) * Dst.cx + 3 + x],
+                                  Blend, cSrcBitsPixel == 32);
+            if (GetTestPixel(&Dst, 3 + x, 2 + y) != Expected) Mismatches++;
+        }
+    }
+    ok(Mismatches == 0, "%lu pixels differ for %ubpp 0x%02x/%u %ldx%ld -> %ldx%ld\n",
+       Mismatches, cSrcBitsPixel, SourceConstantAlpha, AlphaFormat, cxSrc, cySrc, cxDst, cyDst);
+
+    HeapFree(GetProcessHeap(), 0, Before);
+    DeleteTestDib(&Dst);
+    DeleteTestDib(&Src);
+}
+
+START_TEST(GdiAlphaBlend)
+{
+    /* Per pixel alpha, with and without a constant alpha on top */
+    Test_Blend(32, 255, AC_SRC_ALPHA, 0, 0, 40, 30, 40, 30);
+    Test_Blend(32, 128, AC_SRC_ALPHA, 0, 0, 40, 30, 40, 30);
+    Test_Blend(32, 255, AC_SRC_ALPHA, 5, 3, 13, 11, 61, 43);
+    Test_Blend(32, 77, AC_SRC_ALPHA, 1, 2, 37, 27, 17, 9);
+
+    /* Constant alpha only */
+    Test_Blend(32, 100, 0, 0, 0, 40, 30, 40, 30);
+    Test_Blend(32, 0, 0, 7, 0, 11, 29, 53, 13);
+    Test_Blend(24, 200, 0, 0, 0, 40, 30, 40, 30);
+    Test_Blend(24, 31, 0, 5, 3, 13, 11, 61, 43);
+}
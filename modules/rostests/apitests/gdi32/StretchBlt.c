@@ -0,0 +1,177 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Test for StretchBlt on DIB sections
+ */
+
+#include "precomp.h"
+
+typedef struct _TEST_DIB
+{
+    HDC hdc;
+    HBITMAP hbmp;
+    HGDIOBJ hbmpOld;
+    PBYTE pjBits;
+    LONG cx, cy, lDelta;
+    WORD cBitsPixel;
+} TEST_DIB, *PTEST_DIB;
+
+/* 256 distinct colors, so that indexed pixels translate back one to one */
+static
+RGBQUAD
+GetTestPaletteColor(ULONG Index)
+{
+    RGBQUAD Color = { (BYTE)(Index * 7), (BYTE)(255 - Index), (BYTE)Index, 0 };
+    return Color;
+}
+
+static
+BOOL
+CreateTestDib(PTEST_DIB Dib, LONG cx, LONG cy, WORD cBitsPixel, ULONG Seed)
+{
+    struct
+    {
+        BITMAPINFOHEADER bmiHeader;
+        RGBQUAD bmiColors[256];
+    } bmi = {{sizeof(BITMAPINFOHEADER), cx, -cy, 1, cBitsPixel, BI_RGB}};
+    LONG i;
+
+    if (cBitsPixel == 8)
+    {
+        bmi.bmiHeader.biClrUsed = 256;
+        for (i = 0; i < 256; i++) bmi.bmiColors[i] = GetTestPaletteColor(i);
+    }
+
+    Dib->cx = cx;
+    Dib->cy = cy;
+    Dib->cBitsPixel = cBitsPixel;
+    Dib->lDelta = ((cx * cBitsPixel + 31) / 32) * 4;
+    Dib->hdc = CreateCompatibleDC(NULL);
+    Dib->hbmp = CreateDIBSection(Dib->hdc, (PBITMAPINFO)&bmi, DIB_RGB_COLORS, (PVOID*)&Dib->pjBits, NULL, 0);
+    if (!Dib->hdc || !Dib->hbmp)
+    {
+        if (Dib->hbmp) DeleteObject(Dib->hbmp);
+        if (Dib->hdc) DeleteDC(Dib->hdc);
+        return FALSE;
+    }
+    Dib->hbmpOld = SelectObject(Dib->hdc, Dib->hbmp);
+
+    /* Random colors, but keep the unused byte of 32bpp pixels at 0 */
+    for (i = 0; i < Dib->lDelta * cy; i++)
+    {
+        Seed = Seed * 1103515245 + 12345;
+        Dib->pjBits[i] = (BYTE)(Seed >> 16);
+        if (cBitsPixel == 32 && (i & 3) == 3) Dib->pjBits[i] = 0;
+    }
+    return TRUE;
+}
+
+static
+VOID
+DeleteTestDib(PTEST_DIB Dib)
+{
+    SelectObject(Dib->hdc, Dib->hbmpOld);
+    DeleteObject(Dib->hbmp);
+    DeleteDC(Dib->hdc);
+}
+
+static
+ULONG
+GetTestPixel(PTEST_DIB Dib, LONG x, LONG y)
+{
+    PBYTE pj = Dib->pjBits + y * Dib->lDelta + x * (Dib->cBitsPixel / 8);
+
+    switch (Dib->cBitsPixel)
+    {
+        case 8: return *pj;
+        case 16: return *(PUSHORT)pj;
+        case 24: return pj[0] | (pj[1] << 8) | (pj[2] << 16);
+        default: return *(PULONG)pj;
+    }
+}
+
+/* What a source pixel becomes in the destination format, for the formats tested below */
+static
+ULONG
+ConvertTestPixel(WORD cSrcBits, WORD cDstBits, ULONG Color)
+{
+    RGBQUAD Entry;
+
+    if (cSrcBits == cDstBits) return Color;
+
+    if (cSrcBits == 8)
+    {
+        Entry = GetTestPaletteColor(Color);
+        Color = Entry.rgbBlue | (Entry.rgbGreen << 8) | (Entry.rgbRed << 16);
+    }
+
+    /* 0x00RRGGBB to 5-5-5 */
+    if (cDstBits == 16)
+        return ((Color >> 9) & 0x7C00) | ((Color >> 6) & 0x03E0) | ((Color >> 3) & 0x001F);
+
+    return Color;
+}
+
+/* Compares a stretch against the nearest neighbour mapping of the win32k DIB code */
+static
+VOID
+Test_Stretch(WORD cSrcBits, WORD cDstBits, LONG xSrc, LONG ySrc, LONG cxSrc, LONG cySrc, LONG cxDst, LONG cyDst)
+{
+    TEST_DIB Src, Dst;
+    LONG x, y, xs, ys;
+    ULONG Mismatches = 0;
+    BOOL ret;
+
+    if (!CreateTestDib(&Src, 40, 30, cSrcBits, 1))
+    {
+        skip("Failed to create the source DIB\n");
+        return;
+    }
+    if (!CreateTestDib(&Dst, 70, 50, cDstBits, 2))
+    {
+        skip("Failed to create the destination DIB\n");
+        DeleteTestDib(&Src);
+        return;
+    }
+
+    SetStretchBltMode(Dst.hdc, COLORONCOLOR);
+    ret = StretchBlt(Dst.hdc, 3, 2, cxDst, cyDst, Src.hdc, xSrc, ySrc, cxSrc, cySrc, SRCCOPY);
+    ok(ret, "StretchBlt failed for %ubpp %ldx%ld -> %ubpp %ldx%ld\n",
+       cSrcBits, cxSrc, cySrc, cDstBits, cxDst, cyDst);
+
+    for (y = 0; y < cyDst; y++)
+    {
+        ys = ySrc + y * cySrc / cyDst;
+        for (x = 0; x < cxDst; x++)
+        {
+            xs = xSrc + x * cxSrc / cxDst;
+            if (GetTestPixel(&Dst, 3 + x, 2 + y) !=
+                ConvertTestPixel(cSrcBits, cDstBits, GetTestPixel(&Src, xs, ys)))
+            {
+                Mismatches++;
+            }
+        }
+    }
+    ok(Mismatches == 0, "%lu pixels differ for %ubpp %ldx%ld -> %ubpp %ldx%ld\n",
+       Mismatches, cSrcBits, cxSrc, cySrc, cDstBits, cxDst, cyDst);
+
+    DeleteTestDib(&Dst);
+    DeleteTestDib(&Src);
+}
+
+START_TEST(StretchBlt)
+{
+    /* The same format, then conversions that go through the color translation */
+    static const WORD aBitsPixel[][2] = { { 8, 8 }, { 16, 16 }, { 24, 24 }, { 32, 32 }, { 8, 32 }, { 32, 16 } };
+    ULONG i;
+
+    for (i = 0; i < ARRAYSIZE(aBitsPixel); i++)
+    {
+        /* Same size, up, down and a mix of both */
+        Test_Stretch(aBitsPixel[i][0], aBitsPixel[i][1], 0, 0, 40, 30, 40, 30);
+        Test_Stretch(aBitsPixel[i][0], aBitsPixel[i][1], 5, 3, 13, 11, 61, 43);
+        Test_Stretch(aBitsPixel[i][0], aBitsPixel[i][1], 1, 2, 37, 27, 17, 9);
+        Test_Stretch(aBitsPixel[i][0], aBitsPixel[i][1], 7, 0, 11, 29, 53, 13);
+        Test_Stretch(aBitsPixel[i][0], aBitsPixel[i][1], 0, 0, 1, 1, 9, 7);
+    }
+}
@@ -0,0 +1,130 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Tests for cached reads going through many cache manager views
+ */
+
+#include "precomp.h"
+
+/* Mirrors VACB_MAPPING_GRANULARITY */
+#define VIEW_SIZE       0x40000
+#define MAX_VIEWS       256
+
+#define VIEW_HEAD(View) (0xC0DE0000 | (View))
+#define VIEW_TAIL(View) (~(ULONG)(View))
+
+static
+BOOL
+ReadAt(HANDLE hFile, LONGLONG Offset, PVOID Buffer, ULONG Length)
+{
+    LARGE_INTEGER Position;
+    DWORD Read;
+
+    Position.QuadPart = Offset;
+    if (!SetFilePointerEx(hFile, Position, NULL, FILE_BEGIN))
+        return FALSE;
+
+    return ReadFile(hFile, Buffer, Length, &Read, NULL) && Read == Length;
+}
+
+static
+BOOL
+WriteAt(HANDLE hFile, LONGLONG Offset, ULONG Value)
+{
+    LARGE_INTEGER Position;
+    DWORD Written;
+
+    Position.QuadPart = Offset;
+    if (!SetFilePointerEx(hFile, Position, NULL, FILE_BEGIN))
+        return FALSE;
+
+    return WriteFile(hFile, &Value, sizeof(Value), &Written, NULL) && Written == sizeof(Value);
+}
+
+static
+void
+CheckView(HANDLE hFile, ULONG View)
+{
+    ULONG Values[2];
+
+    /* Start and middle of the view */
+    Values[0] = Values[1] = 0xdeadbeef;
+    ok(ReadAt(hFile, (LONGLONG)View * VIEW_SIZE, &Values[0], sizeof(Values[0])),
+       "Read of view %lu failed: %lu\n", View, GetLastError());
+    ok(ReadAt(hFile, (LONGLONG)View * VIEW_SIZE + VIEW_SIZE / 2, &Values[1], sizeof(Values[1])),
+       "Read of the middle of view %lu failed: %lu\n", View, GetLastError());
+    ok(Values[0] == VIEW_HEAD(View), "View %lu starts with 0x%08lx\n", View, Values[0]);
+    ok(Values[1] == 0, "View %lu has 0x%08lx in its middle\n", View, Values[1]);
+
+    /* A read crossing into the next view */
+    if (View + 1 < MAX_VIEWS)
+    {
+        Values[0] = Values[1] = 0xdeadbeef;
+        ok(ReadAt(hFile, (LONGLONG)(View + 1) * VIEW_SIZE - sizeof(ULONG), Values, sizeof(Values)),
+           "Read across views %lu and %lu failed: %lu\n", View, View + 1, GetLastError());
+        ok(Values[0] == VIEW_TAIL(View), "View %lu ends with 0x%08lx\n", View, Values[0]);
+        ok(Values[1] == VIEW_HEAD(View + 1), "View %lu starts with 0x%08lx\n", View + 1, Values[1]);
+    }
+}
+
+START_TEST(CacheViewLookup)
+{
+    HANDLE hFile;
+    CHAR FileName[MAX_PATH];
+    CHAR TempPath[MAX_PATH];
+    LARGE_INTEGER Size;
+    ULONG View;
+
+    if (!GetTempPathA(sizeof(TempPath), TempPath) ||
+        !GetTempFileNameA(TempPath, "cvl", 0, FileName))
+    {
+        skip("No temporary file available\n");
+        return;
+    }
+
+    hFile = CreateFileA(FileName,
+                        GENERIC_READ | GENERIC_WRITE,
+                        0,
+                        NULL,
+                        CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                        NULL);
+    ok(hFile != INVALID_HANDLE_VALUE, "CreateFile failed: %lu\n", GetLastError());
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        DeleteFileA(FileName);
+        return;
+    }
+
+    Size.QuadPart = (LONGLONG)MAX_VIEWS * VIEW_SIZE;
+    if (!SetFilePointerEx(hFile, Size, NULL, FILE_BEGIN) || !SetEndOfFile(hFile))
+    {
+        skip("Cannot extend the test file to %I64u bytes\n", Size.QuadPart);
+        CloseHandle(hFile);
+        return;
+    }
+
+    /* Mark both ends of every view, backwards so views get created out of order */
+    for (View = MAX_VIEWS; View-- > 0;)
+    {
+        ok(WriteAt(hFile, (LONGLONG)View * VIEW_SIZE, VIEW_HEAD(View)),
+           "Write to view %lu failed: %lu\n", View, GetLastError());
+        ok(WriteAt(hFile, (LONGLONG)(View + 1) * VIEW_SIZE - sizeof(ULONG), VIEW_TAIL(View)),
+           "Write to the end of view %lu failed: %lu\n", View, GetLastError());
+    }
+
+    /* Each lookup has to find the view of its own offset, whatever the order */
+    for (View = 0; View < MAX_VIEWS; View++)
+        CheckView(hFile, View);
+    for (View = MAX_VIEWS; View-- > 0;)
+        CheckView(hFile, View);
+    for (View = 0; View < MAX_VIEWS; View++)
+        CheckView(hFile, (View * 37) % MAX_VIEWS);
+
+    /* Views beyond the end of the file do not exist */
+    View = 0xdeadbeef;
+    ok(!ReadAt(hFile, Size.QuadPart, &View, sizeof(View)), "Read past the end succeeded\n");
+    ok(View == 0xdeadbeef, "Read past the end returned 0x%08lx\n", View);
+
+    CloseHandle(hFile);
+}
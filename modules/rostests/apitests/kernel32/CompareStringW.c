@@ -0,0 +1,120 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Tests for CompareStringW agreeing with LCMapStringW sort keys
+ */
+
+#include "precomp.h"
+
+#define KEY_SIZE    256
+
+static PCWSTR Strings[] =
+{
+    L"", L"a", L"A", L"b", L"B", L"z", L"0", L"1", L"9", L"10",
+    L"ab", L"aB", L"Ab", L"AB", L"ba", L"abc", L"abd", L"abC", L"ABC",
+    L"a b", L"a.b", L"ab ", L" ab", L"ab.", L"a  b", L"a,b", L"a_b",
+    L"co-op", L"coop", L"co'op", L"-coop", L"coop-", L"co--op", L"c-o", L"'", L"-", L"a-", L"a'",
+    L"e", L"E", L"\x00e9", L"\x00c9", L"ete", L"\x00e9t\x00e9", L"\x00c9t\x00e9", L"e-t\x00e9",
+    L"Program Files", L"program files", L"Program Files (x86)", L"ProgramData",
+    L"readme.txt", L"README.TXT", L"readme1.txt", L"readme10.txt", L"readme2.txt",
+};
+
+static
+int
+KeySign(PCWSTR String1, PCWSTR String2, DWORD Flags)
+{
+    CHAR Key1[KEY_SIZE], Key2[KEY_SIZE];
+    int Result;
+
+    ok(LCMapStringW(LOCALE_USER_DEFAULT, LCMAP_SORTKEY | Flags, String1, -1, (PWSTR)Key1, sizeof(Key1)) != 0,
+       "No sort key for '%S'\n", String1);
+    ok(LCMapStringW(LOCALE_USER_DEFAULT, LCMAP_SORTKEY | Flags, String2, -1, (PWSTR)Key2, sizeof(Key2)) != 0,
+       "No sort key for '%S'\n", String2);
+
+    Result = strcmp(Key1, Key2);
+    return (Result > 0) - (Result < 0);
+}
+
+static
+void
+TestKeyOrder(PCWSTR *List, ULONG Count, DWORD Flags)
+{
+    ULONG i, j;
+    int Compare;
+
+    for (i = 0; i < Count; i++)
+    {
+        for (j = 0; j < Count; j++)
+        {
+            Compare = CompareStringW(LOCALE_USER_DEFAULT, Flags, List[i], -1, List[j], -1) - CSTR_EQUAL;
+            ok(Compare == KeySign(List[i], List[j], Flags),
+               "Flags 0x%lx: CompareStringW('%S', '%S') = %d disagrees with the sort keys\n",
+               Flags, List[i], List[j], Compare);
+        }
+    }
+}
+
+static
+void
+Test_SortKeys(void)
+{
+    static const DWORD Flags[] =
+    {
+        0, NORM_IGNORECASE, NORM_IGNORENONSPACE, NORM_IGNORESYMBOLS,
+        NORM_IGNORECASE | NORM_IGNORENONSPACE, NORM_IGNORECASE | NORM_IGNORESYMBOLS,
+        NORM_IGNORECASE | NORM_IGNORENONSPACE | NORM_IGNORESYMBOLS,
+        SORT_STRINGSORT, SORT_STRINGSORT | NORM_IGNORECASE, SORT_STRINGSORT | NORM_IGNORENONSPACE,
+    };
+    ULONG i;
+
+    for (i = 0; i < _countof(Flags); i++)
+        TestKeyOrder(Strings, _countof(Strings), Flags[i]);
+}
+
+static
+void
+Test_IgnoreSymbols(void)
+{
+    /* Ignored symbols at the end do not make a string longer */
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, NORM_IGNORESYMBOLS, L"abc", -1, L"abc  ", -1), CSTR_EQUAL);
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, NORM_IGNORESYMBOLS, L"abc.", -1, L"abc", -1), CSTR_EQUAL);
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, NORM_IGNORESYMBOLS, L"", -1, L" .", -1), CSTR_EQUAL);
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, NORM_IGNORESYMBOLS, L"a b", -1, L"ab", -1), CSTR_EQUAL);
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, 0, L"abc", -1, L"abc ", -1), CSTR_LESS_THAN);
+}
+
+static
+void
+Test_Levels(void)
+{
+    /* A difference further in decides over an earlier lower level one */
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, 0, L"Ab", -1, L"ac", -1), CSTR_LESS_THAN);
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, 0, L"ac", -1, L"Ab", -1), CSTR_GREATER_THAN);
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, 0, L"Ab", -1, L"abc", -1), CSTR_LESS_THAN);
+
+    /* Without one, the first lower level difference decides */
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, 0, L"abC", -1, L"Abc", -1), CSTR_LESS_THAN);
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, 0, L"Abc", -1, L"abC", -1), CSTR_GREATER_THAN);
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, NORM_IGNORECASE, L"abC", -1, L"Abc", -1), CSTR_EQUAL);
+
+    /* Same after a hyphen that only one side has */
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, 0, L"co-op", -1, L"coop", -1), CSTR_GREATER_THAN);
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, 0, L"coop", -1, L"co-op", -1), CSTR_LESS_THAN);
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, 0, L"co-op", -1, L"co-op", -1), CSTR_EQUAL);
+
+    /* Hyphens only break ties in word sort, and weigh like symbols in string sort */
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, 0, L"co-op", -1, L"cop", -1), CSTR_LESS_THAN);
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, SORT_STRINGSORT, L"co-op", -1, L"coop", -1), CSTR_LESS_THAN);
+
+    /* Accents tell strings apart, unless they are ignored */
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, 0, L"e", -1, L"\x00e9", -1), CSTR_LESS_THAN);
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, NORM_IGNORENONSPACE, L"e", -1, L"\x00e9", -1), CSTR_EQUAL);
+    ok_int(CompareStringW(LOCALE_USER_DEFAULT, NORM_IGNORENONSPACE, L"E", -1, L"\x00e9", -1), CSTR_GREATER_THAN);
+}
+
+START_TEST(CompareStringW)
+{
+    Test_SortKeys();
+    Test_IgnoreSymbols();
+    Test_Levels();
+}
@@ -0,0 +1,198 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Tests for CopyFileExW data and progress reporting
+ */
+
+#include "precomp.h"
+
+typedef struct _PROGRESS_CONTEXT
+{
+    ULONG Calls;
+    ULONG CancelAt;
+    DWORD FirstReason;
+    LARGE_INTEGER TotalSize;
+    LARGE_INTEGER LastTransferred;
+    BOOL Backwards;
+} PROGRESS_CONTEXT, *PPROGRESS_CONTEXT;
+
+static WCHAR SourceName[MAX_PATH];
+static WCHAR DestName[MAX_PATH];
+
+static
+DWORD
+CALLBACK
+ProgressRoutine(LARGE_INTEGER TotalFileSize,
+                LARGE_INTEGER TotalBytesTransferred,
+                LARGE_INTEGER StreamSize,
+                LARGE_INTEGER StreamBytesTransferred,
+                DWORD StreamNumber,
+                DWORD CallbackReason,
+                HANDLE SourceFile,
+                HANDLE DestinationFile,
+                LPVOID Data)
+{
+    PPROGRESS_CONTEXT Context = Data;
+
+    if (Context->Calls++ == 0)
+        Context->FirstReason = CallbackReason;
+    if (TotalBytesTransferred.QuadPart < Context->LastTransferred.QuadPart)
+        Context->Backwards = TRUE;
+
+    Context->TotalSize = TotalFileSize;
+    Context->LastTransferred = TotalBytesTransferred;
+
+    return (Context->CancelAt && Context->Calls >= Context->CancelAt) ? PROGRESS_CANCEL : PROGRESS_CONTINUE;
+}
+
+static
+BOOL
+WriteTestFile(PCWSTR FileName, ULONG Size)
+{
+    HANDLE File;
+    PUCHAR Data;
+    DWORD Written;
+    ULONG i;
+    BOOL Ret;
+
+    Data = HeapAlloc(GetProcessHeap(), 0, Size + 1);
+    if (!Data) return FALSE;
+
+    for (i = 0; i < Size; i++)
+        Data[i] = (UCHAR)(i * 7 + i / 251);
+
+    File = CreateFileW(FileName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (File == INVALID_HANDLE_VALUE)
+    {
+        HeapFree(GetProcessHeap(), 0, Data);
+        return FALSE;
+    }
+
+    Ret = WriteFile(File, Data, Size, &Written, NULL) && Written == Size;
+    CloseHandle(File);
+    HeapFree(GetProcessHeap(), 0, Data);
+    return Ret;
+}
+
+static
+BOOL
+CheckTestFile(PCWSTR FileName, ULONG Size)
+{
+    HANDLE File;
+    PUCHAR Data;
+    DWORD Read;
+    ULONG i;
+    BOOL Ret;
+
+    File = CreateFileW(FileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (File == INVALID_HANDLE_VALUE) return FALSE;
+
+    Data = HeapAlloc(GetProcessHeap(), 0, Size + 1);
+    if (!Data)
+    {
+        CloseHandle(File);
+        return FALSE;
+    }
+
+    /* One byte more than expected, so a dest that is too long shows */
+    Ret = ReadFile(File, Data, Size + 1, &Read, NULL) && Read == Size;
+    for (i = 0; Ret && i < Size; i++)
+    {
+        Ret = (Data[i] == (UCHAR)(i * 7 + i / 251));
+    }
+
+    CloseHandle(File);
+    HeapFree(GetProcessHeap(), 0, Data);
+    return Ret;
+}
+
+static
+void
+Test_Sizes(DWORD Flags)
+{
+    static const ULONG Sizes[] = { 0, 1, 511, 4096, 65535, 65536, 65537, 300000, 4 * 1024 * 1024 + 123 };
+    PROGRESS_CONTEXT Context;
+    ULONG i;
+
+    for (i = 0; i < _countof(Sizes); i++)
+    {
+        if (!WriteTestFile(SourceName, Sizes[i]))
+        {
+            skip("Cannot create a %lu bytes source\n", Sizes[i]);
+            continue;
+        }
+
+        ZeroMemory(&Context, sizeof(Context));
+        ok(CopyFileExW(SourceName, DestName, ProgressRoutine, &Context, NULL, Flags),
+           "Flags 0x%lx: copying %lu bytes failed with %lu\n", Flags, Sizes[i], GetLastError());
+        ok(CheckTestFile(DestName, Sizes[i]), "Flags 0x%lx: copy of %lu bytes differs\n", Flags, Sizes[i]);
+
+        /* First the stream, then chunks in order, the last one covering the whole file */
+        ok(Context.Calls != 0, "Flags 0x%lx: no progress for %lu bytes\n", Flags, Sizes[i]);
+        ok(Context.FirstReason == CALLBACK_STREAM_SWITCH, "Flags 0x%lx: first reason %lu\n", Flags, Context.FirstReason);
+        ok(!Context.Backwards, "Flags 0x%lx: progress went backwards\n", Flags);
+        ok(Context.TotalSize.QuadPart == Sizes[i], "Flags 0x%lx: total size %I64d\n", Flags, Context.TotalSize.QuadPart);
+        ok(Context.LastTransferred.QuadPart == Sizes[i], "Flags 0x%lx: last progress at %I64d of %lu\n",
+           Flags, Context.LastTransferred.QuadPart, Sizes[i]);
+
+        DeleteFileW(DestName);
+    }
+}
+
+static
+void
+Test_Cancel(void)
+{
+    PROGRESS_CONTEXT Context;
+    BOOL Cancel;
+
+    if (!WriteTestFile(SourceName, 4 * 1024 * 1024))
+    {
+        skip("Cannot create the source\n");
+        return;
+    }
+
+    /* Cancel from the first chunk, the dest goes away */
+    ZeroMemory(&Context, sizeof(Context));
+    Context.CancelAt = 2;
+    SetLastError(0xdeadbeef);
+    ok(!CopyFileExW(SourceName, DestName, ProgressRoutine, &Context, NULL, 0), "Copy succeeded\n");
+    ok_int(GetLastError(), ERROR_REQUEST_ABORTED);
+    ok(GetFileAttributesW(DestName) == INVALID_FILE_ATTRIBUTES, "Dest was kept\n");
+
+    /* Same with the cancel flag */
+    Cancel = TRUE;
+    SetLastError(0xdeadbeef);
+    ok(!CopyFileExW(SourceName, DestName, NULL, NULL, &Cancel, 0), "Copy succeeded\n");
+    ok_int(GetLastError(), ERROR_REQUEST_ABORTED);
+    ok(GetFileAttributesW(DestName) == INVALID_FILE_ATTRIBUTES, "Dest was kept\n");
+
+    /* Unbuffered copies still honor COPY_FILE_FAIL_IF_EXISTS */
+    ok(CopyFileExW(SourceName, DestName, NULL, NULL, NULL, COPY_FILE_NO_BUFFERING), "Copy failed with %lu\n", GetLastError());
+    SetLastError(0xdeadbeef);
+    ok(!CopyFileExW(SourceName, DestName, NULL, NULL, NULL, COPY_FILE_NO_BUFFERING | COPY_FILE_FAIL_IF_EXISTS),
+       "Copy over an existing file succeeded\n");
+    ok_int(GetLastError(), ERROR_FILE_EXISTS);
+    DeleteFileW(DestName);
+}
+
+START_TEST(CopyFileEx)
+{
+    WCHAR TempPath[MAX_PATH];
+
+    GetTempPathW(_countof(TempPath), TempPath);
+    if (!GetTempFileNameW(TempPath, L"cfe", 0, SourceName) ||
+        !GetTempFileNameW(TempPath, L"cfe", 0, DestName))
+    {
+        skip("No temporary files\n");
+        return;
+    }
+    DeleteFileW(DestName);
+
+    Test_Sizes(0);
+    Test_Sizes(COPY_FILE_NO_BUFFERING);
+    Test_Cancel();
+
+    DeleteFileW(SourceName);
+    DeleteFileW(DestName);
+}
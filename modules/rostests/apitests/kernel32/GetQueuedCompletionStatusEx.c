@@ -0,0 +1,184 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Tests for GetQueuedCompletionStatusEx
+ */
+
+#include "precomp.h"
+
+/* XP and 2003 do not have this function */
+static BOOL (WINAPI *pGetQueuedCompletionStatusEx)(HANDLE, LPOVERLAPPED_ENTRY, ULONG, PULONG, DWORD, BOOL);
+
+#define PRODUCER_PACKETS 1000
+
+static LONG g_ApcCalled;
+
+static VOID WINAPI ApcRoutine(ULONG_PTR Parameter)
+{
+    InterlockedIncrement(&g_ApcCalled);
+}
+
+static void test_Basic(HANDLE Port)
+{
+    OVERLAPPED_ENTRY Entries[8];
+    ULONG Removed, i;
+    BOOL Ret;
+
+    /* Nothing is queued */
+    Removed = 0xdeadbeef;
+    SetLastError(0xdeadbeef);
+    Ret = pGetQueuedCompletionStatusEx(Port, Entries, _countof(Entries), &Removed, 0, FALSE);
+    ok(Ret == FALSE, "Ret = %d\n", Ret);
+    ok(GetLastError() == WAIT_TIMEOUT, "GetLastError() = %lu\n", GetLastError());
+    ok(Removed == 0, "Removed = %lu\n", Removed);
+
+    /* No room for anything */
+    SetLastError(0xdeadbeef);
+    Ret = pGetQueuedCompletionStatusEx(Port, Entries, 0, &Removed, 0, FALSE);
+    ok(Ret == FALSE, "Ret = %d\n", Ret);
+    ok(GetLastError() == ERROR_INVALID_PARAMETER, "GetLastError() = %lu\n", GetLastError());
+
+    /* Everything that is queued comes back at once, in order */
+    for (i = 0; i < 3; i++)
+    {
+        Ret = PostQueuedCompletionStatus(Port, 10 + i, 20 + i, (LPOVERLAPPED)(ULONG_PTR)(30 + i));
+        ok(Ret == TRUE, "PostQueuedCompletionStatus failed with %lu\n", GetLastError());
+    }
+
+    Removed = 0;
+    Ret = pGetQueuedCompletionStatusEx(Port, Entries, _countof(Entries), &Removed, 0, FALSE);
+    ok(Ret == TRUE, "Ret = %d, GetLastError() = %lu\n", Ret, GetLastError());
+    ok(Removed == 3, "Removed = %lu\n", Removed);
+    for (i = 0; i < Removed && i < 3; i++)
+    {
+        ok(Entries[i].dwNumberOfBytesTransferred == 10 + i, "%lu: Bytes = %lu\n", i, Entries[i].dwNumberOfBytesTransferred);
+        ok(Entries[i].lpCompletionKey == 20 + i, "%lu: Key = %Iu\n", i, Entries[i].lpCompletionKey);
+        ok(Entries[i].lpOverlapped == (LPOVERLAPPED)(ULONG_PTR)(30 + i), "%lu: Overlapped = %p\n", i, Entries[i].lpOverlapped);
+    }
+
+    /* Only as many as asked for, the others stay queued */
+    for (i = 0; i < 3; i++)
+    {
+        PostQueuedCompletionStatus(Port, 0, i, NULL);
+    }
+
+    Ret = pGetQueuedCompletionStatusEx(Port, Entries, 2, &Removed, 0, FALSE);
+    ok(Ret == TRUE, "Ret = %d, GetLastError() = %lu\n", Ret, GetLastError());
+    ok(Removed == 2, "Removed = %lu\n", Removed);
+
+    Ret = pGetQueuedCompletionStatusEx(Port, Entries, _countof(Entries), &Removed, 0, FALSE);
+    ok(Ret == TRUE, "Ret = %d, GetLastError() = %lu\n", Ret, GetLastError());
+    ok(Removed == 1, "Removed = %lu\n", Removed);
+    ok(Entries[0].lpCompletionKey == 2, "Key = %Iu\n", Entries[0].lpCompletionKey);
+}
+
+static void test_Alertable(HANDLE Port)
+{
+    OVERLAPPED_ENTRY Entries[8];
+    ULONG Removed;
+    BOOL Ret;
+
+    /* A user APC ends an alertable wait and gets delivered */
+    g_ApcCalled = 0;
+    QueueUserAPC(ApcRoutine, GetCurrentThread(), 0);
+
+    Removed = 0xdeadbeef;
+    SetLastError(0xdeadbeef);
+    Ret = pGetQueuedCompletionStatusEx(Port, Entries, _countof(Entries), &Removed, 1000, TRUE);
+    ok(Ret == FALSE, "Ret = %d\n", Ret);
+    ok(GetLastError() == WAIT_IO_COMPLETION, "GetLastError() = %lu\n", GetLastError());
+    ok(Removed == 0, "Removed = %lu\n", Removed);
+    ok(g_ApcCalled == 1, "g_ApcCalled = %ld\n", g_ApcCalled);
+
+    /* A non alertable one leaves it pending */
+    g_ApcCalled = 0;
+    QueueUserAPC(ApcRoutine, GetCurrentThread(), 0);
+
+    SetLastError(0xdeadbeef);
+    Ret = pGetQueuedCompletionStatusEx(Port, Entries, _countof(Entries), &Removed, 10, FALSE);
+    ok(Ret == FALSE, "Ret = %d\n", Ret);
+    ok(GetLastError() == WAIT_TIMEOUT, "GetLastError() = %lu\n", GetLastError());
+    ok(g_ApcCalled == 0, "g_ApcCalled = %ld\n", g_ApcCalled);
+
+    SleepEx(0, TRUE);
+    ok(g_ApcCalled == 1, "g_ApcCalled = %ld\n", g_ApcCalled);
+}
+
+static DWORD WINAPI ProducerThread(LPVOID Parameter)
+{
+    HANDLE Port = Parameter;
+    ULONG i;
+
+    for (i = 0; i < PRODUCER_PACKETS; i++)
+    {
+        PostQueuedCompletionStatus(Port, 0, i, NULL);
+    }
+
+    return 0;
+}
+
+static void test_Producer(HANDLE Port)
+{
+    OVERLAPPED_ENTRY Entries[16];
+    HANDLE Thread;
+    ULONG Received = 0, Removed, i;
+    BOOL Ret;
+
+    Thread = CreateThread(NULL, 0, ProducerThread, Port, 0, NULL);
+    ok(Thread != NULL, "CreateThread failed with %lu\n", GetLastError());
+    if (!Thread)
+        return;
+
+    /* Packets of a single producer come back in the order they were posted */
+    while (Received < PRODUCER_PACKETS)
+    {
+        Ret = pGetQueuedCompletionStatusEx(Port, Entries, _countof(Entries), &Removed, 5000, FALSE);
+        if (!Ret)
+        {
+            ok(0, "Dequeue failed with %lu after %lu packets\n", GetLastError(), Received);
+            break;
+        }
+
+        ok(Removed >= 1 && Removed <= _countof(Entries), "Removed = %lu\n", Removed);
+        for (i = 0; i < Removed; i++)
+        {
+            if (Entries[i].lpCompletionKey != Received + i)
+            {
+                ok(0, "Got key %Iu instead of %lu\n", Entries[i].lpCompletionKey, Received + i);
+                break;
+            }
+        }
+
+        Received += Removed;
+    }
+
+    WaitForSingleObject(Thread, INFINITE);
+    CloseHandle(Thread);
+
+    ok(Received == PRODUCER_PACKETS, "Received = %lu\n", Received);
+}
+
+START_TEST(GetQueuedCompletionStatusEx)
+{
+    HANDLE Port;
+    HMODULE hKernel32;
+
+    hKernel32 = GetModuleHandleW(L"kernel32.dll");
+    pGetQueuedCompletionStatusEx = (void*)GetProcAddress(hKernel32, "GetQueuedCompletionStatusEx");
+    if (!pGetQueuedCompletionStatusEx)
+    {
+        skip("GetQueuedCompletionStatusEx is not available\n");
+        return;
+    }
+
+    Port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    ok(Port != NULL, "CreateIoCompletionPort failed with %lu\n", GetLastError());
+    if (!Port)
+        return;
+
+    test_Basic(Port);
+    test_Alertable(Port);
+    test_Producer(Port);
+
+    CloseHandle(Port);
+}
@@ -0,0 +1,151 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Tests for NtCreateEvent handles
+ */
+
+#include "precomp.h"
+
+#define STRESS_THREADS    4
+#define STRESS_ITERATIONS 2000
+#define HANDLE_BATCH 64
+
+typedef struct _STRESS_CONTEXT
+{
+    HANDLE StartEvent;
+    ULONG Failures;
+} STRESS_CONTEXT, *PSTRESS_CONTEXT;
+
+static
+void
+Test_Reuse(void)
+{
+    HANDLE Handles[HANDLE_BATCH], Event;
+    DWORD_PTR OldAffinity;
+    NTSTATUS Status;
+    ULONG i, j;
+
+    /* Free handles are cached per processor, so stay on one */
+    OldAffinity = SetThreadAffinityMask(GetCurrentThread(), 1);
+    ok(OldAffinity != 0, "SetThreadAffinityMask failed: %lu\n", GetLastError());
+
+    /* Every live handle is distinct */
+    for (i = 0; i < HANDLE_BATCH; i++)
+    {
+        Status = NtCreateEvent(&Handles[i], EVENT_ALL_ACCESS, NULL, NotificationEvent, FALSE);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+        if (!NT_SUCCESS(Status)) Handles[i] = NULL;
+
+        for (j = 0; j < i; j++)
+        {
+            ok(Handles[i] != Handles[j], "Handle %p given out twice\n", Handles[i]);
+        }
+    }
+
+    /* Closed handles are invalid, whichever way they are used */
+    Event = Handles[0];
+    Status = NtClose(Event);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    Status = NtSetEvent(Event, NULL);
+    ok_ntstatus(Status, STATUS_INVALID_HANDLE);
+
+    /* The next event gets the same handle, which then refers to it */
+    Status = NtCreateEvent(&Handles[0], EVENT_ALL_ACCESS, NULL, NotificationEvent, FALSE);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (NT_SUCCESS(Status))
+    {
+        ok(Handles[0] == Event, "Got handle %p instead of %p\n", Handles[0], Event);
+        Status = NtSetEvent(Handles[0], NULL);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+    }
+    else
+    {
+        Handles[0] = NULL;
+    }
+
+    for (i = 0; i < HANDLE_BATCH; i++)
+    {
+        if (Handles[i]) NtClose(Handles[i]);
+    }
+
+    if (OldAffinity) SetThreadAffinityMask(GetCurrentThread(), OldAffinity);
+}
+
+static
+DWORD
+WINAPI
+StressThread(LPVOID Parameter)
+{
+    PSTRESS_CONTEXT Context = Parameter;
+    HANDLE Handles[4];
+    NTSTATUS Status;
+    ULONG i, j;
+
+    WaitForSingleObject(Context->StartEvent, INFINITE);
+
+    /* Keep a few handles open so the table sees more than one at a time */
+    for (i = 0; i < STRESS_ITERATIONS / ARRAYSIZE(Handles); i++)
+    {
+        for (j = 0; j < ARRAYSIZE(Handles); j++)
+        {
+            Status = NtCreateEvent(&Handles[j], EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE);
+            if (!NT_SUCCESS(Status))
+            {
+                Handles[j] = NULL;
+                Context->Failures++;
+            }
+            else if (!NT_SUCCESS(NtSetEvent(Handles[j], NULL)))
+            {
+                /* The handle must refer to the event just created */
+                Context->Failures++;
+            }
+        }
+
+        for (j = 0; j < ARRAYSIZE(Handles); j++)
+        {
+            if (Handles[j] && !NT_SUCCESS(NtClose(Handles[j]))) Context->Failures++;
+        }
+    }
+
+    return 0;
+}
+
+static
+void
+Test_Stress(void)
+{
+    STRESS_CONTEXT Contexts[STRESS_THREADS];
+    HANDLE Threads[STRESS_THREADS];
+    HANDLE StartEvent;
+    ULONG i, Created;
+
+    StartEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ok(StartEvent != NULL, "CreateEvent failed\n");
+    if (!StartEvent) return;
+
+    /* Several threads creating and closing at once, so the handle caches are shared */
+    for (Created = 0; Created < STRESS_THREADS; Created++)
+    {
+        Contexts[Created].StartEvent = StartEvent;
+        Contexts[Created].Failures = 0;
+        Threads[Created] = CreateThread(NULL, 0, StressThread, &Contexts[Created], 0, NULL);
+        if (!Threads[Created]) break;
+    }
+    ok(Created == STRESS_THREADS, "Only %lu threads out of %u\n", Created, STRESS_THREADS);
+
+    SetEvent(StartEvent);
+    WaitForMultipleObjects(Created, Threads, TRUE, INFINITE);
+
+    for (i = 0; i < Created; i++)
+    {
+        ok(Contexts[i].Failures == 0, "Thread %lu had %lu failures\n", i, Contexts[i].Failures);
+        CloseHandle(Threads[i]);
+    }
+    CloseHandle(StartEvent);
+}
+
+START_TEST(NtCreateEvent)
+{
+    Test_Reuse();
+    Test_Stress();
+}
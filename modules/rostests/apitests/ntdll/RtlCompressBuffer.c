@@ -0,0 +1,185 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Test for RtlCompressBuffer with LZNT1
+ */
+
+#include "precomp.h"
+
+#define BUFFER_SIZE     (1024 * 1024)
+
+typedef enum _DATA_KIND
+{
+    DataZero,
+    DataText,
+    DataSmallAlphabet,
+    DataRandom,
+    DataMax
+} DATA_KIND;
+
+static const char *DataNames[DataMax] = { "zero", "text", "small alphabet", "random" };
+
+static PUCHAR Data;
+static PUCHAR Compressed;
+static PUCHAR Decompressed;
+static ULONG CompressedSize;
+
+static
+VOID
+FillData(DATA_KIND Kind, PUCHAR Buffer, ULONG Size)
+{
+    static const char Text[] = "The quick brown fox jumps over the lazy dog. ";
+    ULONG Seed = 0x1234;
+    ULONG i;
+
+    for (i = 0; i < Size; i++)
+    {
+        switch (Kind)
+        {
+            case DataZero:
+                Buffer[i] = 0;
+                break;
+            case DataText:
+                /* Mostly repeating, with the odd typo */
+                Buffer[i] = Text[i % (sizeof(Text) - 1)];
+                if (RtlRandom(&Seed) % 64 == 0)
+                    Buffer[i] ^= 0x20;
+                break;
+            case DataSmallAlphabet:
+                Buffer[i] = 'a' + RtlRandom(&Seed) % 10;
+                break;
+            default:
+                Buffer[i] = (UCHAR)RtlRandom(&Seed);
+                break;
+        }
+    }
+}
+
+static
+BOOLEAN
+RoundTrip(USHORT Format, PUCHAR Buffer, ULONG Size, PVOID WorkSpace)
+{
+    NTSTATUS Status;
+    ULONG FinalSize;
+
+    CompressedSize = 0xdeadbeef;
+    Status = RtlCompressBuffer(Format, Buffer, Size, Compressed, BUFFER_SIZE + BUFFER_SIZE / 64,
+                               4096, &CompressedSize, WorkSpace);
+    if (!NT_SUCCESS(Status))
+    {
+        ok(0, "Compressing %lu bytes failed with 0x%lx\n", Size, Status);
+        return FALSE;
+    }
+
+    /* LZNT1 never grows data by more than a chunk header every 4 KB */
+    ok(CompressedSize <= Size + 2 * ((Size + 4095) / 4096),
+       "%lu bytes compressed to %lu\n", Size, CompressedSize);
+
+    FinalSize = 0xdeadbeef;
+    memset(Decompressed, 0x11, Size + 1);
+    Status = RtlDecompressBuffer(COMPRESSION_FORMAT_LZNT1, Decompressed, Size,
+                                 Compressed, CompressedSize, &FinalSize);
+    if (!NT_SUCCESS(Status))
+    {
+        ok(0, "Decompressing %lu bytes failed with 0x%lx\n", Size, Status);
+        return FALSE;
+    }
+
+    ok(FinalSize == Size, "Decompressed %lu bytes, expected %lu\n", FinalSize, Size);
+    ok(Decompressed[Size] == 0x11, "Too many bytes written\n");
+    return (FinalSize == Size && !memcmp(Buffer, Decompressed, Size));
+}
+
+static
+VOID
+Test_RoundTrip(USHORT Engine, PVOID WorkSpace)
+{
+    /* Tiny ones, and around the chunk boundaries */
+    static const ULONG Sizes[] = { 1, 2, 3, 4, 5, 8, 16, 17, 100, 1000, 4095, 4096, 4097,
+                                   5000, 8191, 8192, 8193, 12345 };
+    USHORT Format = COMPRESSION_FORMAT_LZNT1 | Engine;
+    DATA_KIND Kind;
+    ULONG i;
+
+    for (Kind = 0; Kind < DataMax; Kind++)
+    {
+        FillData(Kind, Data, BUFFER_SIZE);
+
+        for (i = 0; i < _countof(Sizes); i++)
+        {
+            ok(RoundTrip(Format, Data, Sizes[i], WorkSpace),
+               "Round trip of %lu bytes of %s data failed\n", Sizes[i], DataNames[Kind]);
+        }
+
+        ok(RoundTrip(Format, Data, BUFFER_SIZE, WorkSpace),
+           "Round trip of %s data failed\n", DataNames[Kind]);
+
+        /* Anything but random data must get smaller */
+        if (Kind != DataRandom)
+        {
+            ok(CompressedSize < BUFFER_SIZE * 3 / 4, "%s data compressed to %lu bytes\n",
+               DataNames[Kind], CompressedSize);
+        }
+    }
+}
+
+static
+VOID
+Test_Format(PVOID WorkSpace)
+{
+    static UCHAR Wine[] = "WineWineWine";
+    UCHAR Buffer[64];
+    NTSTATUS Status;
+    ULONG FinalSize;
+
+    /* A chunk with one back reference */
+    FinalSize = 0xdeadbeef;
+    Status = RtlCompressBuffer(COMPRESSION_FORMAT_LZNT1, Wine, sizeof(Wine), Buffer, sizeof(Buffer),
+                               4096, &FinalSize, WorkSpace);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok(FinalSize < sizeof(Wine), "Compressed to %lu bytes\n", FinalSize);
+    ok_hex(*(PUSHORT)Buffer & 0xF000, 0xB000);
+    ok_hex(*(PUSHORT)Buffer & 0x0FFF, FinalSize - 3);
+
+    /* The output must fit */
+    Status = RtlCompressBuffer(COMPRESSION_FORMAT_LZNT1, Wine, sizeof(Wine), Buffer, FinalSize - 1,
+                               4096, &FinalSize, WorkSpace);
+    ok_ntstatus(Status, STATUS_BUFFER_TOO_SMALL);
+}
+
+START_TEST(RtlCompressBuffer)
+{
+    ULONG WorkSpaceSize, FragmentWorkSpaceSize, MaximumWorkSpaceSize;
+    PVOID WorkSpace;
+    NTSTATUS Status;
+
+    Status = RtlGetCompressionWorkSpaceSize(COMPRESSION_FORMAT_LZNT1,
+                                            &WorkSpaceSize, &FragmentWorkSpaceSize);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    Status = RtlGetCompressionWorkSpaceSize(COMPRESSION_FORMAT_LZNT1 | COMPRESSION_ENGINE_MAXIMUM,
+                                            &MaximumWorkSpaceSize, &FragmentWorkSpaceSize);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+
+    if (MaximumWorkSpaceSize > WorkSpaceSize)
+        WorkSpaceSize = MaximumWorkSpaceSize;
+
+    WorkSpace = RtlAllocateHeap(RtlGetProcessHeap(), 0, WorkSpaceSize);
+    Data = RtlAllocateHeap(RtlGetProcessHeap(), 0, BUFFER_SIZE);
+    Compressed = RtlAllocateHeap(RtlGetProcessHeap(), 0, BUFFER_SIZE + BUFFER_SIZE / 64);
+    Decompressed = RtlAllocateHeap(RtlGetProcessHeap(), 0, BUFFER_SIZE + 1);
+    if (!WorkSpace || !Data || !Compressed || !Decompressed)
+    {
+        skip("Out of memory\n");
+        goto Cleanup;
+    }
+
+    Test_Format(WorkSpace);
+    Test_RoundTrip(COMPRESSION_ENGINE_STANDARD, WorkSpace);
+    Test_RoundTrip(COMPRESSION_ENGINE_MAXIMUM, WorkSpace);
+
+Cleanup:
+    if (Decompressed) RtlFreeHeap(RtlGetProcessHeap(), 0, Decompressed);
+    if (Compressed) RtlFreeHeap(RtlGetProcessHeap(), 0, Compressed);
+    if (Data) RtlFreeHeap(RtlGetProcessHeap(), 0, Data);
+    if (WorkSpace) RtlFreeHeap(RtlGetProcessHeap(), 0, WorkSpace);
+}
@@ -0,0 +1,264 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Test for RtlSetHeapInformation and the low fragmentation heap
+ */
+
+#include "precomp.h"
+
+#define WORKING_SET     64
+#define ITERATIONS      20000
+#define STRESS_THREADS  8
+
+typedef struct _STRESS_CONTEXT
+{
+    HANDLE Heap;
+    HANDLE StartEvent;
+    ULONG Seed;
+} STRESS_CONTEXT, *PSTRESS_CONTEXT;
+
+static
+ULONG
+QueryFrontEndType(HANDLE Heap)
+{
+    ULONG Type = 0xDEADBEEF;
+    SIZE_T ReturnLength = 0;
+    NTSTATUS Status;
+
+    Status = RtlQueryHeapInformation(Heap, HeapCompatibilityInformation, &Type, sizeof(Type), &ReturnLength);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_size_t(ReturnLength, sizeof(ULONG));
+    return Type;
+}
+
+static
+NTSTATUS
+EnableFrontEnd(HANDLE Heap)
+{
+    ULONG Type = 2;
+
+    return RtlSetHeapInformation(Heap, HeapCompatibilityInformation, &Type, sizeof(Type));
+}
+
+static
+void
+Test_Enable(void)
+{
+    HANDLE Heap;
+    NTSTATUS Status;
+    ULONG Type = 1;
+
+    Heap = RtlCreateHeap(HEAP_GROWABLE, NULL, 0, 0, NULL, NULL);
+    ok(Heap != NULL, "RtlCreateHeap failed\n");
+    if (!Heap) return;
+
+    ok_hex(QueryFrontEndType(Heap), 0);
+
+    /* Only the LFH can be asked for */
+    Status = RtlSetHeapInformation(Heap, HeapCompatibilityInformation, &Type, sizeof(Type));
+    ok_ntstatus(Status, STATUS_UNSUCCESSFUL);
+    Status = RtlSetHeapInformation(Heap, HeapCompatibilityInformation, &Type, sizeof(USHORT));
+    ok_ntstatus(Status, STATUS_BUFFER_TOO_SMALL);
+
+    ok_ntstatus(EnableFrontEnd(Heap), STATUS_SUCCESS);
+    ok_hex(QueryFrontEndType(Heap), 2);
+
+    /* Enabling it twice is fine */
+    ok_ntstatus(EnableFrontEnd(Heap), STATUS_SUCCESS);
+    ok_hex(QueryFrontEndType(Heap), 2);
+
+    RtlDestroyHeap(Heap);
+
+    /* Unserialized heaps can't have it */
+    Heap = RtlCreateHeap(HEAP_GROWABLE | HEAP_NO_SERIALIZE, NULL, 0, 0, NULL, NULL);
+    ok(Heap != NULL, "RtlCreateHeap failed\n");
+    if (!Heap) return;
+
+    ok(!NT_SUCCESS(EnableFrontEnd(Heap)), "LFH enabled on a HEAP_NO_SERIALIZE heap\n");
+    ok_hex(QueryFrontEndType(Heap), 0);
+
+    RtlDestroyHeap(Heap);
+}
+
+static
+void
+Test_Blocks(void)
+{
+    HANDLE Heap;
+    PUCHAR Blocks[256];
+    PUCHAR Block;
+    ULONG i, j;
+    BOOLEAN Zeroed;
+
+    Heap = RtlCreateHeap(HEAP_GROWABLE, NULL, 0, 0, NULL, NULL);
+    ok(Heap != NULL, "RtlCreateHeap failed\n");
+    if (!Heap) return;
+
+    ok_ntstatus(EnableFrontEnd(Heap), STATUS_SUCCESS);
+
+    /* Several rounds, so that blocks get recycled by the front end */
+    for (j = 0; j < 4; j++)
+    {
+        for (i = 0; i < _countof(Blocks); i++)
+        {
+            Blocks[i] = RtlAllocateHeap(Heap, 0, i + 1);
+            ok(Blocks[i] != NULL, "Allocation of %lu bytes failed\n", i + 1);
+            if (!Blocks[i]) continue;
+            ok_size_t(RtlSizeHeap(Heap, 0, Blocks[i]), i + 1);
+            memset(Blocks[i], 0xA5, i + 1);
+        }
+
+        for (i = 0; i < _countof(Blocks); i++)
+        {
+            ok(RtlFreeHeap(Heap, 0, Blocks[i]), "RtlFreeHeap failed\n");
+        }
+    }
+
+    /* Recycled blocks must be zeroed when asked for */
+    for (i = 0; i < _countof(Blocks); i++)
+    {
+        Blocks[i] = RtlAllocateHeap(Heap, HEAP_ZERO_MEMORY, i + 1);
+        ok(Blocks[i] != NULL, "Allocation of %lu bytes failed\n", i + 1);
+        if (!Blocks[i]) continue;
+
+        Zeroed = TRUE;
+        for (j = 0; j <= i; j++)
+        {
+            if (Blocks[i][j] != 0) Zeroed = FALSE;
+        }
+        ok(Zeroed, "Block of %lu bytes isn't zeroed\n", i + 1);
+    }
+
+    /* Reallocation works on front end blocks */
+    for (i = 0; i < _countof(Blocks); i++)
+    {
+        if (!Blocks[i]) continue;
+
+        Block = RtlReAllocateHeap(Heap, 0, Blocks[i], 2 * (i + 1));
+        ok(Block != NULL, "Reallocation of %lu bytes failed\n", i + 1);
+        if (!Block) continue;
+        ok_size_t(RtlSizeHeap(Heap, 0, Block), 2 * (i + 1));
+        Blocks[i] = Block;
+    }
+
+    for (i = 0; i < _countof(Blocks); i++)
+    {
+        RtlFreeHeap(Heap, 0, Blocks[i]);
+    }
+
+    ok(RtlValidateHeap(Heap, 0, NULL), "Heap is corrupted\n");
+    RtlDestroyHeap(Heap);
+}
+
+static
+void
+Test_DoubleFree(void)
+{
+    HANDLE Heap;
+    PVOID Block, Other;
+
+    Heap = RtlCreateHeap(HEAP_GROWABLE, NULL, 0, 0, NULL, NULL);
+    ok(Heap != NULL, "RtlCreateHeap failed\n");
+    if (!Heap) return;
+
+    ok_ntstatus(EnableFrontEnd(Heap), STATUS_SUCCESS);
+
+    Block = RtlAllocateHeap(Heap, 0, 24);
+    ok(Block != NULL, "Allocation failed\n");
+    if (Block)
+    {
+        /* The second free is refused, and the block isn't handed out twice */
+        ok(RtlFreeHeap(Heap, 0, Block), "RtlFreeHeap failed\n");
+        ok(!RtlFreeHeap(Heap, 0, Block), "Block freed twice\n");
+
+        Block = RtlAllocateHeap(Heap, 0, 24);
+        Other = RtlAllocateHeap(Heap, 0, 24);
+        ok(Block != NULL && Other != NULL, "Allocation failed\n");
+        ok(Block != Other, "Block %p handed out twice\n", Block);
+        RtlFreeHeap(Heap, 0, Block);
+        RtlFreeHeap(Heap, 0, Other);
+    }
+
+    ok(RtlValidateHeap(Heap, 0, NULL), "Heap is corrupted\n");
+    RtlDestroyHeap(Heap);
+}
+
+static
+DWORD
+WINAPI
+StressThread(LPVOID Parameter)
+{
+    PSTRESS_CONTEXT Context = Parameter;
+    PVOID Blocks[WORKING_SET] = { NULL };
+    ULONG Seed = Context->Seed;
+    ULONG i, Slot;
+
+    WaitForSingleObject(Context->StartEvent, INFINITE);
+
+    for (i = 0; i < ITERATIONS; i++)
+    {
+        Slot = RtlRandom(&Seed) % WORKING_SET;
+        if (Blocks[Slot])
+        {
+            RtlFreeHeap(Context->Heap, 0, Blocks[Slot]);
+        }
+        Blocks[Slot] = RtlAllocateHeap(Context->Heap, 0, 8 + RtlRandom(&Seed) % 248);
+    }
+
+    for (i = 0; i < WORKING_SET; i++)
+    {
+        RtlFreeHeap(Context->Heap, 0, Blocks[i]);
+    }
+
+    return 0;
+}
+
+static
+void
+Test_Stress(void)
+{
+    STRESS_CONTEXT Contexts[STRESS_THREADS];
+    HANDLE Threads[STRESS_THREADS];
+    HANDLE Heap, StartEvent;
+    ULONG i, Created;
+
+    Heap = RtlCreateHeap(HEAP_GROWABLE, NULL, 0, 0, NULL, NULL);
+    ok(Heap != NULL, "RtlCreateHeap failed\n");
+    if (!Heap) return;
+
+    ok_ntstatus(EnableFrontEnd(Heap), STATUS_SUCCESS);
+
+    StartEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ok(StartEvent != NULL, "CreateEvent failed\n");
+
+    /* Threads sharing the affinity slots must not corrupt the heap */
+    for (Created = 0; Created < STRESS_THREADS; Created++)
+    {
+        Contexts[Created].Heap = Heap;
+        Contexts[Created].StartEvent = StartEvent;
+        Contexts[Created].Seed = 0x1234 + Created;
+        Threads[Created] = CreateThread(NULL, 0, StressThread, &Contexts[Created], 0, NULL);
+        if (!Threads[Created]) break;
+    }
+    ok(Created == STRESS_THREADS, "Only %lu threads out of %u\n", Created, STRESS_THREADS);
+
+    SetEvent(StartEvent);
+    WaitForMultipleObjects(Created, Threads, TRUE, INFINITE);
+
+    for (i = 0; i < Created; i++)
+    {
+        CloseHandle(Threads[i]);
+    }
+    CloseHandle(StartEvent);
+
+    ok(RtlValidateHeap(Heap, 0, NULL), "Heap is corrupted\n");
+    RtlDestroyHeap(Heap);
+}
+
+START_TEST(RtlSetHeapInformation)
+{
+    Test_Enable();
+    Test_Blocks();
+    Test_DoubleFree();
+    Test_Stress();
+}
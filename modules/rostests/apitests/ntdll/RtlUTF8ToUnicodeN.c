@@ -0,0 +1,284 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Tests for the UTF-8 and code page conversions around ASCII runs
+ */
+
+#include "precomp.h"
+
+#define MAX_PREFIX  40
+#define LONG_LENGTH (1024 * 1024)
+
+typedef NTSTATUS (NTAPI *PRTL_UTF8_TO_UNICODE_N)(PWSTR, ULONG, PULONG, PCCH, ULONG);
+typedef NTSTATUS (NTAPI *PRTL_UNICODE_TO_UTF8_N)(PCHAR, ULONG, PULONG, PCWCH, ULONG);
+
+static PRTL_UTF8_TO_UNICODE_N pRtlUTF8ToUnicodeN;
+static PRTL_UNICODE_TO_UTF8_N pRtlUnicodeToUTF8N;
+
+/* Each of these is converted on its own and after every ASCII prefix up to MAX_PREFIX */
+static const struct
+{
+    const char *String;
+    ULONG Length;
+} Utf8Tails[] =
+{
+    { "", 0 },
+    { "z", 1 },
+    { "\xC2\xA9", 2 },
+    { "\xE2\x82\xAC", 3 },
+    { "\xF0\x9F\x98\x80", 4 },
+    { "\xC0\x80", 2 },              /* overlong */
+    { "\xED\xA0\x80", 3 },          /* surrogate */
+    { "\xF4\x90\x80\x80", 4 },      /* above 0x10FFFF */
+    { "\xE2\x82", 2 },              /* truncated */
+    { "\x80\x80", 2 },              /* stray trail bytes */
+    { "\xF5", 1 },
+    { "\xE2\x82\xAC" "abcdefghijklmnopqrstuvwxyz", 29 },
+};
+
+static const struct
+{
+    WCHAR String[4];
+    ULONG Length;
+} Utf16Tails[] =
+{
+    { { 0 }, 0 },
+    { { 'z' }, 1 },
+    { { 0x00A9 }, 1 },
+    { { 0x20AC }, 1 },
+    { { 0xD83D, 0xDE00 }, 2 },
+    { { 0xD800 }, 1 },              /* lead surrogate at the end */
+    { { 0xDC00, 'x' }, 2 },         /* lone trail surrogate */
+    { { 0xD800, 'x' }, 2 },         /* lead surrogate without a trail */
+    { { 0x0080, 0x07FF, 0x0800 }, 3 },
+};
+
+static
+void
+Test_UTF8ToUnicode(void)
+{
+    CHAR Source[MAX_PREFIX + 32];
+    WCHAR Expected[64], Output[MAX_PREFIX + 64];
+    ULONG ExpectedBytes, Bytes, Prefix, Tail, i;
+    NTSTATUS ExpectedStatus, Status;
+
+    for (Tail = 0; Tail < _countof(Utf8Tails); Tail++)
+    {
+        ExpectedStatus = pRtlUTF8ToUnicodeN(Expected, sizeof(Expected), &ExpectedBytes,
+                                            Utf8Tails[Tail].String, Utf8Tails[Tail].Length);
+
+        for (Prefix = 0; Prefix <= MAX_PREFIX; Prefix++)
+        {
+            for (i = 0; i < Prefix; i++)
+                Source[i] = 'A' + i % 26;
+            RtlCopyMemory(&Source[Prefix], Utf8Tails[Tail].String, Utf8Tails[Tail].Length);
+
+            /* The ASCII prefix converts on its own, the tail as if it were alone */
+            RtlFillMemory(Output, sizeof(Output), 0x55);
+            Status = pRtlUTF8ToUnicodeN(Output, sizeof(Output), &Bytes,
+                                        Source, Prefix + Utf8Tails[Tail].Length);
+            ok(Status == ExpectedStatus, "Tail %lu, prefix %lu: Status 0x%lx\n", Tail, Prefix, Status);
+            ok(Bytes == Prefix * sizeof(WCHAR) + ExpectedBytes,
+               "Tail %lu, prefix %lu: Bytes %lu\n", Tail, Prefix, Bytes);
+            for (i = 0; i < Prefix; i++)
+            {
+                if (Output[i] != (WCHAR)Source[i]) break;
+            }
+            ok(i == Prefix, "Tail %lu, prefix %lu: mismatch at %lu\n", Tail, Prefix, i);
+            ok(!memcmp(&Output[Prefix], Expected, ExpectedBytes),
+               "Tail %lu, prefix %lu: wrong tail\n", Tail, Prefix);
+
+            /* Same count without a buffer */
+            Status = pRtlUTF8ToUnicodeN(NULL, 0, &Bytes, Source, Prefix + Utf8Tails[Tail].Length);
+            ok(Status == ExpectedStatus, "Tail %lu, prefix %lu: Status 0x%lx\n", Tail, Prefix, Status);
+            ok(Bytes == Prefix * sizeof(WCHAR) + ExpectedBytes,
+               "Tail %lu, prefix %lu: Bytes %lu\n", Tail, Prefix, Bytes);
+
+            /* A buffer that ends right after the prefix stops there */
+            if (Utf8Tails[Tail].Length)
+            {
+                RtlFillMemory(Output, sizeof(Output), 0x55);
+                Status = pRtlUTF8ToUnicodeN(Output, Prefix * sizeof(WCHAR), &Bytes,
+                                            Source, Prefix + Utf8Tails[Tail].Length);
+                ok(Status != STATUS_SUCCESS, "Tail %lu, prefix %lu: Status 0x%lx\n", Tail, Prefix, Status);
+                ok(Bytes == Prefix * sizeof(WCHAR), "Tail %lu, prefix %lu: Bytes %lu\n", Tail, Prefix, Bytes);
+                ok(Output[Prefix] == 0x5555, "Tail %lu, prefix %lu: wrote past the end\n", Tail, Prefix);
+            }
+        }
+    }
+}
+
+static
+void
+Test_UnicodeToUTF8(void)
+{
+    WCHAR Source[MAX_PREFIX + 4];
+    CHAR Expected[16], Output[MAX_PREFIX + 32];
+    ULONG ExpectedBytes, Bytes, Prefix, Tail, i;
+    NTSTATUS ExpectedStatus, Status;
+
+    for (Tail = 0; Tail < _countof(Utf16Tails); Tail++)
+    {
+        ExpectedStatus = pRtlUnicodeToUTF8N(Expected, sizeof(Expected), &ExpectedBytes,
+                                            Utf16Tails[Tail].String, Utf16Tails[Tail].Length * sizeof(WCHAR));
+
+        for (Prefix = 0; Prefix <= MAX_PREFIX; Prefix++)
+        {
+            for (i = 0; i < Prefix; i++)
+                Source[i] = L'A' + i % 26;
+            RtlCopyMemory(&Source[Prefix], Utf16Tails[Tail].String, Utf16Tails[Tail].Length * sizeof(WCHAR));
+
+            RtlFillMemory(Output, sizeof(Output), 0x55);
+            Status = pRtlUnicodeToUTF8N(Output, sizeof(Output), &Bytes,
+                                        Source, (Prefix + Utf16Tails[Tail].Length) * sizeof(WCHAR));
+            ok(Status == ExpectedStatus, "Tail %lu, prefix %lu: Status 0x%lx\n", Tail, Prefix, Status);
+            ok(Bytes == Prefix + ExpectedBytes, "Tail %lu, prefix %lu: Bytes %lu\n", Tail, Prefix, Bytes);
+            for (i = 0; i < Prefix; i++)
+            {
+                if (Output[i] != (CHAR)Source[i]) break;
+            }
+            ok(i == Prefix, "Tail %lu, prefix %lu: mismatch at %lu\n", Tail, Prefix, i);
+            ok(!memcmp(&Output[Prefix], Expected, ExpectedBytes),
+               "Tail %lu, prefix %lu: wrong tail\n", Tail, Prefix);
+
+            Status = pRtlUnicodeToUTF8N(NULL, 0, &Bytes,
+                                        Source, (Prefix + Utf16Tails[Tail].Length) * sizeof(WCHAR));
+            ok(Status == ExpectedStatus, "Tail %lu, prefix %lu: Status 0x%lx\n", Tail, Prefix, Status);
+            ok(Bytes == Prefix + ExpectedBytes, "Tail %lu, prefix %lu: Bytes %lu\n", Tail, Prefix, Bytes);
+
+            if (Utf16Tails[Tail].Length)
+            {
+                RtlFillMemory(Output, sizeof(Output), 0x55);
+                Status = pRtlUnicodeToUTF8N(Output, Prefix, &Bytes,
+                                            Source, (Prefix + Utf16Tails[Tail].Length) * sizeof(WCHAR));
+                ok(Status != STATUS_SUCCESS, "Tail %lu, prefix %lu: Status 0x%lx\n", Tail, Prefix, Status);
+                ok(Bytes == Prefix, "Tail %lu, prefix %lu: Bytes %lu\n", Tail, Prefix, Bytes);
+                ok(Output[Prefix] == 0x55, "Tail %lu, prefix %lu: wrote past the end\n", Tail, Prefix);
+            }
+        }
+    }
+}
+
+static
+void
+Test_CodePage(void)
+{
+    CHAR Source[256], Narrow[256], Single[2];
+    WCHAR Wide[256], Reference[256];
+    ULONG Bytes, Length, i;
+    NTSTATUS Status;
+    CPINFO CpInfo;
+
+    /* Byte at a time conversions never take the block paths, so they are the reference */
+    if (!GetCPInfo(CP_ACP, &CpInfo) || CpInfo.MaxCharSize != 1)
+    {
+        skip("ANSI code page is not single-byte\n");
+        return;
+    }
+
+    /* Long ASCII runs with the odd high byte in between */
+    for (i = 0; i < _countof(Source); i++)
+        Source[i] = (i % 37 == 36) ? (CHAR)(0x80 + i % 128) : (CHAR)(1 + i % 127);
+
+    for (Length = 0; Length <= _countof(Source); Length += 7)
+    {
+        for (i = 0; i < Length; i++)
+        {
+            Status = RtlMultiByteToUnicodeN(&Reference[i], sizeof(WCHAR), NULL, &Source[i], 1);
+            ok_ntstatus(Status, STATUS_SUCCESS);
+        }
+
+        Status = RtlMultiByteToUnicodeN(Wide, Length * sizeof(WCHAR), &Bytes, Source, Length);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+        ok(Bytes == Length * sizeof(WCHAR), "Length %lu: Bytes %lu\n", Length, Bytes);
+        ok(!memcmp(Wide, Reference, Length * sizeof(WCHAR)), "Length %lu: wrong result\n", Length);
+
+        for (i = 0; i < Length; i++)
+        {
+            Status = RtlUnicodeToMultiByteN(Single, 1, NULL, &Wide[i], sizeof(WCHAR));
+            ok_ntstatus(Status, STATUS_SUCCESS);
+            Reference[i] = (UCHAR)Single[0];
+        }
+
+        Status = RtlUnicodeToMultiByteN(Narrow, Length, &Bytes, Wide, Length * sizeof(WCHAR));
+        ok_ntstatus(Status, STATUS_SUCCESS);
+        ok(Bytes == Length, "Length %lu: Bytes %lu\n", Length, Bytes);
+        for (i = 0; i < Length; i++)
+        {
+            if ((UCHAR)Narrow[i] != Reference[i]) break;
+        }
+        ok(i == Length, "Length %lu: mismatch at %lu\n", Length, i);
+    }
+}
+
+static
+void
+Test_LongString(void)
+{
+    PCHAR Narrow = NULL;
+    PWCHAR Wide = NULL;
+    SIZE_T Size;
+    ULONG Bytes, i;
+    NTSTATUS Status;
+
+    Size = LONG_LENGTH;
+    Status = NtAllocateVirtualMemory(NtCurrentProcess(), (PVOID*)&Narrow, 0, &Size, MEM_COMMIT, PAGE_READWRITE);
+    if (!NT_SUCCESS(Status))
+    {
+        skip("Failed to allocate the narrow buffer\n");
+        return;
+    }
+    Size = LONG_LENGTH * sizeof(WCHAR);
+    Status = NtAllocateVirtualMemory(NtCurrentProcess(), (PVOID*)&Wide, 0, &Size, MEM_COMMIT, PAGE_READWRITE);
+    if (!NT_SUCCESS(Status))
+    {
+        skip("Failed to allocate the wide buffer\n");
+        Size = 0;
+        NtFreeVirtualMemory(NtCurrentProcess(), (PVOID*)&Narrow, &Size, MEM_RELEASE);
+        return;
+    }
+
+    /* ASCII with an accented letter now and then, so the block conversion keeps starting over */
+    for (i = 0; i < LONG_LENGTH / 2; i++)
+        Wide[i] = (i % 1000 == 0) ? 0xE9 : 'a' + i % 26;
+
+    /* To UTF-8, where the accented letters take two bytes */
+    Status = pRtlUnicodeToUTF8N(Narrow, LONG_LENGTH, &Bytes, Wide, LONG_LENGTH / 2 * sizeof(WCHAR));
+    ok(Status == STATUS_SUCCESS && Bytes == LONG_LENGTH / 2 + LONG_LENGTH / 2 / 1000 + 1,
+       "Status 0x%lx, Bytes %lu\n", Status, Bytes);
+
+    /* And back to UTF-16, which must give the same text */
+    RtlFillMemory(&Wide[LONG_LENGTH / 2], LONG_LENGTH / 2 * sizeof(WCHAR), 0x55);
+    Status = pRtlUTF8ToUnicodeN(&Wide[LONG_LENGTH / 2], LONG_LENGTH / 2 * sizeof(WCHAR), &Bytes, Narrow, Bytes);
+    ok(Status == STATUS_SUCCESS && Bytes == LONG_LENGTH / 2 * sizeof(WCHAR), "Status 0x%lx, Bytes %lu\n", Status, Bytes);
+    for (i = 0; i < LONG_LENGTH / 2; i++)
+    {
+        if (Wide[i] != Wide[LONG_LENGTH / 2 + i]) break;
+    }
+    ok(i == LONG_LENGTH / 2, "Mismatch at %lu\n", i);
+
+    Size = 0;
+    NtFreeVirtualMemory(NtCurrentProcess(), (PVOID*)&Wide, &Size, MEM_RELEASE);
+    Size = 0;
+    NtFreeVirtualMemory(NtCurrentProcess(), (PVOID*)&Narrow, &Size, MEM_RELEASE);
+}
+
+START_TEST(RtlUTF8ToUnicodeN)
+{
+    HMODULE hNtdll = GetModuleHandleW(L"ntdll.dll");
+
+    pRtlUTF8ToUnicodeN = (PRTL_UTF8_TO_UNICODE_N)GetProcAddress(hNtdll, "RtlUTF8ToUnicodeN");
+    pRtlUnicodeToUTF8N = (PRTL_UNICODE_TO_UTF8_N)GetProcAddress(hNtdll, "RtlUnicodeToUTF8N");
+
+    Test_CodePage();
+
+    if (!pRtlUTF8ToUnicodeN || !pRtlUnicodeToUTF8N)
+    {
+        skip("RtlUTF8ToUnicodeN or RtlUnicodeToUTF8N not available\n");
+        return;
+    }
+
+    Test_UTF8ToUnicode();
+    Test_UnicodeToUTF8();
+    Test_LongString();
+}
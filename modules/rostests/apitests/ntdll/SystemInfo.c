@@ -8,6 +8,7 @@
 
 #include "precomp.h"
 #include <versionhelpers.h>
+#include <reactos/rossysinfo.h>
 
 #define ntv6(x) (LOBYTE(LOWORD(GetVersion())) >= 6 ? (x) : 0)
 
@@ -323,6 +324,140 @@ Test_KernelDebugger(void)
     ok(Status == STATUS_INVALID_INFO_CLASS, "NtSetSystemInformation returned %lx\n", Status);
 }
 
+static
+DWORD
+WINAPI
+YieldThread(LPVOID Parameter)
+{
+    ULONG i;
+
+    /* Give the scheduler something to do */
+    for (i = 0; i < 1000; i++) SwitchToThread();
+    return 0;
+}
+
+static
+void
+Test_ContextSwitch(void)
+{
+    NTSTATUS Status;
+    ULONG ReturnLength;
+    SYSTEM_CONTEXT_SWITCH_INFORMATION Before, After;
+    SYSTEM_CONTEXT_SWITCH_INFORMATION_EX Extended;
+    HANDLE Threads[4];
+    ULONG i;
+
+    /* Only the exact size is accepted */
+    Status = NtQuerySystemInformation(SystemContextSwitchInformation, &Before, sizeof(Before) - 1, &ReturnLength);
+    ok(Status == STATUS_INFO_LENGTH_MISMATCH, "NtQuerySystemInformation returned %lx\n", Status);
+    Status = NtQuerySystemInformation(SystemContextSwitchInformation, &Before, sizeof(Before) + 1, &ReturnLength);
+    ok(Status == STATUS_INFO_LENGTH_MISMATCH, "NtQuerySystemInformation returned %lx\n", Status);
+
+    Status = NtQuerySystemInformation(SystemContextSwitchInformation, &Before, sizeof(Before), &ReturnLength);
+    ok(Status == STATUS_SUCCESS, "NtQuerySystemInformation returned %lx\n", Status);
+
+    /* Make threads go back and forth between the processors */
+    for (i = 0; i < ARRAYSIZE(Threads); i++)
+    {
+        Threads[i] = CreateThread(NULL, 0, YieldThread, NULL, 0, NULL);
+        ok(Threads[i] != NULL, "CreateThread failed\n");
+    }
+    for (i = 0; i < ARRAYSIZE(Threads); i++)
+    {
+        if (!Threads[i]) continue;
+        WaitForSingleObject(Threads[i], INFINITE);
+        CloseHandle(Threads[i]);
+    }
+
+    Status = NtQuerySystemInformation(SystemContextSwitchInformation, &After, sizeof(After), &ReturnLength);
+    ok(Status == STATUS_SUCCESS, "NtQuerySystemInformation returned %lx\n", Status);
+    ok(After.ContextSwitches > Before.ContextSwitches, "ContextSwitches did not move: %lu\n", After.ContextSwitches);
+
+    /* Class 36 keeps its documented size, the rest is in a ReactOS-private class */
+    Status = NtQuerySystemInformation(SystemContextSwitchInformation, &Extended, sizeof(Extended), &ReturnLength);
+    ok(Status == STATUS_INFO_LENGTH_MISMATCH, "NtQuerySystemInformation returned %lx\n", Status);
+
+    ReturnLength = 0x55555555;
+    Status = NtQuerySystemInformation((SYSTEM_INFORMATION_CLASS)SystemRosContextSwitchInformation, &Extended, sizeof(Extended) - 1, &ReturnLength);
+    if (Status == STATUS_INVALID_INFO_CLASS)
+    {
+        skip("SystemRosContextSwitchInformation is not supported\n");
+        return;
+    }
+    ok(Status == STATUS_INFO_LENGTH_MISMATCH, "NtQuerySystemInformation returned %lx\n", Status);
+    ok(ReturnLength == sizeof(Extended), "ReturnLength = %lu\n", ReturnLength);
+
+    Status = NtQuerySystemInformation((SYSTEM_INFORMATION_CLASS)SystemRosContextSwitchInformation, &Extended, sizeof(Extended), &ReturnLength);
+    ok(Status == STATUS_SUCCESS, "NtQuerySystemInformation returned %lx\n", Status);
+    if (NT_SUCCESS(Status))
+    {
+        ok(Extended.Standard.ContextSwitches >= After.ContextSwitches, "ContextSwitches went back: %lu\n", Extended.Standard.ContextSwitches);
+        ok(Extended.Standard.FindAny + Extended.Standard.FindLast + Extended.Standard.FindIdeal +
+           Extended.Standard.IdleAny + Extended.Standard.IdleCurrent +
+           Extended.Standard.IdleLast + Extended.Standard.IdleIdeal != 0,
+           "No scheduling decisions were counted\n");
+        ok(Extended.PrcbLockContention <= Extended.PrcbLockAcquires, "Contention %lu > acquires %lu\n",
+           Extended.PrcbLockContention, Extended.PrcbLockAcquires);
+        trace("Steals %lu, migrations %lu, PRCB lock %lu/%lu contended, %I64u cycles held\n",
+              Extended.IdleSteals, Extended.Migrations, Extended.PrcbLockContention,
+              Extended.PrcbLockAcquires, Extended.PrcbLockHoldCycles);
+    }
+}
+
+static
+void
+Test_WorkQueue(void)
+{
+    NTSTATUS Status;
+    ULONG ReturnLength;
+    SYSTEM_WORK_QUEUE_INFORMATION Small;
+    PSYSTEM_WORK_QUEUE_INFORMATION Queues;
+    ULONG Count, i, j, Histogram;
+
+    /* A ReactOS-private class */
+    ReturnLength = 0x55555555;
+    Status = NtQuerySystemInformation((SYSTEM_INFORMATION_CLASS)SystemRosWorkQueueInformation, &Small, sizeof(Small) - 1, &ReturnLength);
+    if (Status == STATUS_INVALID_INFO_CLASS)
+    {
+        skip("SystemRosWorkQueueInformation is not supported\n");
+        return;
+    }
+    ok(Status == STATUS_INFO_LENGTH_MISMATCH, "NtQuerySystemInformation returned %lx\n", Status);
+    ok(ReturnLength != 0 && ReturnLength % sizeof(SYSTEM_WORK_QUEUE_INFORMATION) == 0,
+       "ReturnLength = %lu\n", ReturnLength);
+    if (Status != STATUS_INFO_LENGTH_MISMATCH || ReturnLength == 0)
+        return;
+
+    Queues = HeapAlloc(GetProcessHeap(), 0, ReturnLength);
+    if (!Queues)
+    {
+        skip("Out of memory\n");
+        return;
+    }
+
+    Status = NtQuerySystemInformation((SYSTEM_INFORMATION_CLASS)SystemRosWorkQueueInformation, Queues, ReturnLength, &ReturnLength);
+    ok(Status == STATUS_SUCCESS, "NtQuerySystemInformation returned %lx\n", Status);
+    if (NT_SUCCESS(Status))
+    {
+        /* Critical, delayed and hypercritical at least */
+        Count = ReturnLength / sizeof(SYSTEM_WORK_QUEUE_INFORMATION);
+        ok(Count >= 3, "Count = %lu\n", Count);
+
+        /* The queues are busy while booting, so some waits were measured */
+        for (Histogram = 0, i = 0; i < Count; i++)
+        {
+            ok(Queues[i].QueueType == i, "Queue %lu: type %lu\n", i, Queues[i].QueueType);
+            ok(Queues[i].WorkerCount != 0, "Queue %lu: no workers\n", i);
+
+            for (j = 0; j < SYSTEM_WORK_QUEUE_WAIT_BUCKETS; j++)
+                Histogram += Queues[i].WaitTimeHistogram[j];
+        }
+        ok(Histogram != 0, "No work item waits were measured\n");
+    }
+
+    HeapFree(GetProcessHeap(), 0, Queues);
+}
+
 START_TEST(NtSystemInformation)
 {
     NTSTATUS Status;
@@ -364,4 +499,6 @@ START_TEST(NtSystemInformation)
     Test_Flags();
     Test_TimeAdjustment();
     Test_KernelDebugger();
+    Test_ContextSwitch();
+    Test_WorkQueue();
 }
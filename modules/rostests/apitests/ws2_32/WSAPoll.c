@@ -0,0 +1,218 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Tests for WSAPoll
+ */
+
+/* WSAPOLLFD is a Vista type */
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x600
+
+#include "ws2_32.h"
+
+#define POLL_TIMEOUT    300
+
+static
+BOOL
+CreatePair(SOCKET *Listener, SOCKET *Client, SOCKET *Server)
+{
+    struct sockaddr_in addr;
+    WSAPOLLFD fd;
+    int len, ret;
+
+    *Listener = *Client = *Server = INVALID_SOCKET;
+
+    *Listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    *Client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (*Listener == INVALID_SOCKET || *Client == INVALID_SOCKET)
+        goto Fail;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    len = sizeof(addr);
+    if (bind(*Listener, (struct sockaddr *)&addr, sizeof(addr)) ||
+        getsockname(*Listener, (struct sockaddr *)&addr, &len) ||
+        listen(*Listener, 1) ||
+        connect(*Client, (struct sockaddr *)&addr, sizeof(addr)))
+    {
+        goto Fail;
+    }
+
+    /* A pending connection makes the listener readable */
+    fd.fd = *Listener;
+    fd.events = POLLRDNORM;
+    fd.revents = 0x5555;
+    ret = WSAPoll(&fd, 1, POLL_TIMEOUT);
+    ok(ret == 1, "WSAPoll returned %d, error %d\n", ret, WSAGetLastError());
+    ok(fd.revents == POLLRDNORM, "Listener revents 0x%x\n", fd.revents);
+
+    *Server = accept(*Listener, NULL, NULL);
+    if (*Server == INVALID_SOCKET)
+        goto Fail;
+
+    return TRUE;
+
+Fail:
+    skip("Cannot set up a connection, error %d\n", WSAGetLastError());
+    if (*Listener != INVALID_SOCKET) closesocket(*Listener);
+    if (*Client != INVALID_SOCKET) closesocket(*Client);
+    return FALSE;
+}
+
+static
+void
+Test_Timeout(SOCKET Client)
+{
+    WSAPOLLFD fd;
+    DWORD Start, Elapsed;
+    int ret;
+
+    fd.fd = Client;
+    fd.events = POLLRDNORM;
+    fd.revents = 0x5555;
+    Start = GetTickCount();
+    ret = WSAPoll(&fd, 1, POLL_TIMEOUT);
+    Elapsed = GetTickCount() - Start;
+    ok(ret == 0, "WSAPoll returned %d, error %d\n", ret, WSAGetLastError());
+    ok(fd.revents == 0, "revents 0x%x\n", fd.revents);
+    ok(Elapsed >= POLL_TIMEOUT - 50, "Returned after %lu ms\n", Elapsed);
+
+    /* No timeout does not wait at all */
+    fd.revents = 0x5555;
+    Start = GetTickCount();
+    ret = WSAPoll(&fd, 1, 0);
+    Elapsed = GetTickCount() - Start;
+    ok(ret == 0, "WSAPoll returned %d, error %d\n", ret, WSAGetLastError());
+    ok(fd.revents == 0, "revents 0x%x\n", fd.revents);
+    ok(Elapsed < POLL_TIMEOUT, "Returned after %lu ms\n", Elapsed);
+}
+
+static
+void
+Test_Readiness(SOCKET Client, SOCKET Server)
+{
+    WSAPOLLFD fds[2];
+    char Buffer[4];
+    int ret, i;
+
+    /* A connected socket is writable right away */
+    fds[0].fd = Client;
+    fds[0].events = POLLWRNORM;
+    fds[0].revents = 0x5555;
+    ret = WSAPoll(fds, 1, POLL_TIMEOUT);
+    ok(ret == 1, "WSAPoll returned %d, error %d\n", ret, WSAGetLastError());
+    ok(fds[0].revents == POLLWRNORM, "revents 0x%x\n", fds[0].revents);
+
+    ret = send(Server, "poll", 4, 0);
+    ok(ret == 4, "send returned %d, error %d\n", ret, WSAGetLastError());
+
+    /* Only what was asked for is reported, the same way every time */
+    fds[0].events = POLLRDNORM | POLLWRNORM;
+    fds[1].fd = Server;
+    fds[1].events = POLLRDNORM;
+    for (i = 0; i < 3; i++)
+    {
+        fds[0].revents = fds[1].revents = 0x5555;
+        ret = WSAPoll(fds, 2, POLL_TIMEOUT);
+        ok(ret == 1, "%d: WSAPoll returned %d, error %d\n", i, ret, WSAGetLastError());
+        ok(fds[0].revents == (POLLRDNORM | POLLWRNORM), "%d: Client revents 0x%x\n", i, fds[0].revents);
+        ok(fds[1].revents == 0, "%d: Server revents 0x%x\n", i, fds[1].revents);
+    }
+
+    /* Once read, the data no longer makes it readable */
+    ret = recv(Client, Buffer, sizeof(Buffer), 0);
+    ok(ret == 4, "recv returned %d, error %d\n", ret, WSAGetLastError());
+    fds[0].events = POLLRDNORM;
+    fds[0].revents = 0x5555;
+    ret = WSAPoll(fds, 1, 0);
+    ok(ret == 0, "WSAPoll returned %d, error %d\n", ret, WSAGetLastError());
+    ok(fds[0].revents == 0, "revents 0x%x\n", fds[0].revents);
+
+    /* The same socket twice gets the events of each entry */
+    fds[1].fd = Client;
+    fds[1].events = POLLWRNORM;
+    fds[0].revents = fds[1].revents = 0x5555;
+    ret = WSAPoll(fds, 2, POLL_TIMEOUT);
+    ok(ret == 1, "WSAPoll returned %d, error %d\n", ret, WSAGetLastError());
+    ok(fds[0].revents == 0, "First revents 0x%x\n", fds[0].revents);
+    ok(fds[1].revents == POLLWRNORM, "Second revents 0x%x\n", fds[1].revents);
+}
+
+static
+void
+Test_Invalid(SOCKET Client)
+{
+    WSAPOLLFD fds[2];
+    int ret;
+
+    /* Negative descriptors are ignored, unknown ones are reported */
+    fds[0].fd = INVALID_SOCKET;
+    fds[0].events = POLLRDNORM;
+    fds[1].fd = (SOCKET)0xdead0;
+    fds[1].events = POLLRDNORM;
+    fds[0].revents = fds[1].revents = 0x5555;
+    ret = WSAPoll(fds, 2, POLL_TIMEOUT);
+    ok(ret == 1, "WSAPoll returned %d, error %d\n", ret, WSAGetLastError());
+    ok(fds[0].revents == 0, "Ignored revents 0x%x\n", fds[0].revents);
+    ok(fds[1].revents == POLLNVAL, "Unknown revents 0x%x\n", fds[1].revents);
+
+    /* Along with a valid one, without waiting for it */
+    fds[0].fd = Client;
+    fds[0].revents = fds[1].revents = 0x5555;
+    ret = WSAPoll(fds, 2, -1);
+    ok(ret == 1, "WSAPoll returned %d, error %d\n", ret, WSAGetLastError());
+    ok(fds[0].revents == 0, "Client revents 0x%x\n", fds[0].revents);
+    ok(fds[1].revents == POLLNVAL, "Unknown revents 0x%x\n", fds[1].revents);
+
+    ret = WSAPoll(NULL, 1, 0);
+    ok(ret == SOCKET_ERROR, "WSAPoll returned %d\n", ret);
+    ok(WSAGetLastError() == WSAEINVAL, "Error %d\n", WSAGetLastError());
+}
+
+static
+void
+Test_Hangup(SOCKET Client, SOCKET Server)
+{
+    WSAPOLLFD fd;
+    int ret;
+
+    /* A hang-up is reported without asking for readability */
+    closesocket(Server);
+    fd.fd = Client;
+    fd.events = POLLWRNORM;
+    fd.revents = 0x5555;
+    ret = WSAPoll(&fd, 1, POLL_TIMEOUT);
+    ok(ret == 1, "WSAPoll returned %d, error %d\n", ret, WSAGetLastError());
+    ok(fd.revents & POLLHUP, "revents 0x%x\n", fd.revents);
+    ok(!(fd.revents & ~(POLLHUP | POLLWRNORM | POLLERR)), "revents 0x%x\n", fd.revents);
+
+    /* A closed socket is no longer known */
+    closesocket(Client);
+    fd.events = POLLRDNORM;
+    fd.revents = 0x5555;
+    ret = WSAPoll(&fd, 1, POLL_TIMEOUT);
+    ok(ret == 1, "WSAPoll returned %d, error %d\n", ret, WSAGetLastError());
+    ok(fd.revents == POLLNVAL, "revents 0x%x\n", fd.revents);
+}
+
+START_TEST(WSAPoll)
+{
+    SOCKET Listener, Client, Server;
+    WSADATA wdata;
+    int err;
+
+    err = WSAStartup(MAKEWORD(2, 2), &wdata);
+    ok(err == 0, "WSAStartup failed, iResult == %d %d\n", err, WSAGetLastError());
+
+    if (CreatePair(&Listener, &Client, &Server))
+    {
+        Test_Timeout(Client);
+        Test_Readiness(Client, Server);
+        Test_Invalid(Client);
+        Test_Hangup(Client, Server);
+        closesocket(Listener);
+    }
+
+    WSACleanup();
+}
@@ -18,6 +18,7 @@ extern void func_recv(void);
 extern void func_send(void);
 extern void func_WSAAsync(void);
 extern void func_WSAIoctl(void);
+extern void func_WSAPoll(void);
 extern void func_WSARecv(void);
 extern void func_WSAStartup(void);
 
@@ -38,6 +39,7 @@ const struct test winetest_testlist[] =
     { "send", func_send },
     { "WSAAsync", func_WSAAsync },
     { "WSAIoctl", func_WSAIoctl },
+    { "WSAPoll", func_WSAPoll },
     { "WSARecv", func_WSARecv },
     { "WSAStartup", func_WSAStartup },
     { 0, 0 }
@@ -0,0 +1,244 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Test for the forward information base trie of the TCP/IP driver
+ */
+
+#include "precomp.h"
+
+#define MAX_ROUTES      600
+#define LOOKUPS         200000
+
+typedef struct _TEST_ROUTE
+{
+    ULONG Prefix;
+    UINT PrefixLength;
+    BOOLEAN Active;
+} TEST_ROUTE, *PTEST_ROUTE;
+
+static TEST_ROUTE Routes[MAX_ROUTES];
+static ULONG RouteCount;
+static LONG NodeCount;
+static ULONG Seed = 0x1234;
+
+static
+ULONG
+Random(void)
+{
+    /* xorshift32 */
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    return Seed;
+}
+
+static
+ULONG
+Mask(UINT PrefixLength)
+{
+    return PrefixLength ? 0xFFFFFFFF << (32 - PrefixLength) : 0;
+}
+
+static
+PFIB_NODE
+AllocateNode(VOID)
+{
+    NodeCount++;
+    return HeapAlloc(GetProcessHeap(), 0, sizeof(FIB_NODE));
+}
+
+static
+VOID
+FreeNode(PFIB_NODE Node)
+{
+    NodeCount--;
+    HeapFree(GetProcessHeap(), 0, Node);
+}
+
+/* What the driver did before the trie: look at every route */
+static
+PTEST_ROUTE
+LinearLookup(ULONG Address)
+{
+    PTEST_ROUTE Best = NULL;
+    ULONG i;
+
+    for (i = 0; i < RouteCount; i++)
+    {
+        if (!Routes[i].Active)
+            continue;
+
+        if ((Address & Mask(Routes[i].PrefixLength)) == Routes[i].Prefix &&
+            (!Best || Routes[i].PrefixLength > Best->PrefixLength))
+        {
+            Best = &Routes[i];
+        }
+    }
+
+    return Best;
+}
+
+static
+ULONG
+RandomAddress(void)
+{
+    PTEST_ROUTE Route;
+
+    /* Make most of them fall in some network */
+    if (RouteCount && (Random() & 3))
+    {
+        Route = &Routes[Random() % RouteCount];
+        return Route->Prefix | (Random() & ~Mask(Route->PrefixLength));
+    }
+
+    return Random();
+}
+
+static
+UINT
+RandomPrefixLength(void)
+{
+    ULONG Value = Random() % 100;
+
+    /* Roughly what a routing table looks like */
+    if (Value < 2) return 0;
+    if (Value < 60) return 16 + Random() % 9;
+    if (Value < 80) return 25 + Random() % 8;
+    return 1 + Random() % 32;
+}
+
+static
+VOID
+AddRoutes(PFIB_TRIE Trie, ULONG Count)
+{
+    PTEST_ROUTE Route;
+    PFIB_NODE Node;
+
+    while (Count-- && RouteCount < MAX_ROUTES)
+    {
+        Route = &Routes[RouteCount];
+        Route->Active = FALSE;
+        Route->PrefixLength = RandomPrefixLength();
+        Route->Prefix = Random() & Mask(Route->PrefixLength);
+
+        Node = FibTrieInsert(Trie, Route->Prefix, Route->PrefixLength);
+        ok(Node != NULL, "FibTrieInsert failed\n");
+        if (!Node)
+            continue;
+        ok(Node->Prefix == Route->Prefix, "Prefix 0x%08lx, expected 0x%08lx\n", Node->Prefix, Route->Prefix);
+        ok(Node->PrefixLength == Route->PrefixLength, "Length %u, expected %u\n", Node->PrefixLength, Route->PrefixLength);
+
+        /* The same network twice is the same node */
+        if (Node->Routes)
+            continue;
+
+        Node->Routes = Route;
+        Route->Active = TRUE;
+        RouteCount++;
+    }
+}
+
+static
+VOID
+RemoveRoutes(PFIB_TRIE Trie, ULONG Count)
+{
+    PTEST_ROUTE Route;
+    PFIB_NODE Node;
+
+    while (Count--)
+    {
+        Route = &Routes[Random() % RouteCount];
+        if (!Route->Active)
+            continue;
+
+        Node = FibTrieFind(Trie, Route->Prefix, Route->PrefixLength);
+        ok(Node != NULL && Node->Routes == Route, "Route 0x%08lx/%u not found\n", Route->Prefix, Route->PrefixLength);
+        if (!Node)
+            continue;
+
+        Node->Routes = NULL;
+        FibTrieDelete(Trie, Node);
+        Route->Active = FALSE;
+
+        /* It may stay as a branch, but without routes */
+        Node = FibTrieFind(Trie, Route->Prefix, Route->PrefixLength);
+        ok(!Node || !Node->Routes, "Route 0x%08lx/%u still there\n", Route->Prefix, Route->PrefixLength);
+    }
+}
+
+static
+VOID
+CheckLookups(PFIB_TRIE Trie, ULONG Count)
+{
+    PTEST_ROUTE Expected;
+    PFIB_NODE Node, Next;
+    ULONG Address, Mismatches = 0;
+
+    while (Count--)
+    {
+        Address = RandomAddress();
+        Expected = LinearLookup(Address);
+        Node = FibTrieLookup(Trie, Address);
+
+        if ((Node ? Node->Routes : NULL) != Expected)
+        {
+            if (!Mismatches++)
+            {
+                ok(0, "Address 0x%08lx: got %p, expected %p\n",
+                   Address, Node ? Node->Routes : NULL, Expected);
+            }
+            continue;
+        }
+
+        /* The shorter matches are there too, shortest last */
+        for (; Node; Node = Next)
+        {
+            Next = FibTrieNextMatch(Node);
+            if (!Next)
+                break;
+
+            if (Next->PrefixLength >= Node->PrefixLength ||
+                (Address & Next->Mask) != Next->Prefix ||
+                !Next->Routes)
+            {
+                if (!Mismatches++)
+                    ok(0, "Address 0x%08lx: bad next match 0x%08lx/%u\n", Address, Next->Prefix, Next->PrefixLength);
+                break;
+            }
+        }
+    }
+
+    ok(Mismatches == 0, "%lu lookups out of the trie don't match the linear lookup\n", Mismatches);
+}
+
+static
+VOID
+Test_Lookups(void)
+{
+    FIB_TRIE Trie;
+
+    FibTrieInitialize(&Trie, AllocateNode, FreeNode);
+    ok(FibTrieLookup(&Trie, 0x0A000001) == NULL, "Empty trie matched\n");
+
+    /* Grow the table, and shrink it, checking lookups along the way */
+    AddRoutes(&Trie, MAX_ROUTES / 2);
+    CheckLookups(&Trie, LOOKUPS / 4);
+    RemoveRoutes(&Trie, MAX_ROUTES / 4);
+    CheckLookups(&Trie, LOOKUPS / 4);
+    AddRoutes(&Trie, MAX_ROUTES / 2);
+    CheckLookups(&Trie, LOOKUPS / 4);
+    RemoveRoutes(&Trie, MAX_ROUTES);
+    CheckLookups(&Trie, LOOKUPS / 4);
+
+    /* A trie has at most one branch per network */
+    ok(NodeCount > 0 && NodeCount < 2 * MAX_ROUTES, "%ld nodes\n", NodeCount);
+
+    FibTrieDestroy(&Trie);
+    ok(Trie.Root == NULL, "Root is %p\n", Trie.Root);
+    ok(NodeCount == 0, "%ld nodes leaked\n", NodeCount);
+}
+
+START_TEST(FibTrie)
+{
+    Test_Lookups();
+}
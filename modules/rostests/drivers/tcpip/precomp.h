@@ -0,0 +1,12 @@
+#ifndef _TCPIP_DRVTEST_PRECOMP_H_
+#define _TCPIP_DRVTEST_PRECOMP_H_
+
+/* Lets driver sources which don't need the kernel be built in the tests */
+
+#define WIN32_NO_STATUS
+#include <apitest.h>
+#include <ndk/rtlfuncs.h>
+
+#include <fibtrie.h>
+
+#endif /* _TCPIP_DRVTEST_PRECOMP_H_ */
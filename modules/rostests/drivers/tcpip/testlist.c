@@ -3,11 +3,13 @@
 #define STANDALONE
 #include <apitest.h>
 
+extern void func_FibTrie(void);
 extern void func_InterfaceInfo(void);
 extern void func_tcp_info(void);
 
 const struct test winetest_testlist[] =
 {
+    { "FibTrie", func_FibTrie },
     { "InterfaceInfo", func_InterfaceInfo },
     { "tcp_info", func_tcp_info },
 
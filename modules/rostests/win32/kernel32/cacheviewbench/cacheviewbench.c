@@ -0,0 +1,118 @@
+/*
+ * PROJECT:     ReactOS tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Benchmark for the cache manager view lookup
+ * NOTES:       Prints the cost of a cached read against the number of views
+ *              populated in the file. Usage: cacheviewbench [max views]
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Mirrors VACB_MAPPING_GRANULARITY */
+#define VIEW_SIZE       0x40000
+#define ITERATIONS      20000
+
+static
+BOOL
+ReadByteAt(HANDLE hFile, ULONG View)
+{
+    UCHAR Byte;
+    DWORD Read;
+    LARGE_INTEGER Offset;
+
+    Offset.QuadPart = (LONGLONG)View * VIEW_SIZE;
+    if (!SetFilePointerEx(hFile, Offset, NULL, FILE_BEGIN))
+        return FALSE;
+
+    return ReadFile(hFile, &Byte, sizeof(Byte), &Read, NULL) && Read == sizeof(Byte);
+}
+
+int main(int argc, char *argv[])
+{
+    HANDLE hFile;
+    CHAR FileName[MAX_PATH];
+    CHAR TempPath[MAX_PATH];
+    LARGE_INTEGER Frequency, Start, End, Size;
+    ULONG MaxViews, Views, Populated, i;
+    double NsPerRead, FirstNsPerRead = 0.0;
+
+    MaxViews = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1024;
+    if (!MaxViews)
+    {
+        printf("Usage: %s [max views]\n", argv[0]);
+        return 1;
+    }
+
+    if (!GetTempPathA(sizeof(TempPath), TempPath) ||
+        !GetTempFileNameA(TempPath, "cvb", 0, FileName))
+    {
+        printf("No temporary file available\n");
+        return 1;
+    }
+
+    hFile = CreateFileA(FileName,
+                        GENERIC_READ | GENERIC_WRITE,
+                        0,
+                        NULL,
+                        CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                        NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        printf("CreateFile failed: %lu\n", GetLastError());
+        DeleteFileA(FileName);
+        return 1;
+    }
+
+    Size.QuadPart = (LONGLONG)MaxViews * VIEW_SIZE;
+    if (!SetFilePointerEx(hFile, Size, NULL, FILE_BEGIN) || !SetEndOfFile(hFile))
+    {
+        printf("Cannot extend the test file to %I64u bytes\n", Size.QuadPart);
+        CloseHandle(hFile);
+        return 1;
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+
+    /* Populate more and more views, and measure a cached read of the last one,
+     * which is the worst case for a lookup walking the views in order */
+    Populated = 0;
+    for (Views = 1; Views <= MaxViews; Views *= 4)
+    {
+        for (; Populated < Views; Populated++)
+        {
+            if (!ReadByteAt(hFile, Populated))
+            {
+                printf("Read of view %lu failed: %lu\n", Populated, GetLastError());
+                CloseHandle(hFile);
+                return 1;
+            }
+        }
+
+        QueryPerformanceCounter(&Start);
+        for (i = 0; i < ITERATIONS; i++)
+        {
+            if (!ReadByteAt(hFile, Views - 1))
+                break;
+        }
+        QueryPerformanceCounter(&End);
+        if (i != ITERATIONS)
+        {
+            printf("Read failed after %lu iterations: %lu\n", i, GetLastError());
+            CloseHandle(hFile);
+            return 1;
+        }
+
+        NsPerRead = (double)(End.QuadPart - Start.QuadPart) * 1e9 / Frequency.QuadPart / ITERATIONS;
+        if (Views == 1)
+            FirstNsPerRead = NsPerRead;
+
+        printf("%5lu views: %8.0f ns per cached read (%.2fx)\n",
+               Views, NsPerRead, NsPerRead / FirstNsPerRead);
+    }
+
+    CloseHandle(hFile);
+    return 0;
+}
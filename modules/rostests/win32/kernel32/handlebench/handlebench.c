@@ -0,0 +1,145 @@
+/*
+ * PROJECT:     ReactOS tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Benchmark for creating and closing handles
+ * NOTES:       Prints how many NtCreateEvent/NtClose pairs per second 1 to
+ *              16 threads get out of the process handle table, which shows
+ *              how well the per-processor free handle caches scale.
+ *              Usage: handlebench [max threads]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define WIN32_NO_STATUS
+#include <windef.h>
+#include <winbase.h>
+#define NTOS_MODE_USER
+#include <ndk/exfuncs.h>
+#include <ndk/obfuncs.h>
+
+#define ITERATIONS      100000
+#define MAX_THREADS     16
+
+typedef struct _STRESS_CONTEXT
+{
+    HANDLE StartEvent;
+    ULONG Failures;
+} STRESS_CONTEXT, *PSTRESS_CONTEXT;
+
+static
+DWORD
+WINAPI
+StressThread(LPVOID Parameter)
+{
+    PSTRESS_CONTEXT Context = Parameter;
+    HANDLE Handles[4];
+    NTSTATUS Status;
+    ULONG i, j;
+
+    WaitForSingleObject(Context->StartEvent, INFINITE);
+
+    /* Keep a few handles open so the table sees more than one at a time */
+    for (i = 0; i < ITERATIONS / _countof(Handles); i++)
+    {
+        for (j = 0; j < _countof(Handles); j++)
+        {
+            Status = NtCreateEvent(&Handles[j], EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE);
+            if (!NT_SUCCESS(Status))
+            {
+                Handles[j] = NULL;
+                Context->Failures++;
+            }
+        }
+
+        for (j = 0; j < _countof(Handles); j++)
+        {
+            if (Handles[j] && !NT_SUCCESS(NtClose(Handles[j])))
+                Context->Failures++;
+        }
+    }
+
+    return 0;
+}
+
+/* Returns million create/close pairs per second, or a negative value on failure */
+static
+double
+RunStress(ULONG ThreadCount)
+{
+    STRESS_CONTEXT Contexts[MAX_THREADS];
+    HANDLE Threads[MAX_THREADS];
+    LARGE_INTEGER Frequency, Start, End;
+    HANDLE StartEvent;
+    ULONG i, Created;
+    BOOL Failed = FALSE;
+
+    StartEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (!StartEvent)
+    {
+        printf("CreateEvent failed: %lu\n", GetLastError());
+        return -1.0;
+    }
+
+    for (Created = 0; Created < ThreadCount; Created++)
+    {
+        Contexts[Created].StartEvent = StartEvent;
+        Contexts[Created].Failures = 0;
+        Threads[Created] = CreateThread(NULL, 0, StressThread, &Contexts[Created], 0, NULL);
+        if (!Threads[Created])
+        {
+            printf("Only %lu threads out of %lu: %lu\n", Created, ThreadCount, GetLastError());
+            Failed = TRUE;
+            break;
+        }
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    SetEvent(StartEvent);
+    WaitForMultipleObjects(Created, Threads, TRUE, INFINITE);
+    QueryPerformanceCounter(&End);
+
+    for (i = 0; i < Created; i++)
+    {
+        if (Contexts[i].Failures)
+        {
+            printf("Thread %lu had %lu failures\n", i, Contexts[i].Failures);
+            Failed = TRUE;
+        }
+        CloseHandle(Threads[i]);
+    }
+    CloseHandle(StartEvent);
+
+    if (Failed)
+        return -1.0;
+
+    return (double)Created * ITERATIONS / ((double)(End.QuadPart - Start.QuadPart) / Frequency.QuadPart) / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    ULONG MaxThreads, ThreadCount;
+    double Single = 0.0, Rate;
+
+    MaxThreads = (argc > 1) ? strtoul(argv[1], NULL, 0) : MAX_THREADS;
+    if (!MaxThreads || MaxThreads > MAX_THREADS)
+    {
+        printf("Usage: %s [max threads, up to %u]\n", argv[0], MAX_THREADS);
+        return 1;
+    }
+
+    for (ThreadCount = 1; ThreadCount <= MaxThreads; ThreadCount *= 2)
+    {
+        Rate = RunStress(ThreadCount);
+        if (Rate < 0.0)
+            return 1;
+
+        if (ThreadCount == 1)
+            Single = Rate;
+        printf("%2lu threads: %7.3f M create/close per second (%.2fx)\n",
+               ThreadCount, Rate, Rate / Single);
+    }
+
+    return 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * PROJECT:     ReactOS tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Benchmark for the low fragmentation heap front end
+ * NOTES:       Prints the allocation throughput of a heap with and without
+ *              the front end, for 1 to 64 threads sharing the heap.
+ *              Usage: heapbench [max threads]
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define WORKING_SET     64
+#define ITERATIONS      200000
+#define MAX_THREADS     64
+
+typedef struct _STRESS_CONTEXT
+{
+    HANDLE Heap;
+    HANDLE StartEvent;
+    ULONG Seed;
+    BOOL Failed;
+} STRESS_CONTEXT, *PSTRESS_CONTEXT;
+
+static
+ULONG
+NextRandom(PULONG Seed)
+{
+    *Seed = *Seed * 1103515245 + 12345;
+    return *Seed >> 16;
+}
+
+static
+DWORD
+WINAPI
+StressThread(LPVOID Parameter)
+{
+    PSTRESS_CONTEXT Context = Parameter;
+    PVOID Blocks[WORKING_SET] = { NULL };
+    ULONG Seed = Context->Seed;
+    ULONG i, Slot;
+
+    WaitForSingleObject(Context->StartEvent, INFINITE);
+
+    for (i = 0; i < ITERATIONS; i++)
+    {
+        Slot = NextRandom(&Seed) % WORKING_SET;
+        if (Blocks[Slot])
+        {
+            HeapFree(Context->Heap, 0, Blocks[Slot]);
+        }
+        Blocks[Slot] = HeapAlloc(Context->Heap, 0, 8 + NextRandom(&Seed) % 248);
+        if (!Blocks[Slot])
+            Context->Failed = TRUE;
+    }
+
+    for (i = 0; i < WORKING_SET; i++)
+    {
+        if (Blocks[i])
+            HeapFree(Context->Heap, 0, Blocks[i]);
+    }
+
+    return 0;
+}
+
+/* Returns million operations per second, or a negative value on failure */
+static
+double
+RunStress(BOOL FrontEnd, ULONG ThreadCount)
+{
+    STRESS_CONTEXT Contexts[MAX_THREADS];
+    HANDLE Threads[MAX_THREADS];
+    LARGE_INTEGER Frequency, Start, End;
+    HANDLE Heap, StartEvent;
+    ULONG i, Created, Type = 2;
+    BOOL Failed = FALSE;
+
+    Heap = HeapCreate(0, 0, 0);
+    if (!Heap)
+    {
+        printf("HeapCreate failed: %lu\n", GetLastError());
+        return -1.0;
+    }
+
+    if (FrontEnd &&
+        !HeapSetInformation(Heap, HeapCompatibilityInformation, &Type, sizeof(Type)))
+    {
+        printf("Cannot enable the front end: %lu\n", GetLastError());
+        HeapDestroy(Heap);
+        return -1.0;
+    }
+
+    StartEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (!StartEvent)
+    {
+        printf("CreateEvent failed: %lu\n", GetLastError());
+        HeapDestroy(Heap);
+        return -1.0;
+    }
+
+    for (Created = 0; Created < ThreadCount; Created++)
+    {
+        Contexts[Created].Heap = Heap;
+        Contexts[Created].StartEvent = StartEvent;
+        Contexts[Created].Seed = 0x1234 + Created;
+        Contexts[Created].Failed = FALSE;
+        Threads[Created] = CreateThread(NULL, 0, StressThread, &Contexts[Created], 0, NULL);
+        if (!Threads[Created])
+        {
+            printf("Only %lu threads out of %lu: %lu\n", Created, ThreadCount, GetLastError());
+            Failed = TRUE;
+            break;
+        }
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    SetEvent(StartEvent);
+    for (i = 0; i < Created; i += MAXIMUM_WAIT_OBJECTS)
+    {
+        WaitForMultipleObjects(min(Created - i, MAXIMUM_WAIT_OBJECTS), &Threads[i], TRUE, INFINITE);
+    }
+    QueryPerformanceCounter(&End);
+
+    for (i = 0; i < Created; i++)
+    {
+        if (Contexts[i].Failed)
+        {
+            printf("Thread %lu ran out of memory\n", i);
+            Failed = TRUE;
+        }
+        CloseHandle(Threads[i]);
+    }
+    CloseHandle(StartEvent);
+
+    if (!HeapValidate(Heap, 0, NULL))
+    {
+        printf("Heap is corrupted after %lu threads\n", ThreadCount);
+        Failed = TRUE;
+    }
+    HeapDestroy(Heap);
+
+    if (Failed)
+        return -1.0;
+
+    return (double)Created * ITERATIONS * 2 / ((double)(End.QuadPart - Start.QuadPart) / Frequency.QuadPart) / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    ULONG MaxThreads, ThreadCount;
+    double BackEnd, FrontEnd;
+
+    MaxThreads = (argc > 1) ? strtoul(argv[1], NULL, 0) : MAX_THREADS;
+    if (!MaxThreads || MaxThreads > MAX_THREADS)
+    {
+        printf("Usage: %s [max threads, up to %u]\n", argv[0], MAX_THREADS);
+        return 1;
+    }
+
+    for (ThreadCount = 1; ThreadCount <= MaxThreads; ThreadCount *= 2)
+    {
+        BackEnd = RunStress(FALSE, ThreadCount);
+        FrontEnd = RunStress(TRUE, ThreadCount);
+        if (BackEnd < 0.0 || FrontEnd < 0.0)
+            return 1;
+
+        printf("%2lu threads: back end %7.2f Mops/s, front end %7.2f Mops/s (%.2fx)\n",
+               ThreadCount, BackEnd, FrontEnd, FrontEnd / BackEnd);
+    }
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * PROJECT:     ReactOS tests
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Benchmark for batched I/O completion dequeues
+ * NOTES:       Prints how fast packets posted by another thread are
+ *              dequeued one by one with GetQueuedCompletionStatus, and in
+ *              batches of several sizes with GetQueuedCompletionStatusEx.
+ *              Usage: iocpbench [packets]
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEFAULT_PACKETS 200000
+#define MAX_BATCH       256
+
+/* XP and 2003 do not have it */
+static BOOL (WINAPI *pGetQueuedCompletionStatusEx)(HANDLE, LPOVERLAPPED_ENTRY, ULONG, PULONG, DWORD, BOOL);
+
+typedef struct _PRODUCER_CONTEXT
+{
+    HANDLE Port;
+    ULONG Packets;
+} PRODUCER_CONTEXT, *PPRODUCER_CONTEXT;
+
+static
+DWORD
+WINAPI
+ProducerThread(LPVOID Parameter)
+{
+    PPRODUCER_CONTEXT Context = Parameter;
+    ULONG i;
+
+    for (i = 0; i < Context->Packets; i++)
+    {
+        if (!PostQueuedCompletionStatus(Context->Port, 0, i, NULL))
+            return 1;
+    }
+
+    return 0;
+}
+
+/* Returns thousand packets per second, or a negative value on failure.
+ * A batch of 0 means GetQueuedCompletionStatus. */
+static
+double
+RunBenchmark(ULONG Packets, ULONG Batch, PULONG Calls)
+{
+    static OVERLAPPED_ENTRY Entries[MAX_BATCH];
+    PRODUCER_CONTEXT Context;
+    LARGE_INTEGER Frequency, Start, End;
+    HANDLE Thread;
+    ULONG Received = 0, Removed;
+    DWORD Bytes, ExitCode;
+    ULONG_PTR Key;
+    LPOVERLAPPED Overlapped;
+    BOOL Ret;
+
+    *Calls = 0;
+
+    Context.Packets = Packets;
+    Context.Port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    if (!Context.Port)
+    {
+        printf("CreateIoCompletionPort failed: %lu\n", GetLastError());
+        return -1.0;
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    Thread = CreateThread(NULL, 0, ProducerThread, &Context, 0, NULL);
+    if (!Thread)
+    {
+        printf("CreateThread failed: %lu\n", GetLastError());
+        CloseHandle(Context.Port);
+        return -1.0;
+    }
+
+    while (Received < Packets)
+    {
+        if (Batch)
+        {
+            Ret = pGetQueuedCompletionStatusEx(Context.Port, Entries, Batch, &Removed, 5000, FALSE);
+        }
+        else
+        {
+            Ret = GetQueuedCompletionStatus(Context.Port, &Bytes, &Key, &Overlapped, 5000);
+            Removed = 1;
+        }
+
+        if (!Ret)
+        {
+            printf("Dequeue failed with %lu after %lu packets\n", GetLastError(), Received);
+            break;
+        }
+
+        Received += Removed;
+        (*Calls)++;
+    }
+
+    QueryPerformanceCounter(&End);
+
+    WaitForSingleObject(Thread, INFINITE);
+    GetExitCodeThread(Thread, &ExitCode);
+    CloseHandle(Thread);
+    CloseHandle(Context.Port);
+
+    if (ExitCode != 0)
+    {
+        printf("Posting a packet failed\n");
+        return -1.0;
+    }
+
+    if (Received != Packets)
+        return -1.0;
+
+    return (double)Packets / ((double)(End.QuadPart - Start.QuadPart) / Frequency.QuadPart) / 1e3;
+}
+
+int main(int argc, char *argv[])
+{
+    static const ULONG Batches[] = { 0, 1, 4, 16, 64, MAX_BATCH };
+    ULONG Packets, Calls, i;
+    double Rate, Single = 0.0;
+
+    Packets = (argc > 1) ? strtoul(argv[1], NULL, 0) : DEFAULT_PACKETS;
+    if (!Packets)
+    {
+        printf("Usage: %s [packets]\n", argv[0]);
+        return 1;
+    }
+
+    pGetQueuedCompletionStatusEx = (PVOID)GetProcAddress(GetModuleHandleW(L"kernel32.dll"),
+                                                         "GetQueuedCompletionStatusEx");
+    if (!pGetQueuedCompletionStatusEx)
+        printf("GetQueuedCompletionStatusEx is not available\n");
+
+    for (i = 0; i < _countof(Batches); i++)
+    {
+        if (Batches[i] && !pGetQueuedCompletionStatusEx)
+            break;
+
+        Rate = RunBenchmark(Packets, Batches[i], &Calls);
+        if (Rate < 0.0)
+            return 1;
+
+        if (!Batches[i])
+        {
+            Single = Rate;
+            printf("GetQueuedCompletionStatus:            %9.1f kpackets/s, %lu calls\n",
+                   Rate, Calls);
+        }
+        else
+        {
+            printf("GetQueuedCompletionStatusEx (%3lu):    %9.1f kpackets/s, %lu calls (%.2fx)\n",
+                   Batches[i], Rate, Calls, Rate / Single);
+        }
+    }
+
+    return 0;
+}
@@ -242,7 +242,7 @@ CcPurgeCacheSection (
         {
             CcRosUnmarkDirtyVacb(Vacb, FALSE);
         }
-        RemoveEntryList(&Vacb->CacheMapVacbListEntry);
+        CcRosRemoveVacbFromCacheMap(Vacb);
         InsertHeadList(&FreeList, &Vacb->CacheMapVacbListEntry);
     }
     KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
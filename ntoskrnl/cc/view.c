@@ -363,7 +363,7 @@ retry:
             ASSERT(!current->MappedCount);
             ASSERT(Refs == 1);
 
-            RemoveEntryList(&current->CacheMapVacbListEntry);
+            CcRosRemoveVacbFromCacheMap(current);
             RemoveEntryList(&current->VacbLruListEntry);
             InitializeListHead(&current->VacbLruListEntry);
             InsertHeadList(&FreeList, &current->CacheMapVacbListEntry);
@@ -452,6 +452,209 @@ CcRosReleaseVacb (
     return STATUS_SUCCESS;
 }
 
+/* Must be called with the cache map lock held */
+static
+PROS_VACB *
+CcRosGetVacbIndexSlot (
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    LONGLONG FileOffset)
+{
+    ULONGLONG Index;
+    ULONGLONG Leaf;
+
+    Index = (ULONGLONG)FileOffset / VACB_MAPPING_GRANULARITY;
+    Leaf = Index / VACB_INDEX_LEAF_ENTRIES;
+
+    if (Leaf >= SharedCacheMap->VacbIndexSize ||
+        SharedCacheMap->VacbIndex[Leaf] == NULL)
+    {
+        return NULL;
+    }
+
+    return &SharedCacheMap->VacbIndex[Leaf][Index % VACB_INDEX_LEAF_ENTRIES];
+}
+
+/*
+ * Makes sure the index has a slot for FileOffset, so that inserting the
+ * VACB later on, with the cache map lock held, cannot fail.
+ */
+static
+NTSTATUS
+CcRosReserveVacbIndexSlot (
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    LONGLONG FileOffset)
+{
+    ULONG Leaf;
+    ULONG NewSize;
+    KIRQL OldIrql;
+    BOOLEAN NeedIndex;
+    PROS_VACB *NewLeaf;
+    PROS_VACB **NewIndex;
+    PROS_VACB **OldIndex;
+
+    Leaf = (ULONG)(((ULONGLONG)FileOffset / VACB_MAPPING_GRANULARITY) / VACB_INDEX_LEAF_ENTRIES);
+
+    KeAcquireSpinLock(&SharedCacheMap->CacheMapLock, &OldIrql);
+    NeedIndex = (Leaf >= SharedCacheMap->VacbIndexSize);
+    if (!NeedIndex && SharedCacheMap->VacbIndex[Leaf] != NULL)
+    {
+        KeReleaseSpinLock(&SharedCacheMap->CacheMapLock, OldIrql);
+        return STATUS_SUCCESS;
+    }
+    NewSize = max(Leaf + 1, SharedCacheMap->VacbIndexSize * 2);
+    KeReleaseSpinLock(&SharedCacheMap->CacheMapLock, OldIrql);
+
+    NewIndex = NULL;
+    if (NeedIndex)
+    {
+        NewIndex = ExAllocatePoolWithTag(NonPagedPool, NewSize * sizeof(PROS_VACB *), TAG_VACB_INDEX);
+        if (NewIndex == NULL)
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+        RtlZeroMemory(NewIndex, NewSize * sizeof(PROS_VACB *));
+    }
+
+    NewLeaf = ExAllocatePoolWithTag(NonPagedPool, VACB_INDEX_LEAF_ENTRIES * sizeof(PROS_VACB), TAG_VACB_INDEX);
+    if (NewLeaf == NULL)
+    {
+        if (NewIndex != NULL)
+        {
+            ExFreePoolWithTag(NewIndex, TAG_VACB_INDEX);
+        }
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+    RtlZeroMemory(NewLeaf, VACB_INDEX_LEAF_ENTRIES * sizeof(PROS_VACB));
+
+    OldIndex = NULL;
+    KeAcquireSpinLock(&SharedCacheMap->CacheMapLock, &OldIrql);
+    /* Someone may have grown the index in between, only keep the larger one */
+    if (NewIndex != NULL && Leaf >= SharedCacheMap->VacbIndexSize)
+    {
+        if (SharedCacheMap->VacbIndexSize != 0)
+        {
+            RtlCopyMemory(NewIndex,
+                          SharedCacheMap->VacbIndex,
+                          SharedCacheMap->VacbIndexSize * sizeof(PROS_VACB *));
+        }
+        OldIndex = SharedCacheMap->VacbIndex;
+        SharedCacheMap->VacbIndex = NewIndex;
+        SharedCacheMap->VacbIndexSize = NewSize;
+        NewIndex = NULL;
+    }
+    if (SharedCacheMap->VacbIndex[Leaf] == NULL)
+    {
+        SharedCacheMap->VacbIndex[Leaf] = NewLeaf;
+        NewLeaf = NULL;
+    }
+    KeReleaseSpinLock(&SharedCacheMap->CacheMapLock, OldIrql);
+
+    /* Free what we didn't use */
+    if (OldIndex != NULL)
+    {
+        ExFreePoolWithTag(OldIndex, TAG_VACB_INDEX);
+    }
+    if (NewIndex != NULL)
+    {
+        ExFreePoolWithTag(NewIndex, TAG_VACB_INDEX);
+    }
+    if (NewLeaf != NULL)
+    {
+        ExFreePoolWithTag(NewLeaf, TAG_VACB_INDEX);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+CcRosFreeVacbIndex (
+    PROS_SHARED_CACHE_MAP SharedCacheMap)
+{
+    ULONG i;
+
+    for (i = 0; i < SharedCacheMap->VacbIndexSize; i++)
+    {
+        if (SharedCacheMap->VacbIndex[i] != NULL)
+        {
+            ExFreePoolWithTag(SharedCacheMap->VacbIndex[i], TAG_VACB_INDEX);
+        }
+    }
+
+    if (SharedCacheMap->VacbIndex != NULL)
+    {
+        ExFreePoolWithTag(SharedCacheMap->VacbIndex, TAG_VACB_INDEX);
+    }
+
+    SharedCacheMap->VacbIndex = NULL;
+    SharedCacheMap->VacbIndexSize = 0;
+}
+
+/*
+ * Unlinks the VACB from its shared cache map list and index.
+ * Must be called with the cache map lock held.
+ */
+VOID
+NTAPI
+CcRosRemoveVacbFromCacheMap (
+    PROS_VACB Vacb)
+{
+    PROS_VACB *Slot;
+
+    Slot = CcRosGetVacbIndexSlot(Vacb->SharedCacheMap, Vacb->FileOffset.QuadPart);
+    ASSERT(Slot != NULL && *Slot == Vacb);
+    *Slot = NULL;
+
+    RemoveEntryList(&Vacb->CacheMapVacbListEntry);
+}
+
+/*
+ * Returns the VACB preceding FileOffset in the cache map list, or NULL if
+ * there is none. Only the index leaf of FileOffset is searched, then the
+ * list is walked from its end, so the cost does not grow with the file size.
+ * Must be called with the cache map lock held, the leaf must exist.
+ */
+static
+PROS_VACB
+CcRosFindPrecedingVacb (
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    LONGLONG FileOffset)
+{
+    PLIST_ENTRY current_entry;
+    PROS_VACB *LeafSlots;
+    PROS_VACB current;
+    ULONGLONG Index;
+    ULONG i;
+
+    Index = (ULONGLONG)FileOffset / VACB_MAPPING_GRANULARITY;
+    LeafSlots = SharedCacheMap->VacbIndex[Index / VACB_INDEX_LEAF_ENTRIES];
+    ASSERT(LeafSlots != NULL);
+
+    /* Most VACBs are created next to an existing one */
+    for (i = (ULONG)(Index % VACB_INDEX_LEAF_ENTRIES); i-- > 0;)
+    {
+        if (LeafSlots[i] != NULL)
+        {
+            ASSERT(LeafSlots[i]->FileOffset.QuadPart < FileOffset);
+            return LeafSlots[i];
+        }
+    }
+
+    /* Otherwise, the list is sorted, find the last VACB before FileOffset */
+    current_entry = SharedCacheMap->CacheMapVacbListHead.Blink;
+    while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
+    {
+        current = CONTAINING_RECORD(current_entry, ROS_VACB, CacheMapVacbListEntry);
+        if (current->FileOffset.QuadPart < FileOffset)
+        {
+            return current;
+        }
+        current_entry = current_entry->Blink;
+    }
+
+    return NULL;
+}
+
 /* Returns with VACB Lock Held! */
 PROS_VACB
 NTAPI
@@ -459,7 +662,7 @@ CcRosLookupVacb (
     PROS_SHARED_CACHE_MAP SharedCacheMap,
     LONGLONG FileOffset)
 {
-    PLIST_ENTRY current_entry;
+    PROS_VACB *Slot;
     PROS_VACB current;
     KIRQL oldIrql;
 
@@ -468,33 +671,24 @@ CcRosLookupVacb (
     DPRINT("CcRosLookupVacb(SharedCacheMap 0x%p, FileOffset %I64u)\n",
            SharedCacheMap, FileOffset);
 
-    oldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
-    KeAcquireSpinLockAtDpcLevel(&SharedCacheMap->CacheMapLock);
+    /* The cache map lock is enough here: VACBs are only unlinked from the
+     * index with it held, and after having checked their reference count */
+    current = NULL;
+    KeAcquireSpinLock(&SharedCacheMap->CacheMapLock, &oldIrql);
 
-    current_entry = SharedCacheMap->CacheMapVacbListHead.Flink;
-    while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
+    Slot = CcRosGetVacbIndexSlot(SharedCacheMap, FileOffset);
+    if (Slot != NULL && *Slot != NULL)
     {
-        current = CONTAINING_RECORD(current_entry,
-                                    ROS_VACB,
-                                    CacheMapVacbListEntry);
-        if (IsPointInRange(current->FileOffset.QuadPart,
-                           VACB_MAPPING_GRANULARITY,
-                           FileOffset))
-        {
-            CcRosVacbIncRefCount(current);
-            KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
-            KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
-            return current;
-        }
-        if (current->FileOffset.QuadPart > FileOffset)
-            break;
-        current_entry = current_entry->Flink;
+        current = *Slot;
+        ASSERT(IsPointInRange(current->FileOffset.QuadPart,
+                              VACB_MAPPING_GRANULARITY,
+                              FileOffset));
+        CcRosVacbIncRefCount(current);
     }
 
-    KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
-    KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
+    KeReleaseSpinLock(&SharedCacheMap->CacheMapLock, oldIrql);
 
-    return NULL;
+    return current;
 }
 
 VOID
@@ -733,7 +927,7 @@ CcRosFreeUnusedVacb (
             ASSERT(Refs == 1);
 
             /* Reset and move to free list */
-            RemoveEntryList(&current->CacheMapVacbListEntry);
+            CcRosRemoveVacbFromCacheMap(current);
             RemoveEntryList(&current->VacbLruListEntry);
             InitializeListHead(&current->VacbLruListEntry);
             InsertHeadList(&FreeList, &current->CacheMapVacbListEntry);
@@ -784,7 +978,7 @@ CcRosCreateVacb (
 {
     PROS_VACB current;
     PROS_VACB previous;
-    PLIST_ENTRY current_entry;
+    PROS_VACB *Slot;
     NTSTATUS Status;
     KIRQL oldIrql;
     ULONG Refs;
@@ -844,6 +1038,15 @@ Retry:
         return Status;
     }
 
+    /* Make room in the index, so that linking the VACB cannot fail */
+    Status = CcRosReserveVacbIndexSlot(SharedCacheMap, current->FileOffset.QuadPart);
+    if (!NT_SUCCESS(Status))
+    {
+        Refs = CcRosVacbDecRefCount(current);
+        ASSERT(Refs == 0);
+        return Status;
+    }
+
     oldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
 
     *Vacb = current;
@@ -853,48 +1056,35 @@ Retry:
      * our newly created VACB and return the existing one.
      */
     KeAcquireSpinLockAtDpcLevel(&SharedCacheMap->CacheMapLock);
-    current_entry = SharedCacheMap->CacheMapVacbListHead.Flink;
-    previous = NULL;
-    while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
+    Slot = CcRosGetVacbIndexSlot(SharedCacheMap, FileOffset);
+    ASSERT(Slot != NULL);
+    if (*Slot != NULL)
     {
-        current = CONTAINING_RECORD(current_entry,
-                                    ROS_VACB,
-                                    CacheMapVacbListEntry);
-        if (IsPointInRange(current->FileOffset.QuadPart,
-                           VACB_MAPPING_GRANULARITY,
-                           FileOffset))
-        {
-            CcRosVacbIncRefCount(current);
-            KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
+        current = *Slot;
+        CcRosVacbIncRefCount(current);
+        KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
 #if DBG
-            if (SharedCacheMap->Trace)
-            {
-                DPRINT1("CacheMap 0x%p: deleting newly created VACB 0x%p ( found existing one 0x%p )\n",
-                        SharedCacheMap,
-                        (*Vacb),
-                        current);
-            }
+        if (SharedCacheMap->Trace)
+        {
+            DPRINT1("CacheMap 0x%p: deleting newly created VACB 0x%p ( found existing one 0x%p )\n",
+                    SharedCacheMap,
+                    (*Vacb),
+                    current);
+        }
 #endif
-            KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
+        KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
 
-            Refs = CcRosVacbDecRefCount(*Vacb);
-            ASSERT(Refs == 0);
+        Refs = CcRosVacbDecRefCount(*Vacb);
+        ASSERT(Refs == 0);
 
-            *Vacb = current;
-            return STATUS_SUCCESS;
-        }
-        if (current->FileOffset.QuadPart < FileOffset)
-        {
-            ASSERT(previous == NULL ||
-                   previous->FileOffset.QuadPart < current->FileOffset.QuadPart);
-            previous = current;
-        }
-        if (current->FileOffset.QuadPart > FileOffset)
-            break;
-        current_entry = current_entry->Flink;
+        *Vacb = current;
+        return STATUS_SUCCESS;
     }
-    /* There was no existing VACB. */
+
+    /* There was no existing VACB. Keep the list sorted: link the new one
+     * after the closest preceding VACB */
     current = *Vacb;
+    previous = CcRosFindPrecedingVacb(SharedCacheMap, current->FileOffset.QuadPart);
     if (previous)
     {
         InsertHeadList(&previous->CacheMapVacbListEntry, &current->CacheMapVacbListEntry);
@@ -903,6 +1093,7 @@ Retry:
     {
         InsertHeadList(&SharedCacheMap->CacheMapVacbListHead, &current->CacheMapVacbListEntry);
     }
+    *Slot = current;
     KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
     InsertTailList(&VacbLruListHead, &current->VacbLruListEntry);
     KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
@@ -1188,10 +1379,11 @@ CcRosDeleteFileCache (
         KeAcquireSpinLockAtDpcLevel(&SharedCacheMap->CacheMapLock);
         while (!IsListEmpty(&SharedCacheMap->CacheMapVacbListHead))
         {
-            current_entry = RemoveTailList(&SharedCacheMap->CacheMapVacbListHead);
+            current_entry = SharedCacheMap->CacheMapVacbListHead.Blink;
+            current = CONTAINING_RECORD(current_entry, ROS_VACB, CacheMapVacbListEntry);
+            CcRosRemoveVacbFromCacheMap(current);
             KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
 
-            current = CONTAINING_RECORD(current_entry, ROS_VACB, CacheMapVacbListEntry);
             RemoveEntryList(&current->VacbLruListEntry);
             InitializeListHead(&current->VacbLruListEntry);
             if (current->Dirty)
@@ -1259,6 +1451,7 @@ CcRosDeleteFileCache (
         RemoveEntryList(&SharedCacheMap->SharedCacheMapLinks);
         KeReleaseQueuedSpinLock(LockQueueMasterLock, *OldIrql);
 
+        CcRosFreeVacbIndex(SharedCacheMap);
         ExFreeToNPagedLookasideList(&SharedCacheMapLookasideList, SharedCacheMap);
         *OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
     }
@@ -369,6 +369,13 @@ INIT_SECTION CM_SYSTEM_CONTROL_VECTOR CmControlVector[] =
         NULL,
         NULL
     },
+    {
+        L"Session Manager\\Memory Management",
+        L"SectionFaultClusterSize",
+        &MmSectionFaultClusterSize,
+        NULL,
+        NULL
+    },
     {
         L"Session Manager\\Memory Management",
         L"PoolTagSmallTableSize",
@@ -983,40 +983,257 @@ CmpHandleExitNode(IN OUT PHHIVE *Hive,
     }
 }
 
+ULONG
+NTAPI
+CmpComputeHashValue(IN PCM_HASH_CACHE_STACK HashCacheStack,
+                    OUT PULONG TotalSubkeys,
+                    IN ULONG ConvKey,
+                    IN PUNICODE_STRING RemainingName)
+{
+    PWCHAR p, End;
+    ULONG RemainingSubkeys = 0;
+
+    /* Loop the whole name */
+    p = RemainingName->Buffer;
+    End = p + RemainingName->Length / sizeof(WCHAR);
+    while (p < End)
+    {
+        /* Skip path separators */
+        if (*p == OBJ_NAME_PATH_SEPARATOR)
+        {
+            p++;
+            continue;
+        }
+
+        /* Only the first components get hashed, the others will be parsed */
+        if (RemainingSubkeys < CMP_SUBKEY_LEVELS_DEPTH_LIMIT)
+        {
+            HashCacheStack[RemainingSubkeys].NameOfKey.Buffer = p;
+        }
+
+        /* Hash this component the same way KCBs are hashed */
+        while ((p < End) && (*p != OBJ_NAME_PATH_SEPARATOR))
+        {
+            ConvKey = 37 * ConvKey + RtlUpcaseUnicodeChar(*p);
+            p++;
+        }
+
+        if (RemainingSubkeys < CMP_SUBKEY_LEVELS_DEPTH_LIMIT)
+        {
+            HashCacheStack[RemainingSubkeys].NameOfKey.Length =
+                (USHORT)((ULONG_PTR)p - (ULONG_PTR)HashCacheStack[RemainingSubkeys].NameOfKey.Buffer);
+            HashCacheStack[RemainingSubkeys].NameOfKey.MaximumLength =
+                HashCacheStack[RemainingSubkeys].NameOfKey.Length;
+            HashCacheStack[RemainingSubkeys].ConvKey = ConvKey;
+        }
+
+        RemainingSubkeys++;
+    }
+
+    /* Return how many components were hashed and how many there are */
+    *TotalSubkeys = min(RemainingSubkeys, CMP_SUBKEY_LEVELS_DEPTH_LIMIT);
+    return RemainingSubkeys;
+}
+
+static
+BOOLEAN
+CmpCompareKcbName(IN PCM_KEY_CONTROL_BLOCK Kcb,
+                  IN PUNICODE_STRING Name)
+{
+    PCM_NAME_CONTROL_BLOCK NameBlock = Kcb->NameBlock;
+    ULONG i;
+
+    /* Compressed names are stored one byte per character */
+    if (NameBlock->Compressed)
+    {
+        if (NameBlock->NameLength != Name->Length / sizeof(WCHAR)) return FALSE;
+        return !CmpCompareCompressedName(Name, NameBlock->Name, NameBlock->NameLength);
+    }
+
+    /* Otherwise the upcased name is stored as is */
+    if (NameBlock->NameLength != Name->Length) return FALSE;
+    for (i = 0; i < Name->Length / sizeof(WCHAR); i++)
+    {
+        if (RtlUpcaseUnicodeChar(Name->Buffer[i]) != NameBlock->Name[i]) return FALSE;
+    }
+
+    return TRUE;
+}
+
+static
+BOOLEAN
+CmpIsKcbOnHashStack(IN PCM_KEY_CONTROL_BLOCK CachedKcb,
+                    IN PCM_KEY_CONTROL_BLOCK StartKcb,
+                    IN PCM_HASH_CACHE_STACK HashCacheStack,
+                    IN ULONG Level)
+{
+    PCM_KEY_CONTROL_BLOCK Kcb = CachedKcb;
+
+    /* Quickly reject KCBs which aren't at the right depth */
+    if (CachedKcb->TotalLevels != StartKcb->TotalLevels + Level) return FALSE;
+
+    /* Let the parse routine handle symlinks and their OBJ_OPENLINK semantics */
+    if (CachedKcb->Flags & KEY_SYM_LINK) return FALSE;
+
+    /* Walk up to the starting KCB, comparing each name of the path */
+    while (Level)
+    {
+        /* Don't use deleted or fake KCBs, nor anything below a symlink */
+        if ((Kcb->Delete) ||
+            (Kcb->ExtFlags & CM_KCB_KEY_NON_EXIST) ||
+            ((Kcb != CachedKcb) && (Kcb->Flags & KEY_SYM_LINK)))
+        {
+            return FALSE;
+        }
+
+        /* Don't use KCBs from a hive being unloaded either */
+        if ((Kcb->KeyHive->HiveFlags & HIVE_IS_UNLOADING) &&
+            (((PCMHIVE)Kcb->KeyHive)->CreatorOwner != KeGetCurrentThread()))
+        {
+            return FALSE;
+        }
+
+        if (!CmpCompareKcbName(Kcb, &HashCacheStack[Level - 1].NameOfKey)) return FALSE;
+
+        Kcb = Kcb->ParentKcb;
+        Level--;
+    }
+
+    /* We matched the whole path, make sure it starts where we do */
+    return (Kcb == StartKcb);
+}
+
 NTSTATUS
 NTAPI
 CmpBuildHashStackAndLookupCache(IN PCM_KEY_BODY ParseObject,
                                 IN OUT PCM_KEY_CONTROL_BLOCK *Kcb,
-                                IN PUNICODE_STRING Current,
+                                IN OUT PUNICODE_STRING Current,
                                 OUT PHHIVE *Hive,
                                 OUT HCELL_INDEX *Cell,
                                 OUT PULONG TotalRemainingSubkeys,
                                 OUT PULONG MatchRemainSubkeyLevel,
                                 OUT PULONG TotalSubkeys,
-                                OUT PULONG OuterStackArray,
+                                OUT PCM_HASH_CACHE_STACK HashCacheStack,
                                 OUT PULONG *LockedKcbs)
 {
-    /* We don't lock anything for now */
+    PCM_KEY_CONTROL_BLOCK CachedKcb = NULL;
+    PCM_KEY_HASH Entry;
+    ULONG Level, Index;
+    PWCHAR End;
+
+    /* KCB locks are only held while probing the cache */
     *LockedKcbs = NULL;
 
     /* Calculate hash values */
-    *TotalRemainingSubkeys = 0xBAADF00D;
+    *TotalRemainingSubkeys = CmpComputeHashValue(HashCacheStack,
+                                                 TotalSubkeys,
+                                                 (*Kcb)->ConvKey,
+                                                 Current);
 
-    /* Lock the registry */
-    CmpLockRegistry();
+    /* Make sure it's not a dead KCB */
+    ASSERT((*Kcb)->RefCount > 0);
+
+    /* Look for the longest cached prefix of the path, deepest first */
+    for (Level = *TotalSubkeys; Level > 0; Level--)
+    {
+        /* Lock the hash entry this KCB would be in */
+        Index = GET_HASH_INDEX(HashCacheStack[Level - 1].ConvKey);
+        CmpAcquireKcbLockSharedByIndex(Index);
+
+        /* Loop the hash entry */
+        for (Entry = CmpCacheTable[Index].Entry; Entry; Entry = Entry->NextHash)
+        {
+            /* Check if this is the KCB for this path */
+            if (Entry->ConvKey != HashCacheStack[Level - 1].ConvKey) continue;
+            CachedKcb = CONTAINING_RECORD(Entry, CM_KEY_CONTROL_BLOCK, KeyHash);
+            if (CmpIsKcbOnHashStack(CachedKcb, *Kcb, HashCacheStack, Level)) break;
+        }
+
+        /* Reference it while we still own the lock */
+        if ((Entry) && !(CmpReferenceKeyControlBlock(CachedKcb))) Entry = NULL;
+        CmpReleaseKcbLockByIndex(Index);
+
+        /* Stop as soon as we got one */
+        if (Entry) break;
+    }
+
+    if (Level)
+    {
+        /* Found in the cache, skip the components it covers */
+        End = HashCacheStack[Level - 1].NameOfKey.Buffer +
+              HashCacheStack[Level - 1].NameOfKey.Length / sizeof(WCHAR);
+        Current->Length -= (USHORT)((ULONG_PTR)End - (ULONG_PTR)Current->Buffer);
+        Current->MaximumLength -= (USHORT)((ULONG_PTR)End - (ULONG_PTR)Current->Buffer);
+        Current->Buffer = End;
+
+        /* Start from the cached KCB */
+        *Kcb = CachedKcb;
+        *TotalRemainingSubkeys -= Level;
+    }
+    else
+    {
+        /* Nothing cached, start from the object we're parsing */
+        (VOID)CmpReferenceKeyControlBlock(*Kcb);
+    }
+
+    /* Return what's left to parse */
+    *MatchRemainSubkeyLevel = *TotalRemainingSubkeys;
 
     /* Return hive and cell data */
     *Hive = (*Kcb)->KeyHive;
     *Cell = (*Kcb)->KeyCell;
 
-    /* Make sure it's not a dead KCB */
-    ASSERT((*Kcb)->RefCount > 0);
+    return STATUS_SUCCESS;
+}
 
-    /* Reference it */
-    (VOID)CmpReferenceKeyControlBlock(*Kcb);
+static
+NTSTATUS
+CmpOpenCachedKcb(IN PCM_KEY_CONTROL_BLOCK Kcb,
+                 IN PACCESS_STATE AccessState,
+                 IN KPROCESSOR_MODE AccessMode,
+                 OUT PVOID *Object)
+{
+    NTSTATUS Status;
+    PCM_KEY_BODY KeyBody;
 
-    /* Return success for now */
-    return STATUS_SUCCESS;
+    /* Allocate the key object */
+    Status = ObCreateObject(AccessMode,
+                            CmpKeyObjectType,
+                            NULL,
+                            AccessMode,
+                            NULL,
+                            sizeof(CM_KEY_BODY),
+                            0,
+                            0,
+                            Object);
+    if (!NT_SUCCESS(Status))
+    {
+        /* Drop the reference from the cache lookup */
+        CmpDereferenceKeyControlBlock(Kcb);
+        return Status;
+    }
+
+    /* Fill it out, it takes over the reference from the cache lookup */
+    KeyBody = (PCM_KEY_BODY)(*Object);
+    KeyBody->KeyControlBlock = Kcb;
+    KeyBody->Type = CM_KEY_BODY_TYPE;
+    KeyBody->ProcessID = PsGetCurrentProcessId();
+    KeyBody->NotifyBlock = NULL;
+
+    /* Link to the KCB, this locks it if needed */
+    EnlistKeyBodyWithKCB(KeyBody, 0);
+
+    if (!ObCheckObjectAccess(*Object,
+                             AccessState,
+                             FALSE,
+                             AccessMode,
+                             &Status))
+    {
+        /* Access check failed */
+        ObDereferenceObject(*Object);
+    }
+
+    return Status;
 }
 
 NTSTATUS
@@ -1042,6 +1259,7 @@ CmpParseKey(IN PVOID ParseObject,
     UNICODE_STRING Current, NextName;
     PCM_PARSE_CONTEXT ParseContext = Context;
     ULONG TotalRemainingSubkeys = 0, MatchRemainSubkeyLevel = 0, TotalSubkeys = 0;
+    CM_HASH_CACHE_STACK HashCacheStack[CMP_SUBKEY_LEVELS_DEPTH_LIMIT];
     PULONG LockedKcbs = NULL;
     BOOLEAN Result, Last;
     PAGED_CODE();
@@ -1087,7 +1305,7 @@ CmpParseKey(IN PVOID ParseObject,
                                              &TotalRemainingSubkeys,
                                              &MatchRemainSubkeyLevel,
                                              &TotalSubkeys,
-                                             NULL,
+                                             HashCacheStack,
                                              &LockedKcbs);
 
     /* This is now the parent */
@@ -1096,9 +1314,22 @@ CmpParseKey(IN PVOID ParseObject,
     /* Sanity check */
     ASSERT(ParentKcb != NULL);
 
-    /* Check if everything was found cached */
-    if (!TotalRemainingSubkeys)
-        ASSERTMSG("Caching not implemented\n", FALSE);
+    /*
+     * A key cached all the way is opened from its KCB, without the registry
+     * lock. Creates, symlinks, exit nodes and hives being unloaded go
+     * through the hive walk below.
+     */
+    if (!(TotalRemainingSubkeys) &&
+        !(ParseContext) &&
+        !(Kcb->Delete) &&
+        !(Kcb->Flags & (KEY_SYM_LINK | KEY_HIVE_EXIT)) &&
+        !(Kcb->KeyHive->HiveFlags & HIVE_IS_UNLOADING))
+    {
+        return CmpOpenCachedKcb(Kcb, AccessState, AccessMode, Object);
+    }
+
+    /* Walk the hive in the registry lock */
+    CmpLockRegistry();
 
     /* Don't do anything if we're being deleted */
     if (Kcb->Delete)
@@ -186,6 +186,7 @@ ExpFreeHandleTable(IN PHANDLE_TABLE HandleTable)
     ULONG_PTR TableBase = TableCode & ~3;
     ULONG TableLevel = (ULONG)(TableCode & 3);
     PHANDLE_TABLE_ENTRY Level1, *Level2, **Level3;
+    PHANDLE_TABLE_FREE_CACHE FreeCache;
     PAGED_CODE();
 
     /* Check which level we're at */
@@ -244,6 +245,17 @@ ExpFreeHandleTable(IN PHANDLE_TABLE HandleTable)
                               SizeOfHandle(HIGH_LEVEL_ENTRIES));
     }
 
+    /* Free the per-processor caches, sized like ExpAllocateFreeHandleCache did */
+    FreeCache = HandleTable->FreeHandleCache;
+    if (FreeCache)
+    {
+        ExpFreeTablePagedPool(Process,
+                              FreeCache->Allocation,
+                              FIELD_OFFSET(HANDLE_TABLE_FREE_CACHE,
+                                           Processor[FreeCache->ProcessorCount]) +
+                              HANDLE_CACHE_SIZE);
+    }
+
     /* Free the actual table and check if we need to release quota */
     ExFreePoolWithTag(HandleTable, TAG_OBJECT_TABLE);
     if (Process)
@@ -252,6 +264,89 @@ ExpFreeHandleTable(IN PHANDLE_TABLE HandleTable)
     }
 }
 
+PHANDLE_TABLE_FREE_CACHE
+NTAPI
+ExpAllocateFreeHandleCache(IN PEPROCESS Process OPTIONAL)
+{
+    PHANDLE_TABLE_FREE_CACHE FreeCache;
+    PVOID Buffer;
+    SIZE_T Size;
+
+    /* One line for the header and one per processor, plus room to align them */
+    Size = FIELD_OFFSET(HANDLE_TABLE_FREE_CACHE, Processor[KeNumberProcessors]) +
+           HANDLE_CACHE_SIZE;
+    Buffer = ExpAllocateTablePagedPool(Process, Size);
+    if (!Buffer) return NULL;
+
+    /* Keep every processor on its own cache line */
+    FreeCache = ALIGN_UP_POINTER_BY(Buffer, HANDLE_CACHE_SIZE);
+    FreeCache->Allocation = Buffer;
+
+    /*
+     * Tables created before the other processors are started only get a
+     * cache for the boot processor, the others go to the free lists.
+     */
+    FreeCache->ProcessorCount = KeNumberProcessors;
+    return FreeCache;
+}
+
+ULONG
+NTAPI
+ExpPopCachedHandle(IN PHANDLE_TABLE HandleTable)
+{
+    PHANDLE_TABLE_FREE_CACHE FreeCache = HandleTable->FreeHandleCache;
+    PHANDLE_TABLE_CACHE Cache;
+    ULONG Processor, Value, i;
+
+    /* Check if this table and processor have a cache */
+    if (!FreeCache) return 0;
+    Processor = KeGetCurrentProcessorNumber();
+    if (Processor >= FreeCache->ProcessorCount) return 0;
+    Cache = &FreeCache->Processor[Processor];
+
+    /*
+     * Slots are claimed with an exchange, so being moved to another processor
+     * in the middle of this only costs locality, never correctness.
+     */
+    for (i = 0; i < HANDLE_CACHE_ENTRIES; i++)
+    {
+        if (!*(volatile ULONG*)&Cache->Handle[i]) continue;
+
+        Value = InterlockedExchange((PLONG)&Cache->Handle[i], 0);
+        if (Value) return Value;
+    }
+
+    /* Nothing cached */
+    return 0;
+}
+
+BOOLEAN
+NTAPI
+ExpPushCachedHandle(IN PHANDLE_TABLE HandleTable,
+                    IN ULONG Value)
+{
+    PHANDLE_TABLE_FREE_CACHE FreeCache = HandleTable->FreeHandleCache;
+    PHANDLE_TABLE_CACHE Cache;
+    ULONG Processor, i;
+
+    /* Check if this table and processor have a cache */
+    if (!FreeCache) return FALSE;
+    Processor = KeGetCurrentProcessorNumber();
+    if (Processor >= FreeCache->ProcessorCount) return FALSE;
+    Cache = &FreeCache->Processor[Processor];
+
+    /* Take the first empty slot */
+    for (i = 0; i < HANDLE_CACHE_ENTRIES; i++)
+    {
+        if (*(volatile ULONG*)&Cache->Handle[i]) continue;
+
+        if (!InterlockedCompareExchange((PLONG)&Cache->Handle[i], Value, 0)) return TRUE;
+    }
+
+    /* The cache is full, the caller puts it on a free list */
+    return FALSE;
+}
+
 VOID
 NTAPI
 ExpFreeHandleTableEntry(IN PHANDLE_TABLE HandleTable,
@@ -275,12 +370,20 @@ ExpFreeHandleTableEntry(IN PHANDLE_TABLE HandleTable,
     /* Check if we're FIFO */
     if (!HandleTable->StrictFIFO)
     {
+        /* Keep it on this processor if there is room, the next create reuses it */
+        if (ExpPushCachedHandle(HandleTable, Handle.AsULONG)) return;
+
         /* Select a lock index */
         LockIndex = Handle.Index % 4;
 
-        /* Select which entry to use */
+        /*
+         * Only push on the first free list when no allocation holds the lock
+         * for this index. One that does might have read this entry as the
+         * head already, and would install a stale link if it came back.
+         */
+        KeMemoryBarrier();
         Free = (HandleTable->HandleTableLock[LockIndex].Locked) ?
-                &HandleTable->FirstFree : &HandleTable->LastFree;
+                &HandleTable->LastFree : &HandleTable->FirstFree;
     }
     else
     {
@@ -377,6 +480,9 @@ ExpAllocateHandleTable(IN PEPROCESS Process OPTIONAL,
     HandleTable->UniqueProcessId = PsGetCurrentProcess()->UniqueProcessId;
     HandleTable->Flags = 0;
 
+    /* The per-processor caches are optional, the free lists work without them */
+    HandleTable->FreeHandleCache = ExpAllocateFreeHandleCache(Process);
+
     /* Loop all the handle table locks */
     for (i = 0; i < 4; i++)
     {
@@ -611,7 +717,9 @@ ULONG
 NTAPI
 ExpMoveFreeHandles(IN PHANDLE_TABLE HandleTable)
 {
-    ULONG LastFree, i;
+    ULONG LastFree, FirstFree, Head, Previous, Next, i;
+    PHANDLE_TABLE_ENTRY Entry, Tail = NULL;
+    EXHANDLE Handle;
 
     /* Clear the last free index */
     LastFree = InterlockedExchange((PLONG) &HandleTable->LastFree, 0);
@@ -637,9 +745,54 @@ ExpMoveFreeHandles(IN PHANDLE_TABLE HandleTable)
         }
     }
 
-    /* We are strict FIFO, we need to reverse the entries */
-    ASSERT(FALSE);
-    return LastFree;
+    /*
+     * Either handles were freed on the first list in the meantime, or we are
+     * strict FIFO and the chain must be reversed. The chain is ours alone now,
+     * so find its head and tail and push it on the first list in one go.
+     */
+    Handle.GenericHandleOverlay = NULL;
+    Head = Previous = 0;
+    Next = LastFree;
+    while (Next)
+    {
+        /* Get the entry and the link out of it */
+        Handle.Value = Next;
+        Entry = ExpLookupHandleTableEntry(HandleTable, Handle);
+        ASSERT(Entry != NULL);
+        Head = Next;
+        Next = (ULONG)Entry->NextFreeTableEntry;
+
+        if (HandleTable->StrictFIFO)
+        {
+            /* The most recently freed handle is seen first and ends up last */
+            if (!Tail) Tail = Entry;
+            Entry->NextFreeTableEntry = Previous;
+            Previous = Head;
+        }
+        else
+        {
+            /* Keep the order, only the tail is needed */
+            Tail = Entry;
+        }
+    }
+
+    /* Without reversing, the chain still starts where it did */
+    if (!HandleTable->StrictFIFO) Head = LastFree;
+
+    /* Put the chain in front of whatever is on the first list */
+    for (;;)
+    {
+        FirstFree = HandleTable->FirstFree;
+        Tail->NextFreeTableEntry = FirstFree;
+        if (InterlockedCompareExchange((PLONG) &HandleTable->FirstFree,
+                                       Head,
+                                       FirstFree) == FirstFree)
+        {
+            break;
+        }
+    }
+
+    return Head;
 }
 
 PHANDLE_TABLE_ENTRY
@@ -653,6 +806,19 @@ ExpAllocateHandleTableEntry(IN PHANDLE_TABLE HandleTable,
     BOOLEAN Result;
     ULONG i;
 
+    /* Reuse a handle this processor freed recently if there is one */
+    Handle.GenericHandleOverlay = NULL;
+    Handle.Value = ExpPopCachedHandle(HandleTable);
+    if (Handle.Value)
+    {
+        /* Nobody else can see it, no need to touch the free lists */
+        Entry = ExpLookupHandleTableEntry(HandleTable, Handle);
+        ASSERT((Entry != NULL) && (Entry->Object == NULL));
+        InterlockedIncrement(&HandleTable->HandleCount);
+        *NewHandle = Handle;
+        return Entry;
+    }
+
     /* Start allocation loop */
     for (;;)
     {
@@ -663,6 +663,9 @@ ExpInitSystemPhase1(VOID)
     /* Initialize pushlocks */
     ExpInitializePushLocks();
 
+    /* Give each processor its own pool lookaside lists */
+    ExpAllocatePoolLookasideLists();
+
     /* Initialize events and event pairs */
     if (ExpInitializeEventImplementation() == FALSE)
     {
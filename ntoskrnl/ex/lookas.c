@@ -14,6 +14,7 @@
 
 #if defined (ALLOC_PRAGMA)
 #pragma alloc_text(INIT, ExpInitLookasideLists)
+#pragma alloc_text(INIT, ExpAllocatePoolLookasideLists)
 #endif
 
 /* GLOBALS *******************************************************************/
@@ -24,8 +25,13 @@ LIST_ENTRY ExpPagedLookasideListHead;
 KSPIN_LOCK ExpPagedLookasideListLock;
 LIST_ENTRY ExSystemLookasideListHead;
 LIST_ENTRY ExPoolLookasideListHead;
-GENERAL_LOOKASIDE ExpSmallNPagedPoolLookasideLists[MAXIMUM_PROCESSORS];
-GENERAL_LOOKASIDE ExpSmallPagedPoolLookasideLists[MAXIMUM_PROCESSORS];
+GENERAL_LOOKASIDE ExpSmallNPagedPoolLookasideLists[NUMBER_POOL_LOOKASIDE_LISTS];
+GENERAL_LOOKASIDE ExpSmallPagedPoolLookasideLists[NUMBER_POOL_LOOKASIDE_LISTS];
+
+/* Depth tuning parameters */
+#define MINIMUM_LOOKASIDE_DEPTH 4
+#define LOOKASIDE_IDLE_ALLOCATES 75
+#define LOOKASIDE_TARGET_MISS_RATIO 5
 
 /* PRIVATE FUNCTIONS *********************************************************/
 
@@ -66,14 +72,14 @@ ExInitPoolLookasidePointers(VOID)
     PKPRCB Prcb = KeGetCurrentPrcb();
     PGENERAL_LOOKASIDE Entry;
 
-    /* Loop for all pool lists */
-    for (i = 0; i < MAXIMUM_PROCESSORS; i++)
+    /* Loop for all pool lists, there is one per block size */
+    for (i = 0; i < NUMBER_POOL_LOOKASIDE_LISTS; i++)
     {
         /* Initialize the non-paged list */
         Entry = &ExpSmallNPagedPoolLookasideLists[i];
         InitializeSListHead(&Entry->ListHead);
 
-        /* Bind to PRCB */
+        /* Bind to PRCB, until we get a private list */
         Prcb->PPNPagedLookasideList[i].P = Entry;
         Prcb->PPNPagedLookasideList[i].L = Entry;
 
@@ -81,12 +87,146 @@ ExInitPoolLookasidePointers(VOID)
         Entry = &ExpSmallPagedPoolLookasideLists[i];
         InitializeSListHead(&Entry->ListHead);
 
-        /* Bind to PRCB */
+        /* Bind to PRCB, until we get a private list */
         Prcb->PPPagedLookasideList[i].P = Entry;
         Prcb->PPPagedLookasideList[i].L = Entry;
     }
 }
 
+INIT_FUNCTION
+VOID
+NTAPI
+ExpAllocatePoolLookasideLists(VOID)
+{
+    ULONG i, j;
+    PKPRCB Prcb;
+    PGENERAL_LOOKASIDE CurrentList;
+
+    /* Allocate the per-processor lookaside list buffer */
+    CurrentList = ExAllocatePoolWithTag(NonPagedPool,
+                                        2 * NUMBER_POOL_LOOKASIDE_LISTS *
+                                        KeNumberProcessors *
+                                        sizeof(GENERAL_LOOKASIDE),
+                                        'looP');
+    if (!CurrentList)
+    {
+        /* Keep using the global lists only */
+        DPRINT1("Failed to allocate the per-processor pool lookaside lists\n");
+        return;
+    }
+
+    /* Loop all processors */
+    for (i = 0; i < (ULONG)KeNumberProcessors; i++)
+    {
+        /* Get the PRCB for this CPU */
+        Prcb = KiProcessorBlock[i];
+
+        /* Loop all block sizes */
+        for (j = 0; j < NUMBER_POOL_LOOKASIDE_LISTS; j++)
+        {
+            /* Initialize the private non-paged list */
+            ExInitializeSystemLookasideList(CurrentList,
+                                            NonPagedPool,
+                                            (j + 1) * POOL_BLOCK_SIZE,
+                                            'looP',
+                                            256,
+                                            &ExPoolLookasideListHead);
+
+            /* Set it as the first list to try, it has no contention */
+            Prcb->PPNPagedLookasideList[j].P = CurrentList;
+            CurrentList++;
+
+            /* Initialize the private paged list */
+            ExInitializeSystemLookasideList(CurrentList,
+                                            PagedPool,
+                                            (j + 1) * POOL_BLOCK_SIZE,
+                                            'looP',
+                                            256,
+                                            &ExPoolLookasideListHead);
+
+            /* Set it as the first list to try, it has no contention */
+            Prcb->PPPagedLookasideList[j].P = CurrentList;
+            CurrentList++;
+        }
+    }
+}
+
+static
+USHORT
+ExpComputeLookasideDepth(IN ULONG Allocates,
+                         IN ULONG Misses,
+                         IN USHORT MaximumDepth,
+                         IN USHORT Depth)
+{
+    ULONG Ratio, Target;
+
+    /* An idle list doesn't deserve to hold memory */
+    if (Allocates < LOOKASIDE_IDLE_ALLOCATES)
+    {
+        return (USHORT)max(Depth - 10, MINIMUM_LOOKASIDE_DEPTH);
+    }
+
+    /* Compute the miss ratio, in tenths of a percent */
+    Ratio = (ULONG)(((ULONGLONG)Misses * 1000) / Allocates);
+
+    /* Slowly give memory back if the list hits often enough */
+    if (Ratio < LOOKASIDE_TARGET_MISS_RATIO)
+    {
+        return (USHORT)max(Depth - 1, MINIMUM_LOOKASIDE_DEPTH);
+    }
+
+    /* Otherwise grow it, faster the more it misses */
+    Target = Depth + ((Ratio * (MaximumDepth - Depth)) / (1000 * 2)) + 5;
+    return (USHORT)min(Target, MaximumDepth);
+}
+
+static
+VOID
+ExpScanLookasideList(IN PLIST_ENTRY ListHead,
+                     IN PKSPIN_LOCK Lock,
+                     IN BOOLEAN CountsHits)
+{
+    PLIST_ENTRY ListEntry;
+    PGENERAL_LOOKASIDE Lookaside;
+    ULONG Allocates, Misses;
+    KIRQL OldIrql;
+
+    /* Lock the list, if it can change under us */
+    if (Lock) KeAcquireSpinLock(Lock, &OldIrql);
+
+    /* Loop every lookaside list */
+    for (ListEntry = ListHead->Flink;
+         ListEntry != ListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        Lookaside = CONTAINING_RECORD(ListEntry, GENERAL_LOOKASIDE, ListEntry);
+
+        /* Get the activity since the last scan. Pool lists count hits,
+           driver lists count misses, in the same field */
+        Allocates = Lookaside->TotalAllocates - Lookaside->LastTotalAllocates;
+        if (CountsHits)
+            Misses = Allocates - (Lookaside->AllocateHits - Lookaside->LastAllocateHits);
+        else
+            Misses = Lookaside->AllocateMisses - Lookaside->LastAllocateMisses;
+
+        /* Counters are updated without interlocks, keep the miss count sane */
+        if (Misses > Allocates) Misses = Allocates;
+
+        /* Take a new snapshot */
+        Lookaside->LastTotalAllocates = Lookaside->TotalAllocates;
+        Lookaside->LastAllocateHits = Lookaside->AllocateHits;
+
+        /* Set the new depth */
+        Lookaside->Depth = ExpComputeLookasideDepth(Allocates,
+                                                    Misses,
+                                                    Lookaside->MaximumDepth,
+                                                    Lookaside->Depth);
+    }
+
+    /* Release the lock */
+    if (Lock) KeReleaseSpinLock(Lock, OldIrql);
+}
+
 INIT_FUNCTION
 VOID
 NTAPI
@@ -102,13 +242,13 @@ ExpInitLookasideLists(VOID)
     KeInitializeSpinLock(&ExpNonPagedLookasideListLock);
     KeInitializeSpinLock(&ExpPagedLookasideListLock);
 
-    /* Initialize the system lookaside lists */
-    for (i = 0; i < MAXIMUM_PROCESSORS; i++)
+    /* Initialize the global pool lookaside lists */
+    for (i = 0; i < NUMBER_POOL_LOOKASIDE_LISTS; i++)
     {
         /* Initialize the non-paged list */
         ExInitializeSystemLookasideList(&ExpSmallNPagedPoolLookasideLists[i],
                                         NonPagedPool,
-                                        (i + 1) * 8,
+                                        (i + 1) * POOL_BLOCK_SIZE,
                                         'looP',
                                         256,
                                         &ExPoolLookasideListHead);
@@ -116,7 +256,7 @@ ExpInitLookasideLists(VOID)
         /* Initialize the paged list */
         ExInitializeSystemLookasideList(&ExpSmallPagedPoolLookasideLists[i],
                                         PagedPool,
-                                        (i + 1) * 8,
+                                        (i + 1) * POOL_BLOCK_SIZE,
                                         'looP',
                                         256,
                                         &ExPoolLookasideListHead);
@@ -125,6 +265,27 @@ ExpInitLookasideLists(VOID)
 
 /* PUBLIC FUNCTIONS **********************************************************/
 
+/*
+ * @implemented
+ */
+VOID
+ExAdjustLookasideDepth(VOID)
+{
+    /* Tune the pool lists, they are never removed */
+    ExpScanLookasideList(&ExPoolLookasideListHead, NULL, TRUE);
+
+    /* Tune the system lists, they are never removed either */
+    ExpScanLookasideList(&ExSystemLookasideListHead, NULL, FALSE);
+
+    /* Tune the driver lists */
+    ExpScanLookasideList(&ExpNonPagedLookasideListHead,
+                         &ExpNonPagedLookasideListLock,
+                         FALSE);
+    ExpScanLookasideList(&ExpPagedLookasideListHead,
+                         &ExpPagedLookasideListLock,
+                         FALSE);
+}
+
 /*
  * @implemented
  */
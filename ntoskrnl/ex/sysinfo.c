@@ -735,8 +735,8 @@ QSI_DEF(SystemPerformanceInformation)
     Spi->PageReadIoCount = 0; /* FIXME */
     Spi->CacheReadCount = 0; /* FIXME */
     Spi->CacheIoCount = 0; /* FIXME */
-    Spi->DirtyPagesWriteCount = 0; /* FIXME */
-    Spi->DirtyWriteIoCount = 0; /* FIXME */
+    Spi->DirtyPagesWriteCount = MmPagingFilePagesWritten;
+    Spi->DirtyWriteIoCount = MmPagingFileWrites;
     Spi->MappedPagesWriteCount = 0; /* FIXME */
     Spi->MappedWriteIoCount = 0; /* FIXME */
 
@@ -1826,44 +1826,58 @@ QSI_DEF(SystemKernelDebuggerInformation)
     return STATUS_SUCCESS;
 }
 
-/* Class 36 - Context Switch Information */
-QSI_DEF(SystemContextSwitchInformation)
+/* Sums up the scheduler counters of all processors */
+static
+VOID
+ExpGetContextSwitchCounters(OUT PSYSTEM_CONTEXT_SWITCH_INFORMATION_EX Total)
 {
-    PSYSTEM_CONTEXT_SWITCH_INFORMATION ContextSwitchInformation =
-        (PSYSTEM_CONTEXT_SWITCH_INFORMATION)Buffer;
-    ULONG ContextSwitches;
+    PKSCHEDULER_COUNTERS Counters;
     PKPRCB Prcb;
     CHAR i;
 
-    /* Check size of a buffer, it must match our expectations */
-    if (sizeof(SYSTEM_CONTEXT_SWITCH_INFORMATION) != Size)
-        return STATUS_INFO_LENGTH_MISMATCH;
-
-    /* Calculate total value of context switches across all processors */
-    ContextSwitches = 0;
+    RtlZeroMemory(Total, sizeof(*Total));
     for (i = 0; i < KeNumberProcessors; i ++)
     {
         Prcb = KiProcessorBlock[i];
         if (Prcb)
         {
-            ContextSwitches += KeGetContextSwitches(Prcb);
+            Total->Standard.ContextSwitches += KeGetContextSwitches(Prcb);
         }
+
+        /* The scheduler counters are read without locking, they are only statistics */
+        Counters = &KiSchedulerCounters[i];
+        Total->Standard.FindAny += Counters->FindAny;
+        Total->Standard.FindLast += Counters->FindLast;
+        Total->Standard.FindIdeal += Counters->FindIdeal;
+        Total->Standard.IdleAny += Counters->IdleAny;
+        Total->Standard.IdleCurrent += Counters->IdleCurrent;
+        Total->Standard.IdleLast += Counters->IdleLast;
+        Total->Standard.IdleIdeal += Counters->IdleIdeal;
+        Total->Standard.PreemptAny += Counters->PreemptAny;
+        Total->Standard.PreemptCurrent += Counters->PreemptCurrent;
+        Total->Standard.PreemptLast += Counters->PreemptLast;
+        Total->Standard.SwitchToIdle += Counters->SwitchToIdle;
+        Total->IdleSteals += Counters->IdleSteals;
+        Total->Migrations += Counters->Migrations;
+        Total->PrcbLockAcquires += Counters->PrcbLockAcquires;
+        Total->PrcbLockContention += Counters->PrcbLockContention;
+        Total->PrcbLockHoldCycles += Counters->PrcbLockHoldCycles;
     }
+}
+
+/* Class 36 - Context Switch Information */
+QSI_DEF(SystemContextSwitchInformation)
+{
+    PSYSTEM_CONTEXT_SWITCH_INFORMATION ContextSwitchInformation =
+        (PSYSTEM_CONTEXT_SWITCH_INFORMATION)Buffer;
+    SYSTEM_CONTEXT_SWITCH_INFORMATION_EX Total;
 
-    ContextSwitchInformation->ContextSwitches = ContextSwitches;
+    /* Check size of a buffer, it must match our expectations */
+    if (sizeof(SYSTEM_CONTEXT_SWITCH_INFORMATION) != Size)
+        return STATUS_INFO_LENGTH_MISMATCH;
 
-    /* FIXME */
-    ContextSwitchInformation->FindAny = 0;
-    ContextSwitchInformation->FindLast = 0;
-    ContextSwitchInformation->FindIdeal = 0;
-    ContextSwitchInformation->IdleAny = 0;
-    ContextSwitchInformation->IdleCurrent = 0;
-    ContextSwitchInformation->IdleLast = 0;
-    ContextSwitchInformation->IdleIdeal = 0;
-    ContextSwitchInformation->PreemptAny = 0;
-    ContextSwitchInformation->PreemptCurrent = 0;
-    ContextSwitchInformation->PreemptLast = 0;
-    ContextSwitchInformation->SwitchToIdle = 0;
+    ExpGetContextSwitchCounters(&Total);
+    *ContextSwitchInformation = Total.Standard;
 
     return STATUS_SUCCESS;
 }
@@ -2815,6 +2829,63 @@ QSI_DEF(SystemFirmwareTableInformation)
     return Status;
 }
 
+/* ReactOS Class - Work Queue Information */
+QSI_DEF(SystemRosWorkQueueInformation)
+{
+    PSYSTEM_WORK_QUEUE_INFORMATION QueueInformation =
+        (PSYSTEM_WORK_QUEUE_INFORMATION)Buffer;
+    PEX_WORK_QUEUE Queue;
+    PEX_WORK_QUEUE_STATISTICS Statistics;
+    ULONG i, j;
+
+    /* One entry per queue */
+    *ReqSize = MaximumWorkQueue * sizeof(SYSTEM_WORK_QUEUE_INFORMATION);
+    if (Size < *ReqSize)
+    {
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    for (i = 0; i < MaximumWorkQueue; i++)
+    {
+        Queue = &ExWorkerQueue[i];
+        Statistics = &ExpWorkQueueStatistics[i];
+
+        /* Current state of the queue */
+        QueueInformation[i].QueueType = i;
+        QueueInformation[i].QueueDepth = KeReadStateQueue(&Queue->WorkerQueue);
+        QueueInformation[i].WorkerCount = Queue->Info.WorkerCount;
+        QueueInformation[i].ActiveWorkers = Queue->WorkerQueue.CurrentCount;
+        QueueInformation[i].DynamicWorkers = Queue->DynamicThreadCount;
+        QueueInformation[i].WorkItemsProcessed = Queue->WorkItemsProcessed;
+
+        /* What the balance manager measured over the last second */
+        QueueInformation[i].ItemsPerSecond = Statistics->ItemsPerSecond;
+        QueueInformation[i].AverageWaitTime = Statistics->AverageWaitTime;
+        QueueInformation[i].MaximumWaitTime = Statistics->MaximumWaitTime;
+
+        /* And the wait times since boot */
+        for (j = 0; j < SYSTEM_WORK_QUEUE_WAIT_BUCKETS; j++)
+        {
+            QueueInformation[i].WaitTimeHistogram[j] = Statistics->WaitTimeHistogram[j];
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/* ReactOS Class - Context Switch Information */
+QSI_DEF(SystemRosContextSwitchInformation)
+{
+    *ReqSize = sizeof(SYSTEM_CONTEXT_SWITCH_INFORMATION_EX);
+    if (Size < sizeof(SYSTEM_CONTEXT_SWITCH_INFORMATION_EX))
+    {
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    ExpGetContextSwitchCounters((PSYSTEM_CONTEXT_SWITCH_INFORMATION_EX)Buffer);
+    return STATUS_SUCCESS;
+}
+
 /* Query/Set Calls Table */
 typedef
 struct _QSSI_CALLS
@@ -2916,9 +2987,37 @@ CallQS [] =
     SI_QX(SystemFirmwareTableInformation),
 };
 
+/* ReactOS-private classes, see rossysinfo.h */
+static
+QSSI_CALLS
+CallQSRos [] =
+{
+    SI_QX(SystemRosWorkQueueInformation),
+    SI_QX(SystemRosContextSwitchInformation),
+};
+
 C_ASSERT(SystemBasicInformation == 0);
 #define MIN_SYSTEM_INFO_CLASS (SystemBasicInformation)
 #define MAX_SYSTEM_INFO_CLASS (sizeof(CallQS) / sizeof(CallQS[0]))
+C_ASSERT(RTL_NUMBER_OF(CallQSRos) == MaxSystemRosInfoClass - SystemRosInformationBase);
+
+static
+const QSSI_CALLS *
+ExpGetSystemInformationCalls(
+    _In_ SYSTEM_INFORMATION_CLASS SystemInformationClass)
+{
+    ULONG Class = (ULONG)SystemInformationClass;
+
+    /* Documented classes first */
+    if (Class < MAX_SYSTEM_INFO_CLASS)
+        return &CallQS[Class];
+
+    /* Then our own ones, which live far above them */
+    if (Class >= SystemRosInformationBase && Class < MaxSystemRosInfoClass)
+        return &CallQSRos[Class - SystemRosInformationBase];
+
+    return NULL;
+}
 
 /*
  * @implemented
@@ -2936,6 +3035,7 @@ NtQuerySystemInformation(
     ULONG ResultLength = 0;
     ULONG Alignment = TYPE_ALIGNMENT(ULONG);
     NTSTATUS FStatus = STATUS_NOT_IMPLEMENTED;
+    const QSSI_CALLS *Calls;
 
     PAGED_CODE();
 
@@ -2947,8 +3047,8 @@ NtQuerySystemInformation(
         /*
          * Check if the request is valid.
          */
-        if (SystemInformationClass < MIN_SYSTEM_INFO_CLASS ||
-            SystemInformationClass >= MAX_SYSTEM_INFO_CLASS)
+        Calls = ExpGetSystemInformationCalls(SystemInformationClass);
+        if (Calls == NULL)
         {
             _SEH2_YIELD(return STATUS_INVALID_INFO_CLASS);
         }
@@ -2972,21 +3072,21 @@ NtQuerySystemInformation(
         /*
          * Check if the request is valid.
          */
-        if (SystemInformationClass < MIN_SYSTEM_INFO_CLASS ||
-            SystemInformationClass >= MAX_SYSTEM_INFO_CLASS)
+        Calls = ExpGetSystemInformationCalls(SystemInformationClass);
+        if (Calls == NULL)
         {
             _SEH2_YIELD(return STATUS_INVALID_INFO_CLASS);
         }
 #endif
 
-        if (NULL != CallQS [SystemInformationClass].Query)
+        if (NULL != Calls->Query)
         {
             /*
              * Hand the request to a subhandler.
              */
-            FStatus = CallQS [SystemInformationClass].Query(SystemInformation,
-                                                            Length,
-                                                            &ResultLength);
+            FStatus = Calls->Query(SystemInformation,
+                                   Length,
+                                   &ResultLength);
 
             /* Save the result length to the caller */
             if (UnsafeResultLength)
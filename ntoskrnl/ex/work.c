@@ -26,6 +26,16 @@
 /* Magic flag for dynamic worker threads */
 #define EX_DYNAMIC_WORK_THREAD                      0x80000000
 
+/* Limits and timings of the dynamic worker threads */
+#define EX_MAXIMUM_DYNAMIC_THREADS                  16
+#define EX_DYNAMIC_THREAD_IDLE_SECONDS              60
+
+/* In microseconds, measured with the interrupt time, so at least a tick */
+#define EX_WORKER_GROW_WAIT_TIME                    5000
+
+/* How far ahead a worker looks for the stamp of the item it removed */
+#define EX_WORK_QUEUE_LOOKAHEAD                     8
+
 /* Worker thread priority increments (added to base priority) */
 #define EX_HYPERCRITICAL_QUEUE_PRIORITY_INCREMENT   7
 #define EX_CRITICAL_QUEUE_PRIORITY_INCREMENT        5
@@ -34,6 +44,9 @@
 /* The actual worker queue array */
 EX_WORK_QUEUE ExWorkerQueue[MaximumWorkQueue];
 
+/* Wait time and throughput accounting for each queue */
+EX_WORK_QUEUE_STATISTICS ExpWorkQueueStatistics[MaximumWorkQueue];
+
 /* Accounting of the total threads and registry hacked threads */
 ULONG ExCriticalWorkerThreads;
 ULONG ExDelayedWorkerThreads;
@@ -55,6 +68,178 @@ PETHREAD ExpLastWorkerThread;
 
 /* PRIVATE FUNCTIONS *********************************************************/
 
+FORCEINLINE
+ULONG
+ExpTimeToMicroseconds(IN LONGLONG Delta)
+{
+    /* Interrupt time is in 100ns units, clamp it so it fits the statistics */
+    if (Delta <= 0) return 0;
+    return (ULONG)min(Delta / 10, MAXLONG);
+}
+
+/*++
+ * @name ExpStampWorkItem
+ *
+ *     The ExpStampWorkItem routine records when a work item was queued.
+ *
+ * @param Statistics
+ *        Statistics of the queue the item is about to be inserted in.
+ *
+ * @param WorkItem
+ *        The work item.
+ *
+ * @return None.
+ *
+ * @remarks Must be called before the item is inserted, so that it is always
+ *          stamped before a worker can remove it.
+ *
+ *--*/
+static
+VOID
+ExpStampWorkItem(IN PEX_WORK_QUEUE_STATISTICS Statistics,
+                 IN PWORK_QUEUE_ITEM WorkItem)
+{
+    PEX_WORK_QUEUE_STAMP Stamp;
+    LONG Sequence;
+
+    /* Take the next slot in queueing order */
+    Sequence = InterlockedIncrement(&Statistics->QueueSequence) - 1;
+    Stamp = &Statistics->Stamp[(ULONG)Sequence % EX_WORK_QUEUE_STAMPS];
+
+    /* Write the time first, the item pointer is what readers look for */
+    Stamp->Time = KeQueryInterruptTime();
+    InterlockedExchangePointer(&Stamp->Item, WorkItem);
+}
+
+/*++
+ * @name ExpAccountWorkItemWait
+ *
+ *     The ExpAccountWorkItemWait routine measures how long a work item that
+ *     was just removed from its queue has been waiting there.
+ *
+ * @param Statistics
+ *        Statistics of the queue the item was removed from.
+ *
+ * @param WorkItem
+ *        The work item.
+ *
+ * @return None.
+ *
+ * @remarks Items inserted without going through ExQueueWorkItem have no
+ *          stamp and are not accounted. Neither are items whose stamp was
+ *          overwritten because the queue got deeper than the stamp ring.
+ *
+ *--*/
+static
+VOID
+ExpAccountWorkItemWait(IN PEX_WORK_QUEUE_STATISTICS Statistics,
+                       IN PWORK_QUEUE_ITEM WorkItem)
+{
+    PEX_WORK_QUEUE_STAMP Stamp;
+    LONG Sequence, Last, Current, i;
+    LONGLONG Now, Time;
+    ULONG Wait, Milliseconds, Bucket;
+    LONG Maximum;
+
+    /* Get the time first */
+    Now = KeQueryInterruptTime();
+
+    /* Skip the stamps that were overwritten if the queue got too deep */
+    Sequence = Statistics->RemoveSequence;
+    Last = Statistics->QueueSequence;
+    if ((Last - Sequence) > EX_WORK_QUEUE_STAMPS) Sequence = Last - EX_WORK_QUEUE_STAMPS;
+
+    /* Workers can race each other, so the stamp might be a little further */
+    for (i = 0; (i < EX_WORK_QUEUE_LOOKAHEAD) && ((Sequence + i) != Last); i++)
+    {
+        Stamp = &Statistics->Stamp[(ULONG)(Sequence + i) % EX_WORK_QUEUE_STAMPS];
+        if (Stamp->Item != WorkItem) continue;
+
+        /* Found it, read the time before releasing the slot */
+        Time = Stamp->Time;
+        if (InterlockedCompareExchangePointer(&Stamp->Item, NULL, WorkItem) != WorkItem) return;
+
+        /* Move the remove sequence past it, unless someone went further */
+        do
+        {
+            Current = Statistics->RemoveSequence;
+            if ((Current - (Sequence + i + 1)) >= 0) break;
+        } while (InterlockedCompareExchange(&Statistics->RemoveSequence,
+                                           Sequence + i + 1,
+                                           Current) != Current);
+
+        /* Convert the wait to microseconds */
+        Wait = ExpTimeToMicroseconds(Now - Time);
+
+        /* Buckets are below 1ms, then doubling up to 256ms and above */
+        Milliseconds = Wait / 1000;
+        if (Milliseconds)
+        {
+            BitScanReverse(&Bucket, Milliseconds);
+            Bucket = min(Bucket + 1, SYSTEM_WORK_QUEUE_WAIT_BUCKETS - 1);
+        }
+        else
+        {
+            Bucket = 0;
+        }
+        InterlockedIncrement(&Statistics->WaitTimeHistogram[Bucket]);
+
+        /* Accumulate for the balance manager */
+        InterlockedExchangeAdd(&Statistics->PassWaitTime, (LONG)Wait);
+        InterlockedIncrement(&Statistics->PassWaitCount);
+        do
+        {
+            Maximum = Statistics->PassMaximumWait;
+            if ((LONG)Wait <= Maximum) break;
+        } while (InterlockedCompareExchange(&Statistics->PassMaximumWait,
+                                           (LONG)Wait,
+                                           Maximum) != Maximum);
+        return;
+    }
+}
+
+/*++
+ * @name ExpGetQueueHeadWait
+ *
+ *     The ExpGetQueueHeadWait routine returns how long the oldest item still
+ *     on a queue has been waiting, in microseconds.
+ *
+ * @param Statistics
+ *        Statistics of the queue.
+ *
+ * @param Now
+ *        Current interrupt time.
+ *
+ * @return The wait time, or 0 if it cannot be told.
+ *
+ * @remarks The result is a hint. The stamps are read without synchronizing
+ *          with the workers.
+ *
+ *--*/
+static
+ULONG
+ExpGetQueueHeadWait(IN PEX_WORK_QUEUE_STATISTICS Statistics,
+                    IN LONGLONG Now)
+{
+    PEX_WORK_QUEUE_STAMP Stamp;
+    LONG Sequence, Last;
+    LONGLONG Time;
+
+    /* The oldest queued item is the next one the workers will remove */
+    Sequence = Statistics->RemoveSequence;
+    Last = Statistics->QueueSequence;
+    if (Sequence == Last) return 0;
+    if ((Last - Sequence) > EX_WORK_QUEUE_STAMPS) Sequence = Last - EX_WORK_QUEUE_STAMPS;
+
+    /* Check that it's still there */
+    Stamp = &Statistics->Stamp[(ULONG)Sequence % EX_WORK_QUEUE_STAMPS];
+    Time = Stamp->Time;
+    if (!Stamp->Item) return 0;
+
+    /* Convert to microseconds */
+    return ExpTimeToMicroseconds(Now - Time);
+}
+
 /*++
  * @name ExpWorkerThreadEntryPoint
  *
@@ -67,8 +252,8 @@ PETHREAD ExpLastWorkerThread;
  *
  * @return None.
  *
- * @remarks A dynamic thread can timeout after 10 minutes of waiting on a queue
- *          while a static thread will never timeout.
+ * @remarks A dynamic thread times out after a minute without work from its
+ *          queue while a static thread will never timeout.
  *
  *          Worker threads must return at IRQL == PASSIVE_LEVEL, must not have
  *          active impersonation info, and must not have disabled APCs.
@@ -90,12 +275,13 @@ ExpWorkerThreadEntryPoint(IN PVOID Context)
     PETHREAD Thread = PsGetCurrentThread();
     KPROCESSOR_MODE WaitMode;
     EX_QUEUE_WORKER_INFO OldValue, NewValue;
+    PEX_WORK_QUEUE_STATISTICS Statistics;
 
     /* Check if this is a dyamic thread */
     if ((ULONG_PTR)Context & EX_DYNAMIC_WORK_THREAD)
     {
-        /* It is, which means we will eventually time out after 10 minutes */
-        Timeout.QuadPart = Int32x32To64(10, -10000000 * 60);
+        /* It is, which means we will time out once the queue has calmed down */
+        Timeout.QuadPart = Int32x32To64(EX_DYNAMIC_THREAD_IDLE_SECONDS, -10000000);
         TimeoutPointer = &Timeout;
     }
 
@@ -103,6 +289,7 @@ ExpWorkerThreadEntryPoint(IN PVOID Context)
     WorkQueueType = (WORK_QUEUE_TYPE)((ULONG_PTR)Context &
                                       ~EX_DYNAMIC_WORK_THREAD);
     WorkQueue = &ExWorkerQueue[WorkQueueType];
+    Statistics = &ExpWorkQueueStatistics[WorkQueueType];
 
     /* Select the wait mode */
     WaitMode = (UCHAR)WorkQueue->Info.WaitMode;
@@ -152,8 +339,9 @@ ProcessLoop:
         /* Increment Processed Work Items */
         InterlockedIncrement((PLONG)&WorkQueue->WorkItemsProcessed);
 
-        /* Get the Work Item */
+        /* Get the Work Item and account for the time it spent queued */
         WorkItem = CONTAINING_RECORD(QueueEntry, WORK_QUEUE_ITEM, List);
+        ExpAccountWorkItemWait(Statistics, WorkItem);
 
         /* Make sure nobody is trying to play smart with us */
         ASSERT((ULONG_PTR)WorkItem->WorkerRoutine > MmUserProbeAddress);
@@ -341,12 +529,12 @@ ExpDetectWorkerThreadDeadlock(VOID)
     {
         /* Get the queue */
         Queue = &ExWorkerQueue[i];
-        ASSERT(Queue->DynamicThreadCount <= 16);
+        ASSERT(Queue->DynamicThreadCount <= EX_MAXIMUM_DYNAMIC_THREADS);
 
         /* Check if stuff is on the queue that still is unprocessed */
         if ((Queue->QueueDepthLastPass) &&
             (Queue->WorkItemsProcessed == Queue->WorkItemsProcessedLastPass) &&
-            (Queue->DynamicThreadCount < 16))
+            (Queue->DynamicThreadCount < EX_MAXIMUM_DYNAMIC_THREADS))
         {
             /* Stuff is still on the queue and nobody did anything about it */
             DPRINT1("EX: Work Queue Deadlock detected: %lu\n", i);
@@ -360,6 +548,52 @@ ExpDetectWorkerThreadDeadlock(VOID)
     }
 }
 
+/*++
+ * @name ExpUpdateWorkQueueStatistics
+ *
+ *     The ExpUpdateWorkQueueStatistics routine publishes the throughput and
+ *     wait times measured on every queue since the previous call.
+ *
+ * @param None
+ *
+ * @return None.
+ *
+ * @remarks Called by the balance manager about once a second.
+ *
+ *--*/
+VOID
+NTAPI
+ExpUpdateWorkQueueStatistics(VOID)
+{
+    ULONG i, Processed, Count;
+    LONGLONG Now, Elapsed;
+    PEX_WORK_QUEUE_STATISTICS Statistics;
+
+    /* Loop the 3 queues */
+    Now = KeQueryInterruptTime();
+    for (i = 0; i < MaximumWorkQueue; i++)
+    {
+        /* Get the statistics and the time since the last pass */
+        Statistics = &ExpWorkQueueStatistics[i];
+        Elapsed = Now - Statistics->LastPassTime;
+        if (Elapsed <= 0) continue;
+
+        /* Compute the throughput */
+        Processed = ExWorkerQueue[i].WorkItemsProcessed;
+        Statistics->ItemsPerSecond = (ULONG)((Processed - Statistics->ProcessedLastPass) *
+                                             10000000 / Elapsed);
+        Statistics->ProcessedLastPass = Processed;
+        Statistics->LastPassTime = Now;
+
+        /* And the wait times, starting over for the next pass */
+        Count = InterlockedExchange(&Statistics->PassWaitCount, 0);
+        Statistics->AverageWaitTime =
+            Count ? (ULONG)InterlockedExchange(&Statistics->PassWaitTime, 0) / Count : 0;
+        Statistics->MaximumWaitTime =
+            (ULONG)InterlockedExchange(&Statistics->PassMaximumWait, 0);
+    }
+}
+
 /*++
  * @name ExpCheckDynamicThreadCount
  *
@@ -368,20 +602,27 @@ ExpDetectWorkerThreadDeadlock(VOID)
  *
  * @param None
  *
- * @return None.
+ * @return TRUE if a queue is building up and should be checked again soon.
  *
- * @remarks The algorithm for deciding if a new thread must be created is
- *          documented in the ExQueueWorkItem routine.
+ * @remarks A queue gets a new thread when it supports dynamic threads, has
+ *          items waiting while fewer of its workers are running than there
+ *          are processors, and the oldest of those items has been waiting
+ *          for more than EX_WORKER_GROW_WAIT_TIME. Short bursts that the
+ *          existing workers drain quickly thus don't create threads.
  *
  *--*/
-VOID
+BOOLEAN
 NTAPI
 ExpCheckDynamicThreadCount(VOID)
 {
-    ULONG i;
+    ULONG i, Wait;
     PEX_WORK_QUEUE Queue;
+    PEX_WORK_QUEUE_STATISTICS Statistics;
+    LONGLONG Now;
+    BOOLEAN Recheck = FALSE;
 
     /* Loop the 3 queues */
+    Now = KeQueryInterruptTime();
     for (i = 0; i < MaximumWorkQueue; i++)
     {
         /* Get the queue */
@@ -392,13 +633,30 @@ ExpCheckDynamicThreadCount(VOID)
             (!IsListEmpty(&Queue->WorkerQueue.EntryListHead)) &&
             (Queue->WorkerQueue.CurrentCount <
              Queue->WorkerQueue.MaximumCount) &&
-            (Queue->DynamicThreadCount < 16))
+            (Queue->DynamicThreadCount < EX_MAXIMUM_DYNAMIC_THREADS))
         {
-            /* Create a new thread */
-            DPRINT1("EX: Creating new dynamic thread as requested\n");
-            ExpCreateWorkerThread(i, TRUE);
+            /*
+             * Only add a thread once items have been waiting long enough,
+             * counting from the last thread we added so that it gets a
+             * chance to start draining the queue first.
+             */
+            Statistics = &ExpWorkQueueStatistics[i];
+            Wait = min(ExpGetQueueHeadWait(Statistics, Now),
+                       ExpTimeToMicroseconds(Now - Statistics->LastGrowTime));
+            if (Wait >= EX_WORKER_GROW_WAIT_TIME)
+            {
+                /* Create a new thread */
+                DPRINT("EX: Creating new dynamic thread for queue %lu\n", i);
+                ExpCreateWorkerThread(i, TRUE);
+                Statistics->LastGrowTime = Now;
+            }
+
+            /* Look at it again soon either way */
+            Recheck = TRUE;
         }
     }
+
+    return Recheck;
 }
 
 /*++
@@ -424,9 +682,11 @@ NTAPI
 ExpWorkerThreadBalanceManager(IN PVOID Context)
 {
     KTIMER Timer;
-    LARGE_INTEGER Timeout;
+    LARGE_INTEGER Timeout, RecheckTimeout;
+    ULONGLONG CurrentTime, NextPassTime;
     NTSTATUS Status;
     PVOID WaitEvents[3];
+    BOOLEAN Recheck = FALSE;
     PAGED_CODE();
     UNREFERENCED_PARAMETER(Context);
 
@@ -434,9 +694,11 @@ ExpWorkerThreadBalanceManager(IN PVOID Context)
     KeSetBasePriorityThread(KeGetCurrentThread(),
                             EX_CRITICAL_QUEUE_PRIORITY_INCREMENT + 1);
 
-    /* Setup the timer */
+    /* Setup the timer, it fires sooner while a queue is building up */
     KeInitializeTimer(&Timer);
     Timeout.QuadPart = Int32x32To64(-1, 10000000);
+    RecheckTimeout.QuadPart = Int32x32To64(-EX_WORKER_GROW_WAIT_TIME, 10);
+    NextPassTime = KeQueryInterruptTime() + 10000000;
 
     /* We'll wait on the periodic timer and also the emergency event */
     WaitEvents[0] = &Timer;
@@ -447,7 +709,7 @@ ExpWorkerThreadBalanceManager(IN PVOID Context)
     for (;;)
     {
         /* Wait for the timer */
-        KeSetTimer(&Timer, Timeout, NULL);
+        KeSetTimer(&Timer, Recheck ? RecheckTimeout : Timeout, NULL);
         Status = KeWaitForMultipleObjects(3,
                                           WaitEvents,
                                           WaitAny,
@@ -456,15 +718,20 @@ ExpWorkerThreadBalanceManager(IN PVOID Context)
                                           FALSE,
                                           NULL,
                                           NULL);
-        if (Status == 0)
+        if ((Status == 0) || (Status == 1))
         {
-            /* Our timer expired. Check for deadlocks */
-            ExpDetectWorkerThreadDeadlock();
-        }
-        else if (Status == 1)
-        {
-            /* Someone notified us, verify if we should create a new thread */
-            ExpCheckDynamicThreadCount();
+            /* Do the periodic work once a second, however we were woken up */
+            CurrentTime = KeQueryInterruptTime();
+            if (CurrentTime >= NextPassTime)
+            {
+                /* Publish the statistics and check for deadlocks */
+                NextPassTime = CurrentTime + 10000000;
+                ExpUpdateWorkQueueStatistics();
+                ExpDetectWorkerThreadDeadlock();
+            }
+
+            /* Verify if we should create a new thread */
+            Recheck = ExpCheckDynamicThreadCount();
         }
         else if (Status == 2)
         {
@@ -553,8 +820,15 @@ ExpInitializeWorkerThreads(VOID)
         KeInitializeQueue(&ExWorkerQueue[WorkQueueType].WorkerQueue, 0);
     }
 
-    /* Dynamic threads are only used for the critical queue */
+    /* Start measuring the queues */
+    for (WorkQueueType = 0; WorkQueueType < MaximumWorkQueue; WorkQueueType++)
+    {
+        ExpWorkQueueStatistics[WorkQueueType].LastPassTime = KeQueryInterruptTime();
+    }
+
+    /* Dynamic threads are used for the critical and delayed queues */
     ExWorkerQueue[CriticalWorkQueue].Info.MakeThreadsAsNecessary = TRUE;
+    ExWorkerQueue[DelayedWorkQueue].Info.MakeThreadsAsNecessary = TRUE;
 
     /* Initialize the balance set manager events */
     KeInitializeEvent(&ExpThreadSetManagerEvent, SynchronizationEvent, FALSE);
@@ -732,27 +1006,30 @@ ExQueueWorkItem(IN PWORK_QUEUE_ITEM WorkItem,
                      0);
     }
 
-    /* Insert the Queue */
+    /* Stamp the item and insert the Queue */
+    ExpStampWorkItem(&ExpWorkQueueStatistics[QueueType], WorkItem);
     KeInsertQueue(&WorkQueue->WorkerQueue, &WorkItem->List);
     ASSERT(!WorkQueue->Info.QueueDisabled);
 
     /*
-     * Check if we need a new thread. Our decision is as follows:
+     * Check if we might need a new thread. Our decision is as follows:
      *  - This queue type must support Dynamic Threads (duh!)
      *  - It actually has to have unprocessed items
      *  - We have CPUs which could be handling another thread
      *  - We haven't abused our usage of dynamic threads.
+     * The balance manager then waits for the items to have been queued for
+     * long enough before it really creates one.
      */
     if ((WorkQueue->Info.MakeThreadsAsNecessary) &&
         (!IsListEmpty(&WorkQueue->WorkerQueue.EntryListHead)) &&
         (WorkQueue->WorkerQueue.CurrentCount <
          WorkQueue->WorkerQueue.MaximumCount) &&
-        (WorkQueue->DynamicThreadCount < 16))
+        (WorkQueue->DynamicThreadCount < EX_MAXIMUM_DYNAMIC_THREADS))
     {
         /* Let the balance manager know about it */
-        DPRINT1("Requesting a new thread. CurrentCount: %lu. MaxCount: %lu\n",
-                WorkQueue->WorkerQueue.CurrentCount,
-                WorkQueue->WorkerQueue.MaximumCount);
+        DPRINT("Requesting a new thread. CurrentCount: %lu. MaxCount: %lu\n",
+               WorkQueue->WorkerQueue.CurrentCount,
+               WorkQueue->WorkerQueue.MaximumCount);
         KeSetEvent(&ExpThreadSetManagerEvent, 0, FALSE);
     }
 }
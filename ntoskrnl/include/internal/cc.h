@@ -188,6 +188,11 @@ typedef struct _ROS_SHARED_CACHE_MAP
 
     /* ROS specific */
     LIST_ENTRY CacheMapVacbListHead;
+    /* Sparse index of the VACBs, by FileOffset / VACB_MAPPING_GRANULARITY.
+     * Each of the VacbIndexSize slots points to a leaf of
+     * VACB_INDEX_LEAF_ENTRIES VACB pointers, or is NULL. */
+    struct _ROS_VACB ***VacbIndex;
+    ULONG VacbIndexSize;
     BOOLEAN PinAccess;
     KSPIN_LOCK CacheMapLock;
 #if DBG
@@ -195,6 +200,8 @@ typedef struct _ROS_SHARED_CACHE_MAP
 #endif
 } ROS_SHARED_CACHE_MAP, *PROS_SHARED_CACHE_MAP;
 
+#define VACB_INDEX_LEAF_ENTRIES (PAGE_SIZE / sizeof(PVOID))
+
 #define READAHEAD_DISABLED 0x1
 #define WRITEBEHIND_DISABLED 0x2
 
@@ -360,6 +367,12 @@ CcRosLookupVacb(
     LONGLONG FileOffset
 );
 
+VOID
+NTAPI
+CcRosRemoveVacbFromCacheMap(
+    PROS_VACB Vacb
+);
+
 VOID
 NTAPI
 CcInitCacheZeroPage(VOID);
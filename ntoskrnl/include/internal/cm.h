@@ -77,6 +77,7 @@
 //
 #define CMP_SECURITY_HASH_LISTS                         64
 #define CMP_MAX_CALLBACKS                               100
+#define CMP_SUBKEY_LEVELS_DEPTH_LIMIT                   32
 
 //
 // Hashing Constants
@@ -157,6 +158,15 @@ typedef struct _CM_KEY_HASH_TABLE_ENTRY
     PCM_KEY_HASH Entry;
 } CM_KEY_HASH_TABLE_ENTRY, *PCM_KEY_HASH_TABLE_ENTRY;
 
+//
+// Hash Stack used by the Parse Routine to lookup the KCB cache
+//
+typedef struct _CM_HASH_CACHE_STACK
+{
+    UNICODE_STRING NameOfKey;
+    ULONG ConvKey;
+} CM_HASH_CACHE_STACK, *PCM_HASH_CACHE_STACK;
+
 //
 // Name Hash
 //
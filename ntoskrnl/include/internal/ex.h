@@ -67,6 +67,52 @@ extern ULONG_PTR ExpDebuggerPageIn;
 VOID NTAPI ExpDebuggerWorker(IN PVOID Context);
 // #endif /* _WINKD_ */
 
+/*
+ * Work queue statistics (see work.c). Items are stamped when queued and the
+ * stamps are kept in a ring in queueing order, which is also the order the
+ * workers remove them in, so the wait time of each item can be measured
+ * without touching the WORK_QUEUE_ITEM layout.
+ */
+#define EX_WORK_QUEUE_STAMPS 256
+
+typedef struct _EX_WORK_QUEUE_STAMP
+{
+    PVOID Item;
+    LONGLONG Time;
+} EX_WORK_QUEUE_STAMP, *PEX_WORK_QUEUE_STAMP;
+
+typedef struct _EX_WORK_QUEUE_STATISTICS
+{
+    LONG QueueSequence;
+    LONG RemoveSequence;
+    EX_WORK_QUEUE_STAMP Stamp[EX_WORK_QUEUE_STAMPS];
+    LONG WaitTimeHistogram[SYSTEM_WORK_QUEUE_WAIT_BUCKETS];
+
+    /* Accumulated by the workers since the last balance pass, in us */
+    LONG PassWaitTime;
+    LONG PassWaitCount;
+    LONG PassMaximumWait;
+
+    /* Published by the balance manager on every pass */
+    ULONG ItemsPerSecond;
+    ULONG AverageWaitTime;
+    ULONG MaximumWaitTime;
+    ULONG ProcessedLastPass;
+    LONGLONG LastPassTime;
+
+    /* When the balance manager last added a dynamic thread */
+    LONGLONG LastGrowTime;
+} EX_WORK_QUEUE_STATISTICS, *PEX_WORK_QUEUE_STATISTICS;
+
+extern EX_WORK_QUEUE ExWorkerQueue[MaximumWorkQueue];
+extern EX_WORK_QUEUE_STATISTICS ExpWorkQueueStatistics[MaximumWorkQueue];
+
+#ifdef _WIN64
+#define POOL_BLOCK_SIZE 16
+#else
+#define POOL_BLOCK_SIZE  8
+#endif
+
 #ifdef _WIN64
 #define HANDLE_LOW_BITS (PAGE_SHIFT - 4)
 #define HANDLE_HIGH_BITS (PAGE_SHIFT - 3)
@@ -155,6 +201,31 @@ typedef struct _HARDERROR_USER_PARAMETERS
 #define MAX_MID_INDEX       (MID_LEVEL_ENTRIES * LOW_LEVEL_ENTRIES)
 #define MAX_HIGH_INDEX      (MID_LEVEL_ENTRIES * MID_LEVEL_ENTRIES * LOW_LEVEL_ENTRIES)
 
+//
+// Per-processor cache of free handles, one cache line for each processor
+//
+#define HANDLE_CACHE_SIZE       64
+#define HANDLE_CACHE_ENTRIES    (HANDLE_CACHE_SIZE / sizeof(ULONG))
+
+typedef struct _HANDLE_TABLE_CACHE
+{
+    ULONG Handle[HANDLE_CACHE_ENTRIES];
+} HANDLE_TABLE_CACHE, *PHANDLE_TABLE_CACHE;
+
+typedef struct _HANDLE_TABLE_FREE_CACHE
+{
+    union
+    {
+        struct
+        {
+            PVOID Allocation;
+            ULONG ProcessorCount;
+        };
+        HANDLE_TABLE_CACHE Header;
+    };
+    HANDLE_TABLE_CACHE Processor[ANYSIZE_ARRAY];
+} HANDLE_TABLE_FREE_CACHE, *PHANDLE_TABLE_FREE_CACHE;
+
 #define ExpChangeRundown(x, y, z) (ULONG_PTR)InterlockedCompareExchangePointer(&x->Ptr, (PVOID)y, (PVOID)z)
 #define ExpChangePushlock(x, y, z) InterlockedCompareExchangePointer((PVOID*)x, (PVOID)y, (PVOID)z)
 #define ExpSetRundown(x, y) InterlockedExchangePointer(&x->Ptr, (PVOID)y)
@@ -302,6 +373,11 @@ VOID
 NTAPI
 ExInitPoolLookasidePointers(VOID);
 
+INIT_FUNCTION
+VOID
+NTAPI
+ExpAllocatePoolLookasideLists(VOID);
+
 /* Callback Functions ********************************************************/
 
 VOID
@@ -536,6 +536,13 @@ KiExitV86Mode(
     IN PKTRAP_FRAME TrapFrame
 );
 
+VOID
+FASTCALL
+KiZeroPagesNonTemporal(
+    IN PVOID Address,
+    IN ULONG Size
+);
+
 DECLSPEC_NORETURN
 VOID
 NTAPI
@@ -78,6 +78,33 @@ typedef struct _KNMI_HANDLER_CALLBACK
     PVOID Handle;
 } KNMI_HANDLER_CALLBACK, *PKNMI_HANDLER_CALLBACK;
 
+//
+// Scheduler event counters. The KPRCB layout is fixed, so these live in a
+// separate array indexed by processor number, and the set for a processor
+// is only modified while holding that processor's PRCB lock. The PRCB lock
+// statistics are only kept by debug builds.
+//
+typedef struct DECLSPEC_CACHEALIGN _KSCHEDULER_COUNTERS
+{
+    ULONG FindAny;
+    ULONG FindLast;
+    ULONG FindIdeal;
+    ULONG IdleAny;
+    ULONG IdleCurrent;
+    ULONG IdleLast;
+    ULONG IdleIdeal;
+    ULONG PreemptAny;
+    ULONG PreemptCurrent;
+    ULONG PreemptLast;
+    ULONG SwitchToIdle;
+    ULONG IdleSteals;
+    ULONG Migrations;
+    ULONG PrcbLockAcquires;
+    ULONG PrcbLockContention;
+    ULONG64 PrcbLockHoldCycles;
+    ULONG64 PrcbLockAcquireTime;
+} KSCHEDULER_COUNTERS, *PKSCHEDULER_COUNTERS;
+
 typedef PCHAR
 (NTAPI *PKE_BUGCHECK_UNICODE_TO_ANSI)(
     IN PUNICODE_STRING Unicode,
@@ -134,6 +161,7 @@ extern KEVENT KiSwapEvent;
 extern PKPRCB KiProcessorBlock[];
 extern ULONG KiMask32Array[MAXIMUM_PRIORITY];
 extern ULONG_PTR KiIdleSummary;
+extern KSCHEDULER_COUNTERS KiSchedulerCounters[MAXIMUM_PROCESSORS];
 extern PVOID KeUserApcDispatcher;
 extern PVOID KeUserCallbackDispatcher;
 extern PVOID KeUserExceptionDispatcher;
@@ -645,6 +673,17 @@ KiInsertQueue(
     BOOLEAN Head
 );
 
+ULONG
+NTAPI
+KeRemoveQueueEx(
+    IN PKQUEUE Queue,
+    IN KPROCESSOR_MODE WaitMode,
+    IN BOOLEAN Alertable,
+    IN PLARGE_INTEGER Timeout OPTIONAL,
+    OUT PLIST_ENTRY *EntryArray,
+    IN ULONG Count
+);
+
 VOID
 NTAPI
 KiTimerExpiration(
@@ -815,6 +854,11 @@ FASTCALL
 KeZeroPages(IN PVOID Address,
             IN ULONG Size);
 
+VOID
+FASTCALL
+KeZeroPagesFromIdleThread(IN PVOID Address,
+                          IN ULONG Size);
+
 BOOLEAN
 FASTCALL
 KeInvalidAccessAllowed(IN PVOID TrapInformation OPTIONAL);
@@ -298,6 +298,19 @@ KiReleaseTimerLock(IN PKSPIN_LOCK_QUEUE LockQueue)
 
 #else
 
+//
+// Cheap timestamp used to measure how long the PRCB lock is held. The lock
+// statistics are only kept in debug builds, since the PRCB lock is taken
+// on every scheduling decision.
+//
+#if DBG
+#if defined(_M_IX86) || defined(_M_AMD64)
+#define KiReadSchedulerTimestamp() __rdtsc()
+#else
+#define KiReadSchedulerTimestamp() 0ULL
+#endif
+#endif
+
 FORCEINLINE
 VOID
 KiAcquireDispatcherObject(IN DISPATCHER_HEADER* Object)
@@ -432,6 +445,11 @@ FORCEINLINE
 VOID
 KiAcquirePrcbLock(IN PKPRCB Prcb)
 {
+#if DBG
+    PKSCHEDULER_COUNTERS Counters;
+    BOOLEAN Contended = FALSE;
+#endif
+
     /* Make sure we're at a safe level to touch the PRCB lock */
     ASSERT(KeGetCurrentIrql() >= DISPATCH_LEVEL);
 
@@ -442,12 +460,23 @@ KiAcquirePrcbLock(IN PKPRCB Prcb)
         if (!InterlockedExchange((PLONG)&Prcb->PrcbLock, 1)) break;
 
         /* Loop until the other CPU releases it */
+#if DBG
+        Contended = TRUE;
+#endif
         do
         {
             /* Let the CPU know that this is a loop */
             YieldProcessor();
         } while (Prcb->PrcbLock);
     }
+
+#if DBG
+    /* We own the lock, so we own its statistics too */
+    Counters = &KiSchedulerCounters[Prcb->Number];
+    Counters->PrcbLockAcquires++;
+    if (Contended) Counters->PrcbLockContention++;
+    Counters->PrcbLockAcquireTime = KiReadSchedulerTimestamp();
+#endif
 }
 
 //
@@ -461,10 +490,21 @@ FORCEINLINE
 VOID
 KiReleasePrcbLock(IN PKPRCB Prcb)
 {
+#if DBG
+    PKSCHEDULER_COUNTERS Counters;
+#endif
+
     /* Make sure we are above dispatch and the lock is acquired! */
     ASSERT(KeGetCurrentIrql() >= DISPATCH_LEVEL);
     ASSERT(Prcb->PrcbLock != 0);
 
+#if DBG
+    /* Account for the time it was held while we still own it */
+    Counters = &KiSchedulerCounters[Prcb->Number];
+    Counters->PrcbLockHoldCycles += KiReadSchedulerTimestamp() -
+                                    Counters->PrcbLockAcquireTime;
+#endif
+
     /* Release it */
     InterlockedAnd((PLONG)&Prcb->PrcbLock, 0);
 }
@@ -1231,7 +1271,7 @@ KxSetTimerForThreadWait(IN PKTIMER Timer,
     }                                                                       \
                                                                             \
     /* Set wait settings */                                                 \
-    Thread->Alertable = FALSE;                                              \
+    Thread->Alertable = Alertable;                                          \
     Thread->WaitMode = WaitMode;                                            \
     Thread->WaitReason = WrQueue;                                           \
                                                                             \
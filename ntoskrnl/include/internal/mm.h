@@ -9,6 +9,9 @@ struct _EPROCESS;
 extern PMMSUPPORT MmKernelAddressSpace;
 extern PFN_COUNT MiFreeSwapPages;
 extern PFN_COUNT MiUsedSwapPages;
+extern ULONG MmPagingFileWrites;
+extern ULONG MmPagingFilePagesWritten;
+extern ULONG MmSectionFaultClusterSize;
 extern PFN_COUNT MmNumberOfPhysicalPages;
 extern UCHAR MmDisablePagingExecutive;
 extern PFN_NUMBER MmLowestPhysicalPage;
@@ -225,6 +228,8 @@ typedef struct _MEMORY_AREA
             LARGE_INTEGER ViewOffset;
             PMM_SECTION_SEGMENT Segment;
             LIST_ENTRY RegionListHead;
+            PVOID NextFaultAddress;
+            ULONG FaultClusterSize;
         } SectionData;
         struct
         {
@@ -435,6 +440,7 @@ typedef struct _MMPAGING_FILE
     UNICODE_STRING PageFileName;
     PRTL_BITMAP Bitmap;
     HANDLE FileHandle;
+    ULONG AllocationHint;
 }
 MMPAGING_FILE, *PMMPAGING_FILE;
 
@@ -650,6 +656,21 @@ MmWriteToSwapPage(
     PFN_NUMBER Page
 );
 
+NTSTATUS
+NTAPI
+MmWriteToSwapPages(
+    SWAPENTRY SwapEntry,
+    PPFN_NUMBER Pages,
+    ULONG PageCount
+);
+
+ULONG
+NTAPI
+MmWriteSwapCluster(
+    PFN_NUMBER FirstPage,
+    ULONG MaxPages
+);
+
 VOID
 NTAPI
 MmShowOutOfSpaceMessagePagingFile(VOID);
@@ -894,6 +915,23 @@ NTSTATUS
 NTAPI
 MmPageOutPhysicalAddress(PFN_NUMBER Page);
 
+BOOLEAN
+NTAPI
+MmPrepareSwapClusterPage(
+    PFN_NUMBER Page,
+    PEPROCESS *Process,
+    PVOID *Address
+);
+
+VOID
+NTAPI
+MmFinishSwapClusterPage(
+    PFN_NUMBER Page,
+    PEPROCESS Process,
+    PVOID Address,
+    SWAPENTRY SwapEntry
+);
+
 /* freelist.c **********************************************************/
 
 FORCEINLINE
@@ -1015,6 +1053,12 @@ NTAPI
 MiMapPagesInZeroSpace(IN PMMPFN Pfn1,
                       IN PFN_NUMBER NumberOfPages);
 
+PVOID
+NTAPI
+MiMapPagesInZeroingPtes(IN PMMPTE ZeroingPtes,
+                        IN PMMPFN Pfn1,
+                        IN PFN_NUMBER NumberOfPages);
+
 VOID
 NTAPI
 MiUnmapPagesInZeroSpace(IN PVOID VirtualAddress,
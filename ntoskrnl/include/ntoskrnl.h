@@ -87,6 +87,9 @@
 #include <reactos/rossym.h>
 #endif
 
+/* ReactOS-private system information classes */
+#include <reactos/rossysinfo.h>
+
 /* PNP GUIDs */
 #include <umpnpmgr/sysguid.h>
 
@@ -17,6 +17,9 @@ POBJECT_TYPE IoCompletionType;
 
 GENERAL_LOOKASIDE IoCompletionPacketLookaside;
 
+/* Entries NtRemoveIoCompletionEx takes off the queue in one call */
+#define IOP_MAX_REMOVE_COMPLETION_ENTRIES 32
+
 GENERIC_MAPPING IopCompletionMapping =
 {
     STANDARD_RIGHTS_READ | IO_COMPLETION_QUERY_STATE,
@@ -137,6 +140,48 @@ IopDeleteIoCompletion(PVOID ObjectBody)
     }
 }
 
+static
+VOID
+IopUnpackCompletionPacket(IN PLIST_ENTRY ListEntry,
+                          OUT PFILE_IO_COMPLETION_INFORMATION Information)
+{
+    PIOP_MINI_COMPLETION_PACKET Packet;
+    PIRP Irp;
+
+    /* Get the Packet Data */
+    Packet = CONTAINING_RECORD(ListEntry,
+                               IOP_MINI_COMPLETION_PACKET,
+                               ListEntry);
+
+    /* Check if this is piggybacked on an IRP */
+    if (Packet->PacketType == IopCompletionPacketIrp)
+    {
+        /* Get the IRP */
+        Irp = CONTAINING_RECORD(ListEntry,
+                                IRP,
+                                Tail.Overlay.ListEntry);
+
+        /* Save values */
+        Information->KeyContext = Irp->Tail.CompletionKey;
+        Information->ApcContext = Irp->Overlay.AsynchronousParameters.UserApcContext;
+        Information->IoStatusBlock = Irp->IoStatus;
+
+        /* Free the IRP */
+        IoFreeIrp(Irp);
+    }
+    else
+    {
+        /* Save values */
+        Information->KeyContext = Packet->KeyContext;
+        Information->ApcContext = Packet->ApcContext;
+        Information->IoStatusBlock.Status = Packet->IoStatus;
+        Information->IoStatusBlock.Information = Packet->IoStatusInformation;
+
+        /* Free the packet */
+        IopFreeMiniPacket(Packet);
+    }
+}
+
 /* PUBLIC FUNCTIONS **********************************************************/
 
 /*
@@ -449,13 +494,10 @@ NtRemoveIoCompletion(IN HANDLE IoCompletionHandle,
 {
     LARGE_INTEGER SafeTimeout;
     PKQUEUE Queue;
-    PIOP_MINI_COMPLETION_PACKET Packet;
     PLIST_ENTRY ListEntry;
     KPROCESSOR_MODE PreviousMode = ExGetPreviousMode();
     NTSTATUS Status;
-    PIRP Irp;
-    PVOID Apc, Key;
-    IO_STATUS_BLOCK IoStatus;
+    FILE_IO_COMPLETION_INFORMATION Information;
     PAGED_CODE();
 
     /* Check if the call was from user mode */
@@ -506,50 +548,131 @@ NtRemoveIoCompletion(IN HANDLE IoCompletionHandle,
         }
         else
         {
-            /* Get the Packet Data */
-            Packet = CONTAINING_RECORD(ListEntry,
-                                       IOP_MINI_COMPLETION_PACKET,
-                                       ListEntry);
+            /* Get the values and free the packet */
+            IopUnpackCompletionPacket(ListEntry, &Information);
 
-            /* Check if this is piggybacked on an IRP */
-            if (Packet->PacketType == IopCompletionPacketIrp)
+            /* Enter SEH to write back the values */
+            _SEH2_TRY
             {
-                /* Get the IRP */
-                Irp = CONTAINING_RECORD(ListEntry,
-                                        IRP,
-                                        Tail.Overlay.ListEntry);
-
-                /* Save values */
-                Key = Irp->Tail.CompletionKey;
-                Apc = Irp->Overlay.AsynchronousParameters.UserApcContext;
-                IoStatus = Irp->IoStatus;
-
-                /* Free the IRP */
-                IoFreeIrp(Irp);
+                /* Write the values to caller */
+                *ApcContext = Information.ApcContext;
+                *KeyContext = Information.KeyContext;
+                *IoStatusBlock = Information.IoStatusBlock;
             }
-            else
+            _SEH2_EXCEPT(ExSystemExceptionFilter())
             {
-                /* Save values */
-                Key = Packet->KeyContext;
-                Apc = Packet->ApcContext;
-                IoStatus.Status = Packet->IoStatus;
-                IoStatus.Information = Packet->IoStatusInformation;
+                /* Get the exception code */
+                Status = _SEH2_GetExceptionCode();
+            }
+            _SEH2_END;
+        }
 
-                /* Free the packet */
-                IopFreeMiniPacket(Packet);
+        /* Dereference the Object */
+        ObDereferenceObject(Queue);
+    }
+
+    /* Return status */
+    return Status;
+}
+
+NTSTATUS
+NTAPI
+NtRemoveIoCompletionEx(IN HANDLE IoCompletionHandle,
+                       OUT PFILE_IO_COMPLETION_INFORMATION IoCompletionInformation,
+                       IN ULONG Count,
+                       OUT PULONG NumEntriesRemoved,
+                       IN PLARGE_INTEGER Timeout OPTIONAL,
+                       IN BOOLEAN Alertable)
+{
+    LARGE_INTEGER SafeTimeout;
+    PKQUEUE Queue;
+    PLIST_ENTRY ListEntry[IOP_MAX_REMOVE_COMPLETION_ENTRIES];
+    KPROCESSOR_MODE PreviousMode = ExGetPreviousMode();
+    NTSTATUS Status;
+    FILE_IO_COMPLETION_INFORMATION Information;
+    ULONG Removed, i;
+    PAGED_CODE();
+
+    /* There must be room for at least one entry */
+    if (!(Count) || (Count > MAXULONG / sizeof(FILE_IO_COMPLETION_INFORMATION)))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Check if the call was from user mode */
+    if (PreviousMode != KernelMode)
+    {
+        /* Protect probes in SEH */
+        _SEH2_TRY
+        {
+            /* Probe the output array and the count */
+            ProbeForWrite(IoCompletionInformation,
+                          Count * sizeof(FILE_IO_COMPLETION_INFORMATION),
+                          sizeof(ULONG_PTR));
+            ProbeForWriteUlong(NumEntriesRemoved);
+            if (Timeout)
+            {
+                /* Probe and capture the timeout */
+                SafeTimeout = ProbeForReadLargeInteger(Timeout);
+                Timeout = &SafeTimeout;
             }
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            /* Return the exception code */
+            _SEH2_YIELD(return _SEH2_GetExceptionCode());
+        }
+        _SEH2_END;
+    }
+
+    /* Don't take more than we can hold on the stack, the rest stays queued */
+    if (Count > IOP_MAX_REMOVE_COMPLETION_ENTRIES)
+    {
+        Count = IOP_MAX_REMOVE_COMPLETION_ENTRIES;
+    }
+
+    /* Open the Object */
+    Status = ObReferenceObjectByHandle(IoCompletionHandle,
+                                       IO_COMPLETION_MODIFY_STATE,
+                                       IoCompletionType,
+                                       PreviousMode,
+                                       (PVOID*)&Queue,
+                                       NULL);
+    if (NT_SUCCESS(Status))
+    {
+        /* Remove as many entries as there are, waiting for the first one */
+        Removed = KeRemoveQueueEx(Queue,
+                                  PreviousMode,
+                                  Alertable,
+                                  Timeout,
+                                  ListEntry,
+                                  Count);
+
+        /* If we got a timeout, user_apc or alert back, return the status */
+        if (((NTSTATUS)(ULONG_PTR)ListEntry[0] == STATUS_TIMEOUT) ||
+            ((NTSTATUS)(ULONG_PTR)ListEntry[0] == STATUS_USER_APC) ||
+            ((NTSTATUS)(ULONG_PTR)ListEntry[0] == STATUS_ALERTED))
+        {
+            /* Set this as the status, nothing was removed */
+            Status = (NTSTATUS)(ULONG_PTR)ListEntry[0];
+            Removed = 0;
+        }
+
+        /* Loop the entries we got */
+        for (i = 0; i < Removed; i++)
+        {
+            /* Get the values and free the packet */
+            IopUnpackCompletionPacket(ListEntry[i], &Information);
 
             /* Enter SEH to write back the values */
             _SEH2_TRY
             {
                 /* Write the values to caller */
-                *ApcContext = Apc;
-                *KeyContext = Key;
-                *IoStatusBlock = IoStatus;
+                IoCompletionInformation[i] = Information;
             }
             _SEH2_EXCEPT(ExSystemExceptionFilter())
             {
-                /* Get the exception code */
+                /* Get the exception code, but keep freeing the packets */
                 Status = _SEH2_GetExceptionCode();
             }
             _SEH2_END;
@@ -557,6 +680,19 @@ NtRemoveIoCompletion(IN HANDLE IoCompletionHandle,
 
         /* Dereference the Object */
         ObDereferenceObject(Queue);
+
+        /* Enter SEH to write back the count */
+        _SEH2_TRY
+        {
+            /* Write it to caller */
+            *NumEntriesRemoved = Removed;
+        }
+        _SEH2_EXCEPT(ExSystemExceptionFilter())
+        {
+            /* Get the exception code */
+            Status = _SEH2_GetExceptionCode();
+        }
+        _SEH2_END;
     }
 
     /* Return status */
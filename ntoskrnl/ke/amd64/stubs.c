@@ -142,6 +142,11 @@ KiIdleLoop(VOID)
             /* Enable interrupts */
             _enable();
 
+#ifdef CONFIG_SMP
+            /* Other processors hand us threads under our PRCB lock */
+            KiAcquirePrcbLock(Prcb);
+#endif
+
             /* Capture current thread data */
             OldThread = Prcb->CurrentThread;
             NewThread = Prcb->NextThread;
@@ -153,6 +158,13 @@ KiIdleLoop(VOID)
             /* The thread is now running */
             NewThread->State = Running;
 
+#ifdef CONFIG_SMP
+            /* We are not idle anymore */
+            InterlockedAnd64((PLONG64)&KiIdleSummary, ~Prcb->SetMember);
+            Prcb->IdleSchedule = FALSE;
+            KiReleasePrcbLock(Prcb);
+#endif
+
             /* Do the swap at SYNCH_LEVEL */
             KfRaiseIrql(SYNCH_LEVEL);
 
@@ -162,6 +174,14 @@ KiIdleLoop(VOID)
             /* Go back to DISPATCH_LEVEL */
             KeLowerIrql(DISPATCH_LEVEL);
         }
+#ifdef CONFIG_SMP
+        else if (Prcb->IdleSchedule)
+        {
+            /* Enable interrupts and look for work on the other processors */
+            _enable();
+            KiIdleSchedule(Prcb);
+        }
+#endif
         else
         {
             /* Continue staying idle. Note the HAL returns with interrupts on */
@@ -1138,6 +1138,22 @@ KeZeroPages(IN PVOID Address,
     RtlZeroMemory(Address, Size);
 }
 
+VOID
+FASTCALL
+KeZeroPagesFromIdleThread(IN PVOID Address,
+                          IN ULONG Size)
+{
+    /* Nobody is going to read these pages soon, so bypass the caches if we can */
+    if (KeFeatureBits & KF_XMMI64)
+    {
+        KiZeroPagesNonTemporal(Address, Size);
+    }
+    else
+    {
+        KeZeroPages(Address, Size);
+    }
+}
+
 VOID
 NTAPI
 KiSaveProcessorState(IN PKTRAP_FRAME TrapFrame,
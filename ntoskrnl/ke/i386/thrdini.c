@@ -300,6 +300,11 @@ KiIdleLoop(VOID)
             /* Enable interrupts */
             _enable();
 
+#ifdef CONFIG_SMP
+            /* Other processors hand us threads under our PRCB lock */
+            KiAcquirePrcbLock(Prcb);
+#endif
+
             /* Capture current thread data */
             OldThread = Prcb->CurrentThread;
             NewThread = Prcb->NextThread;
@@ -311,9 +316,24 @@ KiIdleLoop(VOID)
             /* The thread is now running */
             NewThread->State = Running;
 
+#ifdef CONFIG_SMP
+            /* We are not idle anymore */
+            InterlockedAnd((PLONG)&KiIdleSummary, ~Prcb->SetMember);
+            Prcb->IdleSchedule = FALSE;
+            KiReleasePrcbLock(Prcb);
+#endif
+
             /* Switch away from the idle thread */
             KiSwapContext(APC_LEVEL, OldThread);
         }
+#ifdef CONFIG_SMP
+        else if (Prcb->IdleSchedule)
+        {
+            /* Enable interrupts and look for work on the other processors */
+            _enable();
+            KiIdleSchedule(Prcb);
+        }
+#endif
         else
         {
             /* Continue staying idle. Note the HAL returns with interrupts on */
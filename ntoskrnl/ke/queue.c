@@ -231,12 +231,13 @@ KeReadStateQueue(IN PKQUEUE Queue)
 }
 
 /*
- * @implemented
+ * Waits for an entry on the queue, common to KeRemoveQueue and KeRemoveQueueEx
  */
+static
 PLIST_ENTRY
-NTAPI
-KeRemoveQueue(IN PKQUEUE Queue,
+KiRemoveQueue(IN PKQUEUE Queue,
               IN KPROCESSOR_MODE WaitMode,
+              IN BOOLEAN Alertable,
               IN PLARGE_INTEGER Timeout OPTIONAL)
 {
     PLIST_ENTRY QueueEntry;
@@ -344,12 +345,12 @@ KeRemoveQueue(IN PKQUEUE Queue,
             }
             else
             {
-                /* Fail if there's a User APC Pending */
-                if ((WaitMode != KernelMode) &&
-                    (Thread->ApcState.UserApcPending))
+                /* Fail if there's a User APC Pending or we were alerted */
+                Status = KiCheckAlertability(Thread, Alertable, WaitMode);
+                if (Status != STATUS_WAIT_0)
                 {
                     /* Return the status and increase the pending threads */
-                    QueueEntry = (PLIST_ENTRY)STATUS_USER_APC;
+                    QueueEntry = (PLIST_ENTRY)Status;
                     Queue->CurrentCount++;
                     break;
                 }
@@ -430,6 +431,91 @@ KeRemoveQueue(IN PKQUEUE Queue,
     return QueueEntry;
 }
 
+/*
+ * @implemented
+ */
+PLIST_ENTRY
+NTAPI
+KeRemoveQueue(IN PKQUEUE Queue,
+              IN KPROCESSOR_MODE WaitMode,
+              IN PLARGE_INTEGER Timeout OPTIONAL)
+{
+    /* Do a non-alertable wait for a single entry */
+    return KiRemoveQueue(Queue, WaitMode, FALSE, Timeout);
+}
+
+/*
+ * @implemented
+ */
+ULONG
+NTAPI
+KeRemoveQueueEx(IN PKQUEUE Queue,
+                IN KPROCESSOR_MODE WaitMode,
+                IN BOOLEAN Alertable,
+                IN PLARGE_INTEGER Timeout OPTIONAL,
+                OUT PLIST_ENTRY *EntryArray,
+                IN ULONG Count)
+{
+    PLIST_ENTRY QueueEntry;
+    ULONG Removed;
+    KIRQL OldIrql;
+    ASSERT_QUEUE(Queue);
+    ASSERT(Count != 0);
+
+    /* Wait for the first entry like KeRemoveQueue would */
+    QueueEntry = KiRemoveQueue(Queue, WaitMode, Alertable, Timeout);
+    EntryArray[0] = QueueEntry;
+
+    /* If the wait failed, the status is the only thing to return */
+    if (((NTSTATUS)(ULONG_PTR)QueueEntry == STATUS_TIMEOUT) ||
+        ((NTSTATUS)(ULONG_PTR)QueueEntry == STATUS_USER_APC) ||
+        ((NTSTATUS)(ULONG_PTR)QueueEntry == STATUS_ALERTED))
+    {
+        return 1;
+    }
+
+    /* Check if the caller has room for more */
+    Removed = 1;
+    if (Count == 1) return Removed;
+
+    /*
+     * We are now counted as running on the queue, so take whatever else is
+     * already there without waiting. The concurrency count doesn't change,
+     * since all of these entries get processed by this same thread.
+     */
+    OldIrql = KiAcquireDispatcherLock();
+    while (Removed < Count)
+    {
+        /* Stop as soon as the queue is empty */
+        QueueEntry = Queue->EntryListHead.Flink;
+        if (QueueEntry == &Queue->EntryListHead) break;
+
+        /* Check if the entry is valid. If not, bugcheck */
+        if (!(QueueEntry->Flink) || !(QueueEntry->Blink))
+        {
+            /* Invalid item */
+            KeBugCheckEx(INVALID_WORK_QUEUE_ITEM,
+                         (ULONG_PTR)QueueEntry,
+                         (ULONG_PTR)Queue,
+                         (ULONG_PTR)NULL,
+                         (ULONG_PTR)((PWORK_QUEUE_ITEM)QueueEntry)->
+                                     WorkerRoutine);
+        }
+
+        /* Decrease the number of entries and remove this one */
+        Queue->Header.SignalState--;
+        RemoveEntryList(QueueEntry);
+        QueueEntry->Flink = NULL;
+
+        /* Return it */
+        EntryArray[Removed++] = QueueEntry;
+    }
+
+    /* Unlock Database and return how many entries we got */
+    KiReleaseDispatcherLock(OldIrql);
+    return Removed;
+}
+
 /*
  * @implemented
  */
@@ -15,25 +15,176 @@
 #ifdef _WIN64
 # define InterlockedOrSetMember(Destination, SetMember) \
     InterlockedOr64((PLONG64)Destination, SetMember);
+# define InterlockedAndSetMember(Destination, SetMember) \
+    InterlockedAnd64((PLONG64)Destination, SetMember);
 #else
 # define InterlockedOrSetMember(Destination, SetMember) \
     InterlockedOr((PLONG)Destination, SetMember);
+# define InterlockedAndSetMember(Destination, SetMember) \
+    InterlockedAnd((PLONG)Destination, SetMember);
 #endif
 
 /* GLOBALS *******************************************************************/
 
 ULONG_PTR KiIdleSummary;
 ULONG_PTR KiIdleSMTSummary;
+KSCHEDULER_COUNTERS KiSchedulerCounters[MAXIMUM_PROCESSORS];
 
 /* FUNCTIONS *****************************************************************/
 
+#ifdef CONFIG_SMP
+FORCEINLINE
+ULONG
+KiFindFirstSetMember(IN KAFFINITY Set)
+{
+    ULONG Processor;
+
+    /* Return the lowest numbered processor in the set */
+    ASSERT(Set != 0);
+#ifdef _WIN64
+    BitScanForward64(&Processor, Set);
+#else
+    BitScanForward(&Processor, Set);
+#endif
+    return Processor;
+}
+
+//
+// Looks for the highest priority thread on another processor's ready queues
+// that is allowed to run on the processor(s) in the given set. The caller
+// must hold the lock of the PRCB being scanned.
+//
+static
+PKTHREAD
+KiFindStealableThread(IN PKPRCB Prcb,
+                      IN KAFFINITY SetMember)
+{
+    ULONG ReadySummary;
+    LONG Priority;
+    PLIST_ENTRY ListHead, NextEntry;
+    PKTHREAD Thread;
+
+    /* Go through the non-empty queues from the highest priority down */
+    ReadySummary = Prcb->ReadySummary;
+    while (ReadySummary)
+    {
+        BitScanReverse((PULONG)&Priority, ReadySummary);
+        ReadySummary ^= PRIORITY_MASK(Priority);
+
+        /* Take the first thread on this queue that may run for us */
+        ListHead = &Prcb->DispatcherReadyListHead[Priority];
+        for (NextEntry = ListHead->Flink;
+             NextEntry != ListHead;
+             NextEntry = NextEntry->Flink)
+        {
+            Thread = CONTAINING_RECORD(NextEntry, KTHREAD, WaitListEntry);
+            if (Thread->Affinity & SetMember) return Thread;
+        }
+    }
+
+    /* Nothing we can run */
+    return NULL;
+}
+#endif
+
 PKTHREAD
 FASTCALL
 KiIdleSchedule(IN PKPRCB Prcb)
 {
-    /* FIXME: TODO */
-    ASSERTMSG("SMP: Not yet implemented\n", FALSE);
+#ifdef CONFIG_SMP
+    PKPRCB OtherPrcb;
+    PKTHREAD Thread = NULL;
+    PKSCHEDULER_COUNTERS Counters;
+    ULONG i, Number;
+    KIRQL OldIrql;
+
+    /* This is only called by the idle thread of the processor */
+    ASSERT(Prcb == KeGetCurrentPrcb());
+
+    /* Raise to synch level and consume the request */
+    OldIrql = KeRaiseIrqlToSynchLevel();
+    Prcb->IdleSchedule = FALSE;
+
+    /* Look at the other processors, starting with our neighbour */
+    for (i = 1; i < (ULONG)KeNumberProcessors; i++)
+    {
+        /* Skip anyone without ready threads, the summary is read unlocked */
+        Number = (Prcb->Number + i) % KeNumberProcessors;
+        OtherPrcb = KiProcessorBlock[Number];
+        if (!(OtherPrcb) || !(OtherPrcb->ReadySummary)) continue;
+
+        /* Lock both PRCBs, always in processor order */
+        if (Number < Prcb->Number)
+        {
+            KiAcquirePrcbLock(OtherPrcb);
+            KiAcquirePrcbLock(Prcb);
+        }
+        else
+        {
+            KiAcquirePrcbLock(Prcb);
+            KiAcquirePrcbLock(OtherPrcb);
+        }
+
+        /* Somebody could have given us a thread while we were looking */
+        if (!Prcb->NextThread)
+        {
+            /* Find a thread we are allowed to run */
+            Thread = KiFindStealableThread(OtherPrcb, Prcb->SetMember);
+            if (Thread)
+            {
+                /* Sanity checks */
+                ASSERT(Thread->State == Ready);
+                ASSERT(Thread->NextProcessor == OtherPrcb->Number);
+
+                /* Remove it from the other processor's queue */
+                if (RemoveEntryList(&Thread->WaitListEntry))
+                {
+                    /* The list is empty now, reset the ready summary */
+                    OtherPrcb->ReadySummary ^= PRIORITY_MASK(Thread->Priority);
+                }
+
+                /* Make it our next thread, we are no longer idle */
+                Thread->NextProcessor = (UCHAR)Prcb->Number;
+                Thread->State = Standby;
+                Prcb->NextThread = Thread;
+                InterlockedAndSetMember(&KiIdleSummary, ~Prcb->SetMember);
+
+                /* Account for the steal */
+                Counters = &KiSchedulerCounters[Prcb->Number];
+                Counters->IdleSteals++;
+                Counters->Migrations++;
+            }
+        }
+        else
+        {
+            /* Return that thread instead */
+            Thread = Prcb->NextThread;
+        }
+
+        /* Release the locks in the reverse order */
+        if (Number < Prcb->Number)
+        {
+            KiReleasePrcbLock(Prcb);
+            KiReleasePrcbLock(OtherPrcb);
+        }
+        else
+        {
+            KiReleasePrcbLock(OtherPrcb);
+            KiReleasePrcbLock(Prcb);
+        }
+
+        /* Stop as soon as we have something to run */
+        if (Thread) break;
+    }
+
+    /* Return to the idle loop, which switches to the thread */
+    KeLowerIrql(OldIrql);
+    return Thread;
+#else
+    /* There is nobody to steal from on UP */
+    UNREFERENCED_PARAMETER(Prcb);
     return NULL;
+#endif
 }
 
 VOID
@@ -81,8 +232,13 @@ KiDeferredReadyThread(IN PKTHREAD Thread)
     PKPRCB Prcb;
     BOOLEAN Preempted;
     ULONG Processor = 0;
+    ULONG Current, LastProcessor;
     KPRIORITY OldPriority;
     PKTHREAD NextThread;
+    PKSCHEDULER_COUNTERS Counters;
+#ifdef CONFIG_SMP
+    KAFFINITY Affinity, IdleSet;
+#endif
 
     /* Sanity checks */
     ASSERT(Thread->State == DeferredReady);
@@ -228,6 +384,106 @@ KiDeferredReadyThread(IN PKTHREAD Thread)
     OldPriority = Thread->Priority;
     Thread->Preempted = FALSE;
 
+    /* Remember where we are and where the thread ran last */
+    Current = KeGetCurrentProcessorNumber();
+    LastProcessor = Thread->NextProcessor;
+
+#ifdef CONFIG_SMP
+    /* Only consider processors that are running and allowed */
+    Affinity = Thread->Affinity & KeActiveProcessors;
+    ASSERT(Affinity != 0);
+
+    /* Check if any of them is idle */
+    IdleSet = KiIdleSummary & Affinity;
+    while (IdleSet)
+    {
+        /* Prefer the ideal processor, then the last one, then this one */
+        if (IdleSet & AFFINITY_MASK(Thread->IdealProcessor))
+        {
+            Processor = Thread->IdealProcessor;
+        }
+        else if (IdleSet & AFFINITY_MASK(LastProcessor))
+        {
+            Processor = LastProcessor;
+        }
+        else if (IdleSet & AFFINITY_MASK(Current))
+        {
+            Processor = Current;
+        }
+        else
+        {
+            Processor = KiFindFirstSetMember(IdleSet);
+        }
+
+        /* Get its PRCB and lock it */
+        Prcb = KiProcessorBlock[Processor];
+        KiAcquirePrcbLock(Prcb);
+
+        /* Make sure it is still idle and nobody gave it a thread meanwhile */
+        if ((KiIdleSummary & Prcb->SetMember) && !(Prcb->NextThread))
+        {
+            /* Claim it, this only clears its own bit in the summary */
+            InterlockedAndSetMember(&KiIdleSummary, ~Prcb->SetMember);
+
+            /* Account for the decision */
+            Counters = &KiSchedulerCounters[Processor];
+            if (Processor == Thread->IdealProcessor) Counters->IdleIdeal++;
+            else if (Processor == LastProcessor) Counters->IdleLast++;
+            else if (Processor == Current) Counters->IdleCurrent++;
+            else Counters->IdleAny++;
+            if (Processor != LastProcessor) Counters->Migrations++;
+
+            /* Set this thread as the next one */
+            Thread->NextProcessor = (UCHAR)Processor;
+            Thread->State = Standby;
+            Prcb->NextThread = Thread;
+
+            /* Unlock the PRCB and wake up the processor if it's not us */
+            KiReleasePrcbLock(Prcb);
+            if (Processor != Current) KiIpiSend(AFFINITY_MASK(Processor), IPI_DPC);
+            return;
+        }
+
+        /* Somebody beat us to it, try the next idle processor */
+        KiReleasePrcbLock(Prcb);
+        IdleSet &= ~Prcb->SetMember;
+    }
+
+    /* Nobody is idle, so go for the ideal processor if we may run there */
+    Processor = Thread->IdealProcessor;
+    if (!(Affinity & AFFINITY_MASK(Processor)))
+    {
+        /* Otherwise the last one, this one, or the first one allowed */
+        if (Affinity & AFFINITY_MASK(LastProcessor))
+        {
+            Processor = LastProcessor;
+        }
+        else if (Affinity & AFFINITY_MASK(Current))
+        {
+            Processor = Current;
+        }
+        else
+        {
+            Processor = KiFindFirstSetMember(Affinity);
+        }
+    }
+    else if ((Processor != LastProcessor) &&
+             (Affinity & AFFINITY_MASK(LastProcessor)) &&
+             (KiProcessorBlock[Processor]->ReadySummary >> OldPriority) &&
+             !(KiProcessorBlock[LastProcessor]->ReadySummary >> OldPriority))
+    {
+        /*
+         * The ideal processor already has work queued at our priority or
+         * above while the last one does not, so balance towards the latter.
+         * The summaries are only a hint here and are read without locking.
+         */
+        Processor = LastProcessor;
+    }
+
+    /* Get the PRCB and lock it */
+    Prcb = KiProcessorBlock[Processor];
+    KiAcquirePrcbLock(Prcb);
+#else
     /* Queue the thread on CPU 0 and get the PRCB and lock it */
     Thread->NextProcessor = 0;
     Prcb = KiProcessorBlock[0];
@@ -241,10 +497,21 @@ KiDeferredReadyThread(IN PKTHREAD Thread)
         Thread->State = Standby;
         Prcb->NextThread = Thread;
 
+        /* Account for the decision */
+        KiSchedulerCounters[0].IdleCurrent++;
+
         /* Unlock the PRCB and return */
         KiReleasePrcbLock(Prcb);
         return;
     }
+#endif
+
+    /* Account for the decision */
+    Counters = &KiSchedulerCounters[Processor];
+    if (Processor == Thread->IdealProcessor) Counters->FindIdeal++;
+    else if (Processor == LastProcessor) Counters->FindLast++;
+    else Counters->FindAny++;
+    if (Processor != LastProcessor) Counters->Migrations++;
 
     /* Set the CPU number */
     Thread->NextProcessor = (UCHAR)Processor;
@@ -261,6 +528,9 @@ KiDeferredReadyThread(IN PKTHREAD Thread)
         {
             /* Preempt the thread */
             NextThread->Preempted = TRUE;
+            if (Processor == Current) Counters->PreemptCurrent++;
+            else if (Processor == LastProcessor) Counters->PreemptLast++;
+            else Counters->PreemptAny++;
 
             /* Put this one as the next one */
             Thread->State = Standby;
@@ -282,6 +552,9 @@ KiDeferredReadyThread(IN PKTHREAD Thread)
         {
             /* Preempt it if it's already running */
             if (NextThread->State == Running) NextThread->Preempted = TRUE;
+            if (Processor == Current) Counters->PreemptCurrent++;
+            else if (Processor == LastProcessor) Counters->PreemptLast++;
+            else Counters->PreemptAny++;
 
             /* Set the thread on standby and as the next thread */
             Thread->State = Standby;
@@ -339,9 +612,9 @@ KiSelectNextThread(IN PKPRCB Prcb)
         /* Enable idle scheduling */
         InterlockedOrSetMember(&KiIdleSummary, Prcb->SetMember);
         Prcb->IdleSchedule = TRUE;
+        KiSchedulerCounters[Prcb->Number].SwitchToIdle++;
 
         /* FIXME: SMT support */
-        ASSERTMSG("SMP: Not yet implemented\n", FALSE);
     }
 
     /* Sanity checks and return the thread */
@@ -387,6 +660,11 @@ KiSwapThread(IN PKTHREAD CurrentThread,
         {
             /* Set the idle summary */
             InterlockedOrSetMember(&KiIdleSummary, Prcb->SetMember);
+            KiSchedulerCounters[Prcb->Number].SwitchToIdle++;
+#ifdef CONFIG_SMP
+            /* Let the idle thread look for work on the other processors */
+            Prcb->IdleSchedule = TRUE;
+#endif
 
             /* Schedule the idle thread */
             NextThread = Prcb->IdleThread;
@@ -1340,6 +1340,50 @@ ExpGetPoolTagInfoTarget(IN PKDPC Dpc,
     KeSignalCallDpcDone(SystemArgument1);
 }
 
+VOID
+NTAPI
+ExpQueryPoolLookasideUsage(OUT PULONG PagedBlocks,
+                           OUT PSIZE_T PagedBytes,
+                           OUT PULONG NonPagedBlocks,
+                           OUT PSIZE_T NonPagedBytes)
+{
+    PLIST_ENTRY ListEntry;
+    PGENERAL_LOOKASIDE Lookaside;
+    USHORT Depth;
+
+    *PagedBlocks = 0;
+    *PagedBytes = 0;
+    *NonPagedBlocks = 0;
+    *NonPagedBytes = 0;
+
+    //
+    // Pool lookaside lists are only ever added during initialization, so the
+    // list can be walked without a lock
+    //
+    for (ListEntry = ExPoolLookasideListHead.Flink;
+         ListEntry != &ExPoolLookasideListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        Lookaside = CONTAINING_RECORD(ListEntry, GENERAL_LOOKASIDE, ListEntry);
+
+        //
+        // Blocks sitting in a lookaside list are still busy from the pool
+        // descriptor's point of view, but they don't belong to their tag anymore
+        //
+        Depth = ExQueryDepthSList(&Lookaside->ListHead);
+        if (Lookaside->Type == NonPagedPool)
+        {
+            *NonPagedBlocks += Depth;
+            *NonPagedBytes += (SIZE_T)Depth * Lookaside->Size;
+        }
+        else
+        {
+            *PagedBlocks += Depth;
+            *PagedBytes += (SIZE_T)Depth * Lookaside->Size;
+        }
+    }
+}
+
 NTSTATUS
 NTAPI
 ExGetPoolTagInfo(IN PSYSTEM_POOLTAG_INFORMATION SystemInformation,
@@ -1352,6 +1396,8 @@ ExGetPoolTagInfo(IN PSYSTEM_POOLTAG_INFORMATION SystemInformation,
     PSYSTEM_POOLTAG TagEntry;
     PPOOL_TRACKER_TABLE Buffer, TrackerEntry;
     POOL_DPC_CONTEXT Context;
+    ULONG PagedBlocks, NonPagedBlocks;
+    SIZE_T PagedBytes, NonPagedBytes;
     ASSERT(KeGetCurrentIrql() == PASSIVE_LEVEL);
 
     //
@@ -1437,6 +1483,35 @@ ExGetPoolTagInfo(IN PSYSTEM_POOLTAG_INFORMATION SystemInformation,
         }
     }
 
+    //
+    // Report the memory cached by the pool lookaside lists under its own tag,
+    // as if each cached block was an allocation that was never freed
+    //
+    ExpQueryPoolLookasideUsage(&PagedBlocks,
+                               &PagedBytes,
+                               &NonPagedBlocks,
+                               &NonPagedBytes);
+    if (PagedBlocks || NonPagedBlocks)
+    {
+        SystemInformation->Count++;
+        CurrentLength += sizeof(*TagEntry);
+        if (SystemInformationLength < CurrentLength)
+        {
+            Status = STATUS_INFO_LENGTH_MISMATCH;
+        }
+        else
+        {
+            TagEntry->TagUlong = TAG_POOL_LOOKASIDE;
+            TagEntry->PagedAllocs = PagedBlocks;
+            TagEntry->PagedFrees = 0;
+            TagEntry->PagedUsed = PagedBytes;
+            TagEntry->NonPagedAllocs = NonPagedBlocks;
+            TagEntry->NonPagedFrees = 0;
+            TagEntry->NonPagedUsed = NonPagedBytes;
+            TagEntry++;
+        }
+    }
+
     //
     // Free the "Generic DPC" temporary buffer, return the buffer length and status
     //
@@ -1729,6 +1804,8 @@ ExQueryPoolUsage(OUT PULONG PagedPoolPages,
     *PagedPoolPages = 0;
     *PagedPoolAllocs = 0;
     *PagedPoolFrees = 0;
+    *PagedPoolLookasideHits = 0;
+    *NonPagedPoolLookasideHits = 0;
 
     //
     // Tally up the totals for all the apged pool
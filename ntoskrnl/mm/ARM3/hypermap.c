@@ -88,6 +88,14 @@ MiMapPageInHyperSpace(IN PEPROCESS Process,
     return MiPteToAddress(PointerPte);
 }
 
+PVOID
+NTAPI
+MiMapPagesInZeroSpace(IN PMMPFN Pfn1,
+                      IN PFN_NUMBER NumberOfPages)
+{
+    return MiMapPagesInZeroingPtes(MiFirstReservedZeroingPte, Pfn1, NumberOfPages);
+}
+
 VOID
 NTAPI
 MiUnmapPageInHyperSpace(IN PEPROCESS Process,
@@ -110,8 +118,9 @@ MiUnmapPageInHyperSpace(IN PEPROCESS Process,
 
 PVOID
 NTAPI
-MiMapPagesInZeroSpace(IN PMMPFN Pfn1,
-                      IN PFN_NUMBER NumberOfPages)
+MiMapPagesInZeroingPtes(IN PMMPTE ZeroingPtes,
+                        IN PMMPFN Pfn1,
+                        IN PFN_NUMBER NumberOfPages)
 {
     MMPTE TempPte;
     PMMPTE PointerPte;
@@ -127,7 +136,7 @@ MiMapPagesInZeroSpace(IN PMMPFN Pfn1,
     //
     // Pick the first zeroing PTE
     //
-    PointerPte = MiFirstReservedZeroingPte;
+    PointerPte = ZeroingPtes;
 
     //
     // Now get the first free PTE
@@ -277,11 +277,6 @@ extern const ULONG MmProtectToValue[32];
 //
 // FIXFIX: These should go in ex.h after the pool merge
 //
-#ifdef _WIN64
-#define POOL_BLOCK_SIZE 16
-#else
-#define POOL_BLOCK_SIZE  8
-#endif
 #define POOL_LISTS_PER_PAGE (PAGE_SIZE / POOL_BLOCK_SIZE)
 #define BASE_POOL_TYPE_MASK 1
 #define POOL_MAX_ALLOC (PAGE_SIZE - (sizeof(POOL_HEADER) + POOL_BLOCK_SIZE))
@@ -647,8 +642,10 @@ extern PMMPDE MiHighestUserPde;
 extern PFN_NUMBER MmSystemPageDirectory[PD_COUNT];
 extern PMMPTE MmSharedUserDataPte;
 extern LIST_ENTRY MmProcessList;
-extern BOOLEAN MmZeroingPageThreadActive;
+extern ULONG MmZeroingPageThreadActive;
 extern KEVENT MmZeroingPageEvent;
+extern ULONG MiZeroedPageListHits;
+extern ULONG MiZeroedPageListMisses;
 extern ULONG MmSystemPageColor;
 extern ULONG MmProcessColorSeed;
 extern PMMWSL MmWorkingSetList;
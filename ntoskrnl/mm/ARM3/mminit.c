@@ -2183,7 +2183,7 @@ MmArmInitSystem(IN ULONG Phase,
 
         /* Set the zero page event */
         KeInitializeEvent(&MmZeroingPageEvent, SynchronizationEvent, FALSE);
-        MmZeroingPageThreadActive = FALSE;
+        MmZeroingPageThreadActive = 0;
 
         /* Initialize the dead stack S-LIST */
         InitializeSListHead(&MmDeadStackSListHead);
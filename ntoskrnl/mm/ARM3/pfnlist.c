@@ -38,6 +38,10 @@ ULONG MmSystemPageColor;
 ULONG MmTransitionSharedPages;
 ULONG MmTotalPagesForPagingFile;
 
+/* Zero page requests served from the zeroed list, and those zeroed inline */
+ULONG MiZeroedPageListHits;
+ULONG MiZeroedPageListMisses;
+
 MMPFNLIST MmZeroedPageListHead = {0, ZeroedPageList, LIST_HEAD, LIST_HEAD};
 MMPFNLIST MmFreePageListHead = {0, FreePageList, LIST_HEAD, LIST_HEAD};
 MMPFNLIST MmStandbyPageListHead = {0, StandbyPageList, LIST_HEAD, LIST_HEAD};
@@ -583,8 +587,16 @@ MiRemoveZeroPage(IN ULONG Color)
     PageIndex = MiRemovePageByColor(PageIndex, Color);
     ASSERT(Pfn1 == MI_PFN_ELEMENT(PageIndex));
 
-    /* Zero it, if needed */
-    if (Zero) MiZeroPhysicalPage(PageIndex);
+    /* Zero it, if needed, and keep track of how often the zero page thread was behind */
+    if (Zero)
+    {
+        MiZeroedPageListMisses++;
+        MiZeroPhysicalPage(PageIndex);
+    }
+    else
+    {
+        MiZeroedPageListHits++;
+    }
 
     /* Sanity checks */
     ASSERT(Pfn1->u3.e2.ReferenceCount == 0);
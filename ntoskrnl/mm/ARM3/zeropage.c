@@ -17,9 +17,17 @@
 
 /* GLOBALS ********************************************************************/
 
-BOOLEAN MmZeroingPageThreadActive;
+/* Number of zeroing threads currently working */
+ULONG MmZeroingPageThreadActive;
 KEVENT MmZeroingPageEvent;
 
+/* Pages taken from the free list for each acquisition of the PFN lock */
+#define MI_ZERO_PAGE_BATCH 16
+C_ASSERT(MI_ZERO_PAGE_BATCH <= (MI_ZERO_PTES - 1));
+
+/* Number of zeroing threads, one per processor */
+static ULONG MiZeroPageThreads;
+
 /* PRIVATE FUNCTIONS **********************************************************/
 
 VOID
@@ -32,83 +40,157 @@ NTAPI
 MiFreeInitializationCode(IN PVOID StartVa,
 IN PVOID EndVa);
 
+static
+DECLSPEC_NORETURN
 VOID
-NTAPI
-MmZeroPageThread(VOID)
+MiZeroFreePages(IN PMMPTE ZeroingPtes)
 {
-    PKTHREAD Thread = KeGetCurrentThread();
-    PVOID StartAddress, EndAddress;
-    PVOID WaitObjects[2];
     KIRQL OldIrql;
     PVOID ZeroAddress;
     PFN_NUMBER PageIndex, FreePage;
-    PMMPFN Pfn1;
-
-    /* Get the discardable sections to free them */
-    MiFindInitializationCode(&StartAddress, &EndAddress);
-    if (StartAddress) MiFreeInitializationCode(StartAddress, EndAddress);
-    DPRINT("Free non-cache pages: %lx\n", MmAvailablePages + MiMemoryConsumers[MC_CACHE].PagesUsed);
-
-    /* Set our priority to 0 */
-    Thread->BasePriority = 0;
-    KeSetPriorityThread(Thread, 0);
-
-    /* Setup the wait objects */
-    WaitObjects[0] = &MmZeroingPageEvent;
-//    WaitObjects[1] = &PoSystemIdleTimer; FIXME: Implement idle timer
+    PFN_NUMBER Pages[MI_ZERO_PAGE_BATCH];
+    ULONG Count, i;
+    PMMPFN Pfn1, FirstPfn;
 
     while (TRUE)
     {
-        KeWaitForMultipleObjects(1, // 2
-                                 WaitObjects,
-                                 WaitAny,
-                                 WrFreePage,
-                                 KernelMode,
-                                 FALSE,
-                                 NULL,
-                                 NULL);
+        /* FIXME: Also wake up on PoSystemIdleTimer, once it is implemented */
+        KeWaitForSingleObject(&MmZeroingPageEvent,
+                              WrFreePage,
+                              KernelMode,
+                              FALSE,
+                              NULL);
         OldIrql = MiAcquirePfnLock();
-        MmZeroingPageThreadActive = TRUE;
+        MmZeroingPageThreadActive++;
 
         while (TRUE)
         {
-            if (!MmFreePageListHead.Total)
+            /* Take a batch of free pages, chained for the zeroing PTEs */
+            FirstPfn = (PMMPFN)LIST_HEAD;
+            for (Count = 0; Count < MI_ZERO_PAGE_BATCH && MmFreePageListHead.Total; Count++)
+            {
+                PageIndex = MmFreePageListHead.Flink;
+                ASSERT(PageIndex != LIST_HEAD);
+                Pfn1 = MiGetPfnEntry(PageIndex);
+                MI_SET_USAGE(MI_USAGE_ZERO_LOOP);
+                MI_SET_PROCESS2("Kernel 0 Loop");
+                FreePage = MiRemoveAnyPage(MI_GET_PAGE_COLOR(PageIndex));
+
+                /* The first global free page should also be the first on its own list */
+                if (FreePage != PageIndex)
+                {
+                    KeBugCheckEx(PFN_LIST_CORRUPT,
+                                 0x8F,
+                                 FreePage,
+                                 PageIndex,
+                                 0);
+                }
+
+                Pfn1->u1.Flink = (ULONG_PTR)FirstPfn;
+                FirstPfn = Pfn1;
+                Pages[Count] = PageIndex;
+            }
+
+            if (!Count)
             {
-                MmZeroingPageThreadActive = FALSE;
+                MmZeroingPageThreadActive--;
                 MiReleasePfnLock(OldIrql);
                 break;
             }
 
-            PageIndex = MmFreePageListHead.Flink;
-            ASSERT(PageIndex != LIST_HEAD);
-            Pfn1 = MiGetPfnEntry(PageIndex);
-            MI_SET_USAGE(MI_USAGE_ZERO_LOOP);
-            MI_SET_PROCESS2("Kernel 0 Loop");
-            FreePage = MiRemoveAnyPage(MI_GET_PAGE_COLOR(PageIndex));
-
-            /* The first global free page should also be the first on its own list */
-            if (FreePage != PageIndex)
+            /* Get an idle processor to help if there is more than we can take */
+            if ((MmFreePageListHead.Total >= MI_ZERO_PAGE_BATCH) &&
+                (MmZeroingPageThreadActive < MiZeroPageThreads))
             {
-                KeBugCheckEx(PFN_LIST_CORRUPT,
-                             0x8F,
-                             FreePage,
-                             PageIndex,
-                             0);
+                KeSetEvent(&MmZeroingPageEvent, IO_NO_INCREMENT, FALSE);
             }
 
-            Pfn1->u1.Flink = LIST_HEAD;
             MiReleasePfnLock(OldIrql);
 
-            ZeroAddress = MiMapPagesInZeroSpace(Pfn1, 1);
+            ZeroAddress = MiMapPagesInZeroingPtes(ZeroingPtes, FirstPfn, Count);
             ASSERT(ZeroAddress);
-            RtlZeroMemory(ZeroAddress, PAGE_SIZE);
-            MiUnmapPagesInZeroSpace(ZeroAddress, 1);
+            KeZeroPagesFromIdleThread(ZeroAddress, Count * PAGE_SIZE);
+            MiUnmapPagesInZeroSpace(ZeroAddress, Count);
 
             OldIrql = MiAcquirePfnLock();
 
-            MiInsertPageInList(&MmZeroedPageListHead, PageIndex);
+            for (i = 0; i < Count; i++)
+            {
+                MiInsertPageInList(&MmZeroedPageListHead, Pages[i]);
+            }
         }
     }
 }
 
+static
+VOID
+NTAPI
+MiZeroPageWorkerThread(IN PVOID Context)
+{
+    PKTHREAD Thread = KeGetCurrentThread();
+    ULONG Processor = PtrToUlong(Context);
+    PMMPTE ZeroingPtes;
+
+    /* Stay on our processor, and only run when it has nothing else to do */
+    KeSetSystemAffinityThread(AFFINITY_MASK(Processor));
+    Thread->BasePriority = 0;
+    KeSetPriorityThread(Thread, 0);
+
+    /* Get our own zeroing PTEs, set up like the zero space */
+    ZeroingPtes = MiReserveSystemPtes(MI_ZERO_PTES, SystemPteSpace);
+    if (!ZeroingPtes)
+    {
+        DPRINT1("No zeroing PTEs for processor %lu\n", Processor);
+        PsTerminateSystemThread(STATUS_INSUFFICIENT_RESOURCES);
+    }
+    RtlZeroMemory(ZeroingPtes, MI_ZERO_PTES * sizeof(MMPTE));
+    ZeroingPtes->u.Hard.PageFrameNumber = MI_ZERO_PTES - 1;
+
+    MiZeroFreePages(ZeroingPtes);
+}
+
+VOID
+NTAPI
+MmZeroPageThread(VOID)
+{
+    PKTHREAD Thread = KeGetCurrentThread();
+    PVOID StartAddress, EndAddress;
+    HANDLE ThreadHandle;
+    NTSTATUS Status;
+    ULONG i;
+
+    /* Get the discardable sections to free them */
+    MiFindInitializationCode(&StartAddress, &EndAddress);
+    if (StartAddress) MiFreeInitializationCode(StartAddress, EndAddress);
+    DPRINT("Free non-cache pages: %lx\n", MmAvailablePages + MiMemoryConsumers[MC_CACHE].PagesUsed);
+
+    /* Set our priority to 0 */
+    Thread->BasePriority = 0;
+    KeSetPriorityThread(Thread, 0);
+
+    /* Other processors zero pages too when they are idle */
+    MiZeroPageThreads = 1;
+    for (i = 1; i < (ULONG)KeNumberProcessors; i++)
+    {
+        Status = PsCreateSystemThread(&ThreadHandle,
+                                      THREAD_ALL_ACCESS,
+                                      NULL,
+                                      NULL,
+                                      NULL,
+                                      MiZeroPageWorkerThread,
+                                      UlongToPtr(i));
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("Failed to create zero page thread for processor %lu: 0x%lx\n", i, Status);
+            break;
+        }
+
+        ZwClose(ThreadHandle);
+        InterlockedIncrementUL(&MiZeroPageThreads);
+    }
+
+    /* This one uses the zero space */
+    MiZeroFreePages(MiFirstReservedZeroingPte);
+}
+
 /* EOF */
@@ -180,12 +180,20 @@ MmTrimUserMemory(ULONG Target, ULONG Priority, PULONG NrFreedPages)
     PFN_NUMBER CurrentPage;
     PFN_NUMBER NextPage;
     NTSTATUS Status;
+    ULONG Ahead = 0;
 
     (*NrFreedPages) = 0;
 
     CurrentPage = MmGetLRUFirstUserPage();
     while (CurrentPage != 0 && Target > 0)
     {
+        /* Write the private pages coming next with a single request */
+        if (Ahead == 0)
+        {
+            Ahead = MmWriteSwapCluster(CurrentPage, Target);
+        }
+        Ahead--;
+
         Status = MmPageOutPhysicalAddress(CurrentPage);
         if (NT_SUCCESS(Status))
         {
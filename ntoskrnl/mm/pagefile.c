@@ -87,6 +87,22 @@ static PFN_COUNT MiReservedSwapPages;
 /* Make sure there can be only 16 paging files */
 C_ASSERT(FILE_FROM_ENTRY(0xffffffff) < MAX_PAGING_FILES);
 
+/*
+ * The balancer writes the private pages it is about to page out ahead of
+ * time, up to this many with a single request, while they are still mapped.
+ */
+#define MI_SWAP_CLUSTER_PAGES 16
+
+typedef struct _MI_SWAP_CLUSTER_PAGE
+{
+    PEPROCESS Process;
+    PVOID Address;
+} MI_SWAP_CLUSTER_PAGE, *PMI_SWAP_CLUSTER_PAGE;
+
+/* Paging file writes, see SystemPerformanceInformation */
+ULONG MmPagingFileWrites;
+ULONG MmPagingFilePagesWritten;
+
 static BOOLEAN MmSwapSpaceMessage = FALSE;
 
 static BOOLEAN MmSystemPageFileLocated = FALSE;
@@ -134,7 +150,7 @@ MmShowOutOfSpaceMessagePagingFile(VOID)
 
 NTSTATUS
 NTAPI
-MmWriteToSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
+MmWriteToSwapPages(SWAPENTRY SwapEntry, PPFN_NUMBER Pages, ULONG PageCount)
 {
     ULONG i;
     ULONG_PTR offset;
@@ -142,12 +158,12 @@ MmWriteToSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
     IO_STATUS_BLOCK Iosb;
     NTSTATUS Status;
     KEVENT Event;
-    UCHAR MdlBase[sizeof(MDL) + sizeof(ULONG)];
+    UCHAR MdlBase[sizeof(MDL) + MI_SWAP_CLUSTER_PAGES * sizeof(PFN_NUMBER)];
     PMDL Mdl = (PMDL)MdlBase;
 
-    DPRINT("MmWriteToSwapPage\n");
+    DPRINT("MmWriteToSwapPages\n");
 
-    if (SwapEntry == 0)
+    if (SwapEntry == 0 || PageCount == 0 || PageCount > MI_SWAP_CLUSTER_PAGES)
     {
         KeBugCheck(MEMORY_MANAGEMENT);
         return(STATUS_UNSUCCESSFUL);
@@ -163,8 +179,8 @@ MmWriteToSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
         KeBugCheck(MEMORY_MANAGEMENT);
     }
 
-    MmInitializeMdl(Mdl, NULL, PAGE_SIZE);
-    MmBuildMdlFromPages(Mdl, &Page);
+    MmInitializeMdl(Mdl, NULL, PageCount * PAGE_SIZE);
+    MmBuildMdlFromPages(Mdl, Pages);
     Mdl->MdlFlags |= MDL_PAGES_LOCKED;
 
     file_offset.QuadPart = offset * PAGE_SIZE;
@@ -185,9 +201,191 @@ MmWriteToSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
     {
         MmUnmapLockedPages (Mdl->MappedSystemVa, Mdl);
     }
+
+    /* The average pages per write can be derived from these */
+    InterlockedIncrementUL(&MmPagingFileWrites);
+    InterlockedExchangeAddUL(&MmPagingFilePagesWritten, PageCount);
+
     return(Status);
 }
 
+NTSTATUS
+NTAPI
+MmWriteToSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
+{
+    return MmWriteToSwapPages(SwapEntry, &Page, 1);
+}
+
+static
+VOID
+MiFreeSwapSlots(ULONG PageFileIndex, ULONG_PTR PageFileOffset, ULONG Count)
+{
+    PMMPAGING_FILE PagingFile;
+
+    /* Caller holds MmPageFileCreationLock */
+    PagingFile = MmPagingFile[PageFileIndex];
+    if (PagingFile == NULL)
+    {
+        KeBugCheck(MEMORY_MANAGEMENT);
+    }
+
+    RtlClearBits(PagingFile->Bitmap, (ULONG)PageFileOffset, Count);
+
+    PagingFile->FreeSpace += Count;
+    PagingFile->CurrentUsage -= Count;
+
+    MiFreeSwapPages += Count;
+    MiUsedSwapPages -= Count;
+}
+
+static
+SWAPENTRY
+MiAllocSwapRun(PULONG Count)
+{
+    ULONG i;
+    ULONG off;
+    ULONG Wanted;
+    PMMPAGING_FILE PagingFile;
+
+    /* Caller holds MmPageFileCreationLock */
+    if (MiFreeSwapPages == 0)
+    {
+        return(0);
+    }
+
+    for (i = 0; i < MAX_PAGING_FILES; i++)
+    {
+        PagingFile = MmPagingFile[i];
+        if (PagingFile == NULL || PagingFile->FreeSpace == 0)
+        {
+            continue;
+        }
+
+        /*
+         * Search from where the last run ended, so that consecutive
+         * allocations land next to each other. Settle for less when the
+         * file is too fragmented for the whole run.
+         */
+        Wanted = (ULONG)min(*Count, PagingFile->FreeSpace);
+        for (;;)
+        {
+            off = RtlFindClearBitsAndSet(PagingFile->Bitmap, Wanted, PagingFile->AllocationHint);
+            if (off != 0xFFFFFFFF || Wanted == 1)
+            {
+                break;
+            }
+            Wanted /= 2;
+        }
+
+        if (off == 0xFFFFFFFF)
+        {
+            KeBugCheck(MEMORY_MANAGEMENT);
+            return(0);
+        }
+
+        PagingFile->AllocationHint = off + Wanted;
+        PagingFile->FreeSpace -= Wanted;
+        PagingFile->CurrentUsage += Wanted;
+        MiUsedSwapPages += Wanted;
+        MiFreeSwapPages -= Wanted;
+
+        *Count = Wanted;
+        return ENTRY_FROM_FILE_OFFSET(i, off + 1);
+    }
+
+    KeBugCheck(MEMORY_MANAGEMENT);
+    return(0);
+}
+
+/*
+ * Writes the private pages among the next ones of the LRU list to the page
+ * file with one request, leaving them mapped. Returns how many pages of the
+ * list were looked at.
+ */
+ULONG
+NTAPI
+MmWriteSwapCluster(PFN_NUMBER FirstPage, ULONG MaxPages)
+{
+    MI_SWAP_CLUSTER_PAGE Cluster[MI_SWAP_CLUSTER_PAGES];
+    PFN_NUMBER Pages[MI_SWAP_CLUSTER_PAGES];
+    PFN_NUMBER CurrentPage, NextPage;
+    SWAPENTRY FirstEntry;
+    ULONG Walked, Count, RunLength, i;
+    NTSTATUS Status;
+
+    if (MaxPages > MI_SWAP_CLUSTER_PAGES)
+    {
+        MaxPages = MI_SWAP_CLUSTER_PAGES;
+    }
+
+    /* Pick the private pages among the next ones of the LRU list */
+    Count = 0;
+    Walked = 0;
+    CurrentPage = FirstPage;
+    while (CurrentPage != 0 && Walked < MaxPages)
+    {
+        Walked++;
+        if (MmPrepareSwapClusterPage(CurrentPage,
+                                     &Cluster[Count].Process,
+                                     &Cluster[Count].Address))
+        {
+            Pages[Count] = CurrentPage;
+            Count++;
+        }
+
+        NextPage = MmGetLRUNextUserPage(CurrentPage);
+        if (NextPage <= CurrentPage)
+        {
+            break;
+        }
+        CurrentPage = NextPage;
+    }
+
+    if (Count == 0)
+    {
+        return max(Walked, 1);
+    }
+
+    /* A fragmented paging file may give us less than asked for */
+    RunLength = Count;
+    KeAcquireGuardedMutex(&MmPageFileCreationLock);
+    FirstEntry = MiAllocSwapRun(&RunLength);
+    KeReleaseGuardedMutex(&MmPageFileCreationLock);
+
+    if (FirstEntry == 0)
+    {
+        RunLength = 0;
+    }
+    else
+    {
+        /*
+         * The pages are still mapped, so a failure only means they get
+         * written one at a time when they are paged out.
+         */
+        Status = MmWriteToSwapPages(FirstEntry, Pages, RunLength);
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("MM: Failed to write %lu pages to swap (Status was 0x%.8X)\n",
+                    RunLength, Status);
+            KeAcquireGuardedMutex(&MmPageFileCreationLock);
+            MiFreeSwapSlots(FILE_FROM_ENTRY(FirstEntry), OFFSET_FROM_ENTRY(FirstEntry) - 1, RunLength);
+            KeReleaseGuardedMutex(&MmPageFileCreationLock);
+            RunLength = 0;
+        }
+    }
+
+    for (i = 0; i < Count; i++)
+    {
+        MmFinishSwapClusterPage(Pages[i],
+                                Cluster[i].Process,
+                                Cluster[i].Address,
+                                i < RunLength ?
+                                ENTRY_FROM_FILE_OFFSET(FILE_FROM_ENTRY(FirstEntry),
+                                                       OFFSET_FROM_ENTRY(FirstEntry) + i) : 0);
+    }
+
+    return Walked;
+}
 
 NTSTATUS
 NTAPI
@@ -279,27 +477,12 @@ MmFreeSwapPage(SWAPENTRY Entry)
 {
     ULONG i;
     ULONG_PTR off;
-    PMMPAGING_FILE PagingFile;
 
     i = FILE_FROM_ENTRY(Entry);
     off = OFFSET_FROM_ENTRY(Entry) - 1;
 
     KeAcquireGuardedMutex(&MmPageFileCreationLock);
-
-    PagingFile = MmPagingFile[i];
-    if (PagingFile == NULL)
-    {
-        KeBugCheck(MEMORY_MANAGEMENT);
-    }
-
-    RtlClearBit(PagingFile->Bitmap, off >> 5);
-
-    PagingFile->FreeSpace++;
-    PagingFile->CurrentUsage--;
-
-    MiFreeSwapPages++;
-    MiUsedSwapPages--;
-
+    MiFreeSwapSlots(i, off, 1);
     KeReleaseGuardedMutex(&MmPageFileCreationLock);
 }
 
@@ -307,42 +490,14 @@ SWAPENTRY
 NTAPI
 MmAllocSwapPage(VOID)
 {
-    ULONG i;
-    ULONG off;
+    ULONG Count = 1;
     SWAPENTRY entry;
 
     KeAcquireGuardedMutex(&MmPageFileCreationLock);
-
-    if (MiFreeSwapPages == 0)
-    {
-        KeReleaseGuardedMutex(&MmPageFileCreationLock);
-        return(0);
-    }
-
-    for (i = 0; i < MAX_PAGING_FILES; i++)
-    {
-        if (MmPagingFile[i] != NULL &&
-                MmPagingFile[i]->FreeSpace >= 1)
-        {
-            off = RtlFindClearBitsAndSet(MmPagingFile[i]->Bitmap, 1, 0);
-            if (off == 0xFFFFFFFF)
-            {
-                KeBugCheck(MEMORY_MANAGEMENT);
-                KeReleaseGuardedMutex(&MmPageFileCreationLock);
-                return(STATUS_UNSUCCESSFUL);
-            }
-            MiUsedSwapPages++;
-            MiFreeSwapPages--;
-            KeReleaseGuardedMutex(&MmPageFileCreationLock);
-
-            entry = ENTRY_FROM_FILE_OFFSET(i, off + 1);
-            return(entry);
-        }
-    }
-
+    entry = MiAllocSwapRun(&Count);
     KeReleaseGuardedMutex(&MmPageFileCreationLock);
-    KeBugCheck(MEMORY_MANAGEMENT);
-    return(0);
+
+    return(entry);
 }
 
 NTSTATUS NTAPI
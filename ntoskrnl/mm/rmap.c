@@ -190,6 +190,132 @@ MmPageOutPhysicalAddress(PFN_NUMBER Page)
     return(Status);
 }
 
+BOOLEAN
+NTAPI
+MmPrepareSwapClusterPage(PFN_NUMBER Page, PEPROCESS *Process, PVOID *Address)
+{
+    PMM_RMAP_ENTRY entry;
+    PMEMORY_AREA MemoryArea;
+    PMM_SECTION_SEGMENT Segment;
+    PEPROCESS OwnerProcess;
+    PVOID OwnerAddress;
+    LARGE_INTEGER Offset;
+    ULONG_PTR Entry;
+    BOOLEAN Private = FALSE;
+    KIRQL OldIrql;
+
+    /*
+     * Only private pages with a single user mapping are written ahead,
+     * the others keep going through MmPageOutSectionView alone.
+     */
+    ExAcquireFastMutex(&RmapListLock);
+    entry = MmGetRmapListHeadPage(Page);
+    if (entry == NULL || entry->Next != NULL ||
+        RMAP_IS_SEGMENT(entry->Address) ||
+        entry->Address >= MmSystemRangeStart)
+    {
+        ExReleaseFastMutex(&RmapListLock);
+        return FALSE;
+    }
+
+    OwnerProcess = entry->Process;
+    OwnerAddress = entry->Address;
+
+    if (!ExAcquireRundownProtection(&OwnerProcess->RundownProtect))
+    {
+        ExReleaseFastMutex(&RmapListLock);
+        return FALSE;
+    }
+    if (!NT_SUCCESS(ObReferenceObjectByPointer(OwnerProcess, PROCESS_ALL_ACCESS, NULL, KernelMode)))
+    {
+        ExReleaseFastMutex(&RmapListLock);
+        ExReleaseRundownProtection(&OwnerProcess->RundownProtect);
+        return FALSE;
+    }
+    ExReleaseFastMutex(&RmapListLock);
+
+    MmLockAddressSpace(&OwnerProcess->Vm);
+    MemoryArea = MmLocateMemoryAreaByAddress(&OwnerProcess->Vm, OwnerAddress);
+    if (MemoryArea != NULL &&
+        !MemoryArea->DeleteInProgress &&
+        MemoryArea->Type == MEMORY_AREA_SECTION_VIEW &&
+        MmIsPagePresent(OwnerProcess, OwnerAddress) &&
+        MmGetPfnForProcess(OwnerProcess, OwnerAddress) == Page)
+    {
+        Segment = MemoryArea->Data.SectionData.Segment;
+        Offset.QuadPart = MemoryArea->Data.SectionData.ViewOffset.QuadPart +
+                          ((ULONG_PTR)OwnerAddress - MA_GetStartingAddress(MemoryArea));
+
+        /* A page being paged out already has a wait entry, leave it alone */
+        MmLockSectionSegment(Segment);
+        Entry = MmGetPageEntrySectionSegment(Segment, &Offset);
+        if (!(Entry && MM_IS_WAIT_PTE(Entry)) &&
+            !(Segment->Flags & MM_PAGEFILE_SEGMENT) &&
+            (IS_SWAP_FROM_SSE(Entry) || PFN_FROM_SSE(Entry) != Page) &&
+            MmGetSavedSwapEntryPage(Page) == 0 &&
+            MmGetReferenceCountPage(Page) == 1)
+        {
+            /*
+             * Written while the page is clean, so that the copy in the page
+             * file is known to be stale if it is dirty again at page out
+             */
+            MmSetCleanPage(OwnerProcess, OwnerAddress);
+
+            /* The page must stay around until it has been written */
+            OldIrql = MiAcquirePfnLock();
+            MmReferencePage(Page);
+            MiReleasePfnLock(OldIrql);
+
+            Private = TRUE;
+        }
+        MmUnlockSectionSegment(Segment);
+    }
+    MmUnlockAddressSpace(&OwnerProcess->Vm);
+
+    if (!Private)
+    {
+        ExReleaseRundownProtection(&OwnerProcess->RundownProtect);
+        ObDereferenceObject(OwnerProcess);
+        return FALSE;
+    }
+
+    *Process = OwnerProcess;
+    *Address = OwnerAddress;
+    return TRUE;
+}
+
+VOID
+NTAPI
+MmFinishSwapClusterPage(PFN_NUMBER Page, PEPROCESS Process, PVOID Address, SWAPENTRY SwapEntry)
+{
+    /*
+     * Give the page its copy in the page file if it is still mapped where it
+     * was, MmPageOutSectionView then pages it out without writing it again.
+     */
+    if (SwapEntry != 0)
+    {
+        MmLockAddressSpace(&Process->Vm);
+        if (MmIsPagePresent(Process, Address) &&
+            MmGetPfnForProcess(Process, Address) == Page &&
+            MmGetSavedSwapEntryPage(Page) == 0)
+        {
+            MmSetSavedSwapEntryPage(Page, SwapEntry);
+            SwapEntry = 0;
+        }
+        MmUnlockAddressSpace(&Process->Vm);
+
+        if (SwapEntry != 0)
+        {
+            MmFreeSwapPage(SwapEntry);
+        }
+    }
+
+    /* Drop what MmPrepareSwapClusterPage took */
+    MmReleasePageMemoryConsumer(MC_USER, Page);
+    ExReleaseRundownProtection(&Process->RundownProtect);
+    ObDereferenceObject(Process);
+}
+
 VOID
 NTAPI
 MmSetCleanAllRmaps(PFN_NUMBER Page)
@@ -137,6 +137,15 @@ POBJECT_TYPE MmSectionObjectType = NULL;
 
 ULONG_PTR MmSubsectionBase;
 
+/*
+ * Most pages a fault on a file backed view maps at once, the faulting one
+ * included. Random faults start with the smaller window, which doubles for
+ * every fault continuing where the previous window ended.
+ */
+ULONG MmSectionFaultClusterSize = 16;
+#define MI_SECTION_FAULT_CLUSTER_MIN 4
+#define MI_SECTION_FAULT_CLUSTER_MAX 32
+
 static ULONG SectionCharacteristicsToProtect[16] =
 {
     PAGE_NOACCESS,          /* 0 = NONE */
@@ -1278,6 +1287,220 @@ MiReadPage(PMEMORY_AREA MemoryArea,
 }
 #endif
 
+#ifndef NEWCC
+static
+ULONG
+MiReserveFaultCluster(PMMSUPPORT AddressSpace,
+                      PMEMORY_AREA MemoryArea,
+                      PMM_REGION Region,
+                      PVOID PAddress,
+                      PVOID *ClusterStart)
+/*
+ * FUNCTION: Choose the pages to map along with a faulting page of a file
+ * backed view, and mark them as being read like the faulting page is.
+ * Only pages of the cache view holding the faulting page are considered,
+ * since that view is read whole anyway.
+ * RETURNS: A mask of the pages reserved, relative to ClusterStart.
+ * NOTE: The address space and the segment must be locked.
+ */
+{
+    PEPROCESS Process = MmGetAddressSpaceOwner(AddressSpace);
+    PMM_SECTION_SEGMENT Segment = MemoryArea->Data.SectionData.Segment;
+    PROS_SECTION_OBJECT Section = MemoryArea->Data.SectionData.Section;
+    ULONG_PTR Start, End, Address, ViewBase;
+    LARGE_INTEGER Offset;
+    LONGLONG FileOffset;
+    ULONG ClusterSize, Mask, i;
+    PMM_REGION PageRegion;
+
+    *ClusterStart = PAddress;
+
+    if (MmSectionFaultClusterSize <= 1 ||
+        Section->FileObject == NULL ||
+        (Segment->Flags & MM_PAGEFILE_SEGMENT) ||
+        (Segment->Image.Characteristics & IMAGE_SCN_MEM_SHARED))
+    {
+        return 0;
+    }
+
+    /* Sequential access gets a growing window starting at the fault */
+    ClusterSize = min(MmSectionFaultClusterSize, MI_SECTION_FAULT_CLUSTER_MAX);
+    if (PAddress == MemoryArea->Data.SectionData.NextFaultAddress)
+    {
+        ClusterSize = min(MemoryArea->Data.SectionData.FaultClusterSize * 2, ClusterSize);
+        Start = (ULONG_PTR)PAddress;
+    }
+    else
+    {
+        ClusterSize = min(MI_SECTION_FAULT_CLUSTER_MIN, ClusterSize);
+        Start = ALIGN_DOWN_BY((ULONG_PTR)PAddress, ClusterSize * PAGE_SIZE);
+    }
+    End = Start + ClusterSize * PAGE_SIZE;
+
+    MemoryArea->Data.SectionData.FaultClusterSize = ClusterSize;
+    MemoryArea->Data.SectionData.NextFaultAddress = (PVOID)End;
+
+    /* Stay within the view and the cache view of the faulting page */
+    ViewBase = MA_GetStartingAddress(MemoryArea);
+    Offset.QuadPart = (ULONG_PTR)PAddress - ViewBase + MemoryArea->Data.SectionData.ViewOffset.QuadPart;
+    FileOffset = Offset.QuadPart + Segment->Image.FileOffset;
+    if ((FileOffset % PAGE_SIZE) != 0)
+    {
+        return 0;
+    }
+    Start = max(Start, (ULONG_PTR)PAddress - (ULONG_PTR)(FileOffset % VACB_MAPPING_GRANULARITY));
+    Start = max(Start, ViewBase);
+    End = min(End, (ULONG_PTR)PAddress + (ULONG_PTR)(VACB_MAPPING_GRANULARITY - FileOffset % VACB_MAPPING_GRANULARITY));
+    End = min(End, MA_GetEndingAddress(MemoryArea));
+
+    Mask = 0;
+    for (Address = Start, i = 0; Address < End; Address += PAGE_SIZE, i++)
+    {
+        if (Address == (ULONG_PTR)PAddress)
+        {
+            continue;
+        }
+
+        Offset.QuadPart = Address - ViewBase + MemoryArea->Data.SectionData.ViewOffset.QuadPart;
+        if (Offset.QuadPart + PAGE_SIZE > Segment->RawLength.QuadPart)
+        {
+            break;
+        }
+
+        /* Only pages nobody has touched, with the protection of the faulting one */
+        PageRegion = MmFindRegion((PVOID)ViewBase,
+                                  &MemoryArea->Data.SectionData.RegionListHead,
+                                  (PVOID)Address, NULL);
+        if (PageRegion != Region ||
+            MmGetPageEntrySectionSegment(Segment, &Offset) != 0 ||
+            MmIsPagePresent(Process, (PVOID)Address) ||
+            MmIsDisabledPage(Process, (PVOID)Address) ||
+            MmIsPageSwapEntry(Process, (PVOID)Address))
+        {
+            continue;
+        }
+
+        MmSetPageEntrySectionSegment(Segment, &Offset, MAKE_SWAP_SSE(MM_WAIT_ENTRY));
+        Mask |= (1UL << i);
+    }
+
+    *ClusterStart = (PVOID)Start;
+    return Mask;
+}
+
+static
+BOOLEAN
+MiGetCachedPage(PMEMORY_AREA MemoryArea,
+                LONGLONG SegOffset,
+                PPFN_NUMBER Page)
+/*
+ * FUNCTION: Get the page backing a section offset from an up to date cache
+ * view, without reading anything. The page is accounted as mapped, as
+ * MiReadPage does for the direct mapped case.
+ */
+{
+    PROS_SHARED_CACHE_MAP SharedCacheMap;
+    LONGLONG BaseOffset;
+    LONGLONG FileOffset;
+    PVOID BaseAddress;
+    BOOLEAN UptoDate;
+    PROS_VACB Vacb;
+    NTSTATUS Status;
+
+    SharedCacheMap = MemoryArea->Data.SectionData.Section->FileObject->SectionObjectPointer->SharedCacheMap;
+    FileOffset = SegOffset + MemoryArea->Data.SectionData.Segment->Image.FileOffset;
+
+    Status = CcRosGetVacb(SharedCacheMap,
+                          FileOffset,
+                          &BaseOffset,
+                          &BaseAddress,
+                          &UptoDate,
+                          &Vacb);
+    if (!NT_SUCCESS(Status))
+    {
+        return FALSE;
+    }
+    if (!UptoDate)
+    {
+        CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE, FALSE);
+        return FALSE;
+    }
+
+    /* Probe the page, since it's PDE might not be synced */
+    (void)*((volatile char*)BaseAddress + FileOffset - BaseOffset);
+
+    (*Page) = MmGetPhysicalAddress((char*)BaseAddress +
+                                   FileOffset - BaseOffset).LowPart >> PAGE_SHIFT;
+
+    CcRosReleaseVacb(SharedCacheMap, Vacb, TRUE, FALSE, TRUE);
+    return TRUE;
+}
+
+static
+VOID
+MiFinishFaultCluster(PMMSUPPORT AddressSpace,
+                     PMEMORY_AREA MemoryArea,
+                     PVOID ClusterStart,
+                     ULONG ReservedMask,
+                     ULONG ReadMask,
+                     PPFN_NUMBER Pages,
+                     ULONG Attributes)
+/*
+ * FUNCTION: Map the pages of a fault cluster that could be read, and give
+ * up the others.
+ * NOTE: The address space and the segment must be locked.
+ */
+{
+    PEPROCESS Process = MmGetAddressSpaceOwner(AddressSpace);
+    PMM_SECTION_SEGMENT Segment = MemoryArea->Data.SectionData.Segment;
+    PROS_SHARED_CACHE_MAP SharedCacheMap;
+    SWAPENTRY FakeSwapEntry;
+    LARGE_INTEGER Offset;
+    PVOID Address;
+    NTSTATUS Status;
+    ULONG i;
+
+    SharedCacheMap = MemoryArea->Data.SectionData.Section->FileObject->SectionObjectPointer->SharedCacheMap;
+
+    for (i = 0; i < MI_SECTION_FAULT_CLUSTER_MAX; i++)
+    {
+        if (!(ReservedMask & (1UL << i)))
+        {
+            continue;
+        }
+
+        Address = (PCHAR)ClusterStart + i * PAGE_SIZE;
+        Offset.QuadPart = (ULONG_PTR)Address - MA_GetStartingAddress(MemoryArea)
+                          + MemoryArea->Data.SectionData.ViewOffset.QuadPart;
+
+        MmDeletePageFileMapping(Process, Address, &FakeSwapEntry);
+
+        if (!(ReadMask & (1UL << i)))
+        {
+            MmSetPageEntrySectionSegment(Segment, &Offset, 0);
+            continue;
+        }
+
+        Status = MmCreateVirtualMapping(Process,
+                                        Address,
+                                        Attributes,
+                                        &Pages[i],
+                                        1);
+        if (!NT_SUCCESS(Status))
+        {
+            /* Not mapping it is fine, it stays in the cache */
+            MmSetPageEntrySectionSegment(Segment, &Offset, 0);
+            CcRosUnmapVacb(SharedCacheMap,
+                           Offset.QuadPart + Segment->Image.FileOffset,
+                           FALSE);
+            continue;
+        }
+        MmInsertRmap(Pages[i], Process, Address);
+        MmSetPageEntrySectionSegment(Segment, &Offset, MAKE_SSE(Pages[i] << PAGE_SHIFT, 1));
+    }
+}
+#endif
+
 static VOID
 MmAlterViewAttributes(PMMSUPPORT AddressSpace,
                       PVOID BaseAddress,
@@ -1602,6 +1825,11 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
     if (Entry == 0)
     {
         SWAPENTRY FakeSwapEntry;
+#ifndef NEWCC
+        PVOID ClusterStart;
+        ULONG ClusterMask, ReadMask, i;
+        PFN_NUMBER ClusterPages[MI_SECTION_FAULT_CLUSTER_MAX];
+#endif
 
         /*
          * If the entry is zero (and it can't change because we have
@@ -1612,8 +1840,21 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
          * Release all our locks and read in the page from disk
          */
         MmSetPageEntrySectionSegment(Segment, &Offset, MAKE_SWAP_SSE(MM_WAIT_ENTRY));
+#ifndef NEWCC
+        /* Take the neighbouring pages along, if they are still untouched */
+        ClusterMask = MiReserveFaultCluster(AddressSpace, MemoryArea, Region, PAddress, &ClusterStart);
+#endif
         MmUnlockSectionSegment(Segment);
         MmCreatePageFileMapping(Process, PAddress, MM_WAIT_ENTRY);
+#ifndef NEWCC
+        for (i = 0; i < MI_SECTION_FAULT_CLUSTER_MAX; i++)
+        {
+            if (ClusterMask & (1UL << i))
+            {
+                MmCreatePageFileMapping(Process, (PCHAR)ClusterStart + i * PAGE_SIZE, MM_WAIT_ENTRY);
+            }
+        }
+#endif
         MmUnlockAddressSpace(AddressSpace);
 
         if ((Segment->Flags & MM_PAGEFILE_SEGMENT) ||
@@ -1638,6 +1879,22 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
                 DPRINT1("MiReadPage failed (Status %x)\n", Status);
             }
         }
+
+#ifndef NEWCC
+        /* The neighbours come from the cache view that was just read */
+        ReadMask = 0;
+        for (i = 0; NT_SUCCESS(Status) && i < MI_SECTION_FAULT_CLUSTER_MAX; i++)
+        {
+            if ((ClusterMask & (1UL << i)) &&
+                MiGetCachedPage(MemoryArea,
+                                Offset.QuadPart + ((PCHAR)ClusterStart + i * PAGE_SIZE - (PCHAR)PAddress),
+                                &ClusterPages[i]))
+            {
+                ReadMask |= (1UL << i);
+            }
+        }
+#endif
+
         if (!NT_SUCCESS(Status))
         {
             /*
@@ -1647,6 +1904,15 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
              * Cleanup and release locks
              */
             MmLockAddressSpace(AddressSpace);
+#ifndef NEWCC
+            if (ClusterMask)
+            {
+                MmLockSectionSegment(Segment);
+                MiFinishFaultCluster(AddressSpace, MemoryArea, ClusterStart,
+                                     ClusterMask, 0, ClusterPages, Attributes);
+                MmUnlockSectionSegment(Segment);
+            }
+#endif
             MiSetPageEvent(Process, Address);
             DPRINT("Address 0x%p\n", Address);
             return(Status);
@@ -1656,6 +1922,14 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
         MmLockAddressSpace(AddressSpace);
         MmLockSectionSegment(Segment);
 
+#ifndef NEWCC
+        if (ClusterMask)
+        {
+            MiFinishFaultCluster(AddressSpace, MemoryArea, ClusterStart,
+                                 ClusterMask, ReadMask, ClusterPages, Attributes);
+        }
+#endif
+
         MmDeletePageFileMapping(Process, PAddress, &FakeSwapEntry);
         DPRINT("CreateVirtualMapping Page %x Process %p PAddress %p Attributes %x\n",
                Page, Process, PAddress, Attributes);
@@ -2200,9 +2474,13 @@ MmPageOutSectionView(PMMSUPPORT AddressSpace,
         DPRINT("Not dirty and private and not swapped (%p:%p)\n", Process, Address);
         MmSetSavedSwapEntryPage(Page, 0);
         MmLockAddressSpace(AddressSpace);
+        MmLockSectionSegment(Context.Segment);
         Status = MmCreatePageFileMapping(Process,
                                          Address,
                                          SwapEntry);
+        /* We had placed a wait entry upon entry ... replace it before leaving */
+        MmSetPageEntrySectionSegment(Context.Segment, &Context.Offset, Entry);
+        MmUnlockSectionSegment(Context.Segment);
         MmUnlockAddressSpace(AddressSpace);
         if (!NT_SUCCESS(Status))
         {
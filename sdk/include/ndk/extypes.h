@@ -654,6 +654,9 @@ typedef struct _HANDLE_TABLE
         UCHAR StrictFIFO:1;
     };
 #endif
+#ifdef __REACTOS__ // ReactOS improvement
+    PVOID FreeHandleCache;
+#endif
 } HANDLE_TABLE, *PHANDLE_TABLE;
 
 #endif
@@ -69,6 +69,7 @@ typedef NTSTATUS *PNTSTATUS;
 #define MS_PRIMITIVE_PROVIDER L"Microsoft Primitive Provider"
 #define MS_PLATFORM_CRYPTO_PROVIDER L"Microsoft Platform Crypto Provider"
 
+#define BCRYPT_AES_ALGORITHM        L"AES"
 #define BCRYPT_MD5_ALGORITHM        L"MD5"
 #define BCRYPT_RNG_ALGORITHM        L"RNG"
 #define BCRYPT_SHA1_ALGORITHM       L"SHA1"
@@ -79,6 +80,13 @@ typedef NTSTATUS *PNTSTATUS;
 #define BCRYPT_ECDSA_P384_ALGORITHM L"ECDSA_P384"
 #define BCRYPT_ECDSA_P521_ALGORITHM L"ECDSA_P521"
 
+#define BCRYPT_CHAIN_MODE_NA  L"ChainingModeN/A"
+#define BCRYPT_CHAIN_MODE_CBC L"ChainingModeCBC"
+#define BCRYPT_CHAIN_MODE_ECB L"ChainingModeECB"
+#define BCRYPT_CHAIN_MODE_CFB L"ChainingModeCFB"
+#define BCRYPT_CHAIN_MODE_CCM L"ChainingModeCCM"
+#define BCRYPT_CHAIN_MODE_GCM L"ChainingModeGCM"
+
 #define BCRYPT_ECDSA_PUBLIC_P256_MAGIC  0x31534345
 #define BCRYPT_ECDSA_PRIVATE_P256_MAGIC 0x32534345
 #define BCRYPT_ECDSA_PUBLIC_P384_MAGIC  0x33534345
@@ -149,6 +157,8 @@ typedef struct _BCRYPT_PKCS1_PADDING_INFO
     LPCWSTR pszAlgId;
 } BCRYPT_PKCS1_PADDING_INFO;
 
+#define BCRYPT_BLOCK_PADDING 0x00000001
+
 #define BCRYPT_PAD_NONE   0x00000001
 #define BCRYPT_PAD_PKCS1  0x00000002
 #define BCRYPT_PAD_OAEP   0x00000004
@@ -156,6 +166,11 @@ typedef struct _BCRYPT_PKCS1_PADDING_INFO
 
 #define BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO_VERSION 1
 
+#define BCRYPT_INIT_AUTH_MODE_INFO(_AUTH_INFO_STRUCT_) \
+    RtlZeroMemory((&_AUTH_INFO_STRUCT_), sizeof(BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO)); \
+    (_AUTH_INFO_STRUCT_).cbSize = sizeof(BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO); \
+    (_AUTH_INFO_STRUCT_).dwInfoVersion = BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO_VERSION;
+
 #define BCRYPT_AUTH_MODE_CHAIN_CALLS_FLAG 0x00000001
 #define BCRYPT_AUTH_MODE_IN_PROGRESS_FLAG 0x00000002
 
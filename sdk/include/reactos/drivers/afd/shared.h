@@ -262,6 +262,10 @@ typedef struct _AFD_TDI_HANDLE_DATA
 #define AFD_GET_PENDING_CONNECT_DATA	41
 #define AFD_VALIDATE_GROUP		42
 
+/* ReactOS extensions */
+#define AFD_POLL_SET_UPDATE		64
+#define AFD_POLL_SET_WAIT		65
+
 /* AFD IOCTLs */
 
 #define IOCTL_AFD_BIND \
@@ -337,6 +341,15 @@ typedef struct _AFD_TDI_HANDLE_DATA
 #define IOCTL_AFD_VALIDATE_GROUP \
   _AFD_CONTROL_CODE(AFD_VALIDATE_GROUP, METHOD_NEITHER)
 
+/* Both take an AFD_POLL_INFO on a control channel. UPDATE adds the handles
+ * to the poll set of the channel, changes their events, or removes them when
+ * the events are 0. WAIT returns the handles with events pending, waiting for
+ * at most Timeout when there are none. */
+#define IOCTL_AFD_POLL_SET_UPDATE \
+  _AFD_CONTROL_CODE(AFD_POLL_SET_UPDATE, METHOD_BUFFERED )
+#define IOCTL_AFD_POLL_SET_WAIT \
+  _AFD_CONTROL_CODE(AFD_POLL_SET_WAIT, METHOD_BUFFERED )
+
 typedef struct _AFD_SOCKET_INFORMATION {
     BOOL CommandChannel;
     INT AddressFamily;
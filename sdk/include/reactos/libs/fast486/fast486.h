@@ -116,6 +116,24 @@
 C_ASSERT((FAST486_CACHE_SIZE >= sizeof(ULONG))
          && (FAST486_CACHE_SIZE <= FAST486_PAGE_SIZE));
 
+/*
+ * Decoded block cache. A block holds a copy of up to FAST486_BLOCK_SIZE bytes
+ * of code and the straight-line instructions decoded from it. It never
+ * crosses a page boundary, and offsets inside it must fit in a UCHAR.
+ * Writes done by the CPU invalidate the blocks they hit, the host must call
+ * Fast486FlushBlockCache when it changes code in other ways, except from
+ * a BOP handler.
+ */
+#define FAST486_BLOCK_SIZE          64
+#define FAST486_BLOCK_INSTRUCTIONS  16
+#define FAST486_NUM_BLOCKS          1024
+#define FAST486_NUM_BLOCK_BUCKETS   256
+#define FAST486_NUM_PHYS_PAGES      0x100000
+
+C_ASSERT((FAST486_BLOCK_SIZE >= sizeof(ULONG))
+         && (FAST486_BLOCK_SIZE <= FAST486_PAGE_SIZE)
+         && (FAST486_BLOCK_SIZE <= 0xFF));
+
 struct _FAST486_STATE;
 typedef struct _FAST486_STATE FAST486_STATE, *PFAST486_STATE;
 
@@ -511,6 +529,46 @@ typedef union _FAST486_FPU_CONTROL_REG
     };
 } FAST486_FPU_CONTROL_REG, *PFAST486_FPU_CONTROL_REG;
 
+typedef struct _FAST486_DECODED_INST
+{
+    VOID (FASTCALL *Handler)(PFAST486_STATE State, UCHAR Opcode);
+    ULONG PrefixFlags;
+    ULONG Displacement;
+    UCHAR Opcode;
+    UCHAR SegmentOverride;
+    UCHAR Offset;       // From the start of the block
+    UCHAR OpcodeLength; // Prefixes and opcode
+    UCHAR ModRmLength;  // ModR/M, SIB and displacement; 0 if there are none
+    UCHAR ModRm;
+    UCHAR Sib;
+} FAST486_DECODED_INST, *PFAST486_DECODED_INST;
+
+typedef struct _FAST486_BLOCK
+{
+    struct _FAST486_BLOCK *NextInPage;
+    ULONG Generation;
+    ULONG LinearAddress;
+    ULONG PhysicalAddress;
+    UCHAR Mode;         // CS size, CPL and paging mode it was decoded for
+    UCHAR Size;         // Bytes in Code, 0 if the block is free
+    UCHAR Length;       // Bytes decoded so far
+    UCHAR Count;        // Instructions decoded so far
+    UCHAR Code[FAST486_BLOCK_SIZE];
+    FAST486_DECODED_INST Instructions[FAST486_BLOCK_INSTRUCTIONS];
+} FAST486_BLOCK, *PFAST486_BLOCK;
+
+typedef struct _FAST486_BLOCK_CACHE
+{
+    ULONG Generation;
+    ULONG Hits;
+    ULONG Misses;
+    ULONG Revalidations;
+    ULONG Invalidations;
+    PFAST486_BLOCK PageBuckets[FAST486_NUM_BLOCK_BUCKETS];
+    ULONG CodePages[FAST486_NUM_PHYS_PAGES / 32];
+    FAST486_BLOCK Blocks[FAST486_NUM_BLOCKS];
+} FAST486_BLOCK_CACHE, *PFAST486_BLOCK_CACHE;
+
 struct _FAST486_STATE
 {
     FAST486_MEM_READ_PROC MemReadCallback;
@@ -544,6 +602,14 @@ struct _FAST486_STATE
     ULONG PrefetchAddress;
     UCHAR PrefetchCache[FAST486_CACHE_SIZE];
 #endif
+#ifndef FAST486_NO_BLOCK_CACHE
+    PFAST486_BLOCK_CACHE BlockCache;
+    PFAST486_BLOCK CurrentBlock;
+    PFAST486_DECODED_INST DecodedInst;
+    ULONG CurrentInstruction;
+    ULONG BlockFetchEnd;
+    BOOLEAN Recording;
+#endif
 #ifndef FAST486_NO_FPU
     FAST486_FPU_DATA_REG FpuRegisters[FAST486_NUM_FPU_REGS];
     FAST486_FPU_STATUS_REG FpuStatus;
@@ -568,7 +634,8 @@ Fast486Initialize(PFAST486_STATE         State,
                   FAST486_BOP_PROC       BopCallback,
                   FAST486_INT_ACK_PROC   IntAckCallback,
                   FAST486_FPU_PROC       FpuCallback,
-                  PULONG                 Tlb);
+                  PULONG                 Tlb,
+                  PFAST486_BLOCK_CACHE   BlockCache);
 
 VOID
 NTAPI
@@ -619,6 +686,10 @@ VOID
 NTAPI
 Fast486Rewind(PFAST486_STATE State);
 
+VOID
+NTAPI
+Fast486FlushBlockCache(PFAST486_STATE State);
+
 #endif // _FAST486_H_
 
 /* EOF */
@@ -0,0 +1,55 @@
+/*
+ * PROJECT:     ReactOS Kernel
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     ReactOS-private NtQuerySystemInformation classes
+ */
+
+#pragma once
+
+//
+// These classes are not part of SYSTEM_INFORMATION_CLASS, and are numbered
+// far enough from it that Windows never uses them. Cast them to
+// SYSTEM_INFORMATION_CLASS to query them. The NDK has to be included first.
+//
+typedef enum _SYSTEM_ROS_INFORMATION_CLASS
+{
+    SystemRosInformationBase = 0x10000,
+    SystemRosWorkQueueInformation = SystemRosInformationBase,
+    SystemRosContextSwitchInformation,
+    MaxSystemRosInfoClass
+} SYSTEM_ROS_INFORMATION_CLASS;
+
+//
+// SystemRosWorkQueueInformation returns one of these per work queue.
+// The wait times are in microseconds.
+//
+#define SYSTEM_WORK_QUEUE_WAIT_BUCKETS 10
+
+typedef struct _SYSTEM_WORK_QUEUE_INFORMATION
+{
+    ULONG QueueType;
+    ULONG QueueDepth;
+    ULONG WorkerCount;
+    ULONG ActiveWorkers;
+    ULONG DynamicWorkers;
+    ULONG WorkItemsProcessed;
+    ULONG ItemsPerSecond;
+    ULONG AverageWaitTime;
+    ULONG MaximumWaitTime;
+    ULONG WaitTimeHistogram[SYSTEM_WORK_QUEUE_WAIT_BUCKETS];
+} SYSTEM_WORK_QUEUE_INFORMATION, *PSYSTEM_WORK_QUEUE_INFORMATION;
+
+//
+// SystemRosContextSwitchInformation returns the SystemContextSwitchInformation
+// counters followed by those of the per-processor ready queues.
+// The PRCB lock statistics stay zero on free builds.
+//
+typedef struct _SYSTEM_CONTEXT_SWITCH_INFORMATION_EX
+{
+    SYSTEM_CONTEXT_SWITCH_INFORMATION Standard;
+    ULONG IdleSteals;
+    ULONG Migrations;
+    ULONG PrcbLockAcquires;
+    ULONG PrcbLockContention;
+    ULONGLONG PrcbLockHoldCycles;
+} SYSTEM_CONTEXT_SWITCH_INFORMATION_EX, *PSYSTEM_CONTEXT_SWITCH_INFORMATION_EX;
@@ -0,0 +1,30 @@
+/*
+ * COPYRIGHT:   See COPYING in the top level directory
+ * PROJECT:     ReactOS WinSock 2 API
+ * FILE:        include/reactos/winsock/wsppoll.h
+ * PURPOSE:     Poll extension of the ReactOS service provider
+ */
+
+#ifndef __WSPPOLL_H
+#define __WSPPOLL_H
+
+/*
+ * The SPI has no poll entry point. The ReactOS provider returns one from
+ * SIO_GET_EXTENSION_FUNCTION_POINTER, and WSAPoll falls back to select
+ * with providers that don't.
+ */
+#define WSAID_ROS_POLL \
+  {0x238b739b,0xa08b,0x4367,{0x9f,0x3e,0x3b,0x84,0xbb,0xc8,0x16,0x44}}
+
+/* WSAPOLLFD, only defined for Vista and later */
+struct pollfd;
+
+/* Same arguments and results as WSAPoll, for sockets of the provider */
+typedef INT
+(WSPAPI *LPFN_WSPPOLL)(
+    IN OUT struct pollfd *fdArray,
+    IN ULONG fds,
+    IN INT timeout,
+    OUT LPINT lpErrno);
+
+#endif /* __WSPPOLL_H */
@@ -0,0 +1,285 @@
+/*
+ * COPYRIGHT:   See COPYING in the top level directory
+ * PROJECT:     ReactOS TCP/IP protocol driver
+ * FILE:        network/fibtrie.c
+ * PURPOSE:     Longest prefix match trie for the forward information base
+ * NOTES:
+ *   The trie only knows about prefixes, the routes hanging off its nodes
+ *   belong to the caller, which also provides the locking. A lookup walks
+ *   at most one node per bit of the address, whatever the number of routes.
+ */
+
+#include "precomp.h"
+
+#define FIB_PREFIX_MASK(Length) ((Length) ? 0xFFFFFFFF << (32 - (Length)) : 0)
+#define FIB_PREFIX_BIT(Prefix, Index) (((Prefix) >> (31 - (Index))) & 1)
+
+
+static UINT FibCommonPrefixLength(
+    ULONG Prefix1,
+    ULONG Prefix2)
+{
+    ULONG Difference = Prefix1 ^ Prefix2;
+    UINT Length;
+
+    for (Length = 0; Length < 32 && !(Difference & (0x80000000 >> Length)); Length++);
+
+    return Length;
+}
+
+
+static VOID FibInitializeNode(
+    PFIB_NODE Node,
+    ULONG Prefix,
+    UINT PrefixLength)
+{
+    Node->Parent = NULL;
+    Node->Child[0] = NULL;
+    Node->Child[1] = NULL;
+    Node->Mask = FIB_PREFIX_MASK(PrefixLength);
+    Node->Prefix = Prefix & Node->Mask;
+    Node->PrefixLength = PrefixLength;
+    Node->Routes = NULL;
+}
+
+
+static VOID FibReplaceChild(
+    PFIB_TRIE Trie,
+    PFIB_NODE Parent,
+    PFIB_NODE OldChild,
+    PFIB_NODE NewChild)
+{
+    if (!Parent)
+        Trie->Root = NewChild;
+    else if (Parent->Child[0] == OldChild)
+        Parent->Child[0] = NewChild;
+    else
+        Parent->Child[1] = NewChild;
+
+    if (NewChild)
+        NewChild->Parent = Parent;
+}
+
+
+VOID FibTrieInitialize(
+    PFIB_TRIE Trie,
+    PFIB_ALLOCATE_NODE AllocateNode,
+    PFIB_FREE_NODE FreeNode)
+/*
+ * FUNCTION: Initializes an empty trie
+ * ARGUMENTS:
+ *     Trie         = Pointer to the trie
+ *     AllocateNode = Routine used to allocate nodes
+ *     FreeNode     = Routine used to free nodes
+ */
+{
+    Trie->Root = NULL;
+    Trie->AllocateNode = AllocateNode;
+    Trie->FreeNode = FreeNode;
+}
+
+
+PFIB_NODE FibTrieInsert(
+    PFIB_TRIE Trie,
+    ULONG Prefix,
+    UINT PrefixLength)
+/*
+ * FUNCTION: Finds or creates the node of a network prefix
+ * ARGUMENTS:
+ *     Trie         = Pointer to the trie
+ *     Prefix       = Network prefix, in host order
+ *     PrefixLength = Number of significant bits of Prefix
+ * RETURNS:
+ *     Pointer to the node, NULL if there are not enough resources
+ */
+{
+    PFIB_NODE Parent = NULL, Node = Trie->Root, NewNode, Branch;
+    UINT Length;
+
+    ASSERT(PrefixLength <= 32);
+    Prefix &= FIB_PREFIX_MASK(PrefixLength);
+
+    /* Go down as long as the nodes are prefixes of the new one */
+    while (Node && Node->PrefixLength <= PrefixLength &&
+           (Prefix & Node->Mask) == Node->Prefix) {
+        if (Node->PrefixLength == PrefixLength)
+            return Node;
+
+        Parent = Node;
+        Node = Node->Child[FIB_PREFIX_BIT(Prefix, Node->PrefixLength)];
+    }
+
+    NewNode = Trie->AllocateNode();
+    if (!NewNode)
+        return NULL;
+    FibInitializeNode(NewNode, Prefix, PrefixLength);
+
+    /* Nothing left below, just hang it there */
+    if (!Node) {
+        if (Parent)
+            Parent->Child[FIB_PREFIX_BIT(Prefix, Parent->PrefixLength)] = NewNode;
+        else
+            Trie->Root = NewNode;
+        NewNode->Parent = Parent;
+        return NewNode;
+    }
+
+    Length = FibCommonPrefixLength(Prefix, Node->Prefix);
+    Length = min(Length, min(PrefixLength, Node->PrefixLength));
+
+    /* The new node is a prefix of the one in place, put it on top */
+    if (Length == PrefixLength) {
+        FibReplaceChild(Trie, Parent, Node, NewNode);
+        NewNode->Child[FIB_PREFIX_BIT(Node->Prefix, PrefixLength)] = Node;
+        Node->Parent = NewNode;
+        return NewNode;
+    }
+
+    /* Otherwise they part somewhere, they need a branch there */
+    Branch = Trie->AllocateNode();
+    if (!Branch) {
+        Trie->FreeNode(NewNode);
+        return NULL;
+    }
+    FibInitializeNode(Branch, Prefix, Length);
+
+    FibReplaceChild(Trie, Parent, Node, Branch);
+    Branch->Child[FIB_PREFIX_BIT(Prefix, Length)] = NewNode;
+    Branch->Child[FIB_PREFIX_BIT(Node->Prefix, Length)] = Node;
+    NewNode->Parent = Branch;
+    Node->Parent = Branch;
+
+    return NewNode;
+}
+
+
+PFIB_NODE FibTrieFind(
+    PFIB_TRIE Trie,
+    ULONG Prefix,
+    UINT PrefixLength)
+/*
+ * FUNCTION: Finds the node of a network prefix
+ * ARGUMENTS:
+ *     Trie         = Pointer to the trie
+ *     Prefix       = Network prefix, in host order
+ *     PrefixLength = Number of significant bits of Prefix
+ * RETURNS:
+ *     Pointer to the node, NULL if the prefix isn't in the trie
+ */
+{
+    PFIB_NODE Node = Trie->Root;
+
+    ASSERT(PrefixLength <= 32);
+    Prefix &= FIB_PREFIX_MASK(PrefixLength);
+
+    while (Node && Node->PrefixLength <= PrefixLength &&
+           (Prefix & Node->Mask) == Node->Prefix) {
+        if (Node->PrefixLength == PrefixLength)
+            return Node;
+
+        Node = Node->Child[FIB_PREFIX_BIT(Prefix, Node->PrefixLength)];
+    }
+
+    return NULL;
+}
+
+
+VOID FibTrieDelete(
+    PFIB_TRIE Trie,
+    PFIB_NODE Node)
+/*
+ * FUNCTION: Removes a node which has no routes left
+ * ARGUMENTS:
+ *     Trie = Pointer to the trie
+ *     Node = Pointer to the node
+ * NOTES:
+ *     The node is kept as long as it is needed to branch
+ */
+{
+    PFIB_NODE Parent, Child;
+
+    while (Node && !Node->Routes && !(Node->Child[0] && Node->Child[1])) {
+        Parent = Node->Parent;
+        Child = Node->Child[0] ? Node->Child[0] : Node->Child[1];
+
+        FibReplaceChild(Trie, Parent, Node, Child);
+        Trie->FreeNode(Node);
+
+        /* The parent may have been there only to branch */
+        Node = Parent;
+    }
+}
+
+
+VOID FibTrieDestroy(
+    PFIB_TRIE Trie)
+/*
+ * FUNCTION: Frees all the nodes of a trie
+ * ARGUMENTS:
+ *     Trie = Pointer to the trie
+ */
+{
+    PFIB_NODE Node = Trie->Root, Next;
+
+    while (Node) {
+        if (Node->Child[0]) {
+            Next = Node->Child[0];
+            Node->Child[0] = NULL;
+        } else if (Node->Child[1]) {
+            Next = Node->Child[1];
+            Node->Child[1] = NULL;
+        } else {
+            Next = Node->Parent;
+            Trie->FreeNode(Node);
+        }
+        Node = Next;
+    }
+
+    Trie->Root = NULL;
+}
+
+
+PFIB_NODE FibTrieLookup(
+    PFIB_TRIE Trie,
+    ULONG Address)
+/*
+ * FUNCTION: Finds the longest prefix with routes matching an address
+ * ARGUMENTS:
+ *     Trie    = Pointer to the trie
+ *     Address = Address to match, in host order
+ * RETURNS:
+ *     Pointer to the node, NULL if no prefix matches
+ */
+{
+    PFIB_NODE Node = Trie->Root, Best = NULL;
+
+    while (Node && (Address & Node->Mask) == Node->Prefix) {
+        if (Node->Routes)
+            Best = Node;
+
+        if (Node->PrefixLength == 32)
+            break;
+
+        Node = Node->Child[FIB_PREFIX_BIT(Address, Node->PrefixLength)];
+    }
+
+    return Best;
+}
+
+
+PFIB_NODE FibTrieNextMatch(
+    PFIB_NODE Node)
+/*
+ * FUNCTION: Finds the next shorter prefix with routes
+ * ARGUMENTS:
+ *     Node = Pointer to a node matching an address
+ * RETURNS:
+ *     Pointer to the next node matching the same address, NULL if none
+ */
+{
+    for (Node = Node->Parent; Node && !Node->Routes; Node = Node->Parent);
+
+    return Node;
+}
+
+/* EOF */
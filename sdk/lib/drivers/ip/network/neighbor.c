@@ -101,6 +101,9 @@ VOID NBTimeout(VOID)
     PNEIGHBOR_CACHE_ENTRY NCE;
     NDIS_STATUS Status;
 
+    /* Free the NCEs retired since the last run */
+    RouterFreeRetiredNCEs();
+
     for (i = 0; i <= NB_HASHMASK; i++) {
         TcpipAcquireSpinLockAtDpcLevel(&NeighborCache[i].Lock);
 
@@ -154,7 +157,8 @@ VOID NBTimeout(VOID)
                     
                     NBFlushPacketQueue(NCE, Status);
 
-                    ExFreePoolWithTag(NCE, NCE_TAG);
+                    /* The route cache may still point to it */
+                    RouterRetireNCE(NCE);
 
                     continue;
                 }
@@ -255,7 +259,7 @@ VOID NBDestroyNeighborsForInterface(PIP_INTERFACE Interface)
                 *PrevNCE = NCE->Next;
 
                 NBFlushPacketQueue(NCE, NDIS_STATUS_REQUEST_ABORTED);
-                ExFreePoolWithTag(NCE, NCE_TAG);
+                RouterRetireNCE(NCE);
 
                 continue;
             }
@@ -623,7 +627,7 @@ VOID NBRemoveNeighbor(
           *PrevNCE = CurNCE->Next;
 
 	  NBFlushPacketQueue( CurNCE, NDIS_STATUS_REQUEST_ABORTED );
-          ExFreePoolWithTag(CurNCE, NCE_TAG);
+          RouterRetireNCE(CurNCE);
 
 	  break;
         }
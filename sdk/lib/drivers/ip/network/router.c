@@ -16,6 +16,15 @@
 
 LIST_ENTRY FIBListHead;
 KSPIN_LOCK FIBLock;
+FIB_TRIE FIBTrie;
+volatile LONG FIBGeneration;
+ROUTE_CACHE_ENTRY RouteCache[ROUTE_CACHE_SIZE];
+volatile LONG RouteCacheReaders;
+PNEIGHBOR_CACHE_ENTRY RetiredNCEs;
+KSPIN_LOCK RetiredNCELock;
+
+#define ROUTE_CACHE_HASH(Address) \
+    ((((ULONG)(Address) * 0x9E3779B1) >> 16) & (ROUTE_CACHE_SIZE - 1))
 
 void RouterDumpRoutes() {
     PLIST_ENTRY CurrentEntry;
@@ -54,6 +63,159 @@ VOID FreeFIB(
 }
 
 
+PFIB_NODE AllocateFIBNode(
+    VOID)
+/*
+ * FUNCTION: Allocates a node of the forward information base trie
+ * RETURNS:
+ *     Pointer to the node, NULL if there are not enough resources
+ */
+{
+    return ExAllocatePoolWithTag(NonPagedPool, sizeof(FIB_NODE), FIB_NODE_TAG);
+}
+
+
+VOID FreeFIBNode(
+    PFIB_NODE Node)
+/*
+ * FUNCTION: Frees a node of the forward information base trie
+ * ARGUMENTS:
+ *     Node = Pointer to the node
+ */
+{
+    ExFreePoolWithTag(Node, FIB_NODE_TAG);
+}
+
+
+VOID RouterFlushRouteCache(
+    VOID)
+/*
+ * FUNCTION: Invalidates all the route cache entries
+ * NOTES:
+ *     Must be called whenever a route changes, or a router goes away
+ */
+{
+    InterlockedIncrement(&FIBGeneration);
+}
+
+
+static PNEIGHBOR_CACHE_ENTRY RouteCacheLookup(
+    IPv4_RAW_ADDRESS Destination)
+/*
+ * FUNCTION: Looks up the route cache, without taking any lock
+ * ARGUMENTS:
+ *     Destination = Destination address
+ * RETURNS:
+ *     Pointer to NCE of router to use, NULL if there is no usable entry
+ * NOTES:
+ *     NCEs are only freed while no lookup is running, see RouterRetireNCE
+ */
+{
+    PROUTE_CACHE_ENTRY Entry = &RouteCache[ROUTE_CACHE_HASH(Destination)];
+    PNEIGHBOR_CACHE_ENTRY NCE = NULL;
+    LONG Sequence;
+
+    InterlockedIncrement(&RouteCacheReaders);
+
+    /* Don't read an entry while it is being written */
+    Sequence = Entry->Sequence;
+    if (!(Sequence & 1)) {
+        KeMemoryBarrier();
+
+        if (Entry->Destination == Destination && Entry->Generation == FIBGeneration)
+            NCE = Entry->Router;
+
+        /* Make sure it wasn't rewritten while we read it */
+        KeMemoryBarrier();
+        if (Entry->Sequence != Sequence)
+            NCE = NULL;
+
+        /* The router may have become unreachable since, let the FIB decide */
+        if (NCE && (NCE->State & (NUD_STALE | NUD_INCOMPLETE)))
+            NCE = NULL;
+    }
+
+    InterlockedDecrement(&RouteCacheReaders);
+
+    return NCE;
+}
+
+
+VOID RouterRetireNCE(
+    PNEIGHBOR_CACHE_ENTRY NCE)
+/*
+ * FUNCTION: Frees an NCE, once no route cache lookup can still use it
+ * ARGUMENTS:
+ *     NCE = Pointer to NCE, already unlinked from the neighbor cache
+ */
+{
+    KIRQL OldIrql;
+
+    /* Lookups starting from now on won't use the route cache entries
+     * pointing to it, the ones already running may still do */
+    RouterFlushRouteCache();
+
+    TcpipAcquireSpinLock(&RetiredNCELock, &OldIrql);
+    NCE->Next = RetiredNCEs;
+    RetiredNCEs = NCE;
+    TcpipReleaseSpinLock(&RetiredNCELock, OldIrql);
+}
+
+
+VOID RouterFreeRetiredNCEs(
+    VOID)
+/*
+ * FUNCTION: Frees the retired NCEs, if no route cache lookup is running
+ * NOTES:
+ *     Called periodically. Whatever can't be freed now is freed next time
+ */
+{
+    PNEIGHBOR_CACHE_ENTRY NCE, NextNCE;
+    KIRQL OldIrql;
+
+    TcpipAcquireSpinLock(&RetiredNCELock, &OldIrql);
+    NCE = RetiredNCEs;
+    if (InterlockedCompareExchange(&RouteCacheReaders, 0, 0) == 0)
+        RetiredNCEs = NULL;
+    else
+        NCE = NULL;
+    TcpipReleaseSpinLock(&RetiredNCELock, OldIrql);
+
+    for (; NCE; NCE = NextNCE) {
+        NextNCE = NCE->Next;
+        ExFreePoolWithTag(NCE, NCE_TAG);
+    }
+}
+
+
+static VOID RouteCacheInsert(
+    IPv4_RAW_ADDRESS Destination,
+    LONG Generation,
+    PNEIGHBOR_CACHE_ENTRY NCE)
+/*
+ * FUNCTION: Remembers the route to a destination
+ * ARGUMENTS:
+ *     Destination = Destination address
+ *     Generation  = FIB generation the route was found in
+ *     NCE         = Pointer to NCE of router to use
+ */
+{
+    PROUTE_CACHE_ENTRY Entry = &RouteCache[ROUTE_CACHE_HASH(Destination)];
+    LONG Sequence = Entry->Sequence;
+
+    /* If someone else is writing it, don't bother */
+    if ((Sequence & 1) ||
+        InterlockedCompareExchange(&Entry->Sequence, Sequence + 1, Sequence) != Sequence)
+        return;
+
+    Entry->Destination = Destination;
+    Entry->Generation = Generation;
+    Entry->Router = NCE;
+
+    InterlockedExchange(&Entry->Sequence, Sequence + 2);
+}
+
+
 VOID DestroyFIBE(
     PFIB_ENTRY FIBE)
 /*
@@ -64,11 +226,23 @@ VOID DestroyFIBE(
  *     The forward information base lock must be held when called
  */
 {
+    PFIB_ENTRY *Link;
+
     TI_DbgPrint(DEBUG_ROUTER, ("Called. FIBE (0x%X).\n", FIBE));
 
     /* Unlink the FIB entry from the list */
     RemoveEntryList(&FIBE->ListEntry);
 
+    /* Unlink it from its network, which goes away with its last route */
+    if (FIBE->Node) {
+        for (Link = (PFIB_ENTRY *)&FIBE->Node->Routes; *Link != FIBE; Link = &(*Link)->Next);
+        *Link = FIBE->Next;
+        FibTrieDelete(&FIBTrie, FIBE->Node);
+    }
+
+    /* Nobody may use it from the route cache anymore */
+    RouterFlushRouteCache();
+
     /* And free the FIB entry */
     FreeFIB(FIBE);
 }
@@ -139,53 +313,6 @@ UINT CopyFIBs( PIP_INTERFACE IF, PFIB_ENTRY Target ) {
 }
 
 
-UINT CommonPrefixLength(
-    PIP_ADDRESS Address1,
-    PIP_ADDRESS Address2)
-/*
- * FUNCTION: Computes the length of the longest prefix common to two addresses
- * ARGUMENTS:
- *     Address1 = Pointer to first address
- *     Address2 = Pointer to second address
- * NOTES:
- *     The two addresses must be of the same type
- * RETURNS:
- *     Length of longest common prefix
- */
-{
-    PUCHAR Addr1, Addr2;
-    UINT Size;
-    UINT i, j;
-    UINT Bitmask;
-
-    TI_DbgPrint(DEBUG_ROUTER, ("Called. Address1 (0x%X)  Address2 (0x%X).\n", Address1, Address2));
-
-    /*TI_DbgPrint(DEBUG_ROUTER, ("Target  (%s) \n", A2S(Address1)));*/
-    /*TI_DbgPrint(DEBUG_ROUTER, ("Adapter (%s).\n", A2S(Address2)));*/
-
-    if (Address1->Type == IP_ADDRESS_V4)
-        Size = sizeof(IPv4_RAW_ADDRESS);
-    else
-        Size = sizeof(IPv6_RAW_ADDRESS);
-
-    Addr1 = (PUCHAR)&Address1->Address.IPv4Address;
-    Addr2 = (PUCHAR)&Address2->Address.IPv4Address;
-
-    /* Find first non-matching byte */
-    for (i = 0; i < Size && Addr1[i] == Addr2[i]; i++);
-    if( i == Size ) return 8 * i;
-
-    /* Find first non-matching bit */
-    Bitmask = 0x80;
-    for (j = 0; (Addr1[i] & Bitmask) == (Addr2[i] & Bitmask); j++)
-        Bitmask >>= 1;
-
-    TI_DbgPrint(DEBUG_ROUTER, ("Returning %d\n", 8 * i + j));
-
-    return 8 * i + j;
-}
-
-
 PFIB_ENTRY RouterAddRoute(
     PIP_ADDRESS NetworkAddress,
     PIP_ADDRESS Netmask,
@@ -206,7 +333,9 @@ PFIB_ENTRY RouterAddRoute(
  *     these references
  */
 {
-    PFIB_ENTRY FIBE;
+    KIRQL OldIrql;
+    PFIB_ENTRY FIBE, *Link;
+    PFIB_NODE Node = NULL;
 
     TI_DbgPrint(DEBUG_ROUTER, ("Called. NetworkAddress (0x%X)  Netmask (0x%X) "
         "Router (0x%X)  Metric (%d).\n", NetworkAddress, Netmask, Router, Metric));
@@ -228,9 +357,33 @@ PFIB_ENTRY RouterAddRoute(
 		   sizeof(FIBE->Netmask) );
     FIBE->Router         = Router;
     FIBE->Metric         = Metric;
+    FIBE->Next           = NULL;
+
+    TcpipAcquireSpinLock(&FIBLock, &OldIrql);
+
+    /* Index it by network. Only IPv4 is routed */
+    if (NetworkAddress->Type == IP_ADDRESS_V4 && Netmask->Type == IP_ADDRESS_V4) {
+        Node = FibTrieInsert(&FIBTrie,
+                             IPv4NToHl(NetworkAddress->Address.IPv4Address),
+                             AddrCountPrefixBits(Netmask));
+        if (!Node) {
+            TcpipReleaseSpinLock(&FIBLock, OldIrql);
+            TI_DbgPrint(MIN_TRACE, ("Insufficient resources.\n"));
+            FreeFIB(FIBE);
+            return NULL;
+        }
+
+        /* Routes to the same network are tried in the order they were added */
+        for (Link = (PFIB_ENTRY *)&Node->Routes; *Link; Link = &(*Link)->Next);
+        *Link = FIBE;
+    }
+    FIBE->Node = Node;
 
     /* Add FIB to the forward information base */
-    TcpipInterlockedInsertTailList(&FIBListHead, &FIBE->ListEntry, &FIBLock);
+    InsertTailList(&FIBListHead, &FIBE->ListEntry);
+    RouterFlushRouteCache();
+
+    TcpipReleaseSpinLock(&FIBLock, OldIrql);
 
     return FIBE;
 }
@@ -244,50 +397,71 @@ PNEIGHBOR_CACHE_ENTRY RouterGetRoute(PIP_ADDRESS Destination)
  * RETURNS:
  *     Pointer to NCE for router, NULL if none was found
  * NOTES:
- *     If found the NCE is referenced
+ *     The longest matching network with a reachable router wins. If none
+ *     of the matching routers is reachable, the longest network wins
  */
 {
     KIRQL OldIrql;
-    PLIST_ENTRY CurrentEntry;
-    PLIST_ENTRY NextEntry;
+    PFIB_NODE Node;
     PFIB_ENTRY Current;
-    UCHAR State;
-    UINT Length, BestLength = 0, MaskLength;
-    PNEIGHBOR_CACHE_ENTRY NCE, BestNCE = NULL;
+    LONG Generation;
+    BOOLEAN Longest = TRUE;
+    PNEIGHBOR_CACHE_ENTRY BestNCE = NULL, FallbackNCE = NULL;
 
     TI_DbgPrint(DEBUG_ROUTER, ("Called. Destination (0x%X)\n", Destination));
 
     TI_DbgPrint(DEBUG_ROUTER, ("Destination (%s)\n", A2S(Destination)));
 
-    TcpipAcquireSpinLock(&FIBLock, &OldIrql);
-
-    CurrentEntry = FIBListHead.Flink;
-    while (CurrentEntry != &FIBListHead) {
-        NextEntry = CurrentEntry->Flink;
-	    Current = CONTAINING_RECORD(CurrentEntry, FIB_ENTRY, ListEntry);
-
-        NCE   = Current->Router;
-        State = NCE->State;
+    if (Destination->Type != IP_ADDRESS_V4) {
+        TI_DbgPrint(DEBUG_ROUTER,("Packet won't be routed\n"));
+        return NULL;
+    }
 
-	Length = CommonPrefixLength(Destination, &Current->NetworkAddress);
-	MaskLength = AddrCountPrefixBits(&Current->Netmask);
+    /* Most packets go where the previous ones went */
+    BestNCE = RouteCacheLookup(Destination->Address.IPv4Address);
+    if (BestNCE) {
+        TI_DbgPrint(DEBUG_ROUTER,("Routing to %s (cached)\n", A2S(&BestNCE->Address)));
+        return BestNCE;
+    }
 
-	TI_DbgPrint(DEBUG_ROUTER,("This-Route: %s (Sharing %d bits)\n",
-				  A2S(&NCE->Address), Length));
+    TcpipAcquireSpinLock(&FIBLock, &OldIrql);
 
-	if(Length >= MaskLength && (Length > BestLength || !BestNCE) &&
-           ((!(State & NUD_STALE) && !(State & NUD_INCOMPLETE)) || !BestNCE)) {
-	    /* This seems to be a better router */
-	    BestNCE    = NCE;
-	    BestLength = Length;
-	    TI_DbgPrint(DEBUG_ROUTER,("Route selected\n"));
-	}
+    /* The FIB can't change as long as we hold the lock */
+    Generation = FIBGeneration;
+
+    for (Node = FibTrieLookup(&FIBTrie, IPv4NToHl(Destination->Address.IPv4Address));
+         Node && !BestNCE;
+         Node = FibTrieNextMatch(Node)) {
+        for (Current = Node->Routes; Current; Current = Current->Next) {
+            TI_DbgPrint(DEBUG_ROUTER,("This-Route: %s (Sharing %d bits)\n",
+                                      A2S(&Current->Router->Address), Node->PrefixLength));
+
+            if (!(Current->Router->State & (NUD_STALE | NUD_INCOMPLETE))) {
+                /* This seems to be a good router */
+                BestNCE = Current->Router;
+                TI_DbgPrint(DEBUG_ROUTER,("Route selected\n"));
+                break;
+            }
+
+            if (!FallbackNCE)
+                FallbackNCE = Current->Router;
+        }
 
-        CurrentEntry = NextEntry;
+        /* A shorter network may be better now, but not forever */
+        if (!BestNCE)
+            Longest = FALSE;
     }
 
     TcpipReleaseSpinLock(&FIBLock, OldIrql);
 
+    if( BestNCE ) {
+        /* Only remember the route which will stay the best one */
+        if (Longest)
+            RouteCacheInsert(Destination->Address.IPv4Address, Generation, BestNCE);
+    } else {
+        BestNCE = FallbackNCE;
+    }
+
     if( BestNCE ) {
 	TI_DbgPrint(DEBUG_ROUTER,("Routing to %s\n", A2S(&BestNCE->Address)));
     } else {
@@ -439,30 +613,30 @@ PFIB_ENTRY RouterCreateRoute(
  */
 {
     KIRQL OldIrql;
-    PLIST_ENTRY CurrentEntry;
-    PLIST_ENTRY NextEntry;
+    PFIB_NODE Node;
     PFIB_ENTRY Current;
     PNEIGHBOR_CACHE_ENTRY NCE;
 
     TcpipAcquireSpinLock(&FIBLock, &OldIrql);
 
-    CurrentEntry = FIBListHead.Flink;
-    while (CurrentEntry != &FIBListHead) {
-        NextEntry = CurrentEntry->Flink;
-        Current = CONTAINING_RECORD(CurrentEntry, FIB_ENTRY, ListEntry);
-
-        NCE   = Current->Router;
-
-        if(AddrIsEqual(NetworkAddress, &Current->NetworkAddress) &&
-           AddrIsEqual(Netmask, &Current->Netmask) &&
-           NCE->Interface == Interface)
-        {
-            TI_DbgPrint(DEBUG_ROUTER,("Attempting to add duplicate route to %s\n", A2S(NetworkAddress)));
-            TcpipReleaseSpinLock(&FIBLock, OldIrql);
-            return NULL;
+    /* Duplicates can only be among the routes to the same network */
+    if (NetworkAddress->Type == IP_ADDRESS_V4 && Netmask->Type == IP_ADDRESS_V4) {
+        Node = FibTrieFind(&FIBTrie,
+                           IPv4NToHl(NetworkAddress->Address.IPv4Address),
+                           AddrCountPrefixBits(Netmask));
+
+        for (Current = Node ? Node->Routes : NULL; Current; Current = Current->Next) {
+            NCE   = Current->Router;
+
+            if(AddrIsEqual(NetworkAddress, &Current->NetworkAddress) &&
+               AddrIsEqual(Netmask, &Current->Netmask) &&
+               NCE->Interface == Interface)
+            {
+                TI_DbgPrint(DEBUG_ROUTER,("Attempting to add duplicate route to %s\n", A2S(NetworkAddress)));
+                TcpipReleaseSpinLock(&FIBLock, OldIrql);
+                return NULL;
+            }
         }
-
-        CurrentEntry = NextEntry;
     }
 
     TcpipReleaseSpinLock(&FIBLock, OldIrql);
@@ -492,6 +666,11 @@ NTSTATUS RouterStartup(
     /* Initialize the Forward Information Base */
     InitializeListHead(&FIBListHead);
     TcpipInitializeSpinLock(&FIBLock);
+    FibTrieInitialize(&FIBTrie, AllocateFIBNode, FreeFIBNode);
+    TcpipInitializeSpinLock(&RetiredNCELock);
+
+    /* Start past the generation of the zeroed route cache entries */
+    FIBGeneration = 1;
 
     return STATUS_SUCCESS;
 }
@@ -512,8 +691,12 @@ NTSTATUS RouterShutdown(
     /* Clear Forward Information Base */
     TcpipAcquireSpinLock(&FIBLock, &OldIrql);
     DestroyFIBEs();
+    FibTrieDestroy(&FIBTrie);
     TcpipReleaseSpinLock(&FIBLock, OldIrql);
 
+    /* Neighbors which went away recently */
+    RouterFreeRetiredNCEs();
+
     return STATUS_SUCCESS;
 }
 
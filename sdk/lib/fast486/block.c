@@ -0,0 +1,425 @@
+/*
+ * Fast486 386/486 CPU Emulation Library
+ * block.c
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/* INCLUDES *******************************************************************/
+
+#include <windef.h>
+
+// #define NDEBUG
+#include <debug.h>
+
+#include <fast486.h>
+#include "common.h"
+#include "opcodes.h"
+
+#ifndef FAST486_NO_BLOCK_CACHE
+
+/* DEFINES ********************************************************************/
+
+/*
+ * A block is found by its linear address, and then by the physical page of
+ * its code when the memory is written to.
+ */
+#define BLOCK_INDEX(x)  ((((x) >> 12) ^ (x)) & (FAST486_NUM_BLOCKS - 1))
+#define BLOCK_BUCKET(x) (((x) >> 12) & (FAST486_NUM_BLOCK_BUCKETS - 1))
+
+C_ASSERT((FAST486_NUM_BLOCKS & (FAST486_NUM_BLOCKS - 1)) == 0);
+C_ASSERT((FAST486_NUM_BLOCK_BUCKETS & (FAST486_NUM_BLOCK_BUCKETS - 1)) == 0);
+
+/* PRIVATE FUNCTIONS **********************************************************/
+
+static
+inline
+UCHAR
+Fast486BlockMode(PFAST486_STATE State)
+{
+    /* Everything the decoding and the code fetch checks depend on */
+    return (UCHAR)(State->SegmentRegs[FAST486_REG_CS].Size
+                   | (Fast486GetCurrentPrivLevel(State) << 1)
+                   | ((State->ControlRegisters[FAST486_REG_CR0] & FAST486_CR0_PE) ? 0x08 : 0)
+                   | ((State->ControlRegisters[FAST486_REG_CR0] & FAST486_CR0_PG) ? 0x10 : 0)
+                   | (State->Flags.Vm ? 0x20 : 0));
+}
+
+static
+inline
+ULONG
+Fast486BlockMaxSize(PFAST486_STATE State,
+                    ULONG Offset,
+                    ULONG LinearAddress)
+{
+    PFAST486_SEG_REG CachedDescriptor = &State->SegmentRegs[FAST486_REG_CS];
+    ULONG Size = FAST486_PAGE_SIZE - PAGE_OFFSET(LinearAddress);
+
+    /* Leave the faulting fetches to Fast486ReadMemory */
+    if (Offset > CachedDescriptor->Limit) return 0;
+
+    if ((State->ControlRegisters[FAST486_REG_CR0] & FAST486_CR0_PE) && !State->Flags.Vm)
+    {
+        if (!CachedDescriptor->Present
+            || !CachedDescriptor->Executable
+            || (Fast486GetCurrentPrivLevel(State) > CachedDescriptor->Dpl))
+        {
+            return 0;
+        }
+    }
+
+    /* Stay in the page, in the segment, and below the wrap around of 16-bit code */
+    if (Size > FAST486_BLOCK_SIZE) Size = FAST486_BLOCK_SIZE;
+    if ((CachedDescriptor->Limit - Offset) < (Size - 1)) Size = CachedDescriptor->Limit - Offset + 1;
+    if (!CachedDescriptor->Size && ((0x10000 - Offset) < Size)) Size = 0x10000 - Offset;
+
+    return Size;
+}
+
+static
+inline
+BOOLEAN
+Fast486BlockTranslate(PFAST486_STATE State,
+                      ULONG LinearAddress,
+                      PULONG PhysicalAddress)
+{
+    FAST486_PAGE_TABLE TableEntry;
+
+    if (!(State->ControlRegisters[FAST486_REG_CR0] & FAST486_CR0_PG))
+    {
+        *PhysicalAddress = LinearAddress;
+        return TRUE;
+    }
+
+    TableEntry.Value = Fast486GetPageTableEntry(State, PAGE_ALIGN(LinearAddress), FALSE);
+
+    if (!TableEntry.Present || (!TableEntry.Usermode && (Fast486GetCurrentPrivLevel(State) > 0)))
+    {
+        /* This would be a page fault */
+        return FALSE;
+    }
+
+    *PhysicalAddress = (TableEntry.Address << 12) | PAGE_OFFSET(LinearAddress);
+    return TRUE;
+}
+
+static
+VOID
+Fast486LinkBlock(PFAST486_BLOCK_CACHE BlockCache,
+                 PFAST486_BLOCK Block)
+{
+    ULONG Page = Block->PhysicalAddress >> 12;
+    PFAST486_BLOCK *Bucket = &BlockCache->PageBuckets[BLOCK_BUCKET(Block->PhysicalAddress)];
+
+    Block->NextInPage = *Bucket;
+    *Bucket = Block;
+
+    /* Writes to this page must be looked at from now on */
+    BlockCache->CodePages[Page >> 5] |= 1u << (Page & 31);
+}
+
+static
+VOID
+Fast486UnlinkBlock(PFAST486_BLOCK_CACHE BlockCache,
+                   PFAST486_BLOCK Block)
+{
+    PFAST486_BLOCK *Link = &BlockCache->PageBuckets[BLOCK_BUCKET(Block->PhysicalAddress)];
+
+    /* The page bit is cleared later, by the next write to the page */
+    while (*Link != Block) Link = &(*Link)->NextInPage;
+    *Link = Block->NextInPage;
+    Block->NextInPage = NULL;
+}
+
+static
+PFAST486_BLOCK
+Fast486FindBlock(PFAST486_STATE State,
+                 ULONG Offset,
+                 ULONG LinearAddress)
+{
+    PFAST486_BLOCK_CACHE BlockCache = State->BlockCache;
+    PFAST486_BLOCK Block = &BlockCache->Blocks[BLOCK_INDEX(LinearAddress)];
+    UCHAR Code[FAST486_BLOCK_SIZE];
+    ULONG PhysicalAddress;
+    ULONG Size;
+    UCHAR Mode;
+
+    Size = Fast486BlockMaxSize(State, Offset, LinearAddress);
+    if (Size == 0) return NULL;
+
+    Mode = Fast486BlockMode(State);
+
+    if ((Block->Size != 0)
+        && (Block->LinearAddress == LinearAddress)
+        && (Block->Mode == Mode)
+        && (Block->Size <= Size))
+    {
+        if (Block->Generation == BlockCache->Generation)
+        {
+            BlockCache->Hits++;
+            return Block;
+        }
+
+        /* The cache was flushed, check if the memory still holds the same code */
+        if (!Fast486BlockTranslate(State, LinearAddress, &PhysicalAddress)) return NULL;
+        State->MemReadCallback(State, PhysicalAddress, Code, Block->Size);
+
+        if (RtlCompareMemory(Code, Block->Code, Block->Size) == Block->Size)
+        {
+            if (PhysicalAddress != Block->PhysicalAddress)
+            {
+                /* Mapped somewhere else */
+                Fast486UnlinkBlock(BlockCache, Block);
+                Block->PhysicalAddress = PhysicalAddress;
+                Fast486LinkBlock(BlockCache, Block);
+            }
+
+            Block->Generation = BlockCache->Generation;
+            BlockCache->Revalidations++;
+            return Block;
+        }
+    }
+    else if (!Fast486BlockTranslate(State, LinearAddress, &PhysicalAddress))
+    {
+        return NULL;
+    }
+
+    /* Throw away what was there, and start a new block */
+    BlockCache->Misses++;
+    if (Block->Size != 0) Fast486UnlinkBlock(BlockCache, Block);
+
+    Block->Generation = BlockCache->Generation;
+    Block->LinearAddress = LinearAddress;
+    Block->PhysicalAddress = PhysicalAddress;
+    Block->Mode = Mode;
+    Block->Size = (UCHAR)Size;
+    Block->Length = 0;
+    Block->Count = 0;
+    State->MemReadCallback(State, PhysicalAddress, Block->Code, Size);
+
+    Fast486LinkBlock(BlockCache, Block);
+    return Block;
+}
+
+/* PUBLIC FUNCTIONS ***********************************************************/
+
+BOOLEAN
+FASTCALL
+Fast486BlockExecute(PFAST486_STATE State)
+{
+    PFAST486_SEG_REG CachedDescriptor = &State->SegmentRegs[FAST486_REG_CS];
+    PFAST486_BLOCK Block = State->CurrentBlock;
+    PFAST486_DECODED_INST Instruction;
+    ULONG Offset, LinearAddress, Index;
+
+    Offset = (CachedDescriptor->Size) ? State->InstPtr.Long
+                                      : State->InstPtr.LowWord;
+    LinearAddress = CachedDescriptor->Base + Offset;
+
+    if (State->Recording)
+    {
+        /* A block being decoded goes through the normal path, in order */
+        if (LinearAddress == Block->LinearAddress + Block->Length) return FALSE;
+
+        /* An interrupt went somewhere else */
+        Fast486BlockRecordStop(State);
+        Block = State->CurrentBlock;
+    }
+
+    Index = State->CurrentInstruction;
+
+    /* Check for the next instruction of the block, or the same one again */
+    if ((Block != NULL)
+        && (Index < Block->Count)
+        && (LinearAddress == Block->LinearAddress + Block->Instructions[Index].Offset))
+    {
+        Instruction = &Block->Instructions[Index];
+    }
+    else if ((Block != NULL)
+             && (Index > 0)
+             && (LinearAddress == Block->LinearAddress + Block->Instructions[Index - 1].Offset))
+    {
+        Instruction = &Block->Instructions[--Index];
+    }
+    else
+    {
+        Block = Fast486FindBlock(State, Offset, LinearAddress);
+        State->CurrentBlock = Block;
+        State->CurrentInstruction = Index = 0;
+
+        if (Block == NULL) return FALSE;
+
+        if (Block->Count == 0)
+        {
+            /* Decode it while executing it */
+            State->Recording = TRUE;
+            State->BlockFetchEnd = 0;
+            return FALSE;
+        }
+
+        Instruction = &Block->Instructions[0];
+    }
+
+    State->CurrentInstruction = Index + 1;
+
+    /* Do what the decoder would have done until the opcode handler */
+    State->SavedInstPtr = State->InstPtr;
+    State->SavedStackPtr = State->GeneralRegs[FAST486_REG_ESP];
+    State->PrefixFlags = Instruction->PrefixFlags;
+    State->SegmentOverride = (FAST486_SEG_REGS)Instruction->SegmentOverride;
+
+    if (CachedDescriptor->Size) State->InstPtr.Long += Instruction->OpcodeLength;
+    else State->InstPtr.LowWord += Instruction->OpcodeLength;
+
+    /* Call the opcode handler, with the ModR/M already parsed */
+    State->DecodedInst = Instruction->ModRmLength ? Instruction : NULL;
+    Instruction->Handler(State, Instruction->Opcode);
+
+    State->DecodedInst = NULL;
+    State->PrefixFlags = 0;
+    return TRUE;
+}
+
+VOID
+FASTCALL
+Fast486BlockRecordStart(PFAST486_STATE State,
+                        UCHAR Opcode)
+{
+    PFAST486_BLOCK Block = State->CurrentBlock;
+    PFAST486_DECODED_INST Instruction = &Block->Instructions[Block->Count];
+
+    /* The prefixes and the opcode were fetched from the block */
+    Instruction->Handler = Fast486OpcodeHandlers[Opcode];
+    Instruction->PrefixFlags = State->PrefixFlags;
+    Instruction->Opcode = Opcode;
+    Instruction->SegmentOverride = (UCHAR)State->SegmentOverride;
+    Instruction->Offset = Block->Length;
+    Instruction->OpcodeLength = (UCHAR)(State->BlockFetchEnd - Block->Length);
+    Instruction->ModRmLength = 0;
+}
+
+VOID
+FASTCALL
+Fast486BlockRecordEnd(PFAST486_STATE State)
+{
+    PFAST486_SEG_REG CachedDescriptor = &State->SegmentRegs[FAST486_REG_CS];
+    PFAST486_BLOCK Block = State->CurrentBlock;
+    ULONG Offset;
+
+    /* The whole instruction was in the block, keep it */
+    Block->Length = (UCHAR)State->BlockFetchEnd;
+    Block->Count++;
+    State->CurrentInstruction = Block->Count;
+
+    Offset = (CachedDescriptor->Size) ? State->InstPtr.Long
+                                      : State->InstPtr.LowWord;
+
+    /* The block ends with the first jump, or when it's full */
+    if ((Block->Count == FAST486_BLOCK_INSTRUCTIONS)
+        || (Block->Length == Block->Size)
+        || ((CachedDescriptor->Base + Offset) != (Block->LinearAddress + Block->Length)))
+    {
+        Fast486BlockRecordStop(State);
+    }
+}
+
+VOID
+FASTCALL
+Fast486BlockRecordStop(PFAST486_STATE State)
+{
+    PFAST486_BLOCK Block = State->CurrentBlock;
+
+    State->Recording = FALSE;
+
+    if (Block->Length == 0)
+    {
+        /* Nothing could be decoded, free it */
+        Fast486UnlinkBlock(State->BlockCache, Block);
+        Block->Size = 0;
+        State->CurrentBlock = NULL;
+        return;
+    }
+
+    /* Only keep the code that was decoded, so writes around it don't hit it */
+    Block->Size = Block->Length;
+}
+
+VOID
+FASTCALL
+Fast486InvalidateBlocks(PFAST486_STATE State,
+                        ULONG PhysicalAddress,
+                        ULONG Size)
+{
+    PFAST486_BLOCK_CACHE BlockCache = State->BlockCache;
+    PFAST486_BLOCK Block, *Link;
+    ULONG EndAddress = PhysicalAddress + Size;
+    ULONG Page = PhysicalAddress >> 12;
+    ULONG LastPage = (EndAddress - 1) >> 12;
+    BOOLEAN Used;
+
+    while (TRUE)
+    {
+        if (BlockCache->CodePages[Page >> 5] & (1u << (Page & 31)))
+        {
+            Used = FALSE;
+            Link = &BlockCache->PageBuckets[BLOCK_BUCKET(Page << 12)];
+
+            while ((Block = *Link) != NULL)
+            {
+                if ((Block->PhysicalAddress >> 12) != Page)
+                {
+                    /* Another page in the same bucket */
+                    Link = &Block->NextInPage;
+                    continue;
+                }
+
+                if ((Block->PhysicalAddress >= EndAddress)
+                    || ((Block->PhysicalAddress + Block->Size) <= PhysicalAddress))
+                {
+                    /* Not written to */
+                    Used = TRUE;
+                    Link = &Block->NextInPage;
+                    continue;
+                }
+
+                if (Block == State->CurrentBlock)
+                {
+                    /* Take the rest of the instruction from memory */
+                    State->CurrentBlock = NULL;
+                    State->DecodedInst = NULL;
+                    State->Recording = FALSE;
+                }
+
+                /* The code changed, free the block */
+                *Link = Block->NextInPage;
+                Block->NextInPage = NULL;
+                Block->Size = 0;
+                BlockCache->Invalidations++;
+            }
+
+            /* Stop looking at the page if it has no code anymore */
+            if (!Used) BlockCache->CodePages[Page >> 5] &= ~(1u << (Page & 31));
+        }
+
+        if (Page == LastPage) break;
+        Page = (Page + 1) & (FAST486_NUM_PHYS_PAGES - 1);
+    }
+}
+
+#endif
+
+/* EOF */
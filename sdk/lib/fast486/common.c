@@ -591,6 +591,11 @@ Fast486ExceptionWithErrorCode(PFAST486_STATE State,
     /* Restore the SP to the saved SP */
     State->GeneralRegs[FAST486_REG_ESP] = State->SavedStackPtr;
 
+#ifndef FAST486_NO_BLOCK_CACHE
+    /* Execution continues somewhere else */
+    Fast486LeaveBlock(State);
+#endif
+
     /* Get the interrupt vector */
     if (!Fast486GetIntVector(State, ExceptionCode, &IdtEntry))
     {
@@ -912,6 +917,11 @@ Fast486TaskSwitch(PFAST486_STATE State, FAST486_TASK_SWITCH_TYPE Type, USHORT Se
     State->PrefetchValid = FALSE;
 #endif
 
+#ifndef FAST486_NO_BLOCK_CACHE
+    /* And the decoded blocks, since CR3 may change */
+    Fast486FlushBlocks(State);
+#endif
+
     /* Load the registers */
     if (NewTssDescriptor.Signature == FAST486_BUSY_TSS_SIGNATURE)
     {
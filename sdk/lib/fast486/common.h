@@ -194,6 +194,48 @@ Fast486CallGate
     BOOLEAN Call
 );
 
+#ifndef FAST486_NO_BLOCK_CACHE
+
+BOOLEAN
+FASTCALL
+Fast486BlockExecute
+(
+    PFAST486_STATE State
+);
+
+VOID
+FASTCALL
+Fast486BlockRecordStart
+(
+    PFAST486_STATE State,
+    UCHAR Opcode
+);
+
+VOID
+FASTCALL
+Fast486BlockRecordEnd
+(
+    PFAST486_STATE State
+);
+
+VOID
+FASTCALL
+Fast486BlockRecordStop
+(
+    PFAST486_STATE State
+);
+
+VOID
+FASTCALL
+Fast486InvalidateBlocks
+(
+    PFAST486_STATE State,
+    ULONG PhysicalAddress,
+    ULONG Size
+);
+
+#endif
+
 /* INLINED FUNCTIONS **********************************************************/
 
 #include "common.inl"
@@ -155,6 +155,87 @@ Fast486FlushTlb(PFAST486_STATE State)
     State->TlbEmpty = TRUE;
 }
 
+#ifndef FAST486_NO_BLOCK_CACHE
+
+FORCEINLINE
+VOID
+FASTCALL
+Fast486LeaveBlock(PFAST486_STATE State)
+{
+    /* Stop recording, and stop taking code from the current block */
+    if (State->Recording) Fast486BlockRecordStop(State);
+    State->CurrentBlock = NULL;
+    State->DecodedInst = NULL;
+}
+
+FORCEINLINE
+VOID
+FASTCALL
+Fast486FlushBlocks(PFAST486_STATE State)
+{
+    if (State->BlockCache == NULL) return;
+
+    Fast486LeaveBlock(State);
+
+    /* Every block must be checked again before it is used, 0 is never valid */
+    if (++State->BlockCache->Generation == 0) State->BlockCache->Generation = 1;
+}
+
+FORCEINLINE
+VOID
+FASTCALL
+Fast486CheckBlockWrite(PFAST486_STATE State,
+                       ULONG PhysicalAddress,
+                       ULONG Size)
+{
+    PFAST486_BLOCK_CACHE BlockCache = State->BlockCache;
+    ULONG Page, LastPage;
+
+    if (BlockCache == NULL) return;
+
+    Page = PhysicalAddress >> 12;
+    LastPage = (PhysicalAddress + Size - 1) >> 12;
+
+    /* Only the pages holding blocks need a closer look */
+    while (TRUE)
+    {
+        if (BlockCache->CodePages[Page >> 5] & (1u << (Page & 31)))
+        {
+            Fast486InvalidateBlocks(State, PhysicalAddress, Size);
+            break;
+        }
+
+        if (Page == LastPage) break;
+        Page = (Page + 1) & (FAST486_NUM_PHYS_PAGES - 1);
+    }
+}
+
+FORCEINLINE
+PUCHAR
+FASTCALL
+Fast486GetBlockCode(PFAST486_STATE State,
+                    ULONG LinearAddress,
+                    ULONG Size)
+{
+    PFAST486_BLOCK Block = State->CurrentBlock;
+    ULONG Offset;
+
+    if (Block == NULL) return NULL;
+
+    Offset = LinearAddress - Block->LinearAddress;
+    if ((Offset >= Block->Size) || (Size > (ULONG)(Block->Size - Offset)))
+    {
+        /* The instruction doesn't fit in the block, it can't be recorded */
+        if (State->Recording) Fast486BlockRecordStop(State);
+        return NULL;
+    }
+
+    if (State->Recording) State->BlockFetchEnd = Offset + Size;
+    return &Block->Code[Offset];
+}
+
+#endif
+
 FORCEINLINE
 BOOLEAN
 FASTCALL
@@ -286,6 +367,11 @@ Fast486WriteLinearMemory(PFAST486_STATE State,
                                     (PVOID)((ULONG_PTR)Buffer + BufferOffset),
                                     PageLength);
 
+#ifndef FAST486_NO_BLOCK_CACHE
+            /* Forget the code that was there */
+            Fast486CheckBlockWrite(State, (TableEntry.Address << 12) | PageOffset, PageLength);
+#endif
+
             BufferOffset += PageLength;
         }
     }
@@ -293,6 +379,11 @@ Fast486WriteLinearMemory(PFAST486_STATE State,
     {
         /* Write the memory */
         State->MemWriteCallback(State, LinearAddress, Buffer, Size);
+
+#ifndef FAST486_NO_BLOCK_CACHE
+        /* Forget the code that was there */
+        Fast486CheckBlockWrite(State, LinearAddress, Size);
+#endif
     }
 
     return TRUE;
@@ -572,6 +663,11 @@ Fast486LoadSegmentInternal(PFAST486_STATE State,
     /* Check for protected mode */
     if (State->ControlRegisters[FAST486_REG_CR0] & FAST486_CR0_PE)
     {
+#ifndef FAST486_NO_BLOCK_CACHE
+        /* The privilege level and the code size may change */
+        if (Segment == FAST486_REG_CS) Fast486LeaveBlock(State);
+#endif
+
         /* Check for VM86 mode */
         if (State->Flags.Vm)
         {
@@ -861,18 +957,30 @@ Fast486FetchByte(PFAST486_STATE State,
 {
     PFAST486_SEG_REG CachedDescriptor;
     ULONG Offset;
-#ifndef FAST486_NO_PREFETCH
+#if !defined(FAST486_NO_PREFETCH) || !defined(FAST486_NO_BLOCK_CACHE)
     ULONG LinearAddress;
 #endif
+#ifndef FAST486_NO_BLOCK_CACHE
+    PUCHAR Code;
+#endif
 
     /* Get the cached descriptor of CS */
     CachedDescriptor = &State->SegmentRegs[FAST486_REG_CS];
 
     Offset = (CachedDescriptor->Size) ? State->InstPtr.Long
                                       : State->InstPtr.LowWord;
-#ifndef FAST486_NO_PREFETCH
+#if !defined(FAST486_NO_PREFETCH) || !defined(FAST486_NO_BLOCK_CACHE)
     LinearAddress = CachedDescriptor->Base + Offset;
+#endif
 
+#ifndef FAST486_NO_BLOCK_CACHE
+    if ((Code = Fast486GetBlockCode(State, LinearAddress, sizeof(UCHAR))) != NULL)
+    {
+        *Data = *Code;
+    }
+    else
+#endif
+#ifndef FAST486_NO_PREFETCH
     if (State->PrefetchValid
         && (LinearAddress >= State->PrefetchAddress)
         && ((LinearAddress + sizeof(UCHAR)) <= (State->PrefetchAddress + FAST486_CACHE_SIZE)))
@@ -910,9 +1018,12 @@ Fast486FetchWord(PFAST486_STATE State,
 {
     PFAST486_SEG_REG CachedDescriptor;
     ULONG Offset;
-#ifndef FAST486_NO_PREFETCH
+#if !defined(FAST486_NO_PREFETCH) || !defined(FAST486_NO_BLOCK_CACHE)
     ULONG LinearAddress;
 #endif
+#ifndef FAST486_NO_BLOCK_CACHE
+    PUCHAR Code;
+#endif
 
     /* Get the cached descriptor of CS */
     CachedDescriptor = &State->SegmentRegs[FAST486_REG_CS];
@@ -920,9 +1031,18 @@ Fast486FetchWord(PFAST486_STATE State,
     Offset = (CachedDescriptor->Size) ? State->InstPtr.Long
                                       : State->InstPtr.LowWord;
 
-#ifndef FAST486_NO_PREFETCH
+#if !defined(FAST486_NO_PREFETCH) || !defined(FAST486_NO_BLOCK_CACHE)
     LinearAddress = CachedDescriptor->Base + Offset;
+#endif
 
+#ifndef FAST486_NO_BLOCK_CACHE
+    if ((Code = Fast486GetBlockCode(State, LinearAddress, sizeof(USHORT))) != NULL)
+    {
+        *Data = *(PUSHORT)Code;
+    }
+    else
+#endif
+#ifndef FAST486_NO_PREFETCH
     if (State->PrefetchValid
         && (LinearAddress >= State->PrefetchAddress)
         && ((LinearAddress + sizeof(USHORT)) <= (State->PrefetchAddress + FAST486_CACHE_SIZE)))
@@ -961,9 +1081,12 @@ Fast486FetchDword(PFAST486_STATE State,
 {
     PFAST486_SEG_REG CachedDescriptor;
     ULONG Offset;
-#ifndef FAST486_NO_PREFETCH
+#if !defined(FAST486_NO_PREFETCH) || !defined(FAST486_NO_BLOCK_CACHE)
     ULONG LinearAddress;
 #endif
+#ifndef FAST486_NO_BLOCK_CACHE
+    PUCHAR Code;
+#endif
 
     /* Get the cached descriptor of CS */
     CachedDescriptor = &State->SegmentRegs[FAST486_REG_CS];
@@ -971,9 +1094,18 @@ Fast486FetchDword(PFAST486_STATE State,
     Offset = (CachedDescriptor->Size) ? State->InstPtr.Long
                                       : State->InstPtr.LowWord;
 
-#ifndef FAST486_NO_PREFETCH
+#if !defined(FAST486_NO_PREFETCH) || !defined(FAST486_NO_BLOCK_CACHE)
     LinearAddress = CachedDescriptor->Base + Offset;
+#endif
 
+#ifndef FAST486_NO_BLOCK_CACHE
+    if ((Code = Fast486GetBlockCode(State, LinearAddress, sizeof(ULONG))) != NULL)
+    {
+        *Data = *(PULONG)Code;
+    }
+    else
+#endif
+#ifndef FAST486_NO_PREFETCH
     if (State->PrefetchValid
         && (LinearAddress >= State->PrefetchAddress)
         && ((LinearAddress + sizeof(ULONG)) <= (State->PrefetchAddress + FAST486_CACHE_SIZE)))
@@ -1016,19 +1148,165 @@ Fast486CalculateParity(UCHAR Number)
 FORCEINLINE
 BOOLEAN
 FASTCALL
-Fast486ParseModRegRm(PFAST486_STATE State,
+Fast486FetchModRegRm(PFAST486_STATE State,
                      BOOLEAN AddressSize,
-                     PFAST486_MOD_REG_RM ModRegRm)
+                     PUCHAR ModRmByte,
+                     PUCHAR SibByte,
+                     PULONG Displacement)
 {
-    UCHAR ModRmByte, Mode, RegMem;
+    UCHAR Mode, RegMem;
 
     /* Fetch the MOD REG R/M byte */
-    if (!Fast486FetchByte(State, &ModRmByte))
+    if (!Fast486FetchByte(State, ModRmByte))
     {
         /* Exception occurred */
         return FALSE;
     }
 
+    /* Unpack the mode and R/M */
+    Mode = *ModRmByte >> 6;
+    RegMem = *ModRmByte & 0x07;
+
+    *SibByte = 0;
+    *Displacement = 0;
+
+    /* Nothing else follows a register operand */
+    if (Mode == 3) return TRUE;
+
+    if (AddressSize)
+    {
+        if (RegMem == FAST486_REG_ESP)
+        {
+            /* Fetch the SIB byte */
+            if (!Fast486FetchByte(State, SibByte))
+            {
+                /* Exception occurred */
+                return FALSE;
+            }
+
+            if (((*SibByte & 0x07) == FAST486_REG_EBP) && (Mode == 0))
+            {
+                /* Fetch the base */
+                if (!Fast486FetchDword(State, Displacement))
+                {
+                    /* Exception occurred */
+                    return FALSE;
+                }
+            }
+        }
+
+        if (Mode == 1)
+        {
+            CHAR Offset;
+
+            /* Fetch the byte */
+            if (!Fast486FetchByte(State, (PUCHAR)&Offset))
+            {
+                /* Exception occurred */
+                return FALSE;
+            }
+
+            /* Sign-extend it */
+            *Displacement = (LONG)Offset;
+        }
+        else if ((Mode == 2) || ((Mode == 0) && (RegMem == FAST486_REG_EBP)))
+        {
+            /* Fetch the dword */
+            if (!Fast486FetchDword(State, Displacement))
+            {
+                /* Exception occurred */
+                return FALSE;
+            }
+        }
+    }
+    else
+    {
+        if (Mode == 1)
+        {
+            CHAR Offset;
+
+            /* Fetch the byte */
+            if (!Fast486FetchByte(State, (PUCHAR)&Offset))
+            {
+                /* Exception occurred */
+                return FALSE;
+            }
+
+            /* Sign-extend it */
+            *Displacement = (LONG)Offset;
+        }
+        else if ((Mode == 2) || ((Mode == 0) && (RegMem == 6)))
+        {
+            SHORT Offset;
+
+            /* Fetch the word */
+            if (!Fast486FetchWord(State, (PUSHORT)&Offset))
+            {
+                /* Exception occurred */
+                return FALSE;
+            }
+
+            /* Sign-extend it */
+            *Displacement = (LONG)Offset;
+        }
+    }
+
+    return TRUE;
+}
+
+FORCEINLINE
+BOOLEAN
+FASTCALL
+Fast486ParseModRegRm(PFAST486_STATE State,
+                     BOOLEAN AddressSize,
+                     PFAST486_MOD_REG_RM ModRegRm)
+{
+    UCHAR ModRmByte, SibByte, Mode, RegMem;
+    ULONG Displacement;
+#ifndef FAST486_NO_BLOCK_CACHE
+    PFAST486_DECODED_INST DecodedInst = State->DecodedInst;
+
+    if (DecodedInst != NULL)
+    {
+        /* It was decoded before, skip it */
+        State->DecodedInst = NULL;
+        ModRmByte = DecodedInst->ModRm;
+        SibByte = DecodedInst->Sib;
+        Displacement = DecodedInst->Displacement;
+
+        if (State->SegmentRegs[FAST486_REG_CS].Size) State->InstPtr.Long += DecodedInst->ModRmLength;
+        else State->InstPtr.LowWord += DecodedInst->ModRmLength;
+    }
+    else
+#endif
+    {
+#ifndef FAST486_NO_BLOCK_CACHE
+        ULONG FetchStart = State->BlockFetchEnd;
+#endif
+
+        if (!Fast486FetchModRegRm(State, AddressSize, &ModRmByte, &SibByte, &Displacement))
+        {
+            /* Exception occurred */
+            return FALSE;
+        }
+
+#ifndef FAST486_NO_BLOCK_CACHE
+        if (State->Recording)
+        {
+            /* Keep it for the next time, if this is the first one */
+            DecodedInst = &State->CurrentBlock->Instructions[State->CurrentBlock->Count];
+
+            if (DecodedInst->ModRmLength == 0)
+            {
+                DecodedInst->ModRm = ModRmByte;
+                DecodedInst->Sib = SibByte;
+                DecodedInst->Displacement = Displacement;
+                DecodedInst->ModRmLength = (UCHAR)(State->BlockFetchEnd - FetchStart);
+            }
+        }
+#endif
+    }
+
     /* Unpack the mode and R/M */
     Mode = ModRmByte >> 6;
     RegMem = ModRmByte & 0x07;
@@ -1054,16 +1332,8 @@ Fast486ParseModRegRm(PFAST486_STATE State,
     {
         if (RegMem == FAST486_REG_ESP)
         {
-            UCHAR SibByte;
             ULONG Scale, Index, Base;
 
-            /* Fetch the SIB byte */
-            if (!Fast486FetchByte(State, &SibByte))
-            {
-                /* Exception occurred */
-                return FALSE;
-            }
-
             /* Unpack the scale, index and base */
             Scale = 1 << (SibByte >> 6);
             Index = (SibByte >> 3) & 0x07;
@@ -1077,12 +1347,8 @@ Fast486ParseModRegRm(PFAST486_STATE State,
             }
             else
             {
-                /* Fetch the base */
-                if (!Fast486FetchDword(State, &Base))
-                {
-                    /* Exception occurred */
-                    return FALSE;
-                }
+                /* The base is the displacement */
+                Base = 0;
             }
 
             if (((SibByte & 0x07) == FAST486_REG_ESP)
@@ -1123,34 +1389,8 @@ Fast486ParseModRegRm(PFAST486_STATE State,
             }
         }
 
-        if (Mode == 1)
-        {
-            CHAR Offset;
-
-            /* Fetch the byte */
-            if (!Fast486FetchByte(State, (PUCHAR)&Offset))
-            {
-                /* Exception occurred */
-                return FALSE;
-            }
-
-            /* Add the signed offset to the address */
-            ModRegRm->MemoryAddress += (LONG)Offset;
-        }
-        else if ((Mode == 2) || ((Mode == 0) && (RegMem == FAST486_REG_EBP)))
-        {
-            LONG Offset;
-
-            /* Fetch the dword */
-            if (!Fast486FetchDword(State, (PULONG)&Offset))
-            {
-                /* Exception occurred */
-                return FALSE;
-            }
-
-            /* Add the signed offset to the address */
-            ModRegRm->MemoryAddress += Offset;
-        }
+        /* Add the signed displacement to the address */
+        ModRegRm->MemoryAddress += Displacement;
     }
     else
     {
@@ -1239,34 +1479,8 @@ Fast486ParseModRegRm(PFAST486_STATE State,
             }
         }
 
-        if (Mode == 1)
-        {
-            CHAR Offset;
-
-            /* Fetch the byte */
-            if (!Fast486FetchByte(State, (PUCHAR)&Offset))
-            {
-                /* Exception occurred */
-                return FALSE;
-            }
-
-            /* Add the signed offset to the address */
-            ModRegRm->MemoryAddress += (LONG)Offset;
-        }
-        else if ((Mode == 2) || ((Mode == 0) && (RegMem == 6)))
-        {
-            SHORT Offset;
-
-            /* Fetch the word */
-            if (!Fast486FetchWord(State, (PUSHORT)&Offset))
-            {
-                /* Exception occurred */
-                return FALSE;
-            }
-
-            /* Add the signed offset to the address */
-            ModRegRm->MemoryAddress += (LONG)Offset;
-        }
+        /* Add the signed displacement to the address */
+        ModRegRm->MemoryAddress += Displacement;
 
         /* Clear the top 16 bits */
         ModRegRm->MemoryAddress &= 0x0000FFFF;
@@ -60,33 +60,55 @@ Fast486ExecutionControl(PFAST486_STATE State, FAST486_EXEC_CMD Command)
 
         if (!State->Halted)
         {
-NextInst:
-            /* Check if this is a new instruction */
-            if (State->PrefixFlags == 0)
+#ifndef FAST486_NO_BLOCK_CACHE
+            /* Check if the instruction was decoded before */
+            if (State->BlockCache && Fast486BlockExecute(State))
             {
-                State->SavedInstPtr = State->InstPtr;
-                State->SavedStackPtr = State->GeneralRegs[FAST486_REG_ESP];
+                /* Yes, it has been executed already */
             }
-
-            /* Perform an instruction fetch */
-            if (!Fast486FetchByte(State, &Opcode))
+            else
+#endif
             {
-                /* Exception occurred */
-                State->PrefixFlags = 0;
-                continue;
-            }
+NextInst:
+                /* Check if this is a new instruction */
+                if (State->PrefixFlags == 0)
+                {
+                    State->SavedInstPtr = State->InstPtr;
+                    State->SavedStackPtr = State->GeneralRegs[FAST486_REG_ESP];
+                }
 
-            // TODO: Check for CALL/RET to update ProcedureCallCount.
+                /* Perform an instruction fetch */
+                if (!Fast486FetchByte(State, &Opcode))
+                {
+                    /* Exception occurred */
+                    State->PrefixFlags = 0;
+                    continue;
+                }
 
-            /* Call the opcode handler */
-            CurrentHandler = Fast486OpcodeHandlers[Opcode];
-            CurrentHandler(State, Opcode);
+                // TODO: Check for CALL/RET to update ProcedureCallCount.
 
-            /* If this is a prefix, go to the next instruction immediately */
-            if (CurrentHandler == Fast486OpcodePrefix) goto NextInst;
+                /* Call the opcode handler */
+                CurrentHandler = Fast486OpcodeHandlers[Opcode];
+#ifndef FAST486_NO_BLOCK_CACHE
+                if (State->Recording && (CurrentHandler != Fast486OpcodePrefix))
+                {
+                    /* Add it to the block being decoded */
+                    Fast486BlockRecordStart(State, Opcode);
+                }
+#endif
+                CurrentHandler(State, Opcode);
+
+                /* If this is a prefix, go to the next instruction immediately */
+                if (CurrentHandler == Fast486OpcodePrefix) goto NextInst;
+
+#ifndef FAST486_NO_BLOCK_CACHE
+                /* Check if it was recorded till the end */
+                if (State->Recording) Fast486BlockRecordEnd(State);
+#endif
 
-            /* A non-prefix opcode has been executed, reset the prefix flags */
-            State->PrefixFlags = 0;
+                /* A non-prefix opcode has been executed, reset the prefix flags */
+                State->PrefixFlags = 0;
+            }
         }
 
         /*
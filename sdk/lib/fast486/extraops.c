@@ -640,6 +640,11 @@ FAST486_OPCODE_HANDLER(Fast486ExtOpcodeLoadControlReg)
     State->PrefetchValid = FALSE;
 #endif
 
+#ifndef FAST486_NO_BLOCK_CACHE
+    /* The decoded blocks too */
+    Fast486FlushBlocks(State);
+#endif
+
     if (ModRegRm.Register == (INT)FAST486_REG_CR3)
     {
         /* Flush the TLB */
@@ -108,7 +108,8 @@ Fast486Initialize(PFAST486_STATE         State,
                   FAST486_BOP_PROC       BopCallback,
                   FAST486_INT_ACK_PROC   IntAckCallback,
                   FAST486_FPU_PROC       FpuCallback,
-                  PULONG                 Tlb)
+                  PULONG                 Tlb,
+                  PFAST486_BLOCK_CACHE   BlockCache)
 {
     /* Set the callbacks (or use default ones if some are NULL) */
     State->MemReadCallback  = (MemReadCallback  ? MemReadCallback  : Fast486MemReadCallback );
@@ -122,6 +123,20 @@ Fast486Initialize(PFAST486_STATE         State,
     /* Set the TLB (if given) */
     State->Tlb = Tlb;
 
+#ifndef FAST486_NO_BLOCK_CACHE
+    /* Set the block cache (if given) */
+    State->BlockCache = BlockCache;
+
+    if (BlockCache != NULL)
+    {
+        /* Start empty */
+        RtlZeroMemory(BlockCache, sizeof(*BlockCache));
+        BlockCache->Generation = 1;
+    }
+#else
+    UNREFERENCED_PARAMETER(BlockCache);
+#endif
+
     /* Reset the CPU */
     Fast486Reset(State);
 }
@@ -132,7 +147,7 @@ Fast486Reset(PFAST486_STATE State)
 {
     FAST486_SEG_REGS i;
 
-    /* Save the callbacks and TLB */
+    /* Save the callbacks, TLB and block cache */
     FAST486_MEM_READ_PROC  MemReadCallback  = State->MemReadCallback;
     FAST486_MEM_WRITE_PROC MemWriteCallback = State->MemWriteCallback;
     FAST486_IO_READ_PROC   IoReadCallback   = State->IoReadCallback;
@@ -141,6 +156,9 @@ Fast486Reset(PFAST486_STATE State)
     FAST486_INT_ACK_PROC   IntAckCallback   = State->IntAckCallback;
     FAST486_FPU_PROC       FpuCallback      = State->FpuCallback;
     PULONG                 Tlb              = State->Tlb;
+#ifndef FAST486_NO_BLOCK_CACHE
+    PFAST486_BLOCK_CACHE   BlockCache       = State->BlockCache;
+#endif
 
     /* Clear the entire structure */
     RtlZeroMemory(State, sizeof(*State));
@@ -186,7 +204,7 @@ Fast486Reset(PFAST486_STATE State)
     State->FpuTag = 0xFFFF;
 #endif
 
-    /* Restore the callbacks and TLB */
+    /* Restore the callbacks, TLB and block cache */
     State->MemReadCallback  = MemReadCallback;
     State->MemWriteCallback = MemWriteCallback;
     State->IoReadCallback   = IoReadCallback;
@@ -195,9 +213,17 @@ Fast486Reset(PFAST486_STATE State)
     State->IntAckCallback   = IntAckCallback;
     State->FpuCallback      = FpuCallback;
     State->Tlb              = Tlb;
+#ifndef FAST486_NO_BLOCK_CACHE
+    State->BlockCache       = BlockCache;
+#endif
 
     /* Flush the TLB */
     Fast486FlushTlb(State);
+
+#ifndef FAST486_NO_BLOCK_CACHE
+    /* The memory may not hold the same code anymore */
+    Fast486FlushBlocks(State);
+#endif
 }
 
 VOID
@@ -258,6 +284,22 @@ Fast486Rewind(PFAST486_STATE State)
 #ifndef FAST486_NO_PREFETCH
     State->PrefetchValid = FALSE;
 #endif
+
+#ifndef FAST486_NO_BLOCK_CACHE
+    Fast486LeaveBlock(State);
+#endif
+}
+
+VOID
+NTAPI
+Fast486FlushBlockCache(PFAST486_STATE State)
+{
+#ifndef FAST486_NO_BLOCK_CACHE
+    /* Call the internal function */
+    Fast486FlushBlocks(State);
+#else
+    UNREFERENCED_PARAMETER(State);
+#endif
 }
 
 /* EOF */
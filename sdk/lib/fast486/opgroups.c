@@ -2264,6 +2264,11 @@ FAST486_OPCODE_HANDLER(Fast486ExtOpcodeGroup0F01)
             State->PrefetchValid = FALSE;
 #endif
 
+#ifndef FAST486_NO_BLOCK_CACHE
+            /* And the decoded blocks */
+            Fast486FlushBlocks(State);
+#endif
+
             /* This is a privileged instruction */
             if (Fast486GetCurrentPrivLevel(State) != 0)
             {
@@ -65,34 +65,47 @@ typedef ULONG BITMAP_INDEX, *PBITMAP_INDEX;
 typedef ULONG BITMAP_BUFFER, *PBITMAP_BUFFER;
 #endif
 
-/* DATA *********************************************************************/
+/* PRIVATE FUNCTIONS ********************************************************/
+
+/* Number of set bits in a buffer, counted in parallel within the word */
+static __inline
+BITMAP_INDEX
+RtlpBitCount(
+    _In_ BITMAP_BUFFER Value)
+{
+    Value = Value - ((Value >> 1) & (MAXINDEX / 3));
+    Value = (Value & (MAXINDEX / 5)) + ((Value >> 2) & (MAXINDEX / 5));
+    Value = (Value + (Value >> 4)) & (MAXINDEX / 17);
+    return (BITMAP_INDEX)((BITMAP_BUFFER)(Value * (MAXINDEX / 255)) >> (_BITCOUNT - 8));
+}
 
-/* Number of set bits per byte value */
-static const
-UCHAR
-BitCountTable[256] =
+/* Returns the first buffer from Buffer up to MaxBuffer that is not equal
+   to Pattern, or MaxBuffer. Long uniform stretches are compared four
+   buffers at a time */
+static __inline
+PBITMAP_BUFFER
+RtlpSkipUniformBuffers(
+    _In_ PBITMAP_BUFFER Buffer,
+    _In_ PBITMAP_BUFFER MaxBuffer,
+    _In_ BITMAP_BUFFER Pattern)
 {
-    /* x0 x1 x2 x3 x4 x5 x6 x7 x8 x9 xA xB xC xD xE xF */
-       0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, /* 0x */
-       1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, /* 1x */
-       1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, /* 2x */
-       2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, /* 3x */
-       1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, /* 4x */
-       2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, /* 5x */
-       2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, /* 6c */
-       3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, /* 7x */
-       1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, /* 8x */
-       2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, /* 9x */
-       2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, /* Ax */
-       3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, /* Bx */
-       2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, /* Cx */
-       3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, /* Dx */
-       3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, /* Ex */
-       4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8  /* Fx */
-};
+    while (MaxBuffer - Buffer >= 4)
+    {
+        if (((Buffer[0] ^ Pattern) | (Buffer[1] ^ Pattern) |
+             (Buffer[2] ^ Pattern) | (Buffer[3] ^ Pattern)) != 0)
+        {
+            break;
+        }
+        Buffer += 4;
+    }
 
+    while (Buffer < MaxBuffer && *Buffer == Pattern)
+    {
+        Buffer++;
+    }
 
-/* PRIVATE FUNCTIONS ********************************************************/
+    return Buffer;
+}
 
 static __inline
 BITMAP_INDEX
@@ -121,9 +134,10 @@ RtlpGetLengthOfRunClear(
     Value = *Buffer++ >> BitPos << BitPos;
 
     /* Skip all clear ULONGs */
-    while (Value == 0 && Buffer < MaxBuffer)
+    if (Value == 0)
     {
-        Value = *Buffer++;
+        Buffer = RtlpSkipUniformBuffers(Buffer, MaxBuffer, 0);
+        if (Buffer < MaxBuffer) Value = *Buffer++;
     }
 
     /* Did we reach the end? */
@@ -175,9 +189,10 @@ RtlpGetLengthOfRunSet(
     InvValue = ~(*Buffer++) >> BitPos << BitPos;
 
     /* Skip all set ULONGs */
-    while (InvValue == 0 && Buffer < MaxBuffer)
+    if (InvValue == 0)
     {
-        InvValue = ~(*Buffer++);
+        Buffer = RtlpSkipUniformBuffers(Buffer, MaxBuffer, MAXINDEX);
+        if (Buffer < MaxBuffer) InvValue = ~(*Buffer++);
     }
 
     /* Did we reach the end? */
@@ -296,7 +311,7 @@ RtlClearBit(
     _In_ BITMAP_INDEX BitNumber)
 {
     ASSERT(BitNumber <= BitMapHeader->SizeOfBitMap);
-    BitMapHeader->Buffer[BitNumber / _BITCOUNT] &= ~(1 << (BitNumber & (_BITCOUNT - 1)));
+    BitMapHeader->Buffer[BitNumber / _BITCOUNT] &= ~((BITMAP_INDEX)1 << (BitNumber & (_BITCOUNT - 1)));
 }
 
 VOID
@@ -474,22 +489,23 @@ NTAPI
 RtlNumberOfSetBits(
     _In_ PRTL_BITMAP BitMapHeader)
 {
-    PUCHAR Byte, MaxByte;
+    PBITMAP_BUFFER Buffer, MaxBuffer;
     BITMAP_INDEX BitCount = 0;
-    ULONG Shift;
+    ULONG Bits;
 
-    Byte = (PUCHAR)BitMapHeader->Buffer;
-    MaxByte = Byte + BitMapHeader->SizeOfBitMap / 8;
+    Buffer = BitMapHeader->Buffer;
+    MaxBuffer = Buffer + BitMapHeader->SizeOfBitMap / _BITCOUNT;
 
-    while (Byte < MaxByte)
+    while (Buffer < MaxBuffer)
     {
-        BitCount += BitCountTable[*Byte++];
+        BitCount += RtlpBitCount(*Buffer++);
     }
 
-    if (BitMapHeader->SizeOfBitMap & 7)
+    /* Only count the bits of the last ULONG that belong to the bitmap */
+    Bits = (ULONG)(BitMapHeader->SizeOfBitMap & (_BITCOUNT - 1));
+    if (Bits)
     {
-        Shift = 8 - (BitMapHeader->SizeOfBitMap & 7);
-        BitCount += BitCountTable[((*Byte) << Shift) & 0xFF];
+        BitCount += RtlpBitCount(*Buffer & ~(MAXINDEX << Bits));
     }
 
     return BitCount;
@@ -216,28 +216,213 @@ out:
 }
 
 
+/* compress data with LZNT1 */
+
+#define LZNT1_CHUNK_SIZE        0x1000
+#define LZNT1_MIN_MATCH         3
+#define LZNT1_HASH_SIZE         0x1000
+#define LZNT1_NO_POSITION       0xFFFF
+
+/* How many earlier positions the match finder looks at */
+#define LZNT1_CHAIN_STANDARD    16
+#define LZNT1_CHAIN_MAXIMUM     LZNT1_CHUNK_SIZE
+
+/* Hash chains of the positions of 3 byte sequences in the current chunk */
+typedef struct _LZNT1_WORKSPACE
+{
+    USHORT Head[LZNT1_HASH_SIZE];
+    USHORT Prev[LZNT1_CHUNK_SIZE];
+} LZNT1_WORKSPACE, *PLZNT1_WORKSPACE;
+
+C_ASSERT(sizeof(LZNT1_WORKSPACE) <= 0x8010);
+
+typedef struct _LZNT1_MATCH
+{
+    ULONG Length;
+    ULONG Displacement;
+} LZNT1_MATCH;
+
+/* number of displacement bits of a back reference at this position of the chunk,
+ * this must agree with lznt1_decompress_chunk */
+static ULONG lznt1_displacement_bits(ULONG pos)
+{
+    ULONG displacement_bits;
+
+    for (displacement_bits = 12; displacement_bits > 4; displacement_bits--)
+        if ((1U << (displacement_bits - 1)) < pos) break;
+
+    return displacement_bits;
+}
+
+static ULONG lznt1_hash(const UCHAR *src)
+{
+    return ((src[0] << 8) ^ (src[1] << 4) ^ src[2]) & (LZNT1_HASH_SIZE - 1);
+}
+
+static void lznt1_insert(PLZNT1_WORKSPACE ws, const UCHAR *src, ULONG src_size, ULONG pos)
+{
+    ULONG hash;
+
+    if (pos + LZNT1_MIN_MATCH > src_size)
+        return;
+
+    hash = lznt1_hash(src + pos);
+    ws->Prev[pos] = ws->Head[hash];
+    ws->Head[hash] = (USHORT)pos;
+}
+
+static LZNT1_MATCH lznt1_find_match(PLZNT1_WORKSPACE ws, const UCHAR *src, ULONG src_size,
+                                    ULONG pos, ULONG max_chain)
+{
+    LZNT1_MATCH match = { 0, 0 };
+    ULONG max_length, length, candidate;
+
+    if (pos + LZNT1_MIN_MATCH > src_size)
+        return match;
+
+    /* longer matches need more length bits, which leaves fewer for the displacement */
+    max_length = (1U << (16 - lznt1_displacement_bits(pos))) - 1 + LZNT1_MIN_MATCH;
+    max_length = min(max_length, src_size - pos);
+
+    /* all earlier positions of the chunk are in reach, the displacement bits grow with pos */
+    for (candidate = ws->Head[lznt1_hash(src + pos)];
+         candidate != LZNT1_NO_POSITION && max_chain--;
+         candidate = ws->Prev[candidate])
+    {
+        if (src[candidate + match.Length] != src[pos + match.Length])
+            continue;
+
+        for (length = 0; length < max_length && src[candidate + length] == src[pos + length]; length++);
+
+        if (length > match.Length)
+        {
+            match.Length = length;
+            match.Displacement = pos - candidate;
+            if (length == max_length) break;
+        }
+    }
+
+    if (match.Length < LZNT1_MIN_MATCH)
+        match.Length = 0;
+
+    return match;
+}
+
+/* compress a single LZNT1 chunk, returns 0 if it doesn't get smaller than dst_size */
+static ULONG lznt1_compress_chunk(UCHAR *dst, ULONG dst_size, const UCHAR *src, ULONG src_size,
+                                  PLZNT1_WORKSPACE ws, BOOLEAN maximum)
+{
+    UCHAR *dst_cur = dst, *dst_end = dst + dst_size, *flags = NULL;
+    ULONG max_chain = maximum ? LZNT1_CHAIN_MAXIMUM : LZNT1_CHAIN_STANDARD;
+    ULONG pos = 0, token = 0, length_bits, i;
+    LZNT1_MATCH match = { 0, 0 }, next = { 0, 0 };
+    BOOLEAN have_match = FALSE;
+
+    for (i = 0; i < LZNT1_HASH_SIZE; i++)
+        ws->Head[i] = LZNT1_NO_POSITION;
+
+    while (pos < src_size)
+    {
+        if (!have_match)
+            match = lznt1_find_match(ws, src, src_size, pos, max_chain);
+        have_match = FALSE;
+        lznt1_insert(ws, src, src_size, pos);
+
+        /* the maximum engine checks whether the next position has a longer match */
+        if (maximum && match.Length && pos + 1 < src_size)
+        {
+            next = lznt1_find_match(ws, src, src_size, pos + 1, max_chain);
+            if (next.Length > match.Length)
+            {
+                match.Length = 0;
+                have_match = TRUE;
+            }
+        }
+
+        /* every 8 entities are preceded by their flags */
+        if (!(token++ & 7))
+        {
+            if (dst_cur >= dst_end) return 0;
+            flags = dst_cur++;
+            *flags = 0;
+        }
+
+        if (match.Length)
+        {
+            /* backwards reference */
+            if (dst_cur + sizeof(WORD) > dst_end) return 0;
+            length_bits = 16 - lznt1_displacement_bits(pos);
+            *(WORD *)dst_cur = (WORD)(((match.Displacement - 1) << length_bits) |
+                                      (match.Length - LZNT1_MIN_MATCH));
+            dst_cur += sizeof(WORD);
+            *flags |= 1 << ((token - 1) & 7);
+
+            for (i = 1; i < match.Length; i++)
+                lznt1_insert(ws, src, src_size, pos + i);
+            pos += match.Length;
+        }
+        else
+        {
+            /* uncompressed data */
+            if (dst_cur >= dst_end) return 0;
+            *dst_cur++ = src[pos++];
+        }
+
+        if (have_match)
+            match = next;
+    }
+
+    return dst_cur - dst;
+}
+
 static NTSTATUS
 RtlpCompressBufferLZNT1(UCHAR *src, ULONG src_size, UCHAR *dst, ULONG dst_size,
-                        ULONG chunk_size, ULONG *final_size, UCHAR *workspace)
+                        ULONG chunk_size, ULONG *final_size, UCHAR *workspace,
+                        USHORT engine)
 {
         UCHAR *src_cur = src, *src_end = src + src_size;
         UCHAR *dst_cur = dst, *dst_end = dst + dst_size;
-        ULONG block_size;
+        ULONG block_size, compressed_size;
 
+        /* LZNT1 chunks always hold 4 KB, so chunk_size doesn't matter */
         while (src_cur < src_end)
         {
             /* determine size of current chunk */
-            block_size = min(0x1000, src_end - src_cur);
-            if (dst_cur + sizeof(WORD) + block_size > dst_end)
+            block_size = min(LZNT1_CHUNK_SIZE, src_end - src_cur);
+            if (dst_cur + sizeof(WORD) > dst_end)
                 return STATUS_BUFFER_TOO_SMALL;
 
-            /* write (uncompressed) chunk header */
-            *(WORD *)dst_cur = 0x3000 | (block_size - 1);
-            dst_cur += sizeof(WORD);
+            /* keep the chunk compressed only if that makes it smaller */
+            compressed_size = 0;
+            if (workspace)
+            {
+                compressed_size = lznt1_compress_chunk(dst_cur + sizeof(WORD),
+                                                       min(block_size - 1, dst_end - dst_cur - sizeof(WORD)),
+                                                       src_cur, block_size,
+                                                       (PLZNT1_WORKSPACE)workspace,
+                                                       engine == COMPRESSION_ENGINE_MAXIMUM);
+            }
+
+            if (compressed_size)
+            {
+                /* write compressed chunk header */
+                *(WORD *)dst_cur = 0xB000 | (compressed_size - 1);
+                dst_cur += sizeof(WORD) + compressed_size;
+            }
+            else
+            {
+                if (dst_cur + sizeof(WORD) + block_size > dst_end)
+                    return STATUS_BUFFER_TOO_SMALL;
+
+                /* write (uncompressed) chunk header */
+                *(WORD *)dst_cur = 0x3000 | (block_size - 1);
+                dst_cur += sizeof(WORD);
+
+                /* write chunk content */
+                memcpy(dst_cur, src_cur, block_size);
+                dst_cur += block_size;
+            }
 
-            /* write chunk content */
-            memcpy(dst_cur, src_cur, block_size);
-            dst_cur += block_size;
             src_cur += block_size;
         }
 
@@ -261,7 +446,8 @@ RtlpWorkSpaceSizeLZNT1(USHORT Engine,
    }
    else if (Engine == COMPRESSION_ENGINE_MAXIMUM)
    {
-      *BufferAndWorkSpaceSize = 0x10;
+      /* Same hash chains, they are just searched further */
+      *BufferAndWorkSpaceSize = 0x8010;
       *FragmentWorkSpaceSize = 0x1000;
       return(STATUS_SUCCESS);
    }
@@ -284,7 +470,7 @@ RtlCompressBuffer(IN USHORT CompressionFormatAndEngine,
                   IN PVOID WorkSpace)
 {
    USHORT Format = CompressionFormatAndEngine & COMPRESSION_FORMAT_MASK;
-   /* USHORT Engine = CompressionFormatAndEngine & COMPRESSION_ENGINE_MASK; */
+   USHORT Engine = CompressionFormatAndEngine & COMPRESSION_ENGINE_MASK;
 
    if ((Format == COMPRESSION_FORMAT_NONE) ||
          (Format == COMPRESSION_FORMAT_DEFAULT))
@@ -297,7 +483,8 @@ RtlCompressBuffer(IN USHORT CompressionFormatAndEngine,
                                      CompressedBufferSize,
                                      UncompressedChunkSize,
                                      FinalCompressedSize,
-                                     WorkSpace));
+                                     WorkSpace,
+                                     Engine));
 
    return(STATUS_UNSUPPORTED_COMPRESSION);
 }
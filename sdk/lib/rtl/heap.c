@@ -1563,6 +1563,9 @@ RtlDestroyHeap(HANDLE HeapPtr) /* [in] Handle of heap */
     if (RtlpGetMode() == UserMode &&
         HeapPtr == NtCurrentPeb()->ProcessHeap) return HeapPtr;
 
+    /* Free the front end heap */
+    RtlpDestroyLowFragmentationHeap(Heap);
+
     /* Free up all big allocations */
     Current = Heap->VirtualAllocdBlocks.Flink;
     while (Current != &Heap->VirtualAllocdBlocks)
@@ -1977,6 +1980,28 @@ RtlAllocateHeap(IN PVOID HeapPtr,
 
     Index = AllocationSize >> HEAP_ENTRY_SHIFT;
 
+    /* Plain small blocks can come from the front end, if there is one */
+    if (Heap->FrontEndHeap &&
+        !(Flags & HEAP_NO_SERIALIZE) &&
+        EntryFlags == HEAP_ENTRY_BUSY &&
+        Index < HEAP_LFH_BUCKETS)
+    {
+        InUseEntry = RtlpLowFragHeapAlloc(Heap, Index);
+        if (InUseEntry)
+        {
+            /* The block may be bigger than needed */
+            InUseEntry->UnusedBytes = (UCHAR)((InUseEntry->Size << HEAP_ENTRY_SHIFT) - Size);
+            InUseEntry->SmallTagIndex = 0;
+
+            /* Zero memory if that was requested */
+            if (Flags & HEAP_ZERO_MEMORY)
+                RtlZeroMemory(InUseEntry + 1, Size);
+
+            /* User data starts right after the entry's header */
+            return InUseEntry + 1;
+        }
+    }
+
     /* Acquire the lock if necessary */
     if (!(Flags & HEAP_NO_SERIALIZE))
     {
@@ -2196,6 +2221,15 @@ BOOLEAN NTAPI RtlFreeHeap(
             RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_INVALID_PARAMETER);
             _SEH2_YIELD(return FALSE);
         }
+        /* Blocks cached by the front end are still busy for the back end */
+        if (Heap->FrontEndHeap &&
+            HeapEntry->SmallTagIndex == HEAP_LFH_CACHED_TAG)
+        {
+            /* This block was already freed */
+            DPRINT1("HEAP: Trying to free an already freed block %p!\n", Ptr);
+            RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_INVALID_PARAMETER);
+            _SEH2_YIELD(return FALSE);
+        }
     }
     _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
     {
@@ -2206,6 +2240,14 @@ BOOLEAN NTAPI RtlFreeHeap(
     }
     _SEH2_END;
 
+    /* Small blocks may be kept by the front end, if there is one */
+    if (Heap->FrontEndHeap &&
+        !(Flags & HEAP_NO_SERIALIZE) &&
+        RtlpLowFragHeapFree(Heap, HeapEntry))
+    {
+        return TRUE;
+    }
+
     /* Lock if necessary */
     if (!(Flags & HEAP_NO_SERIALIZE))
     {
@@ -3916,6 +3958,8 @@ RtlSetHeapInformation(IN HANDLE HeapHandle OPTIONAL,
                       IN PVOID HeapInformation,
                       IN SIZE_T HeapInformationLength)
 {
+    PHEAP Heap = (PHEAP)HeapHandle;
+
     /* Setting heap information is not really supported except for enabling LFH */
     if (HeapInformationClass == HeapCompatibilityInformation)
     {
@@ -3927,13 +3971,23 @@ RtlSetHeapInformation(IN HANDLE HeapHandle OPTIONAL,
         }
 
         /* Check for a special magic value for enabling LFH */
-        if (*(PULONG)HeapInformation != 2)
+        if (*(PULONG)HeapInformation != HEAP_FRONT_END_LFH)
         {
             return STATUS_UNSUCCESSFUL;
         }
 
-        DPRINT1("RtlSetHeapInformation() needs to enable LFH\n");
-        return STATUS_SUCCESS;
+        /* The front end relies on the heap lock and plain blocks */
+        if (!Heap ||
+            (Heap->Flags & (HEAP_NO_SERIALIZE |
+                            HEAP_TAIL_CHECKING_ENABLED |
+                            HEAP_FREE_CHECKING_ENABLED)) ||
+            (Heap->ForceFlags & HEAP_FLAG_PAGE_ALLOCS) ||
+            RtlpHeapIsSpecial(Heap->Flags))
+        {
+            return STATUS_UNSUCCESSFUL;
+        }
+
+        return RtlpActivateLowFragmentationHeap(Heap);
     }
 
     return STATUS_SUCCESS;
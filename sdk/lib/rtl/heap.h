@@ -55,6 +55,18 @@
 /* Segment flags */
 #define HEAP_USER_ALLOCATED    0x1
 
+/* Front end heap types */
+#define HEAP_FRONT_END_NONE    0
+#define HEAP_FRONT_END_LFH     2
+
+/* Low fragmentation front end heap definitions */
+#define HEAP_LFH_BUCKETS        HEAP_FREELISTS
+#define HEAP_LFH_AFFINITY_SLOTS 8
+#define HEAP_LFH_SLOT_BYTES     0x2000
+#define HEAP_LFH_MIN_DEPTH      4
+#define HEAP_LFH_REFILL_COUNT   8
+#define HEAP_LFH_CACHED_TAG     0xFF
+
 /* A handy inline to distinguis normal heap, special "debug heap" and special "page heap" */
 FORCEINLINE BOOLEAN
 RtlpHeapIsSpecial(ULONG Flags)
@@ -327,6 +339,19 @@ typedef struct _HEAP_VIRTUAL_ALLOC_ENTRY
     HEAP_ENTRY BusyBlock;
 } HEAP_VIRTUAL_ALLOC_ENTRY, *PHEAP_VIRTUAL_ALLOC_ENTRY;
 
+/* One bucket per block size. Each affinity slot caches busy blocks
+   of this exact size, which are handed out without taking the heap lock */
+typedef struct _HEAP_LFH_BUCKET
+{
+    SLIST_HEADER AffinitySlots[HEAP_LFH_AFFINITY_SLOTS];
+    USHORT MaximumDepth;
+} HEAP_LFH_BUCKET, *PHEAP_LFH_BUCKET;
+
+typedef struct _HEAP_LFH
+{
+    HEAP_LFH_BUCKET Buckets[HEAP_LFH_BUCKETS];
+} HEAP_LFH, *PHEAP_LFH;
+
 /* Global variables */
 extern RTL_CRITICAL_SECTION RtlpProcessHeapsListLock;
 extern BOOLEAN RtlpPageHeapEnabled;
@@ -406,6 +431,21 @@ RtlDebugSizeHeap(HANDLE HeapPtr,
                  ULONG Flags,
                  PVOID Ptr);
 
+/* heaplfh.c */
+NTSTATUS NTAPI
+RtlpActivateLowFragmentationHeap(PHEAP Heap);
+
+VOID NTAPI
+RtlpDestroyLowFragmentationHeap(PHEAP Heap);
+
+PHEAP_ENTRY NTAPI
+RtlpLowFragHeapAlloc(PHEAP Heap,
+                     SIZE_T Index);
+
+BOOLEAN NTAPI
+RtlpLowFragHeapFree(PHEAP Heap,
+                    PHEAP_ENTRY HeapEntry);
+
 /* heappage.c */
 
 HANDLE NTAPI
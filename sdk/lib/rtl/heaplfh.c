@@ -0,0 +1,187 @@
+/*
+ * PROJECT:         ReactOS Runtime Library
+ * LICENSE:         GPL - See COPYING in the top level directory
+ * FILE:            lib/rtl/heaplfh.c
+ * PURPOSE:         Heap manager low fragmentation front end
+ */
+
+/* INCLUDES ******************************************************************/
+
+#include <rtl.h>
+#include <heap.h>
+
+#define NDEBUG
+#include <debug.h>
+
+/* NOTES **********************************************************************
+ *
+ * The front end caches busy blocks of the back end, one bucket per block
+ * size, so that small allocations and frees don't have to take the heap
+ * lock. Cached blocks stay busy from the back end point of view: their
+ * header is never written by the front end but for the UnusedBytes and
+ * SmallTagIndex fields, which the back end doesn't touch on busy blocks.
+ * SmallTagIndex is set to HEAP_LFH_CACHED_TAG while a block is cached,
+ * which is how RtlFreeHeap catches a block being freed twice.
+ *
+ * Each bucket is split in affinity slots, picked from the current thread,
+ * so that threads mostly push and pop their own slot. When a slot is empty,
+ * it gets refilled with a batch of blocks taken from the back end with a
+ * single lock acquisition.
+ */
+
+/* FUNCTIONS ******************************************************************/
+
+FORCEINLINE
+PSLIST_HEADER
+RtlpGetLowFragHeapSlot(PHEAP_LFH_BUCKET Bucket)
+{
+    ULONG Slot = 0;
+
+    /* Thread IDs are multiples of 4 */
+    if (RtlpGetMode() == UserMode)
+        Slot = (ULONG)((ULONG_PTR)NtCurrentTeb()->ClientId.UniqueThread >> 2) % HEAP_LFH_AFFINITY_SLOTS;
+
+    return &Bucket->AffinitySlots[Slot];
+}
+
+static
+BOOLEAN
+RtlpLowFragHeapPush(PHEAP_LFH Lfh,
+                    PHEAP_ENTRY HeapEntry)
+{
+    PHEAP_LFH_BUCKET Bucket;
+    PSLIST_HEADER Slot;
+
+    /* Only small blocks are cached */
+    if (HeapEntry->Size >= HEAP_LFH_BUCKETS) return FALSE;
+
+    Bucket = &Lfh->Buckets[HeapEntry->Size];
+    Slot = RtlpGetLowFragHeapSlot(Bucket);
+
+    /* Don't hoard memory, let the back end have it when the slot is full */
+    if (RtlQueryDepthSList(Slot) >= Bucket->MaximumDepth) return FALSE;
+
+    /* Mark it freed, the user data of the block holds the list entry */
+    HeapEntry->SmallTagIndex = HEAP_LFH_CACHED_TAG;
+    RtlInterlockedPushEntrySList(Slot, (PSLIST_ENTRY)(HeapEntry + 1));
+    return TRUE;
+}
+
+NTSTATUS NTAPI
+RtlpActivateLowFragmentationHeap(PHEAP Heap)
+{
+    PHEAP_LFH Lfh;
+    ULONG i, j, Depth;
+
+    /* Nothing to do if it's already active */
+    if (Heap->FrontEndHeap) return STATUS_SUCCESS;
+
+    /* Take it from the heap itself, so that it is committed the way the
+       heap's memory is. Heap blocks are aligned enough for SList headers */
+    Lfh = RtlAllocateHeap(Heap, 0, sizeof(HEAP_LFH));
+    if (!Lfh)
+    {
+        DPRINT1("HEAP: Failed to allocate the front end heap\n");
+        return STATUS_NO_MEMORY;
+    }
+
+    for (i = 0; i < HEAP_LFH_BUCKETS; i++)
+    {
+        for (j = 0; j < HEAP_LFH_AFFINITY_SLOTS; j++)
+            RtlInitializeSListHead(&Lfh->Buckets[i].AffinitySlots[j]);
+
+        /* Cache about the same amount of memory in each slot, whatever the block size */
+        Depth = i ? HEAP_LFH_SLOT_BYTES / (i << HEAP_ENTRY_SHIFT) : 0;
+        Lfh->Buckets[i].MaximumDepth = (USHORT)max(Depth, HEAP_LFH_MIN_DEPTH);
+    }
+
+    /* Publish it, unless someone beat us. Ours is too big to be cached */
+    if (InterlockedCompareExchangePointer(&Heap->FrontEndHeap, Lfh, NULL) != NULL)
+    {
+        RtlFreeHeap(Heap, 0, Lfh);
+        return STATUS_SUCCESS;
+    }
+
+    Heap->FrontEndHeapType = HEAP_FRONT_END_LFH;
+    return STATUS_SUCCESS;
+}
+
+VOID NTAPI
+RtlpDestroyLowFragmentationHeap(PHEAP Heap)
+{
+    if (!Heap->FrontEndHeap) return;
+
+    /* It lives in the heap segments, like the cached blocks,
+       so they all go away with them */
+    Heap->FrontEndHeap = NULL;
+    Heap->FrontEndHeapType = HEAP_FRONT_END_NONE;
+}
+
+PHEAP_ENTRY NTAPI
+RtlpLowFragHeapAlloc(PHEAP Heap,
+                     SIZE_T Index)
+{
+    PHEAP_LFH Lfh = (PHEAP_LFH)Heap->FrontEndHeap;
+    PHEAP_ENTRY HeapEntry, Block = NULL;
+    PSLIST_ENTRY ListEntry;
+    PVOID Ptr;
+    ULONG i;
+
+    ASSERT(Index < HEAP_LFH_BUCKETS);
+
+    /* Fast path, no lock involved */
+    ListEntry = RtlInterlockedPopEntrySList(RtlpGetLowFragHeapSlot(&Lfh->Buckets[Index]));
+    if (ListEntry) return (PHEAP_ENTRY)ListEntry - 1;
+
+    /* The slot is empty, refill it from the back end */
+    RtlEnterHeapLock(Heap->LockVariable, TRUE);
+    _SEH2_TRY
+    {
+        for (i = 0; i < HEAP_LFH_REFILL_COUNT; i++)
+        {
+            /* We own the lock, so the back end doesn't need to take it */
+            Ptr = RtlAllocateHeap(Heap,
+                                  HEAP_NO_SERIALIZE,
+                                  (Index << HEAP_ENTRY_SHIFT) - sizeof(HEAP_ENTRY));
+            if (!Ptr) break;
+
+            HeapEntry = (PHEAP_ENTRY)Ptr - 1;
+
+            /* The first one is for the caller */
+            if (!Block)
+            {
+                Block = HeapEntry;
+                continue;
+            }
+
+            /* Cache the others. They can be bigger than asked for, if
+               the back end didn't split a remainder too small to be free */
+            if (!RtlpLowFragHeapPush(Lfh, HeapEntry))
+            {
+                RtlFreeHeap(Heap, HEAP_NO_SERIALIZE, Ptr);
+                break;
+            }
+        }
+    }
+    _SEH2_FINALLY
+    {
+        RtlLeaveHeapLock(Heap->LockVariable);
+    }
+    _SEH2_END;
+
+    return Block;
+}
+
+BOOLEAN NTAPI
+RtlpLowFragHeapFree(PHEAP Heap,
+                    PHEAP_ENTRY HeapEntry)
+{
+    /* Only plain blocks can be handed out again by the fast path:
+       no extra stuff, user flags, fill pattern or virtual allocation */
+    if ((HeapEntry->Flags & ~HEAP_ENTRY_LAST_ENTRY) != HEAP_ENTRY_BUSY)
+        return FALSE;
+
+    return RtlpLowFragHeapPush((PHEAP_LFH)Heap->FrontEndHeap, HeapEntry);
+}
+
+/* EOF */
@@ -35,9 +35,67 @@ PUSHORT NlsOemLeadByteInfo = NULL; /* exported */
 USHORT NlsOemDefaultChar = '\0';
 USHORT NlsUnicodeDefaultChar = 0;
 
+/* TRUE when the single-byte ANSI code page maps 0x00-0x7F to itself both ways */
+static BOOLEAN NlsAnsiIsAsciiCompatible = FALSE;
+
+/*
+ * Number of characters checked for ASCII at once. After a block that is not
+ * only ASCII, the converters wait for this many ASCII characters in a row
+ * before checking again, so mixed text is not checked over and over.
+ */
+#define NLS_ASCII_BLOCK 16
+
 
 /* FUNCTIONS *****************************************************************/
 
+static
+BOOLEAN
+RtlpIsAsciiBlockA(IN PCSTR String)
+{
+    UCHAR Bits = 0;
+    ULONG i;
+
+    for (i = 0; i < NLS_ASCII_BLOCK; i++)
+        Bits |= (UCHAR)String[i];
+
+    return (Bits & 0x80) == 0;
+}
+
+static
+BOOLEAN
+RtlpIsAsciiBlockW(IN PCWCH String)
+{
+    WCHAR Bits = 0;
+    ULONG i;
+
+    for (i = 0; i < NLS_ASCII_BLOCK; i++)
+        Bits |= String[i];
+
+    return (Bits & 0xFF80) == 0;
+}
+
+static
+VOID
+RtlpWidenAsciiBlock(OUT PWCHAR UnicodeString,
+                    IN PCSTR AsciiString)
+{
+    ULONG i;
+
+    for (i = 0; i < NLS_ASCII_BLOCK; i++)
+        UnicodeString[i] = (UCHAR)AsciiString[i];
+}
+
+static
+VOID
+RtlpNarrowAsciiBlock(OUT PCHAR AsciiString,
+                     IN PCWCH UnicodeString)
+{
+    ULONG i;
+
+    for (i = 0; i < NLS_ASCII_BLOCK; i++)
+        AsciiString[i] = (CHAR)UnicodeString[i];
+}
+
 /*
  * @unimplemented
  */
@@ -250,7 +308,19 @@ RtlMultiByteToUnicodeN(OUT PWCHAR UnicodeString,
         if (ResultSize)
             *ResultSize = Size * sizeof(WCHAR);
 
-        for (i = 0; i < Size; i++)
+        i = 0;
+        if (NlsAnsiIsAsciiCompatible)
+        {
+            /* Plain ASCII needs no table lookups */
+            for (; Size - i >= NLS_ASCII_BLOCK; i += NLS_ASCII_BLOCK)
+            {
+                if (!RtlpIsAsciiBlockA(&MbString[i]))
+                    break;
+                RtlpWidenAsciiBlock(&UnicodeString[i], &MbString[i]);
+            }
+        }
+
+        for (; i < Size; i++)
             UnicodeString[i] = NlsAnsiToUnicodeTable[(UCHAR)MbString[i]];
     }
     else
@@ -261,16 +331,37 @@ RtlMultiByteToUnicodeN(OUT PWCHAR UnicodeString,
         UCHAR Char;
         USHORT LeadByteInfo;
         PCSTR MbEnd = MbString + MbSize;
+        ULONG AsciiRun = NLS_ASCII_BLOCK;
 
         for (i = 0; i < UnicodeSize / sizeof(WCHAR) && MbString < MbEnd; i++)
         {
+            /* Widen plain ASCII a block at a time, leaving at least one character */
+            while (AsciiRun >= NLS_ASCII_BLOCK &&
+                   UnicodeSize / sizeof(WCHAR) - i > NLS_ASCII_BLOCK &&
+                   MbEnd - MbString > NLS_ASCII_BLOCK)
+            {
+                /* Not only ASCII, go one character at a time for a while */
+                if (!RtlpIsAsciiBlockA(MbString))
+                {
+                    AsciiRun = 0;
+                    break;
+                }
+
+                RtlpWidenAsciiBlock(UnicodeString, MbString);
+                UnicodeString += NLS_ASCII_BLOCK;
+                MbString += NLS_ASCII_BLOCK;
+                i += NLS_ASCII_BLOCK;
+            }
+
             Char = *(PUCHAR)MbString++;
 
             if (Char < 0x80)
             {
                 *UnicodeString++ = Char;
+                AsciiRun++;
                 continue;
             }
+            AsciiRun = 0;
 
             LeadByteInfo = NlsLeadByteInfo[Char];
 
@@ -442,6 +533,8 @@ RtlOemToUnicodeN(OUT PWCHAR UnicodeString,
 VOID NTAPI
 RtlResetRtlTranslations(IN PNLSTABLEINFO NlsTable)
 {
+    ULONG i;
+
     PAGED_CODE_RTL();
 
     DPRINT("RtlResetRtlTranslations() called\n");
@@ -455,6 +548,14 @@ RtlResetRtlTranslations(IN PNLSTABLEINFO NlsTable)
     NlsAnsiCodePage = NlsTable->AnsiTableInfo.CodePage;
     DPRINT("Ansi codepage %hu\n", NlsAnsiCodePage);
 
+    /* Most single-byte code pages leave ASCII alone, remember if this one does */
+    NlsAnsiIsAsciiCompatible = !NlsMbCodePageTag;
+    for (i = 0; i < 0x80 && NlsAnsiIsAsciiCompatible; i++)
+    {
+        if (NlsAnsiToUnicodeTable[i] != i || (UCHAR)NlsUnicodeToAnsiTable[i] != i)
+            NlsAnsiIsAsciiCompatible = FALSE;
+    }
+
     /* Set OEM data */
     NlsOemToUnicodeTable = (PUSHORT)NlsTable->OemTableInfo.MultiByteTable;
     NlsUnicodeToOemTable = NlsTable->OemTableInfo.WideCharTable;
@@ -473,6 +574,168 @@ RtlResetRtlTranslations(IN PNLSTABLEINFO NlsTable)
     NlsUnicodeDefaultChar = NlsTable->OemTableInfo.TransDefaultChar;
 }
 
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+RtlUTF8ToUnicodeN(OUT PWSTR UnicodeStringDestination,
+                  IN ULONG UnicodeStringMaxByteCount,
+                  OUT PULONG UnicodeStringActualByteCount,
+                  IN PCCH UTF8StringSource,
+                  IN ULONG UTF8StringByteCount)
+{
+    NTSTATUS Status = STATUS_SUCCESS;
+    ULONG i, j;
+    ULONG Written = 0;
+    ULONG Char;
+    ULONG TrailBytes;
+    WCHAR Utf16Char[3];
+    ULONG Utf16Length;
+    ULONG AsciiRun = NLS_ASCII_BLOCK;
+
+    if (!UTF8StringSource)
+        return STATUS_INVALID_PARAMETER_4;
+    if (!UnicodeStringActualByteCount)
+        return STATUS_INVALID_PARAMETER;
+
+    for (i = 0; i < UTF8StringByteCount; i++)
+    {
+        /* Copy plain ASCII a block at a time, leaving at least one byte */
+        while (AsciiRun >= NLS_ASCII_BLOCK && UTF8StringByteCount - i > NLS_ASCII_BLOCK)
+        {
+            if (UnicodeStringDestination &&
+                UnicodeStringMaxByteCount < NLS_ASCII_BLOCK * sizeof(WCHAR))
+            {
+                break;
+            }
+
+            /* Not only ASCII, go one character at a time for a while */
+            if (!RtlpIsAsciiBlockA(&UTF8StringSource[i]))
+            {
+                AsciiRun = 0;
+                break;
+            }
+
+            if (UnicodeStringDestination)
+            {
+                RtlpWidenAsciiBlock(UnicodeStringDestination, &UTF8StringSource[i]);
+                UnicodeStringDestination += NLS_ASCII_BLOCK;
+                UnicodeStringMaxByteCount -= NLS_ASCII_BLOCK * sizeof(WCHAR);
+            }
+            Written += NLS_ASCII_BLOCK;
+            i += NLS_ASCII_BLOCK;
+        }
+
+        /* Read the lead byte */
+        Char = (UCHAR)UTF8StringSource[i];
+        TrailBytes = 0;
+        AsciiRun = (Char < 0x80) ? AsciiRun + 1 : 0;
+        if (Char >= 0xF5)
+        {
+            Char = 0xFFFD;
+            Status = STATUS_SOME_NOT_MAPPED;
+        }
+        else if (Char >= 0xF0)
+        {
+            Char &= 0x07;
+            TrailBytes = 3;
+        }
+        else if (Char >= 0xE0)
+        {
+            Char &= 0x0F;
+            TrailBytes = 2;
+        }
+        else if (Char >= 0xC2)
+        {
+            Char &= 0x1F;
+            TrailBytes = 1;
+        }
+        else if (Char >= 0x80)
+        {
+            /* Overlong or trail byte */
+            Char = 0xFFFD;
+            Status = STATUS_SOME_NOT_MAPPED;
+        }
+
+        /* Read the trail bytes */
+        if (i + TrailBytes < UTF8StringByteCount)
+        {
+            for (j = 0; j < TrailBytes; j++)
+            {
+                if ((UTF8StringSource[i + 1] & 0xC0) == 0x80)
+                {
+                    Char = (Char << 6) | (UTF8StringSource[i + 1] & 0x3F);
+                    i++;
+                }
+                else
+                {
+                    Char = 0xFFFD;
+                    TrailBytes = 0;
+                    Status = STATUS_SOME_NOT_MAPPED;
+                    break;
+                }
+            }
+        }
+        else
+        {
+            /* Truncated sequence, it ends the string */
+            Char = 0xFFFD;
+            TrailBytes = 0;
+            Status = STATUS_SOME_NOT_MAPPED;
+            i = UTF8StringByteCount;
+        }
+
+        /* Encode it as UTF-16 */
+        if ((Char > 0x10FFFF) ||
+            (Char >= 0xD800 && Char <= 0xDFFF) ||
+            (TrailBytes == 2 && Char < 0x800) ||
+            (TrailBytes == 3 && Char < 0x10000))
+        {
+            /* Invalid code point or overlong encoding, one replacement per trail byte */
+            Utf16Char[0] = Utf16Char[1] = Utf16Char[2] = 0xFFFD;
+            Utf16Length = TrailBytes;
+            Status = STATUS_SOME_NOT_MAPPED;
+        }
+        else if (Char >= 0x10000)
+        {
+            Char -= 0x10000;
+            Utf16Char[0] = 0xD800 + ((Char >> 10) & 0x3FF);
+            Utf16Char[1] = 0xDC00 + (Char & 0x3FF);
+            Utf16Length = 2;
+        }
+        else
+        {
+            Utf16Char[0] = (WCHAR)Char;
+            Utf16Length = 1;
+        }
+
+        if (!UnicodeStringDestination)
+        {
+            Written += Utf16Length;
+            continue;
+        }
+
+        for (j = 0; j < Utf16Length; j++)
+        {
+            if (UnicodeStringMaxByteCount >= sizeof(WCHAR))
+            {
+                *UnicodeStringDestination++ = Utf16Char[j];
+                UnicodeStringMaxByteCount -= sizeof(WCHAR);
+                Written++;
+            }
+            else
+            {
+                UnicodeStringMaxByteCount = 0;
+                Status = STATUS_BUFFER_TOO_SMALL;
+            }
+        }
+    }
+
+    *UnicodeStringActualByteCount = Written * sizeof(WCHAR);
+    return Status;
+}
+
 /*
  * @unimplemented
  */
@@ -541,7 +804,21 @@ RtlUnicodeToMultiByteN(OUT PCHAR MbString,
         if (ResultSize)
             *ResultSize = Size;
 
-        for (i = 0; i < Size; i++)
+        i = 0;
+        if (NlsAnsiIsAsciiCompatible)
+        {
+            /* Plain ASCII needs no table lookups */
+            for (; Size - i >= NLS_ASCII_BLOCK; i += NLS_ASCII_BLOCK)
+            {
+                if (!RtlpIsAsciiBlockW(UnicodeString))
+                    break;
+                RtlpNarrowAsciiBlock(MbString, UnicodeString);
+                MbString += NLS_ASCII_BLOCK;
+                UnicodeString += NLS_ASCII_BLOCK;
+            }
+        }
+
+        for (; i < Size; i++)
         {
             *MbString++ = NlsUnicodeToAnsiTable[*UnicodeString++];
         }
@@ -553,16 +830,37 @@ RtlUnicodeToMultiByteN(OUT PCHAR MbString,
 
         USHORT WideChar;
         USHORT MbChar;
+        ULONG AsciiRun = NLS_ASCII_BLOCK;
 
         for (i = MbSize, Size = UnicodeSize / sizeof(WCHAR); i && Size; i--, Size--)
         {
+            /* Narrow plain ASCII a block at a time, leaving at least one character */
+            while (AsciiRun >= NLS_ASCII_BLOCK &&
+                   i > NLS_ASCII_BLOCK && Size > NLS_ASCII_BLOCK)
+            {
+                /* Not only ASCII, go one character at a time for a while */
+                if (!RtlpIsAsciiBlockW(UnicodeString))
+                {
+                    AsciiRun = 0;
+                    break;
+                }
+
+                RtlpNarrowAsciiBlock(MbString, UnicodeString);
+                MbString += NLS_ASCII_BLOCK;
+                UnicodeString += NLS_ASCII_BLOCK;
+                i -= NLS_ASCII_BLOCK;
+                Size -= NLS_ASCII_BLOCK;
+            }
+
             WideChar = *UnicodeString++;
 
             if (WideChar < 0x80)
             {
                 *MbString++ = LOBYTE(WideChar);
+                AsciiRun++;
                 continue;
             }
+            AsciiRun = 0;
 
             MbChar = NlsUnicodeToMbAnsiTable[WideChar];
 
@@ -708,6 +1006,138 @@ RtlUnicodeToOemN(OUT PCHAR OemString,
     return STATUS_SUCCESS;
 }
 
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+RtlUnicodeToUTF8N(OUT PCHAR UTF8StringDestination,
+                  IN ULONG UTF8StringMaxByteCount,
+                  OUT PULONG UTF8StringActualByteCount,
+                  IN PCWCH UnicodeStringSource,
+                  IN ULONG UnicodeStringByteCount)
+{
+    NTSTATUS Status = STATUS_SUCCESS;
+    ULONG UnicodeLength = UnicodeStringByteCount / sizeof(WCHAR);
+    ULONG i;
+    ULONG Written = 0;
+    ULONG Char;
+    UCHAR Utf8Char[4];
+    ULONG Utf8Length;
+    ULONG AsciiRun = NLS_ASCII_BLOCK;
+
+    if (!UnicodeStringSource)
+        return STATUS_INVALID_PARAMETER_4;
+    if (!UTF8StringActualByteCount)
+        return STATUS_INVALID_PARAMETER;
+    if (UTF8StringDestination && UnicodeStringByteCount % sizeof(WCHAR))
+        return STATUS_INVALID_PARAMETER_5;
+
+    for (i = 0; i < UnicodeLength; i++)
+    {
+        /* Copy plain ASCII a block at a time, leaving at least one character */
+        while (AsciiRun >= NLS_ASCII_BLOCK && UnicodeLength - i > NLS_ASCII_BLOCK)
+        {
+            if (UTF8StringDestination && UTF8StringMaxByteCount < NLS_ASCII_BLOCK)
+                break;
+
+            /* Not only ASCII, go one character at a time for a while */
+            if (!RtlpIsAsciiBlockW(&UnicodeStringSource[i]))
+            {
+                AsciiRun = 0;
+                break;
+            }
+
+            if (UTF8StringDestination)
+            {
+                RtlpNarrowAsciiBlock(UTF8StringDestination, &UnicodeStringSource[i]);
+                UTF8StringDestination += NLS_ASCII_BLOCK;
+                UTF8StringMaxByteCount -= NLS_ASCII_BLOCK;
+            }
+            Written += NLS_ASCII_BLOCK;
+            i += NLS_ASCII_BLOCK;
+        }
+
+        /* Decode the UTF-16 code point */
+        Char = UnicodeStringSource[i];
+        AsciiRun = (Char < 0x80) ? AsciiRun + 1 : 0;
+        if (Char >= 0xDC00 && Char <= 0xDFFF)
+        {
+            /* Lone trail surrogate */
+            Char = 0xFFFD;
+            Status = STATUS_SOME_NOT_MAPPED;
+        }
+        else if (Char >= 0xD800 && Char <= 0xDBFF)
+        {
+            if (i + 1 < UnicodeLength &&
+                UnicodeStringSource[i + 1] >= 0xDC00 && UnicodeStringSource[i + 1] <= 0xDFFF)
+            {
+                Char = ((Char - 0xD800) << 10) | (UnicodeStringSource[i + 1] - 0xDC00);
+                Char += 0x10000;
+                i++;
+            }
+            else
+            {
+                /* Lead surrogate without a trail */
+                Char = 0xFFFD;
+                Status = STATUS_SOME_NOT_MAPPED;
+            }
+        }
+
+        /* Encode it as UTF-8 */
+        ASSERT(Char <= 0x10FFFF);
+        if (Char < 0x80)
+        {
+            Utf8Char[0] = (UCHAR)Char;
+            Utf8Length = 1;
+        }
+        else if (Char < 0x800)
+        {
+            Utf8Char[0] = 0xC0 | ((Char >> 6) & 0x1F);
+            Utf8Char[1] = 0x80 | (Char & 0x3F);
+            Utf8Length = 2;
+        }
+        else if (Char < 0x10000)
+        {
+            Utf8Char[0] = 0xE0 | ((Char >> 12) & 0x0F);
+            Utf8Char[1] = 0x80 | ((Char >> 6) & 0x3F);
+            Utf8Char[2] = 0x80 | (Char & 0x3F);
+            Utf8Length = 3;
+        }
+        else
+        {
+            Utf8Char[0] = 0xF0 | ((Char >> 18) & 0x07);
+            Utf8Char[1] = 0x80 | ((Char >> 12) & 0x3F);
+            Utf8Char[2] = 0x80 | ((Char >> 6) & 0x3F);
+            Utf8Char[3] = 0x80 | (Char & 0x3F);
+            Utf8Length = 4;
+        }
+
+        if (!UTF8StringDestination)
+        {
+            Written += Utf8Length;
+            continue;
+        }
+
+        if (UTF8StringMaxByteCount >= Utf8Length)
+        {
+            RtlCopyMemory(UTF8StringDestination, Utf8Char, Utf8Length);
+            UTF8StringDestination += Utf8Length;
+            UTF8StringMaxByteCount -= Utf8Length;
+            Written += Utf8Length;
+        }
+        else
+        {
+            /* Nothing more is written, but the rest is still checked */
+            UTF8StringMaxByteCount = 0;
+            Status = STATUS_BUFFER_TOO_SMALL;
+        }
+    }
+
+    *UTF8StringActualByteCount = Written;
+    return Status;
+}
+
 /*
  * @implemented
  */
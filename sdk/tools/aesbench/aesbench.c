@@ -0,0 +1,266 @@
+/*
+ * PROJECT:     bcrypt AES benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Checks bcrypt's AES modes against mbedtls on the host and
+ *              compares their throughput
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <ntstatus.h>
+#include <windef.h>
+#include <string.h>
+
+#include "bcrypt_internal.h"
+
+#define BUFFER_SIZE     (16 * 1024 * 1024)
+#define CHECK_BLOCKS    40
+#define TIMED_RUNS      3
+
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+typedef enum _AES_MODE
+{
+    EcbEncrypt,
+    EcbDecrypt,
+    CbcEncrypt,
+    CbcDecrypt,
+    GcmEncrypt,
+    GcmDecrypt,
+    ModeMax
+} AES_MODE;
+
+static const char *ModeNames[ModeMax] =
+{
+    "ECB encrypt", "ECB decrypt", "CBC encrypt", "CBC decrypt", "GCM encrypt", "GCM decrypt"
+};
+
+static const UCHAR Secret[32] =
+{
+    0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+    0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7, 0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4
+};
+
+static const UCHAR Nonce[GCM_NONCE_SIZE] =
+{
+    0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88
+};
+
+static ULONG Seed;
+
+static ULONG
+Random(void)
+{
+    Seed = Seed * 1103515245 + 12345;
+    return Seed >> 16;
+}
+
+/* Runs one mode through bcrypt or mbedtls, returns FALSE on a failure */
+static BOOL
+Run(AES_MODE Mode, BOOL Reference, struct aes_key *Key, const UCHAR *Input,
+    UCHAR *Output, ULONG Size, UCHAR *Tag)
+{
+    UCHAR Iv[AES_BLOCK_SIZE] = { 0 };
+    ULONG i;
+
+    switch (Mode)
+    {
+        case EcbEncrypt:
+        case EcbDecrypt:
+            if (!Reference)
+            {
+                if (Mode == EcbEncrypt)
+                    aes_encrypt_ecb(Key, Input, Output, Size);
+                else
+                    aes_decrypt_ecb(Key, Input, Output, Size);
+                return TRUE;
+            }
+            for (i = 0; i < Size; i += AES_BLOCK_SIZE)
+            {
+                mbedtls_aes_crypt_ecb(Mode == EcbEncrypt ? &Key->enc : &Key->dec,
+                                      Mode == EcbEncrypt ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT,
+                                      Input + i, Output + i);
+            }
+            return TRUE;
+
+        case CbcEncrypt:
+        case CbcDecrypt:
+            if (!Reference)
+            {
+                if (Mode == CbcEncrypt)
+                    aes_encrypt_cbc(Key, Iv, Input, Output, Size);
+                else
+                    aes_decrypt_cbc(Key, Iv, Input, Output, Size);
+                return TRUE;
+            }
+            return !mbedtls_aes_crypt_cbc(Mode == CbcEncrypt ? &Key->enc : &Key->dec,
+                                          Mode == CbcEncrypt ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT,
+                                          Size, Iv, Input, Output);
+
+        case GcmEncrypt:
+            if (!Reference)
+                return aes_encrypt_gcm(Key, Nonce, Secret, sizeof(Secret), Input, Output, Size,
+                                       Tag, AES_BLOCK_SIZE) == STATUS_SUCCESS;
+            return !mbedtls_gcm_crypt_and_tag(&Key->gcm, MBEDTLS_GCM_ENCRYPT, Size, Nonce,
+                                              GCM_NONCE_SIZE, Secret, sizeof(Secret), Input,
+                                              Output, AES_BLOCK_SIZE, Tag);
+
+        default:
+            if (!Reference)
+                return aes_decrypt_gcm(Key, Nonce, Secret, sizeof(Secret), Input, Output, Size,
+                                       Tag, AES_BLOCK_SIZE) == STATUS_SUCCESS;
+            return !mbedtls_gcm_auth_decrypt(&Key->gcm, Size, Nonce, GCM_NONCE_SIZE, Secret,
+                                             sizeof(Secret), Tag, AES_BLOCK_SIZE, Input, Output);
+    }
+}
+
+/*
+ * Every block count up to CHECK_BLOCKS, so each lane loop runs with all
+ * the tails it can have. GCM also gets sizes that are not whole blocks.
+ */
+static ULONG
+Check(struct aes_key *Key, ULONG KeyBits, PUCHAR Data)
+{
+    UCHAR Plain[CHECK_BLOCKS * AES_BLOCK_SIZE], Cipher[CHECK_BLOCKS * AES_BLOCK_SIZE];
+    UCHAR Result[CHECK_BLOCKS * AES_BLOCK_SIZE], Expected[CHECK_BLOCKS * AES_BLOCK_SIZE];
+    UCHAR Tag[AES_BLOCK_SIZE], ExpectedTag[AES_BLOCK_SIZE];
+    ULONG Errors = 0, Size, Step;
+    int Mode;
+
+    for (Mode = 0; Mode < ModeMax; Mode++)
+    {
+        Step = (Mode == GcmEncrypt || Mode == GcmDecrypt) ? 1 : AES_BLOCK_SIZE;
+        for (Size = Step; Size <= sizeof(Plain); Size += Step)
+        {
+            memcpy(Plain, Data, Size);
+
+            /* The decryptions start from what mbedtls encrypted */
+            if (Mode == GcmDecrypt)
+            {
+                Run(GcmEncrypt, TRUE, Key, Plain, Cipher, Size, Tag);
+                memcpy(ExpectedTag, Tag, sizeof(Tag));
+                memcpy(Plain, Cipher, Size);
+            }
+
+            if (!Run(Mode, TRUE, Key, Plain, Expected, Size, ExpectedTag) ||
+                !Run(Mode, FALSE, Key, Plain, Result, Size, Tag) ||
+                memcmp(Result, Expected, Size) ||
+                (Mode == GcmEncrypt && memcmp(Tag, ExpectedTag, sizeof(Tag))))
+            {
+                printf("AES-%lu %s of %lu bytes differs from mbedtls\n",
+                       (unsigned long)KeyBits, ModeNames[Mode], (unsigned long)Size);
+                Errors++;
+                break;
+            }
+        }
+    }
+
+    return Errors;
+}
+
+/* Best of a few runs, in MB/s, or 0 on a failure */
+static double
+Time(AES_MODE Mode, BOOL Reference, struct aes_key *Key, const UCHAR *Input,
+     UCHAR *Output, ULONG Size, UCHAR *Tag)
+{
+    clock_t Start, Best = 0;
+    ULONG i;
+
+    for (i = 0; i < TIMED_RUNS; i++)
+    {
+        Start = clock();
+        if (!Run(Mode, Reference, Key, Input, Output, Size, Tag))
+            return 0.0;
+        Start = clock() - Start;
+        if (i == 0 || Start < Best)
+            Best = Start;
+    }
+
+    return (double)Size / 1e6 / ((double)max(Best, 1) / CLOCKS_PER_SEC);
+}
+
+int main(int argc, char *argv[])
+{
+    static const ULONG KeySizes[] = { 16, 32 };
+    struct aes_key Key;
+    ULONG Size = BUFFER_SIZE, Errors = 0, i;
+    PUCHAR Data, Output;
+    UCHAR Tag[AES_BLOCK_SIZE];
+    double BCrypt, MbedTls;
+    int Mode;
+
+    if (argc > 1) Size = strtoul(argv[1], NULL, 0) & ~(AES_BLOCK_SIZE - 1);
+    if (Size < CHECK_BLOCKS * AES_BLOCK_SIZE || Size > BUFFER_SIZE)
+    {
+        fprintf(stderr, "Usage: %s [bytes, %u to %u]\n", argv[0],
+                CHECK_BLOCKS * AES_BLOCK_SIZE, BUFFER_SIZE);
+        return 1;
+    }
+
+    Data = malloc(Size);
+    Output = malloc(Size);
+    if (!Data || !Output)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    /* Touch the output too, so the first run doesn't pay for it */
+    Seed = 0x1234;
+    for (i = 0; i < Size; i++)
+        Data[i] = (UCHAR)Random();
+    memset(Output, 0, Size);
+
+    for (i = 0; i < sizeof(KeySizes) / sizeof(KeySizes[0]); i++)
+    {
+        if (aes_key_init(&Key, Secret, KeySizes[i]) != STATUS_SUCCESS)
+        {
+            fprintf(stderr, "Cannot set up an AES-%lu key\n", (unsigned long)KeySizes[i] * 8);
+            return 1;
+        }
+
+        printf("AES-%lu, bcrypt %s AES-NI:\n", (unsigned long)KeySizes[i] * 8,
+               Key.hw ? "with" : "without");
+
+        Errors += Check(&Key, KeySizes[i] * 8, Data);
+
+        for (Mode = 0; Mode < ModeMax; Mode++)
+        {
+            /* Decrypting what was encrypted keeps the GCM tag right */
+            if (Mode == GcmDecrypt)
+            {
+                Run(GcmEncrypt, TRUE, &Key, Data, Output, Size, Tag);
+                memcpy(Data, Output, Size);
+            }
+
+            BCrypt = Time(Mode, FALSE, &Key, Data, Output, Size, Tag);
+            MbedTls = Time(Mode, TRUE, &Key, Data, Output, Size, Tag);
+            if (BCrypt == 0.0 || MbedTls == 0.0)
+            {
+                printf("  %s failed\n", ModeNames[Mode]);
+                Errors++;
+                continue;
+            }
+
+            printf("  %-12s bcrypt %8.1f MB/s, mbedtls %8.1f MB/s (%.2fx)\n",
+                   ModeNames[Mode], BCrypt, MbedTls, BCrypt / MbedTls);
+        }
+
+        aes_key_free(&Key);
+    }
+
+    free(Data);
+    free(Output);
+
+    if (Errors)
+    {
+        printf("%lu errors\n", (unsigned long)Errors);
+        return 1;
+    }
+
+    return 0;
+}
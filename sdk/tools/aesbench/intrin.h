@@ -0,0 +1,15 @@
+/*
+ * PROJECT:     bcrypt AES benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     The MSVC style __cpuid bcrypt's aes.c uses
+ */
+
+#pragma once
+
+static inline void
+__cpuid(int CPUInfo[4], int InfoType)
+{
+    __asm__ __volatile__("cpuid"
+                         : "=a" (CPUInfo[0]), "=b" (CPUInfo[1]), "=c" (CPUInfo[2]), "=d" (CPUInfo[3])
+                         : "a" (InfoType), "c" (0));
+}
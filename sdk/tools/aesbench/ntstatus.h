@@ -0,0 +1,14 @@
+/*
+ * PROJECT:     bcrypt AES benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     The status codes bcrypt's aes.c returns
+ */
+
+#pragma once
+
+#include <typedefs.h>
+
+#define STATUS_SUCCESS              ((NTSTATUS)0x00000000)
+#define STATUS_INVALID_PARAMETER    ((NTSTATUS)0xC000000D)
+#define STATUS_INTERNAL_ERROR       ((NTSTATUS)0xC00000E5)
+#define STATUS_AUTH_TAG_MISMATCH    ((NTSTATUS)0xC000A002)
@@ -0,0 +1,17 @@
+/*
+ * PROJECT:     bcrypt AES benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     The part of winbase.h needed to build bcrypt's aes.c on the host
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+static inline void
+SecureZeroMemory(void *Buffer, size_t Size)
+{
+    volatile unsigned char *p = Buffer;
+
+    while (Size--) *p++ = 0;
+}
@@ -0,0 +1,9 @@
+/*
+ * PROJECT:     bcrypt AES benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Stands in for windef.h, the host typedefs cover what bcrypt needs
+ */
+
+#pragma once
+
+#include <typedefs.h>
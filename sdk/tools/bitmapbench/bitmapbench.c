@@ -0,0 +1,99 @@
+/*
+ * PROJECT:     RTL bitmap benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Scans bitmaps of growing sizes on the host and reports
+ *              how many bits per second the RTL bitmap functions go through
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <rtl.h>
+
+/* Up to a gigabit */
+#define MAX_SHIFT   30
+
+static double
+Seconds(clock_t Start, clock_t End)
+{
+    return (double)(End - Start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[])
+{
+    RTL_BITMAP BitMapHeader;
+    clock_t Start, End;
+    PULONG Buffer;
+    ULONG Shift, Bits, Iterations, Errors, i;
+    ULONG MaxShift = MAX_SHIFT;
+    double Count, FindClear, FindSet, Total;
+
+    if (argc > 1) MaxShift = min(strtoul(argv[1], NULL, 0), MAX_SHIFT);
+
+    /* One buffer for all sizes */
+    Buffer = malloc(((size_t)1 << MaxShift) / 8);
+    if (!Buffer)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    for (Shift = 10, Errors = 0; Shift <= MaxShift; Shift += 4)
+    {
+        Bits = 1 << Shift;
+
+        /* Repeat the small ones so every size scans about the same number of bits */
+        Iterations = max((1 << 28) / Bits, 1);
+        Total = (double)Bits * Iterations;
+        RtlInitializeBitMap(&BitMapHeader, Buffer, Bits);
+
+        /* Everything set but the last bit, the worst case for finding a clear bit */
+        RtlSetAllBits(&BitMapHeader);
+        RtlClearBits(&BitMapHeader, Bits - 1, 1);
+
+        Start = clock();
+        for (i = 0; i < Iterations; i++)
+        {
+            if (RtlNumberOfSetBits(&BitMapHeader) != Bits - 1) Errors++;
+        }
+        End = clock();
+        Count = Seconds(Start, End);
+
+        Start = clock();
+        for (i = 0; i < Iterations; i++)
+        {
+            if (RtlFindClearBits(&BitMapHeader, 1, 0) != Bits - 1) Errors++;
+        }
+        End = clock();
+        FindClear = Seconds(Start, End);
+
+        /* And the other way round */
+        RtlClearAllBits(&BitMapHeader);
+        RtlSetBits(&BitMapHeader, Bits - 1, 1);
+
+        Start = clock();
+        for (i = 0; i < Iterations; i++)
+        {
+            if (RtlFindSetBits(&BitMapHeader, 1, 0) != Bits - 1) Errors++;
+        }
+        End = clock();
+        FindSet = Seconds(Start, End);
+
+        /* Gigabits per second */
+        printf("%10lu bits: count %7.2f, find clear %7.2f, find set %7.2f Gbit/s\n",
+               (unsigned long)Bits,
+               Total / Count / 1e9,
+               Total / FindClear / 1e9,
+               Total / FindSet / 1e9);
+    }
+
+    free(Buffer);
+
+    if (Errors)
+    {
+        fprintf(stderr, "%lu wrong results\n", (unsigned long)Errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * PROJECT:     RTL bitmap benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     The part of rtl.h needed to build bitmap.c on the host
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <typedefs.h>
+
+#define _In_
+#define _In_opt_
+#define _Out_
+#define _In_range_(Min, Max)
+#define __drv_aliasesMem
+
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+static __inline BOOLEAN
+BitScanForward(ULONG *Index, ULONG Mask)
+{
+    if (!Mask) return FALSE;
+    *Index = __builtin_ctz(Mask);
+    return TRUE;
+}
+
+static __inline BOOLEAN
+BitScanReverse(ULONG *Index, ULONG Mask)
+{
+    if (!Mask) return FALSE;
+    *Index = 31 - __builtin_clz(Mask);
+    return TRUE;
+}
+
+static __inline VOID
+RtlFillMemoryUlong(PVOID Destination, SIZE_T Length, ULONG Pattern)
+{
+    PULONG Buffer = Destination;
+    SIZE_T i;
+
+    for (i = 0; i < Length / sizeof(ULONG); i++) Buffer[i] = Pattern;
+}
+
+/* bitmap.c */
+VOID NTAPI RtlInitializeBitMap(PRTL_BITMAP BitMapHeader, PULONG BitMapBuffer, ULONG SizeOfBitMap);
+VOID NTAPI RtlClearAllBits(PRTL_BITMAP BitMapHeader);
+VOID NTAPI RtlSetAllBits(PRTL_BITMAP BitMapHeader);
+VOID NTAPI RtlClearBits(PRTL_BITMAP BitMapHeader, ULONG StartingIndex, ULONG NumberToClear);
+VOID NTAPI RtlSetBits(PRTL_BITMAP BitMapHeader, ULONG StartingIndex, ULONG NumberToSet);
+ULONG NTAPI RtlNumberOfSetBits(PRTL_BITMAP BitMapHeader);
+ULONG NTAPI RtlFindClearBits(PRTL_BITMAP BitMapHeader, ULONG NumberToFind, ULONG HintIndex);
+ULONG NTAPI RtlFindSetBits(PRTL_BITMAP BitMapHeader, ULONG NumberToFind, ULONG HintIndex);
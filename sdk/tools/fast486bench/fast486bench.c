@@ -0,0 +1,164 @@
+/*
+ * PROJECT:     Fast486 benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Runs a fixed instruction mix on the host, with and without
+ *              the decoded block cache, and reports the emulation speed
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <windef.h>
+#include <fast486.h>
+
+#define MEMORY_SIZE     0x100000
+#define CODE_SEGMENT    0x1000
+#define DATA_SEGMENT    0x2000
+#define STACK_SEGMENT   0x3000
+
+/* Real mode code, the kind DOS programs run under NTVDM */
+static const UCHAR Code[] =
+{
+    0xB9, 0x00, 0x40,                   /* 00: mov cx, 4000h            */
+    0xBE, 0x00, 0x01,                   /* 03: mov si, 100h             */
+    0x31, 0xDB,                         /* 06: xor bx, bx               */
+    0x8B, 0x40, 0x04,                   /* 08: mov ax, [bx+si+4]        */
+    0x01, 0xC8,                         /* 0B: add ax, cx               */
+    0x89, 0x40, 0x08,                   /* 0D: mov [bx+si+8], ax        */
+    0xFF, 0x44, 0x10,                   /* 10: inc word [si+10h]        */
+    0x50,                               /* 13: push ax                  */
+    0xE8, 0x37, 0x00,                   /* 14: call 4Eh                 */
+    0x5A,                               /* 17: pop dx                   */
+    0xD1, 0xE2,                         /* 18: shl dx, 1                */
+    0x81, 0xE2, 0xF0, 0x0F,             /* 1A: and dx, 0FF0h            */
+    0x81, 0xFA, 0x00, 0x01,             /* 1E: cmp dx, 100h             */
+    0x72, 0x02,                         /* 22: jb 26h                   */
+    0xB2, 0x01,                         /* 24: mov dl, 1                */
+    0x66, 0x8B, 0x04,                   /* 26: mov eax, [si]            */
+    0x66, 0x05, 0x78, 0x56, 0x34, 0x12, /* 29: add eax, 12345678h       */
+    0x66, 0x89, 0x44, 0x20,             /* 2F: mov [si+20h], eax        */
+    0x8D, 0x79, 0x30,                   /* 33: lea di, [bx+di+30h]      */
+    0x81, 0xE7, 0xFE, 0x0F,             /* 36: and di, 0FFEh            */
+    0xA5,                               /* 3A: movsw                    */
+    0xF6, 0xC1, 0xFF,                   /* 3B: test cl, 0FFh            */
+    0x75, 0x0A,                         /* 3E: jnz 4Ah                  */
+    0x2E, 0x88, 0x16, 0x46, 0x00,       /* 40: mov cs:[46h], dl         */
+    0xB3, 0x00,                         /* 45: mov bl, 0 (patched)      */
+    0x00, 0x5C, 0x40,                   /* 47: add [si+40h], bl         */
+    0xE2, 0xB7,                         /* 4A: loop 3                   */
+    0xEB, 0xB2,                         /* 4C: jmp 0                    */
+    0x55,                               /* 4E: push bp                  */
+    0x89, 0xE5,                         /* 4F: mov bp, sp               */
+    0x8B, 0x46, 0x04,                   /* 51: mov ax, [bp+4]           */
+    0x35, 0x55, 0x55,                   /* 54: xor ax, 5555h            */
+    0x89, 0x46, 0x04,                   /* 57: mov [bp+4], ax           */
+    0x5D,                               /* 5A: pop bp                   */
+    0xC3                                /* 5B: ret                      */
+};
+
+static PUCHAR Memory;
+
+static VOID
+FASTCALL
+BenchMemRead(PFAST486_STATE State, ULONG Address, PVOID Buffer, ULONG Size)
+{
+    UNREFERENCED_PARAMETER(State);
+
+    if (Address < MEMORY_SIZE && Size <= MEMORY_SIZE - Address)
+        memcpy(Buffer, Memory + Address, Size);
+    else
+        memset(Buffer, 0xFF, Size);
+}
+
+static VOID
+FASTCALL
+BenchMemWrite(PFAST486_STATE State, ULONG Address, PVOID Buffer, ULONG Size)
+{
+    UNREFERENCED_PARAMETER(State);
+
+    if (Address < MEMORY_SIZE && Size <= MEMORY_SIZE - Address)
+        memcpy(Memory + Address, Buffer, Size);
+}
+
+static double
+Run(PFAST486_STATE State, PFAST486_BLOCK_CACHE BlockCache, ULONG Count)
+{
+    clock_t Start, End;
+    ULONG i;
+
+    memset(Memory, 0, MEMORY_SIZE);
+    memcpy(Memory + (CODE_SEGMENT << 4), Code, sizeof(Code));
+
+    Fast486Initialize(State, BenchMemRead, BenchMemWrite,
+                      NULL, NULL, NULL, NULL, NULL, NULL, BlockCache);
+    Fast486SetSegment(State, FAST486_REG_DS, DATA_SEGMENT);
+    Fast486SetSegment(State, FAST486_REG_ES, DATA_SEGMENT);
+    Fast486SetStack(State, STACK_SEGMENT, 0xFFFE);
+    Fast486ExecuteAt(State, CODE_SEGMENT, 0);
+
+    Start = clock();
+    for (i = 0; i < Count; i++) Fast486StepInto(State);
+    End = clock();
+
+    /* Million instructions per second */
+    return (double)Count / ((double)(End - Start) / CLOCKS_PER_SEC) / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    static FAST486_STATE Uncached, Cached;
+    PFAST486_BLOCK_CACHE BlockCache;
+    PUCHAR UncachedMemory;
+    ULONG Count = 20000000;
+    double Before, After;
+    int i;
+
+    if (argc > 1) Count = strtoul(argv[1], NULL, 0);
+
+    Memory = malloc(MEMORY_SIZE);
+    UncachedMemory = malloc(MEMORY_SIZE);
+    BlockCache = calloc(1, sizeof(*BlockCache));
+    if (!Memory || !UncachedMemory || !BlockCache)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    Before = Run(&Uncached, NULL, Count);
+    memcpy(UncachedMemory, Memory, MEMORY_SIZE);
+    After = Run(&Cached, BlockCache, Count);
+
+    /* Both must end up in the same place */
+    for (i = 0; i < FAST486_NUM_GEN_REGS; i++)
+    {
+        if (Uncached.GeneralRegs[i].Long != Cached.GeneralRegs[i].Long)
+        {
+            fprintf(stderr, "Register %d is %08X, expected %08X\n",
+                    i, Cached.GeneralRegs[i].Long, Uncached.GeneralRegs[i].Long);
+            return 1;
+        }
+    }
+    if (Uncached.InstPtr.Long != Cached.InstPtr.Long ||
+        Uncached.Flags.Long != Cached.Flags.Long ||
+        memcmp(UncachedMemory, Memory, MEMORY_SIZE))
+    {
+        fprintf(stderr, "The block cache changed the results\n");
+        return 1;
+    }
+
+    printf("%lu instructions\n", (unsigned long)Count);
+    printf("Without block cache: %8.2f MIPS\n", Before);
+    printf("With block cache:    %8.2f MIPS (%.2fx)\n", After, After / Before);
+    printf("Blocks: %lu hits, %lu misses, %lu revalidated, %lu invalidated\n",
+           (unsigned long)BlockCache->Hits,
+           (unsigned long)BlockCache->Misses,
+           (unsigned long)BlockCache->Revalidations,
+           (unsigned long)BlockCache->Invalidations);
+
+    free(BlockCache);
+    free(UncachedMemory);
+    free(Memory);
+    return 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * PROJECT:     Fast486 benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     The part of windef.h needed to build Fast486 on the host
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <typedefs.h>
+
+typedef ULONGLONG *PULONGLONG;
+typedef LONGLONG *PLONGLONG;
+
+#define FASTCALL
+#if defined(_MSC_VER)
+#define FORCEINLINE __forceinline
+#else
+#define FORCEINLINE static __inline__ __attribute__((always_inline))
+#endif
+
+#define C_ASSERT(e) typedef char __C_ASSERT__[(e) ? 1 : -1]
+#define UNREFERENCED_PARAMETER(P) ((void)(P))
+#define UlongToPtr(ul) ((PVOID)(ULONG_PTR)(ul))
+#define DbgPrint printf
+
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#define RtlFillMemory(Destination, Length, Fill) memset(Destination, Fill, Length)
+
+static __inline SIZE_T
+RtlCompareMemory(const VOID *Source1, const VOID *Source2, SIZE_T Length)
+{
+    SIZE_T i;
+
+    for (i = 0; i < Length; i++)
+    {
+        if (((const UCHAR *)Source1)[i] != ((const UCHAR *)Source2)[i]) break;
+    }
+
+    return i;
+}
@@ -0,0 +1,204 @@
+/*
+ * PROJECT:     TCP/IP FIB trie benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Builds routing tables of growing sizes on the host and reports
+ *              the cost of a route lookup through the trie against a scan of
+ *              every route, which is what the driver did before the trie
+ */
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "precomp.h"
+
+#define MAX_ROUTES      100000
+#define LOOKUPS         200000
+
+typedef struct _BENCH_ROUTE
+{
+    ULONG Prefix;
+    UINT PrefixLength;
+} BENCH_ROUTE, *PBENCH_ROUTE;
+
+static BENCH_ROUTE Routes[MAX_ROUTES];
+static ULONG RouteCount;
+static ULONG Seed = 0x1234;
+
+static ULONG
+Random(void)
+{
+    /* xorshift32 */
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 17;
+    Seed ^= Seed << 5;
+    return Seed;
+}
+
+static ULONG
+Mask(UINT PrefixLength)
+{
+    return PrefixLength ? 0xFFFFFFFF << (32 - PrefixLength) : 0;
+}
+
+static PFIB_NODE
+AllocateNode(VOID)
+{
+    return malloc(sizeof(FIB_NODE));
+}
+
+static VOID
+FreeNode(PFIB_NODE Node)
+{
+    free(Node);
+}
+
+static PBENCH_ROUTE
+LinearLookup(ULONG Address)
+{
+    PBENCH_ROUTE Best = NULL;
+    ULONG i;
+
+    for (i = 0; i < RouteCount; i++)
+    {
+        if ((Address & Mask(Routes[i].PrefixLength)) == Routes[i].Prefix &&
+            (!Best || Routes[i].PrefixLength > Best->PrefixLength))
+        {
+            Best = &Routes[i];
+        }
+    }
+
+    return Best;
+}
+
+static ULONG
+RandomAddress(void)
+{
+    PBENCH_ROUTE Route;
+
+    /* Make most of them fall in some network */
+    if (RouteCount && (Random() & 3))
+    {
+        Route = &Routes[Random() % RouteCount];
+        return Route->Prefix | (Random() & ~Mask(Route->PrefixLength));
+    }
+
+    return Random();
+}
+
+static UINT
+RandomPrefixLength(void)
+{
+    ULONG Value = Random() % 100;
+
+    /* Roughly what a routing table looks like */
+    if (Value < 2) return 0;
+    if (Value < 60) return 16 + Random() % 9;
+    if (Value < 80) return 25 + Random() % 8;
+    return 1 + Random() % 32;
+}
+
+static BOOLEAN
+AddRoutes(PFIB_TRIE Trie, ULONG Count)
+{
+    PBENCH_ROUTE Route;
+    PFIB_NODE Node;
+
+    while (RouteCount < Count)
+    {
+        Route = &Routes[RouteCount];
+        Route->PrefixLength = RandomPrefixLength();
+        Route->Prefix = Random() & Mask(Route->PrefixLength);
+
+        Node = FibTrieInsert(Trie, Route->Prefix, Route->PrefixLength);
+        if (!Node)
+        {
+            fprintf(stderr, "FibTrieInsert failed\n");
+            return FALSE;
+        }
+
+        /* The same network twice is the same node */
+        if (Node->Routes)
+            continue;
+
+        Node->Routes = Route;
+        RouteCount++;
+    }
+
+    return TRUE;
+}
+
+static double
+NsPerLookup(clock_t Start, clock_t End, ULONG Lookups)
+{
+    return (double)(End - Start) * 1e9 / CLOCKS_PER_SEC / Lookups;
+}
+
+int main(int argc, char *argv[])
+{
+    FIB_TRIE Trie;
+    PFIB_NODE Node;
+    clock_t Start, Middle, End;
+    ULONG MaxRoutes = MAX_ROUTES;
+    ULONG Count, Lookups, Address, Errors = 0, Matches = 0, SavedSeed, i;
+
+    if (argc > 1) MaxRoutes = min(strtoul(argv[1], NULL, 0), MAX_ROUTES);
+
+    FibTrieInitialize(&Trie, AllocateNode, FreeNode);
+
+    for (Count = 10; Count <= MaxRoutes; Count *= 10)
+    {
+        if (!AddRoutes(&Trie, Count))
+        {
+            FibTrieDestroy(&Trie);
+            return 1;
+        }
+
+        /* Both must find the same routes */
+        SavedSeed = Seed;
+        for (i = 0; i < LOOKUPS / 100; i++)
+        {
+            Address = RandomAddress();
+            Node = FibTrieLookup(&Trie, Address);
+            if ((Node ? Node->Routes : NULL) != LinearLookup(Address))
+                Errors++;
+        }
+
+        /* Same addresses for both, keeping the linear scan from taking
+         * forever on large tables */
+        Lookups = min(LOOKUPS, LOOKUPS * 100 / Count);
+        Seed = SavedSeed;
+        Start = clock();
+        for (i = 0; i < Lookups; i++)
+        {
+            if (LinearLookup(RandomAddress()))
+                Matches++;
+        }
+        Middle = clock();
+        Seed = SavedSeed;
+        for (i = 0; i < LOOKUPS; i++)
+        {
+            Node = FibTrieLookup(&Trie, RandomAddress());
+            if (Node && Node->Routes)
+                Matches++;
+        }
+        End = clock();
+
+        printf("%6lu routes: linear %8.0f ns, trie %4.0f ns per lookup\n",
+               RouteCount,
+               NsPerLookup(Start, Middle, Lookups),
+               NsPerLookup(Middle, End, LOOKUPS));
+    }
+
+    FibTrieDestroy(&Trie);
+
+    if (Errors)
+    {
+        printf("The trie and the linear scan disagree on %lu addresses\n", Errors);
+        return 1;
+    }
+
+    /* Keeps the lookups from being optimized away */
+    printf("%lu addresses matched a route\n", Matches);
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+/*
+ * PROJECT:     TCP/IP FIB trie benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Stands in for the driver precomp.h, fibtrie.c only needs
+ *              the host typedefs
+ */
+
+#pragma once
+
+#include <assert.h>
+#include <stdio.h>
+#include <typedefs.h>
+
+#define ASSERT(x) assert(x)
+
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+
+#include <fibtrie.h>
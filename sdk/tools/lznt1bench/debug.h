@@ -0,0 +1,7 @@
+/*
+ * PROJECT:     RTL LZNT1 benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Stands in for debug.h, the host typedefs cover what compress.c needs
+ */
+
+#pragma once
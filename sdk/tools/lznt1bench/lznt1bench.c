@@ -0,0 +1,152 @@
+/*
+ * PROJECT:     RTL LZNT1 benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Compresses and decompresses a few kinds of data on the host
+ *              with both LZNT1 engines and reports the ratio and throughput
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <rtl.h>
+
+#define BUFFER_SIZE     (16 * 1024 * 1024)
+
+typedef enum _DATA_KIND
+{
+    DataZero,
+    DataText,
+    DataSmallAlphabet,
+    DataRandom,
+    DataMax
+} DATA_KIND;
+
+static const char *DataNames[DataMax] = { "zero", "text", "small alphabet", "random" };
+
+static ULONG Seed;
+
+static ULONG
+Random(void)
+{
+    Seed = Seed * 1103515245 + 12345;
+    return Seed >> 16;
+}
+
+static VOID
+FillData(DATA_KIND Kind, PUCHAR Buffer, ULONG Size)
+{
+    static const char Text[] = "The quick brown fox jumps over the lazy dog. ";
+    ULONG i;
+
+    Seed = 0x1234;
+    for (i = 0; i < Size; i++)
+    {
+        switch (Kind)
+        {
+            case DataZero:
+                Buffer[i] = 0;
+                break;
+            case DataText:
+                /* Mostly repeating, with the odd typo */
+                Buffer[i] = Text[i % (sizeof(Text) - 1)];
+                if (Random() % 64 == 0)
+                    Buffer[i] ^= 0x20;
+                break;
+            case DataSmallAlphabet:
+                Buffer[i] = 'a' + Random() % 10;
+                break;
+            default:
+                Buffer[i] = (UCHAR)Random();
+                break;
+        }
+    }
+}
+
+static double
+MBPerSecond(ULONG Size, clock_t Start, clock_t End)
+{
+    return (double)Size / 1e6 / ((double)(End - Start) / CLOCKS_PER_SEC);
+}
+
+int main(int argc, char *argv[])
+{
+    static const USHORT Engines[] = { COMPRESSION_ENGINE_STANDARD, COMPRESSION_ENGINE_MAXIMUM };
+    ULONG Size = BUFFER_SIZE;
+    ULONG WorkSpaceSize, MaximumWorkSpaceSize, FragmentWorkSpaceSize;
+    ULONG CompressedSize, FinalSize, Errors = 0, i;
+    PUCHAR Data, Compressed, Decompressed;
+    clock_t Start, Middle, End;
+    PVOID WorkSpace;
+    DATA_KIND Kind;
+    NTSTATUS Status;
+
+    if (argc > 1) Size = min(strtoul(argv[1], NULL, 0), BUFFER_SIZE);
+    if (!Size)
+    {
+        fprintf(stderr, "Usage: %s [bytes]\n", argv[0]);
+        return 1;
+    }
+
+    RtlGetCompressionWorkSpaceSize(COMPRESSION_FORMAT_LZNT1 | COMPRESSION_ENGINE_STANDARD,
+                                   &WorkSpaceSize, &FragmentWorkSpaceSize);
+    RtlGetCompressionWorkSpaceSize(COMPRESSION_FORMAT_LZNT1 | COMPRESSION_ENGINE_MAXIMUM,
+                                   &MaximumWorkSpaceSize, &FragmentWorkSpaceSize);
+
+    WorkSpace = malloc(max(WorkSpaceSize, MaximumWorkSpaceSize));
+    Data = malloc(Size);
+
+    /* LZNT1 never grows data by more than a chunk header every 4 KB */
+    Compressed = malloc(Size + Size / 64 + 2);
+    Decompressed = malloc(Size);
+    if (!WorkSpace || !Data || !Compressed || !Decompressed)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    for (Kind = 0; Kind < DataMax; Kind++)
+    {
+        FillData(Kind, Data, Size);
+
+        for (i = 0; i < sizeof(Engines) / sizeof(Engines[0]); i++)
+        {
+            Start = clock();
+            Status = RtlCompressBuffer(COMPRESSION_FORMAT_LZNT1 | Engines[i], Data, Size,
+                                       Compressed, Size + Size / 64 + 2, 4096,
+                                       &CompressedSize, WorkSpace);
+            Middle = clock();
+            if (Status != STATUS_SUCCESS)
+            {
+                printf("%s data, %s engine: compression failed with 0x%lx\n",
+                       DataNames[Kind], i ? "maximum" : "standard", (unsigned long)Status);
+                Errors++;
+                continue;
+            }
+
+            Status = RtlDecompressBuffer(COMPRESSION_FORMAT_LZNT1, Decompressed, Size,
+                                         Compressed, CompressedSize, &FinalSize);
+            End = clock();
+            if (Status != STATUS_SUCCESS || FinalSize != Size || memcmp(Data, Decompressed, Size))
+            {
+                printf("%s data, %s engine: round trip failed\n",
+                       DataNames[Kind], i ? "maximum" : "standard");
+                Errors++;
+                continue;
+            }
+
+            printf("%-14s %-8s %3u%%, compression %7.1f MB/s, decompression %7.1f MB/s\n",
+                   DataNames[Kind], i ? "maximum" : "standard",
+                   (unsigned)((ULONGLONG)CompressedSize * 100 / Size),
+                   MBPerSecond(Size, Start, Middle),
+                   MBPerSecond(Size, Middle, End));
+        }
+    }
+
+    free(Decompressed);
+    free(Compressed);
+    free(Data);
+    free(WorkSpace);
+
+    return Errors ? 1 : 0;
+}
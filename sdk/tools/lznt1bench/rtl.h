@@ -0,0 +1,54 @@
+/*
+ * PROJECT:     RTL LZNT1 benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     The part of rtl.h needed to build compress.c on the host
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <typedefs.h>
+
+#ifndef C_ASSERT
+#define C_ASSERT(e) typedef char __C_ASSERT__[(e) ? 1 : -1]
+#endif
+
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#define COMPRESSION_FORMAT_NONE         0x0000
+#define COMPRESSION_FORMAT_DEFAULT      0x0001
+#define COMPRESSION_FORMAT_LZNT1        0x0002
+#define COMPRESSION_ENGINE_STANDARD     0x0000
+#define COMPRESSION_ENGINE_MAXIMUM      0x0100
+
+#define STATUS_SUCCESS                  ((NTSTATUS)0x00000000)
+#define STATUS_BAD_COMPRESSION_BUFFER   ((NTSTATUS)0xC0000242)
+#define STATUS_ACCESS_VIOLATION         ((NTSTATUS)0xC0000005)
+#define STATUS_BUFFER_TOO_SMALL         ((NTSTATUS)0xC0000023)
+#define STATUS_NOT_SUPPORTED            ((NTSTATUS)0xC00000BB)
+#define STATUS_INVALID_PARAMETER        ((NTSTATUS)0xC000000D)
+#define STATUS_UNSUPPORTED_COMPRESSION  ((NTSTATUS)0xC000025F)
+#define STATUS_NOT_IMPLEMENTED          ((NTSTATUS)0xC0000002)
+
+/* Only taken by the unimplemented chunk functions */
+typedef struct _COMPRESSED_DATA_INFO *PCOMPRESSED_DATA_INFO;
+
+/* compress.c */
+NTSTATUS NTAPI RtlGetCompressionWorkSpaceSize(USHORT CompressionFormatAndEngine,
+                                              PULONG CompressBufferAndWorkSpaceSize,
+                                              PULONG CompressFragmentWorkSpaceSize);
+NTSTATUS NTAPI RtlCompressBuffer(USHORT CompressionFormatAndEngine,
+                                 PUCHAR UncompressedBuffer, ULONG UncompressedBufferSize,
+                                 PUCHAR CompressedBuffer, ULONG CompressedBufferSize,
+                                 ULONG UncompressedChunkSize, PULONG FinalCompressedSize,
+                                 PVOID WorkSpace);
+NTSTATUS NTAPI RtlDecompressBuffer(USHORT CompressionFormat,
+                                   PUCHAR UncompressedBuffer, ULONG UncompressedBufferSize,
+                                   PUCHAR CompressedBuffer, ULONG CompressedBufferSize,
+                                   PULONG FinalUncompressedSize);
@@ -1,20 +1,16 @@
 /*
- * PROJECT:         ReactOS Kernel - Vista+ APIs
- * LICENSE:         GPL v2 - See COPYING in the top level directory
- * FILE:            lib/drivers/ntoskrnl_vista/rtl.c
- * PURPOSE:         Rtl functions of Vista+
- * PROGRAMMERS:     Thomas Faber <thomas.faber@reactos.org>
+ * PROJECT:     RTL UTF-8 benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     The UTF-8 conversions drivers used to link from ntoskrnl_vista,
+ *              kept unchanged as the reference for the RTL ones
  */
 
-#include <ntdef.h>
-#include <ntifs.h>
-
-typedef UCHAR BYTE;
+#include <rtl.h>
 
 /******************************************************************************
- * RtlUnicodeToUTF8N [NTDLL.@]
+ * RefUnicodeToUTF8N, the former ntoskrnl_vista RtlUnicodeToUTF8N
  */
-NTSTATUS NTAPI RtlUnicodeToUTF8N(CHAR *utf8_dest, ULONG utf8_bytes_max,
+NTSTATUS NTAPI RefUnicodeToUTF8N(CHAR *utf8_dest, ULONG utf8_bytes_max,
                                  ULONG *utf8_bytes_written,
                                  const WCHAR *uni_src, ULONG uni_bytes)
 {
@@ -124,9 +120,9 @@ NTSTATUS NTAPI RtlUnicodeToUTF8N(CHAR *utf8_dest, ULONG utf8_bytes_max,
 
 
 /******************************************************************************
- * RtlUTF8ToUnicodeN [NTDLL.@]
+ * RefUTF8ToUnicodeN, the former ntoskrnl_vista RtlUTF8ToUnicodeN
  */
-NTSTATUS NTAPI RtlUTF8ToUnicodeN(WCHAR *uni_dest, ULONG uni_bytes_max,
+NTSTATUS NTAPI RefUTF8ToUnicodeN(WCHAR *uni_dest, ULONG uni_bytes_max,
                                  ULONG *uni_bytes_written,
                                  const CHAR *utf8_src, ULONG utf8_bytes)
 {
@@ -0,0 +1,52 @@
+/*
+ * PROJECT:     RTL UTF-8 benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     The part of rtl.h needed to build nls.c on the host
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <typedefs.h>
+#include <ntnls.h>
+
+typedef const CHAR *PCCH;
+typedef const WCHAR *PCWCH;
+
+typedef struct _NLS_FILE_HEADER
+{
+    USHORT HeaderSize;
+    USHORT CodePage;
+    USHORT MaximumCharacterSize;
+    USHORT DefaultChar;
+    USHORT UniDefaultChar;
+    USHORT TransDefaultChar;
+    USHORT TransUniDefaultChar;
+    UCHAR LeadByte[MAXIMUM_LEADBYTES];
+} NLS_FILE_HEADER, *PNLS_FILE_HEADER;
+
+#define STATUS_SUCCESS              ((NTSTATUS)0x00000000)
+#define STATUS_SOME_NOT_MAPPED      ((NTSTATUS)0x00000107)
+#define STATUS_INVALID_PARAMETER    ((NTSTATUS)0xC000000D)
+#define STATUS_BUFFER_TOO_SMALL     ((NTSTATUS)0xC0000023)
+#define STATUS_INVALID_PARAMETER_4  ((NTSTATUS)0xC00000F2)
+#define STATUS_INVALID_PARAMETER_5  ((NTSTATUS)0xC00000F3)
+
+#define PAGED_CODE_RTL()
+
+/* nls.c */
+NTSTATUS NTAPI RtlUTF8ToUnicodeN(PWSTR UnicodeStringDestination, ULONG UnicodeStringMaxByteCount,
+                                 PULONG UnicodeStringActualByteCount,
+                                 PCCH UTF8StringSource, ULONG UTF8StringByteCount);
+NTSTATUS NTAPI RtlUnicodeToUTF8N(PCHAR UTF8StringDestination, ULONG UTF8StringMaxByteCount,
+                                 PULONG UTF8StringActualByteCount,
+                                 PCWCH UnicodeStringSource, ULONG UnicodeStringByteCount);
+
+/* reference.c */
+NTSTATUS NTAPI RefUTF8ToUnicodeN(WCHAR *uni_dest, ULONG uni_bytes_max,
+                                 ULONG *uni_bytes_written,
+                                 const CHAR *utf8_src, ULONG utf8_bytes);
+NTSTATUS NTAPI RefUnicodeToUTF8N(CHAR *utf8_dest, ULONG utf8_bytes_max,
+                                 ULONG *utf8_bytes_written,
+                                 const WCHAR *uni_src, ULONG uni_bytes);
@@ -0,0 +1,242 @@
+/*
+ * PROJECT:     RTL UTF-8 benchmark
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * PURPOSE:     Checks RtlUTF8ToUnicodeN and RtlUnicodeToUTF8N against the
+ *              former ntoskrnl_vista code on random and adversarial input,
+ *              then reports how fast both convert text
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <rtl.h>
+
+#define MAX_CHARS       80
+#define BUFFER_SIZE     (MAX_CHARS * 4 + 16)
+#define BENCH_CHARS     (1024 * 1024)
+#define TIMED_RUNS      5
+
+typedef NTSTATUS (NTAPI *PUTF8_TO_UNICODE)(PWSTR, ULONG, PULONG, PCCH, ULONG);
+typedef NTSTATUS (NTAPI *PUNICODE_TO_UTF8)(PCHAR, ULONG, PULONG, PCWCH, ULONG);
+
+/* Lead, trail, overlong, surrogate and out of range bytes */
+static const UCHAR Utf8Bytes[] =
+{
+    0xC2, 0xA9, 0xE2, 0x82, 0xAC, 0xF0, 0x9F, 0x98, 0x80, 0xED,
+    0xA0, 0x80, 0xC0, 0xF5, 0xF4, 0x90, 0xE0, 0x80, 0xBF
+};
+
+/* Boundaries of the UTF-8 lengths and lone or paired surrogates */
+static const WCHAR Utf16Chars[] =
+{
+    0x0080, 0x00FF, 0x07FF, 0x0800, 0x20AC, 0xD800, 0xDBFF,
+    0xDC00, 0xDFFF, 0xE000, 0xFFFF
+};
+
+static ULONG Seed = 1;
+
+static ULONG
+Random(void)
+{
+    Seed = Seed * 1103515245 + 12345;
+    return Seed >> 8;
+}
+
+/* Mostly ASCII, so the block conversion kicks in, with runs of something else */
+static VOID
+RandomUtf8(PCHAR String, ULONG Length)
+{
+    ULONG Mode = Random() % 4, i;
+
+    for (i = 0; i < Length; i++)
+    {
+        if (Mode == 0 || Random() % 100 < 70)
+            String[i] = Random() % 0x80;
+        else if (Mode == 1)
+            String[i] = 0x80 + Random() % 0x80;
+        else
+            String[i] = Utf8Bytes[Random() % sizeof(Utf8Bytes)];
+    }
+}
+
+static VOID
+RandomUtf16(PWCHAR String, ULONG Length)
+{
+    ULONG Mode = Random() % 3, i;
+
+    for (i = 0; i < Length; i++)
+    {
+        if (Mode == 0 || Random() % 100 < 70)
+            String[i] = Random() % 0x80;
+        else
+            String[i] = Utf16Chars[Random() % (sizeof(Utf16Chars) / sizeof(Utf16Chars[0]))];
+    }
+}
+
+static ULONG
+CheckUtf8ToUnicode(ULONG Iterations)
+{
+    CHAR Source[MAX_CHARS];
+    WCHAR Expected[BUFFER_SIZE], Actual[BUFFER_SIZE];
+    ULONG ExpectedSize, ActualSize, Length, MaxSize, Errors = 0, i;
+    NTSTATUS ExpectedStatus, ActualStatus;
+    BOOLEAN QuerySize;
+
+    for (i = 0; i < Iterations; i++)
+    {
+        Length = Random() % MAX_CHARS;
+        RandomUtf8(Source, Length);
+        MaxSize = Random() % sizeof(Expected);
+        QuerySize = (Random() % 4 == 0);
+
+        /* The output must match byte for byte, including what is left alone */
+        memset(Expected, 0xAB, sizeof(Expected));
+        memset(Actual, 0xAB, sizeof(Actual));
+        ExpectedSize = ActualSize = 0x1234;
+        ExpectedStatus = RefUTF8ToUnicodeN(QuerySize ? NULL : Expected, MaxSize, &ExpectedSize, Source, Length);
+        ActualStatus = RtlUTF8ToUnicodeN(QuerySize ? NULL : Actual, MaxSize, &ActualSize, Source, Length);
+
+        if (ExpectedStatus != ActualStatus || ExpectedSize != ActualSize ||
+            memcmp(Expected, Actual, sizeof(Expected)))
+        {
+            if (Errors++ < 5)
+            {
+                fprintf(stderr, "RtlUTF8ToUnicodeN: %lu bytes into %lu: status 0x%lx size %lu, expected 0x%lx size %lu\n",
+                        (unsigned long)Length, (unsigned long)MaxSize,
+                        (unsigned long)ActualStatus, (unsigned long)ActualSize,
+                        (unsigned long)ExpectedStatus, (unsigned long)ExpectedSize);
+            }
+        }
+    }
+
+    return Errors;
+}
+
+static ULONG
+CheckUnicodeToUtf8(ULONG Iterations)
+{
+    WCHAR Source[MAX_CHARS];
+    CHAR Expected[BUFFER_SIZE], Actual[BUFFER_SIZE];
+    ULONG ExpectedSize, ActualSize, Length, MaxSize, Errors = 0, i;
+    NTSTATUS ExpectedStatus, ActualStatus;
+    BOOLEAN QuerySize;
+
+    for (i = 0; i < Iterations; i++)
+    {
+        /* In bytes, odd ones included */
+        RandomUtf16(Source, MAX_CHARS);
+        Length = Random() % sizeof(Source);
+        MaxSize = Random() % sizeof(Expected);
+        QuerySize = (Random() % 4 == 0);
+
+        memset(Expected, 0xAB, sizeof(Expected));
+        memset(Actual, 0xAB, sizeof(Actual));
+        ExpectedSize = ActualSize = 0x1234;
+        ExpectedStatus = RefUnicodeToUTF8N(QuerySize ? NULL : Expected, MaxSize, &ExpectedSize, Source, Length);
+        ActualStatus = RtlUnicodeToUTF8N(QuerySize ? NULL : Actual, MaxSize, &ActualSize, Source, Length);
+
+        if (ExpectedStatus != ActualStatus || ExpectedSize != ActualSize ||
+            memcmp(Expected, Actual, sizeof(Expected)))
+        {
+            if (Errors++ < 5)
+            {
+                fprintf(stderr, "RtlUnicodeToUTF8N: %lu bytes into %lu: status 0x%lx size %lu, expected 0x%lx size %lu\n",
+                        (unsigned long)Length, (unsigned long)MaxSize,
+                        (unsigned long)ActualStatus, (unsigned long)ActualSize,
+                        (unsigned long)ExpectedStatus, (unsigned long)ExpectedSize);
+            }
+        }
+    }
+
+    return Errors;
+}
+
+/* Million characters per second, from the best of a few runs */
+static double
+RunUtf8ToUnicode(PUTF8_TO_UNICODE Convert, PCCH Source, PWCHAR Destination, ULONG Repeat)
+{
+    clock_t Start, Best = 0;
+    ULONG Size, Run, i;
+
+    for (Run = 0; Run < TIMED_RUNS; Run++)
+    {
+        Start = clock();
+        for (i = 0; i < Repeat; i++)
+            Convert(Destination, BENCH_CHARS * sizeof(WCHAR), &Size, Source, BENCH_CHARS);
+        Start = clock() - Start;
+        if (Run == 0 || Start < Best)
+            Best = Start;
+    }
+
+    return (double)BENCH_CHARS * Repeat / ((double)(Best ? Best : 1) / CLOCKS_PER_SEC) / 1e6;
+}
+
+static double
+RunUnicodeToUtf8(PUNICODE_TO_UTF8 Convert, PCWCH Source, PCHAR Destination, ULONG Repeat)
+{
+    clock_t Start, Best = 0;
+    ULONG Size, Run, i;
+
+    for (Run = 0; Run < TIMED_RUNS; Run++)
+    {
+        Start = clock();
+        for (i = 0; i < Repeat; i++)
+            Convert(Destination, BENCH_CHARS * 3, &Size, Source, BENCH_CHARS * sizeof(WCHAR));
+        Start = clock() - Start;
+        if (Run == 0 || Start < Best)
+            Best = Start;
+    }
+
+    return (double)BENCH_CHARS * Repeat / ((double)(Best ? Best : 1) / CLOCKS_PER_SEC) / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    ULONG Iterations = 300000, Repeat = 20, Errors, i;
+    PCHAR Utf8;
+    PWCHAR Utf16;
+    double Before, After;
+
+    if (argc > 1) Iterations = strtoul(argv[1], NULL, 0);
+    if (argc > 2) Repeat = strtoul(argv[2], NULL, 0);
+
+    Errors = CheckUtf8ToUnicode(Iterations);
+    Errors += CheckUnicodeToUtf8(Iterations);
+    printf("%lu random conversions each way, %lu mismatches\n",
+           (unsigned long)Iterations, (unsigned long)Errors);
+    if (Errors) return 1;
+
+    Utf8 = malloc(BENCH_CHARS * 3);
+    Utf16 = malloc(BENCH_CHARS * sizeof(WCHAR));
+    if (!Utf8 || !Utf16)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    /* Plain ASCII text */
+    for (i = 0; i < BENCH_CHARS; i++) Utf8[i] = 'a' + i % 26;
+    Before = RunUtf8ToUnicode(RefUTF8ToUnicodeN, Utf8, Utf16, Repeat);
+    After = RunUtf8ToUnicode(RtlUTF8ToUnicodeN, Utf8, Utf16, Repeat);
+    printf("ASCII to UTF-16:     %8.2f -> %8.2f Mchar/s (%.2fx)\n", Before, After, After / Before);
+
+    Before = RunUnicodeToUtf8(RefUnicodeToUTF8N, Utf16, Utf8, Repeat);
+    After = RunUnicodeToUtf8(RtlUnicodeToUTF8N, Utf16, Utf8, Repeat);
+    printf("ASCII from UTF-16:   %8.2f -> %8.2f Mchar/s (%.2fx)\n", Before, After, After / Before);
+
+    /* An accented letter every eight characters, so the block check keeps failing */
+    for (i = 0; i < BENCH_CHARS; i++) Utf8[i] = (i % 8 == 0) ? 0xC3 : (i % 8 == 1) ? 0xA9 : 'a' + i % 26;
+    Before = RunUtf8ToUnicode(RefUTF8ToUnicodeN, Utf8, Utf16, Repeat);
+    After = RunUtf8ToUnicode(RtlUTF8ToUnicodeN, Utf8, Utf16, Repeat);
+    printf("Mixed to UTF-16:     %8.2f -> %8.2f Mchar/s (%.2fx)\n", Before, After, After / Before);
+
+    for (i = 0; i < BENCH_CHARS; i++) Utf16[i] = (i % 8) ? 'a' + i % 26 : 0xE9;
+    Before = RunUnicodeToUtf8(RefUnicodeToUTF8N, Utf16, Utf8, Repeat);
+    After = RunUnicodeToUtf8(RtlUnicodeToUTF8N, Utf16, Utf8, Repeat);
+    printf("Mixed from UTF-16:   %8.2f -> %8.2f Mchar/s (%.2fx)\n", Before, After, After / Before);
+
+    free(Utf16);
+    free(Utf8);
+    return 0;
+}
@@ -39,6 +39,9 @@
 FAST486_STATE EmulatorContext;
 BOOLEAN CpuRunning = FALSE;
 
+/* Instructions decoded by the CPU, kept between runs */
+static PFAST486_BLOCK_CACHE BlockCache = NULL;
+
 /* No more than 'MaxCpuCallLevel' recursive CPU calls are allowed */
 static const INT MaxCpuCallLevel = 32;
 static INT CpuCallLevel = 0; // == 0: CPU stopped; >= 1: CPU running or halted
@@ -222,6 +225,10 @@ BOOLEAN CpuInitialize(VOID)
         // return FALSE;
     // }
 
+    /* Allocate the block cache, the CPU can do without it */
+    BlockCache = RtlAllocateHeap(RtlGetProcessHeap(), 0, sizeof(*BlockCache));
+    if (BlockCache == NULL) DPRINT1("Failed to allocate the block cache\n");
+
     /* Initialize the CPU */
     Fast486Initialize(&EmulatorContext,
                       EmulatorReadMemory,
@@ -231,7 +238,8 @@ BOOLEAN CpuInitialize(VOID)
                       EmulatorBiosOperation,
                       EmulatorIntAcknowledge,
                       EmulatorFpu,
-                      NULL /* TODO: Use a TLB */);
+                      NULL /* TODO: Use a TLB */,
+                      BlockCache);
 
     /* Initialize the software callback system and register the emulator BOPs */
     // RegisterBop(BOP_DEBUGGER  , EmulatorDebugBreakBop);
@@ -243,6 +251,12 @@ BOOLEAN CpuInitialize(VOID)
 VOID CpuCleanup(VOID)
 {
     // Fast486Cleanup();
+
+    if (BlockCache != NULL)
+    {
+        RtlFreeHeap(RtlGetProcessHeap(), 0, BlockCache);
+        BlockCache = NULL;
+    }
 }
 
 /* EOF */
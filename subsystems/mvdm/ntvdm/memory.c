@@ -271,7 +271,11 @@ VOID FASTCALL EmulatorCopyMemory(PFAST486_STATE State, ULONG DestAddress, ULONG
 
 VOID EmulatorSetA20(BOOLEAN Enabled)
 {
+    if (A20Line == Enabled) return;
     A20Line = Enabled;
+
+    /* The code above 1 MB is not the same anymore */
+    Fast486FlushBlockCache(&EmulatorContext);
 }
 
 BOOLEAN EmulatorGetA20(VOID)
@@ -34,7 +34,8 @@ DIB_XXBPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
                      RECTL* SourceRect, CLIPOBJ* ClipRegion,
                      XLATEOBJ* ColorTranslation, BLENDOBJ* BlendObj)
 {
-  INT DstX, DstY, SrcX, SrcY;
+  INT DstX, DstY;
+  DIB_DDA DdaX, DdaY;
   BLENDFUNCTION BlendFunc;
   register NICEPIXEL32 DstPixel32;
   register NICEPIXEL32 SrcPixel32;
@@ -81,15 +82,17 @@ DIB_XXBPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
   EXLATEOBJ_vInitialize(&exloDstRGB, pexlo->ppalDst, &gpalRGB, 0, 0, 0);
   EXLATEOBJ_vInitialize(&exloRGBSrc, &gpalRGB, pexlo->ppalSrc, 0, 0, 0);
 
-  SrcY = SourceRect->top;
+  DIB_DdaInit(&DdaY, SourceRect->top, SourceRect->bottom - SourceRect->top,
+              DestRect->bottom - DestRect->top);
   DstY = DestRect->top;
   while ( DstY < DestRect->bottom )
   {
-    SrcX = SourceRect->left;
+    DIB_DdaInit(&DdaX, SourceRect->left, SourceRect->right - SourceRect->left,
+                DestRect->right - DestRect->left);
     DstX = DestRect->left;
     while(DstX < DestRect->right)
     {
-      SrcPixel32.ul = DIB_GetSource(Source, SrcX, SrcY, &exloSrcRGB.xlo);
+      SrcPixel32.ul = DIB_GetSource(Source, DdaX.Pos, DdaY.Pos, &exloSrcRGB.xlo);
       SrcPixel32.col.red = (SrcPixel32.col.red * BlendFunc.SourceConstantAlpha) / 255;
       SrcPixel32.col.green = (SrcPixel32.col.green * BlendFunc.SourceConstantAlpha) / 255;
       SrcPixel32.col.blue = (SrcPixel32.col.blue * BlendFunc.SourceConstantAlpha) / 255;
@@ -106,12 +109,10 @@ DIB_XXBPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
       pfnDibPutPixel(Dest, DstX, DstY, XLATEOBJ_iXlate(ColorTranslation, DstPixel32.ul));
 
       DstX++;
-      SrcX = SourceRect->left + ((DstX-DestRect->left)*(SourceRect->right - SourceRect->left))
-                                            /(DestRect->right-DestRect->left);
+      DIB_DdaStep(&DdaX);
     }
     DstY++;
-    SrcY = SourceRect->top + ((DstY-DestRect->top)*(SourceRect->bottom - SourceRect->top))
-                                            /(DestRect->bottom-DestRect->top);
+    DIB_DdaStep(&DdaY);
   }
 
   EXLATEOBJ_vCleanup(&exloDstRGB);
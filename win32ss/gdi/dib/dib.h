@@ -141,3 +141,37 @@ ULONG DIB_DoRop(ULONG Rop, ULONG Dest, ULONG Source, ULONG Pattern);
 #define DIB_GetSourceIndex(SourceSurf,sx,sy)                \
   DibFunctionsForBitmapFormat[SourceSurf->iBitmapFormat].   \
     DIB_GetPixel(SourceSurf, sx, sy)
+
+/* Steps through Start + (i * Num) / Den for i = 0, 1, ... without dividing.
+   Gives exactly the same positions as the division, Num >= 0 and Den > 0 */
+typedef struct _DIB_DDA
+{
+  LONG Pos;
+  LONG Rem;
+  LONG Quot;
+  LONG Frac;
+  LONG Den;
+} DIB_DDA;
+
+static __inline VOID
+DIB_DdaInit(DIB_DDA *Dda, LONG Start, LONG Num, LONG Den)
+{
+  ASSERT(Num >= 0 && Den > 0);
+  Dda->Pos = Start;
+  Dda->Rem = 0;
+  Dda->Quot = Num / Den;
+  Dda->Frac = Num % Den;
+  Dda->Den = Den;
+}
+
+static __inline VOID
+DIB_DdaStep(DIB_DDA *Dda)
+{
+  Dda->Pos += Dda->Quot;
+  Dda->Rem += Dda->Frac;
+  if (Dda->Rem >= Dda->Den)
+  {
+    Dda->Rem -= Dda->Den;
+    Dda->Pos++;
+  }
+}
@@ -212,13 +212,8 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-          BltInfo->XlateSourceToDest, *SourceBits);
-        SourceBits += 1;
-        DestBits += 2;
-      }
+      XLATEOBJ_vXlateLine(BltInfo->XlateSourceToDest, DestBits, 16,
+        SourceBits, 8, BltInfo->DestRect.right - BltInfo->DestRect.left);
 
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
@@ -285,15 +280,8 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
         {
           SourceBits = SourceLine;
           DestBits = DestLine;
-          for (i = BltInfo->DestRect.left; i <
-            BltInfo->DestRect.right; i++)
-          {
-            *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-              BltInfo->XlateSourceToDest,
-              *((WORD *)SourceBits));
-            SourceBits += 2;
-            DestBits += 2;
-          }
+          XLATEOBJ_vXlateLine(BltInfo->XlateSourceToDest, DestBits, 16,
+            SourceBits, 16, BltInfo->DestRect.right - BltInfo->DestRect.left);
           SourceLine += BltInfo->SourceSurface->lDelta;
           DestLine += BltInfo->DestSurface->lDelta;
         }
@@ -317,15 +305,8 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
         {
           SourceBits = SourceLine;
           DestBits = DestLine;
-          for (i = BltInfo->DestRect.left; i <
-            BltInfo->DestRect.right; i++)
-          {
-            *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-              BltInfo->XlateSourceToDest,
-              *((WORD *)SourceBits));
-            SourceBits += 2;
-            DestBits += 2;
-          }
+          XLATEOBJ_vXlateLine(BltInfo->XlateSourceToDest, DestBits, 16,
+            SourceBits, 16, BltInfo->DestRect.right - BltInfo->DestRect.left);
           SourceLine -= BltInfo->SourceSurface->lDelta;
           DestLine -= BltInfo->DestSurface->lDelta;
         }
@@ -345,17 +326,8 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        xColor = (*(SourceBits + 2) << 0x10) +
-          (*(SourceBits + 1) << 0x08) + (*(SourceBits));
-
-        *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-          BltInfo->XlateSourceToDest, xColor);
-
-        SourceBits += 3;
-        DestBits += 2;
-      }
+      XLATEOBJ_vXlateLine(BltInfo->XlateSourceToDest, DestBits, 16,
+        SourceBits, 24, BltInfo->DestRect.right - BltInfo->DestRect.left);
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
     }
@@ -373,14 +345,8 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-          BltInfo->XlateSourceToDest,
-          *((PDWORD) SourceBits));
-        SourceBits += 4;
-        DestBits += 2;
-      }
+      XLATEOBJ_vXlateLine(BltInfo->XlateSourceToDest, DestBits, 16,
+        SourceBits, 32, BltInfo->DestRect.right - BltInfo->DestRect.left);
 
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
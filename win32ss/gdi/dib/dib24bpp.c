@@ -114,14 +114,8 @@ DIB_24BPP_BitBltSrcCopy(PBLTINFO BltInfo)
         SourceBits = SourceLine;
         DestBits = DestLine;
 
-        for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-        {
-          xColor = XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, *SourceBits);
-          *DestBits = xColor & 0xff;
-          *(PWORD)(DestBits + 1) = (WORD)(xColor >> 8);
-          SourceBits += 1;
-          DestBits += 3;
-        }
+        XLATEOBJ_vXlateLine(BltInfo->XlateSourceToDest, DestBits, 24, SourceBits, 8,
+          BltInfo->DestRect.right - BltInfo->DestRect.left);
 
         SourceLine += BltInfo->SourceSurface->lDelta;
         DestLine += BltInfo->DestSurface->lDelta;
@@ -136,14 +130,8 @@ DIB_24BPP_BitBltSrcCopy(PBLTINFO BltInfo)
         SourceLine_16BPP = SourceBits_16BPP;
         DestLine = DestBits;
 
-        for (i=BltInfo->DestRect.left; i<BltInfo->DestRect.right; i++)
-        {
-          xColor = XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, *SourceLine_16BPP);
-          *DestLine++ = xColor & 0xff;
-          *(PWORD)DestLine = (WORD)(xColor >> 8);
-          DestLine += 2;
-          SourceLine_16BPP++;
-        }
+        XLATEOBJ_vXlateLine(BltInfo->XlateSourceToDest, DestLine, 24, SourceLine_16BPP, 16,
+          BltInfo->DestRect.right - BltInfo->DestRect.left);
 
         SourceBits_16BPP = (PWORD)((PBYTE)SourceBits_16BPP + BltInfo->SourceSurface->lDelta);
         DestBits += BltInfo->DestSurface->lDelta;
@@ -177,19 +165,15 @@ DIB_24BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       }
       else
       {
-        sx = BltInfo->SourcePoint.x;
-        sy = BltInfo->SourcePoint.y;
+        SourceLine = (PBYTE)BltInfo->SourceSurface->pvScan0 + (BltInfo->SourcePoint.y * BltInfo->SourceSurface->lDelta) + 3 * BltInfo->SourcePoint.x;
+        DestLine = DestBits;
 
-        for (j=BltInfo->DestRect.top; j<BltInfo->DestRect.bottom; j++)
+        for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
         {
-          sx = BltInfo->SourcePoint.x;
-          for (i=BltInfo->DestRect.left; i<BltInfo->DestRect.right; i++)
-          {
-            DWORD pixel = DIB_24BPP_GetPixel(BltInfo->SourceSurface, sx, sy);
-            DIB_24BPP_PutPixel(BltInfo->DestSurface, i, j, XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, pixel));
-            sx++;
-          }
-          sy++;
+          XLATEOBJ_vXlateLine(BltInfo->XlateSourceToDest, DestLine, 24, SourceLine, 24,
+            BltInfo->DestRect.right - BltInfo->DestRect.left);
+          SourceLine += BltInfo->SourceSurface->lDelta;
+          DestLine += BltInfo->DestSurface->lDelta;
         }
       }
       break;
@@ -203,14 +187,8 @@ DIB_24BPP_BitBltSrcCopy(PBLTINFO BltInfo)
         SourceBits = SourceLine;
         DestBits = DestLine;
 
-        for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-        {
-          xColor = XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, *((PDWORD) SourceBits));
-          *DestBits = xColor & 0xff;
-          *(PWORD)(DestBits + 1) = (WORD)(xColor >> 8);
-          SourceBits += 4;
-          DestBits += 3;
-        }
+        XLATEOBJ_vXlateLine(BltInfo->XlateSourceToDest, DestBits, 24, SourceBits, 32,
+          BltInfo->DestRect.right - BltInfo->DestRect.left);
 
         SourceLine += BltInfo->SourceSurface->lDelta;
         DestLine += BltInfo->DestSurface->lDelta;
@@ -52,7 +52,6 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
   LONG     i, j, sx, sy, xColor, f1;
   PBYTE    SourceBits, DestBits, SourceLine, DestLine;
   PBYTE    SourceBits_4BPP, SourceLine_4BPP;
-  PDWORD   Source32, Dest32;
 
   DestBits = (PBYTE)BltInfo->DestSurface->pvScan0
     + (BltInfo->DestRect.top * BltInfo->DestSurface->lDelta)
@@ -120,13 +119,8 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        xColor = *SourceBits;
-        *((PDWORD) DestBits) = (DWORD)XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, xColor);
-        SourceBits += 1;
-        DestBits += 4;
-      }
+      XLATEOBJ_vXlateLine(BltInfo->XlateSourceToDest, DestBits, 32, SourceBits, 8,
+        BltInfo->DestRect.right - BltInfo->DestRect.left);
 
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
@@ -142,13 +136,8 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        xColor = *((PWORD) SourceBits);
-        *((PDWORD) DestBits) = (DWORD)XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, xColor);
-        SourceBits += 2;
-        DestBits += 4;
-      }
+      XLATEOBJ_vXlateLine(BltInfo->XlateSourceToDest, DestBits, 32, SourceBits, 16,
+        BltInfo->DestRect.right - BltInfo->DestRect.left);
 
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
@@ -166,15 +155,8 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       SourceBits = SourceLine;
       DestBits = DestLine;
 
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        xColor = (*(SourceBits + 2) << 0x10) +
-          (*(SourceBits + 1) << 0x08) +
-          (*(SourceBits));
-        *((PDWORD)DestBits) = (DWORD)XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, xColor);
-        SourceBits += 3;
-        DestBits += 4;
-      }
+      XLATEOBJ_vXlateLine(BltInfo->XlateSourceToDest, DestBits, 32, SourceBits, 24,
+        BltInfo->DestRect.right - BltInfo->DestRect.left);
 
       SourceLine += BltInfo->SourceSurface->lDelta;
       DestLine += BltInfo->DestSurface->lDelta;
@@ -218,24 +200,9 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
         SourceBits = ((PBYTE)BltInfo->SourceSurface->pvScan0 + (BltInfo->SourcePoint.y * BltInfo->SourceSurface->lDelta) + 4 * BltInfo->SourcePoint.x);
         for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
         {
-          if (BltInfo->DestRect.left < BltInfo->SourcePoint.x)
-          {
-            Dest32 = (DWORD *) DestBits;
-            Source32 = (DWORD *) SourceBits;
-            for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-            {
-              *Dest32++ = XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, *Source32++);
-            }
-          }
-          else
-          {
-            Dest32 = (DWORD *) DestBits + (BltInfo->DestRect.right - BltInfo->DestRect.left - 1);
-            Source32 = (DWORD *) SourceBits + (BltInfo->DestRect.right - BltInfo->DestRect.left - 1);
-            for (i = BltInfo->DestRect.right - 1; BltInfo->DestRect.left <= i; i--)
-            {
-              *Dest32-- = XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, *Source32--);
-            }
-          }
+          /* Different palettes mean different surfaces, the line can't overlap */
+          XLATEOBJ_vXlateLine(BltInfo->XlateSourceToDest, DestBits, 32, SourceBits, 32,
+            BltInfo->DestRect.right - BltInfo->DestRect.left);
           SourceBits += BltInfo->SourceSurface->lDelta;
           DestBits += BltInfo->DestSurface->lDelta;
         }
@@ -246,24 +213,9 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
         DestBits = (PBYTE)BltInfo->DestSurface->pvScan0 + ((BltInfo->DestRect.bottom - 1) * BltInfo->DestSurface->lDelta) + 4 * BltInfo->DestRect.left;
         for (j = BltInfo->DestRect.bottom - 1; BltInfo->DestRect.top <= j; j--)
         {
-          if (BltInfo->DestRect.left < BltInfo->SourcePoint.x)
-          {
-            Dest32 = (DWORD *) DestBits;
-            Source32 = (DWORD *) SourceBits;
-            for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-            {
-              *Dest32++ = XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, *Source32++);
-            }
-          }
-          else
-          {
-            Dest32 = (DWORD *) DestBits + (BltInfo->DestRect.right - BltInfo->DestRect.left - 1);
-            Source32 = (DWORD *) SourceBits + (BltInfo->DestRect.right - BltInfo->DestRect.left - 1);
-            for (i = BltInfo->DestRect.right - 1; BltInfo->DestRect.left <= i; i--)
-            {
-              *Dest32-- = XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, *Source32--);
-            }
-          }
+          /* Different palettes mean different surfaces, the line can't overlap */
+          XLATEOBJ_vXlateLine(BltInfo->XlateSourceToDest, DestBits, 32, SourceBits, 32,
+            BltInfo->DestRect.right - BltInfo->DestRect.left);
           SourceBits -= BltInfo->SourceSurface->lDelta;
           DestBits -= BltInfo->DestSurface->lDelta;
         }
@@ -325,20 +277,57 @@ DIB_32BPP_TransparentBlt(SURFOBJ *DestSurf, SURFOBJ *SourceSurf,
   return TRUE;
 }
 
-typedef union {
-  ULONG ul;
-  struct {
-    UCHAR red;
-    UCHAR green;
-    UCHAR blue;
-    UCHAR alpha;
-  } col;
-} NICEPIXEL32;
-
-static __inline UCHAR
-Clamp8(ULONG val)
+/* The blend below works on all four channels of a pixel at once, each one
+   widened to 16 bits in a 64 bit integer. None of the products overflow a
+   lane, so it gives exactly what doing the channels one by one gives */
+#define DIB_LANES_LOW 0x00FF00FF00FF00FFULL
+#define DIB_LANES_ONE 0x0001000100010001ULL
+
+static __inline ULONGLONG
+DIB_32BPP_Widen(ULONG Pixel)
+{
+  return (Pixel & 0xFF) | ((ULONGLONG)(Pixel & 0xFF00) << 8) |
+         ((ULONGLONG)(Pixel & 0xFF0000) << 16) | ((ULONGLONG)(Pixel & 0xFF000000) << 24);
+}
+
+static __inline ULONG
+DIB_32BPP_Narrow(ULONGLONG Lanes)
+{
+  return (ULONG)((Lanes & 0xFF) | ((Lanes >> 8) & 0xFF00) |
+                 ((Lanes >> 16) & 0xFF0000) | ((Lanes >> 24) & 0xFF000000));
+}
+
+/* x / 255 for each lane, exact for x <= 255 * 255 */
+static __inline ULONGLONG
+DIB_32BPP_Div255(ULONGLONG Lanes)
+{
+  return ((Lanes + DIB_LANES_ONE + ((Lanes >> 8) & DIB_LANES_LOW)) >> 8) & DIB_LANES_LOW;
+}
+
+/* One pixel of the AC_SRC_OVER blend. Source channels are scaled by the
+   constant alpha, the destination by the inverse of the source alpha and
+   the sum saturates at 255 */
+static __inline ULONG
+DIB_32BPP_BlendPixel(ULONG Src, ULONG Dst, UCHAR ConstAlpha,
+                     BOOLEAN PerPixelAlpha, BOOLEAN SrcHasAlpha)
 {
-  return (val > 255) ? 255 : (UCHAR)val;
+  ULONGLONG SrcLanes, DstLanes;
+  ULONG Alpha;
+
+  SrcLanes = DIB_32BPP_Widen(Src);
+  if (ConstAlpha != 255)
+    SrcLanes = DIB_32BPP_Div255(SrcLanes * ConstAlpha);
+  if (!SrcHasAlpha)
+    SrcLanes = (SrcLanes & 0x0000FFFFFFFFFFFFULL) | ((ULONGLONG)ConstAlpha << 48);
+
+  Alpha = PerPixelAlpha ? (ULONG)(SrcLanes >> 48) : ConstAlpha;
+
+  DstLanes = DIB_32BPP_Div255(DIB_32BPP_Widen(Dst) * (255 - Alpha)) + SrcLanes;
+
+  /* Sums are at most 510, so bit 8 of a lane tells it went past 255 */
+  DstLanes |= ((DstLanes >> 8) & DIB_LANES_ONE) * 0xFF;
+
+  return DIB_32BPP_Narrow(DstLanes);
 }
 
 BOOLEAN
@@ -346,11 +335,13 @@ DIB_32BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
                      RECTL* SourceRect, CLIPOBJ* ClipRegion,
                      XLATEOBJ* ColorTranslation, BLENDOBJ* BlendObj)
 {
-  INT Rows, Cols, SrcX, SrcY;
-  register PULONG Dst;
+  LONG Rows, Cols, DstWidth, DstHeight;
+  PULONG Dst, SrcLine;
   BLENDFUNCTION BlendFunc;
-  register NICEPIXEL32 DstPixel, SrcPixel;
-  UCHAR Alpha, SrcBpp;
+  BOOLEAN PerPixelAlpha, SrcHasAlpha, Direct;
+  DIB_DDA DdaX, DdaY;
+  ULONG Src;
+  UCHAR SrcBpp;
 
   DPRINT("DIB_32BPP_AlphaBlend: srcRect: (%d,%d)-(%d,%d), dstRect: (%d,%d)-(%d,%d)\n",
     SourceRect->left, SourceRect->top, SourceRect->right, SourceRect->bottom,
@@ -379,40 +370,59 @@ DIB_32BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
     return FALSE;
   }
 
+  SrcBpp = BitsPerFormat(Source->iBitmapFormat);
+  PerPixelAlpha = (BlendFunc.AlphaFormat & AC_SRC_ALPHA) != 0;
+  SrcHasAlpha = (SrcBpp == 32);
+
+  /* 32bpp sources that need no translation are read straight from the bits */
+  Direct = SrcHasAlpha &&
+           (ColorTranslation == NULL || (ColorTranslation->flXlate & XO_TRIVIAL));
+
+  DstWidth = DestRect->right - DestRect->left;
+  DstHeight = DestRect->bottom - DestRect->top;
   Dst = (PULONG)((ULONG_PTR)Dest->pvScan0 + (DestRect->top * Dest->lDelta) +
     (DestRect->left << 2));
-  SrcBpp = BitsPerFormat(Source->iBitmapFormat);
 
-  Rows = 0;
-   SrcY = SourceRect->top;
-   while (++Rows <= DestRect->bottom - DestRect->top)
+  DIB_DdaInit(&DdaY, SourceRect->top, SourceRect->bottom - SourceRect->top, DstHeight);
+  for (Rows = 0; Rows < DstHeight; Rows++)
   {
-    Cols = 0;
-    SrcX = SourceRect->left;
-    while (++Cols <= DestRect->right - DestRect->left)
+    SrcLine = (PULONG)((ULONG_PTR)Source->pvScan0 + DdaY.Pos * Source->lDelta);
+
+    DIB_DdaInit(&DdaX, SourceRect->left, SourceRect->right - SourceRect->left, DstWidth);
+    for (Cols = 0; Cols < DstWidth; Cols++)
     {
-      SrcPixel.ul = DIB_GetSource(Source, SrcX, SrcY, ColorTranslation);
-      SrcPixel.col.red = (SrcPixel.col.red * BlendFunc.SourceConstantAlpha) / 255;
-      SrcPixel.col.green = (SrcPixel.col.green * BlendFunc.SourceConstantAlpha)  / 255;
-      SrcPixel.col.blue = (SrcPixel.col.blue * BlendFunc.SourceConstantAlpha) / 255;
-      SrcPixel.col.alpha = (32 == SrcBpp) ?
-                        (SrcPixel.col.alpha * BlendFunc.SourceConstantAlpha) / 255 :
-                        BlendFunc.SourceConstantAlpha ;
-
-      Alpha = ((BlendFunc.AlphaFormat & AC_SRC_ALPHA) != 0) ?
-           SrcPixel.col.alpha : BlendFunc.SourceConstantAlpha ;
-
-      DstPixel.ul = *Dst;
-      DstPixel.col.red = Clamp8((DstPixel.col.red * (255 - Alpha)) / 255 + SrcPixel.col.red) ;
-      DstPixel.col.green = Clamp8((DstPixel.col.green * (255 - Alpha)) / 255 + SrcPixel.col.green) ;
-      DstPixel.col.blue = Clamp8((DstPixel.col.blue * (255 - Alpha)) / 255 + SrcPixel.col.blue) ;
-      DstPixel.col.alpha = Clamp8((DstPixel.col.alpha * (255 - Alpha)) / 255 + SrcPixel.col.alpha) ;
-      *Dst++ = DstPixel.ul;
-      SrcX = SourceRect->left + (Cols*(SourceRect->right - SourceRect->left))/(DestRect->right - DestRect->left);
+      if (Direct)
+      {
+        Src = SrcLine[DdaX.Pos];
+
+        /* Opaque and fully transparent pixels are the common ones in icons */
+        if (PerPixelAlpha && BlendFunc.SourceConstantAlpha == 255)
+        {
+          if ((Src >> 24) == 255)
+          {
+            Dst[Cols] = Src;
+            DIB_DdaStep(&DdaX);
+            continue;
+          }
+          if (Src == 0)
+          {
+            DIB_DdaStep(&DdaX);
+            continue;
+          }
+        }
+      }
+      else
+      {
+        Src = DIB_GetSource(Source, DdaX.Pos, DdaY.Pos, ColorTranslation);
+      }
+
+      Dst[Cols] = DIB_32BPP_BlendPixel(Src, Dst[Cols], BlendFunc.SourceConstantAlpha,
+                                       PerPixelAlpha, SrcHasAlpha);
+      DIB_DdaStep(&DdaX);
     }
-    Dst = (PULONG)((ULONG_PTR)Dest->pvScan0 + ((DestRect->top + Rows) * Dest->lDelta) +
-                (DestRect->left << 2));
-    SrcY = SourceRect->top + (Rows*(SourceRect->bottom - SourceRect->top))/(DestRect->bottom - DestRect->top);
+
+    Dst = (PULONG)((ULONG_PTR)Dst + Dest->lDelta);
+    DIB_DdaStep(&DdaY);
   }
 
   return TRUE;
@@ -19,9 +19,21 @@ EXLATEOBJ_iXlateTrivial(
     _In_ PEXLATEOBJ pexlo,
     _In_ ULONG iColor);
 
+_Function_class_(FN_XLATE_LINE)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateLineTrivial(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cx) PULONG pulDst,
+    _In_reads_(cx) const ULONG *pulSrc,
+    _In_ ULONG cx);
+
+/* Number of pixels translated at once when the layout has to be converted */
+#define XLATE_LINE_CHUNK 64
+
 /** Globals *******************************************************************/
 
-EXLATEOBJ gexloTrivial = {{0, XO_TRIVIAL, 0, 0, 0, 0}, EXLATEOBJ_iXlateTrivial};
+EXLATEOBJ gexloTrivial = {{0, XO_TRIVIAL, 0, 0, 0, 0}, EXLATEOBJ_iXlateTrivial, EXLATEOBJ_vXlateLineTrivial};
 
 static ULONG giUniqueXlate = 0;
 
@@ -36,6 +48,59 @@ static const BYTE gajXlate6to8[64] =
 194,198,202,207,210,215,219,223,227,231,235,239,243,247,251,255};
 
 
+/** Palette lookup cache *****************************************************/
+
+static
+VOID
+EXLATEOBJ_vAllocateCache(
+    _Inout_ PEXLATEOBJ pexlo)
+{
+    PXLATECACHEENTRY pCache;
+    ULONG i, iIndex;
+
+    pCache = EngAllocMem(0, XLATE_CACHE_SIZE * sizeof(XLATECACHEENTRY), GDITAG_PXLATE);
+    if (!pCache)
+    {
+        /* Not a problem, we will look for each color in the palette */
+        return;
+    }
+
+    /* Colors have 24 bits, so this one never matches, but still give it
+       the right index, so that a lookup doesn't have to check for it */
+    iIndex = PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, 0xFFFFFFFF);
+    for (i = 0; i < XLATE_CACHE_SIZE; i++)
+    {
+        pCache[i].iColor = 0xFFFFFFFF;
+        pCache[i].iIndex = iIndex;
+    }
+
+    pexlo->pCache = pCache;
+}
+
+FORCEINLINE
+ULONG
+EXLATEOBJ_iGetNearestIndex(
+    _In_ PEXLATEOBJ pexlo,
+    _In_ ULONG iColor)
+{
+    PXLATECACHEENTRY pEntry;
+
+    if (!pexlo->pCache)
+        return PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, iColor);
+
+    /* The palette lookup ignores the high byte, so does the cache */
+    iColor &= 0xFFFFFF;
+    pEntry = &pexlo->pCache[(iColor * 0x9E3779B1) >> (32 - XLATE_CACHE_BITS)];
+    if (pEntry->iColor != iColor)
+    {
+        pEntry->iIndex = PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, iColor);
+        pEntry->iColor = iColor;
+    }
+
+    return pEntry->iIndex;
+}
+
+
 /** iXlate functions **********************************************************/
 
 _Post_satisfies_(return==iColor)
@@ -179,7 +244,7 @@ ULONG
 FASTCALL
 EXLATEOBJ_iXlateRGBtoPal(PEXLATEOBJ pexlo, ULONG iColor)
 {
-    return PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, iColor);
+    return EXLATEOBJ_iGetNearestIndex(pexlo, iColor);
 }
 
 _Function_class_(FN_XLATE)
@@ -252,7 +317,7 @@ EXLATEOBJ_iXlate555toPal(PEXLATEOBJ pexlo, ULONG iColor)
 {
     iColor = EXLATEOBJ_iXlate555toRGB(pexlo, iColor);
 
-    return PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, iColor);
+    return EXLATEOBJ_iGetNearestIndex(pexlo, iColor);
 }
 
 _Function_class_(FN_XLATE)
@@ -321,7 +386,7 @@ EXLATEOBJ_iXlate565toPal(EXLATEOBJ *pexlo, ULONG iColor)
 {
     iColor = EXLATEOBJ_iXlate565toRGB(pexlo, iColor);
 
-    return PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, iColor);
+    return EXLATEOBJ_iGetNearestIndex(pexlo, iColor);
 }
 
 _Function_class_(FN_XLATE)
@@ -347,7 +412,253 @@ EXLATEOBJ_iXlateBitfieldsToPal(PEXLATEOBJ pexlo, ULONG iColor)
     iColor = EXLATEOBJ_iXlateShiftAndMask(pexlo, iColor);
 
     /* Return nearest index */
-    return PALETTE_ulGetNearestPaletteIndex(pexlo->ppalDst, iColor);
+    return EXLATEOBJ_iGetNearestIndex(pexlo, iColor);
+}
+
+
+/** Line functions ************************************************************/
+
+/*
+ * These translate a run of pixels at once, so that the blitters don't pay
+ * for an indirect call per pixel. They are plain loops without branches,
+ * which the compiler can unroll and vectorize. pulDst can be pulSrc.
+ */
+
+#define XLATE_LINE_FUNCTION(name) \
+_Function_class_(FN_XLATE_LINE) \
+VOID \
+FASTCALL \
+EXLATEOBJ_vXlateLine##name( \
+    _In_ PEXLATEOBJ pexlo, \
+    _Out_writes_(cx) PULONG pulDst, \
+    _In_reads_(cx) const ULONG *pulSrc, \
+    _In_ ULONG cx) \
+{ \
+    ULONG i; \
+    for (i = 0; i < cx; i++) \
+        pulDst[i] = EXLATEOBJ_iXlate##name(pexlo, pulSrc[i]); \
+}
+
+_Function_class_(FN_XLATE_LINE)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateLineTrivial(
+    _In_ PEXLATEOBJ pexlo,
+    _Out_writes_(cx) PULONG pulDst,
+    _In_reads_(cx) const ULONG *pulSrc,
+    _In_ ULONG cx)
+{
+    if (pulDst != pulSrc)
+        RtlCopyMemory(pulDst, pulSrc, cx * sizeof(ULONG));
+}
+
+_Function_class_(FN_XLATE_LINE)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateLineGeneric(PEXLATEOBJ pexlo, PULONG pulDst, const ULONG *pulSrc, ULONG cx)
+{
+    PFN_XLATE pfnXlate = pexlo->pfnXlate;
+    ULONG i;
+
+    for (i = 0; i < cx; i++)
+        pulDst[i] = pfnXlate(pexlo, pulSrc[i]);
+}
+
+_Function_class_(FN_XLATE_LINE)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateLineToMono(PEXLATEOBJ pexlo, PULONG pulDst, const ULONG *pulSrc, ULONG cx)
+{
+    ULONG iBackColor = pexlo->xlo.pulXlate[0];
+    ULONG i;
+
+    for (i = 0; i < cx; i++)
+        pulDst[i] = (pulSrc[i] == iBackColor);
+}
+
+_Function_class_(FN_XLATE_LINE)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateLineTable(PEXLATEOBJ pexlo, PULONG pulDst, const ULONG *pulSrc, ULONG cx)
+{
+    const ULONG *pulXlate = pexlo->xlo.pulXlate;
+    ULONG cEntries = pexlo->xlo.cEntries;
+    ULONG i, iColor;
+
+    for (i = 0; i < cx; i++)
+    {
+        iColor = pulSrc[i];
+        pulDst[i] = (iColor < cEntries) ? pulXlate[iColor] : 0;
+    }
+}
+
+_Function_class_(FN_XLATE_LINE)
+VOID
+FASTCALL
+EXLATEOBJ_vXlateLineShiftAndMask(PEXLATEOBJ pexlo, PULONG pulDst, const ULONG *pulSrc, ULONG cx)
+{
+    /* Keep them in registers, pulDst could alias them otherwise */
+    ULONG ulRedMask = pexlo->ulRedMask, ulRedShift = pexlo->ulRedShift;
+    ULONG ulGreenMask = pexlo->ulGreenMask, ulGreenShift = pexlo->ulGreenShift;
+    ULONG ulBlueMask = pexlo->ulBlueMask, ulBlueShift = pexlo->ulBlueShift;
+    ULONG i, iColor;
+
+    for (i = 0; i < cx; i++)
+    {
+        iColor = pulSrc[i];
+        pulDst[i] = (_rotl(iColor, ulRedShift) & ulRedMask) |
+                    (_rotl(iColor, ulGreenShift) & ulGreenMask) |
+                    (_rotl(iColor, ulBlueShift) & ulBlueMask);
+    }
+}
+
+XLATE_LINE_FUNCTION(RGBtoBGR)
+XLATE_LINE_FUNCTION(RGBto555)
+XLATE_LINE_FUNCTION(BGRto555)
+XLATE_LINE_FUNCTION(RGBto565)
+XLATE_LINE_FUNCTION(BGRto565)
+XLATE_LINE_FUNCTION(555toRGB)
+XLATE_LINE_FUNCTION(555toBGR)
+XLATE_LINE_FUNCTION(555to565)
+XLATE_LINE_FUNCTION(565to555)
+XLATE_LINE_FUNCTION(565toRGB)
+XLATE_LINE_FUNCTION(565toBGR)
+
+/* Looking up the palette is the expensive part, so these get the cache */
+#define XLATE_LINE_FUNCTION_TO_PAL(name) \
+_Function_class_(FN_XLATE_LINE) \
+VOID \
+FASTCALL \
+EXLATEOBJ_vXlateLine##name( \
+    _In_ PEXLATEOBJ pexlo, \
+    _Out_writes_(cx) PULONG pulDst, \
+    _In_reads_(cx) const ULONG *pulSrc, \
+    _In_ ULONG cx) \
+{ \
+    ULONG i; \
+    if (!pexlo->pCache) EXLATEOBJ_vAllocateCache(pexlo); \
+    for (i = 0; i < cx; i++) \
+        pulDst[i] = EXLATEOBJ_iXlate##name(pexlo, pulSrc[i]); \
+}
+
+XLATE_LINE_FUNCTION_TO_PAL(RGBtoPal)
+XLATE_LINE_FUNCTION_TO_PAL(555toPal)
+XLATE_LINE_FUNCTION_TO_PAL(565toPal)
+XLATE_LINE_FUNCTION_TO_PAL(BitfieldsToPal)
+
+static const struct
+{
+    PFN_XLATE pfnXlate;
+    PFN_XLATE_LINE pfnXlateLine;
+} gaXlateLineFunctions[] =
+{
+    {EXLATEOBJ_iXlateTrivial, EXLATEOBJ_vXlateLineTrivial},
+    {EXLATEOBJ_iXlateToMono, EXLATEOBJ_vXlateLineToMono},
+    {EXLATEOBJ_iXlateTable, EXLATEOBJ_vXlateLineTable},
+    {EXLATEOBJ_iXlateRGBtoBGR, EXLATEOBJ_vXlateLineRGBtoBGR},
+    {EXLATEOBJ_iXlateRGBto555, EXLATEOBJ_vXlateLineRGBto555},
+    {EXLATEOBJ_iXlateBGRto555, EXLATEOBJ_vXlateLineBGRto555},
+    {EXLATEOBJ_iXlateRGBto565, EXLATEOBJ_vXlateLineRGBto565},
+    {EXLATEOBJ_iXlateBGRto565, EXLATEOBJ_vXlateLineBGRto565},
+    {EXLATEOBJ_iXlateRGBtoPal, EXLATEOBJ_vXlateLineRGBtoPal},
+    {EXLATEOBJ_iXlate555toRGB, EXLATEOBJ_vXlateLine555toRGB},
+    {EXLATEOBJ_iXlate555toBGR, EXLATEOBJ_vXlateLine555toBGR},
+    {EXLATEOBJ_iXlate555to565, EXLATEOBJ_vXlateLine555to565},
+    {EXLATEOBJ_iXlate555toPal, EXLATEOBJ_vXlateLine555toPal},
+    {EXLATEOBJ_iXlate565to555, EXLATEOBJ_vXlateLine565to555},
+    {EXLATEOBJ_iXlate565toRGB, EXLATEOBJ_vXlateLine565toRGB},
+    {EXLATEOBJ_iXlate565toBGR, EXLATEOBJ_vXlateLine565toBGR},
+    {EXLATEOBJ_iXlate565toPal, EXLATEOBJ_vXlateLine565toPal},
+    {EXLATEOBJ_iXlateShiftAndMask, EXLATEOBJ_vXlateLineShiftAndMask},
+    {EXLATEOBJ_iXlateBitfieldsToPal, EXLATEOBJ_vXlateLineBitfieldsToPal},
+};
+
+static
+PFN_XLATE_LINE
+EXLATEOBJ_pfnGetXlateLine(
+    _In_ PFN_XLATE pfnXlate)
+{
+    ULONG i;
+
+    for (i = 0; i < _countof(gaXlateLineFunctions); i++)
+    {
+        if (gaXlateLineFunctions[i].pfnXlate == pfnXlate)
+            return gaXlateLineFunctions[i].pfnXlateLine;
+    }
+
+    return EXLATEOBJ_vXlateLineGeneric;
+}
+
+static
+VOID
+EXLATEOBJ_vReadLine(
+    _Out_writes_(cx) PULONG pulDst,
+    _In_ PBYTE pjSrc,
+    _In_ ULONG cBitsSrc,
+    _In_ ULONG cx)
+{
+    ULONG i;
+
+    switch (cBitsSrc)
+    {
+        case 8:
+            for (i = 0; i < cx; i++)
+                pulDst[i] = pjSrc[i];
+            break;
+
+        case 16:
+            for (i = 0; i < cx; i++)
+                pulDst[i] = ((PUSHORT)pjSrc)[i];
+            break;
+
+        case 24:
+            for (i = 0; i < cx; i++, pjSrc += 3)
+                pulDst[i] = pjSrc[0] | (pjSrc[1] << 8) | (pjSrc[2] << 16);
+            break;
+
+        default:
+            ASSERT(cBitsSrc == 32);
+            RtlCopyMemory(pulDst, pjSrc, cx * sizeof(ULONG));
+            break;
+    }
+}
+
+static
+VOID
+EXLATEOBJ_vWriteLine(
+    _Out_ PBYTE pjDst,
+    _In_reads_(cx) const ULONG *pulSrc,
+    _In_ ULONG cBitsDst,
+    _In_ ULONG cx)
+{
+    ULONG i;
+
+    switch (cBitsDst)
+    {
+        case 8:
+            for (i = 0; i < cx; i++)
+                pjDst[i] = (BYTE)pulSrc[i];
+            break;
+
+        case 16:
+            for (i = 0; i < cx; i++)
+                ((PUSHORT)pjDst)[i] = (USHORT)pulSrc[i];
+            break;
+
+        case 24:
+            for (i = 0; i < cx; i++, pjDst += 3)
+            {
+                pjDst[0] = (BYTE)pulSrc[i];
+                pjDst[1] = (BYTE)(pulSrc[i] >> 8);
+                pjDst[2] = (BYTE)(pulSrc[i] >> 16);
+            }
+            break;
+
+        default:
+            ASSERT(cBitsDst == 32);
+            RtlCopyMemory(pjDst, pulSrc, cx * sizeof(ULONG));
+            break;
+    }
 }
 
 
@@ -374,7 +685,9 @@ EXLATEOBJ_vInitialize(
     pexlo->xlo.flXlate = 0;
     pexlo->xlo.pulXlate = pexlo->aulXlate;
     pexlo->pfnXlate = EXLATEOBJ_iXlateTrivial;
+    pexlo->pfnXlateLine = EXLATEOBJ_vXlateLineTrivial;
     pexlo->hColorTransform = NULL;
+    pexlo->pCache = NULL;
     pexlo->ppalSrc = ppalSrc;
     pexlo->ppalDst = ppalDst;
     pexlo->xlo.iSrcType = (USHORT)ppalSrc->flFlags;
@@ -604,6 +917,9 @@ EXLATEOBJ_vInitialize(
         pexlo->xlo.flXlate = XO_TRIVIAL;
     else
         pexlo->xlo.flXlate &= ~XO_TRIVIAL;
+
+    /* Get the line function doing the same */
+    pexlo->pfnXlateLine = EXLATEOBJ_pfnGetXlateLine(pexlo->pfnXlate);
 }
 
 VOID
@@ -654,6 +970,67 @@ EXLATEOBJ_vCleanup(
         EngFreeMem(pexlo->xlo.pulXlate);
     }
     pexlo->xlo.pulXlate = pexlo->aulXlate;
+
+    if (pexlo->pCache)
+    {
+        EngFreeMem(pexlo->pCache);
+        pexlo->pCache = NULL;
+    }
+}
+
+VOID
+NTAPI
+XLATEOBJ_vXlateLine(
+    _In_opt_ XLATEOBJ *pxlo,
+    _Out_ PVOID pvDst,
+    _In_ ULONG cBitsDst,
+    _In_ PVOID pvSrc,
+    _In_ ULONG cBitsSrc,
+    _In_ ULONG cx)
+{
+    PEXLATEOBJ pexlo = pxlo ? (PEXLATEOBJ)pxlo : &gexloTrivial;
+    ULONG aulBuffer[XLATE_LINE_CHUNK];
+    PBYTE pjSrc = pvSrc, pjDst = pvDst;
+    const ULONG *pulSrc;
+    PULONG pulDst;
+    ULONG cChunk;
+
+    ASSERT(cBitsSrc == 8 || cBitsSrc == 16 || cBitsSrc == 24 || cBitsSrc == 32);
+    ASSERT(cBitsDst == 8 || cBitsDst == 16 || cBitsDst == 24 || cBitsDst == 32);
+
+    /* Nothing to convert, translate the whole line at once */
+    if (cBitsSrc == 32 && cBitsDst == 32)
+    {
+        pexlo->pfnXlateLine(pexlo, pvDst, pvSrc, cx);
+        return;
+    }
+
+    while (cx)
+    {
+        cChunk = min(cx, XLATE_LINE_CHUNK);
+
+        /* Widen the source pixels to ULONGs, unless they already are */
+        if (cBitsSrc == 32)
+        {
+            pulSrc = (const ULONG *)pjSrc;
+        }
+        else
+        {
+            EXLATEOBJ_vReadLine(aulBuffer, pjSrc, cBitsSrc, cChunk);
+            pulSrc = aulBuffer;
+        }
+
+        /* Translate them, in place if they need to be narrowed */
+        pulDst = (cBitsDst == 32) ? (PULONG)pjDst : aulBuffer;
+        pexlo->pfnXlateLine(pexlo, pulDst, pulSrc, cChunk);
+
+        if (cBitsDst != 32)
+            EXLATEOBJ_vWriteLine(pjDst, aulBuffer, cBitsDst, cChunk);
+
+        pjSrc += cChunk * (cBitsSrc / 8);
+        pjDst += cChunk * (cBitsDst / 8);
+        cx -= cChunk;
+    }
 }
 
 /** Public DDI Functions ******************************************************/
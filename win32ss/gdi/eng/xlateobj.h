@@ -16,11 +16,31 @@ ULONG
     _In_ struct _EXLATEOBJ *pexlo,
     _In_ ULONG iColor);
 
+_Function_class_(FN_XLATE_LINE)
+typedef
+VOID
+(FASTCALL *PFN_XLATE_LINE)(
+    _In_ struct _EXLATEOBJ *pexlo,
+    _Out_writes_(cx) PULONG pulDst,
+    _In_reads_(cx) const ULONG *pulSrc,
+    _In_ ULONG cx);
+
+/* Colors already looked up in the destination palette */
+typedef struct _XLATECACHEENTRY
+{
+    ULONG iColor;
+    ULONG iIndex;
+} XLATECACHEENTRY, *PXLATECACHEENTRY;
+
+#define XLATE_CACHE_BITS 10
+#define XLATE_CACHE_SIZE (1 << XLATE_CACHE_BITS)
+
 typedef struct _EXLATEOBJ
 {
     XLATEOBJ xlo;
 
     PFN_XLATE pfnXlate;
+    PFN_XLATE_LINE pfnXlateLine;
 
     PPALETTE ppalSrc;
     PPALETTE ppalDst;
@@ -28,6 +48,8 @@ typedef struct _EXLATEOBJ
 
     HANDLE hColorTransform;
 
+    PXLATECACHEENTRY pCache;
+
     union
     {
         ULONG aulXlate[6];
@@ -54,6 +76,16 @@ XLATEOBJ_pfnXlate(
     return ((PEXLATEOBJ)pxlo)->pfnXlate;
 }
 
+VOID
+NTAPI
+XLATEOBJ_vXlateLine(
+    _In_opt_ XLATEOBJ *pxlo,
+    _Out_ PVOID pvDst,
+    _In_ ULONG cBitsDst,
+    _In_ PVOID pvSrc,
+    _In_ ULONG cBitsSrc,
+    _In_ ULONG cx);
+
 VOID
 NTAPI
 EXLATEOBJ_vInitialize(
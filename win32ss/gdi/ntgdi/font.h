@@ -25,7 +25,9 @@ typedef struct _FONT_ENTRY_COLL_MEM
 
 typedef struct _FONT_CACHE_ENTRY
 {
-    LIST_ENTRY ListEntry;
+    LIST_ENTRY ListEntry;       /* In the LRU list of the shard */
+    LIST_ENTRY HashEntry;       /* In the hash bucket of the shard */
+    SIZE_T Size;                /* Bytes charged to the cache */
     int GlyphIndex;
     FT_Face Face;
     FT_BitmapGlyph BitmapGlyph;
@@ -36,6 +38,24 @@ typedef struct _FONT_CACHE_ENTRY
     MATRIX mxWorldToDevice;
 } FONT_CACHE_ENTRY, *PFONT_CACHE_ENTRY;
 
+#define FONT_CACHE_HASH_BUCKETS 64
+
+/* The glyphs of the fonts (face and height) hashing to the same shard */
+typedef struct _FONT_CACHE_SHARD
+{
+    LIST_ENTRY LruListHead;
+    LIST_ENTRY HashBuckets[FONT_CACHE_HASH_BUCKETS];
+    SIZE_T Size;
+    ULONG NumEntries;
+} FONT_CACHE_SHARD, *PFONT_CACHE_SHARD;
+
+typedef struct _FONT_CACHE_STATS
+{
+    ULONG Hits;
+    ULONG Misses;
+    ULONG Evictions;
+} FONT_CACHE_STATS, *PFONT_CACHE_STATS;
+
 
 /*
  * FONTSUBST_... --- constants for font substitutes
@@ -88,10 +88,14 @@ static BOOL             g_RenderingEnabled = TRUE;
 #define ASSERT_FREETYPE_LOCK_NOT_HELD() \
     ASSERT(g_FreeTypeLock->Owner != KeGetCurrentThread())
 
-#define MAX_FONT_CACHE 256
+/* Bytes of glyph bitmaps we keep around, whatever their number */
+#define MAX_FONT_CACHE_BYTES (1024 * 1024)
+#define FONT_CACHE_SHARDS 8
 
-static LIST_ENTRY g_FontCacheListHead;
-static UINT g_FontCacheNumEntries;
+static FONT_CACHE_SHARD g_FontCacheShards[FONT_CACHE_SHARDS];
+static SIZE_T g_FontCacheSize;
+static ULONG g_FontCacheNumEntries;
+static FONT_CACHE_STATS g_FontCacheStats;
 
 static PWCHAR g_ElfScripts[32] =   /* These are in the order of the fsCsb[0] bits */
 {
@@ -253,16 +257,81 @@ SharedFace_AddRef(PSHARED_FACE Ptr)
     ++Ptr->RefCount;
 }
 
+static PFONT_CACHE_SHARD
+GetCacheShard(FT_Face Face, INT Height)
+{
+    ULONG Hash;
+
+    /* Hash the whole font and mix all the bits, the common heights
+       are multiples of each other and would end up together otherwise */
+    Hash = (ULONG)((ULONG_PTR)Face >> 4);
+    Hash = Hash * 31 + (ULONG)abs(Height);
+    Hash ^= Hash >> 16;
+    Hash *= 0x85EBCA6B;
+    Hash ^= Hash >> 13;
+    Hash *= 0xC2B2AE35;
+    Hash ^= Hash >> 16;
+
+    return &g_FontCacheShards[Hash % FONT_CACHE_SHARDS];
+}
+
+static PLIST_ENTRY
+GetCacheBucket(
+    PFONT_CACHE_SHARD Shard,
+    FT_Face Face,
+    INT GlyphIndex,
+    INT Height,
+    FT_Render_Mode RenderMode)
+{
+    ULONG Hash;
+
+    /* The transformation isn't hashed, glyphs are seldom drawn with several */
+    Hash = (ULONG)((ULONG_PTR)Face >> 4);
+    Hash = Hash * 31 + (ULONG)GlyphIndex;
+    Hash = Hash * 31 + (ULONG)Height;
+    Hash = Hash * 31 + (ULONG)RenderMode;
+    Hash ^= Hash >> 16;
+
+    return &Shard->HashBuckets[Hash % FONT_CACHE_HASH_BUCKETS];
+}
+
+static void
+InitFontCache(VOID)
+{
+    ULONG i, j;
+
+    for (i = 0; i < FONT_CACHE_SHARDS; i++)
+    {
+        InitializeListHead(&g_FontCacheShards[i].LruListHead);
+        for (j = 0; j < FONT_CACHE_HASH_BUCKETS; j++)
+            InitializeListHead(&g_FontCacheShards[i].HashBuckets[j]);
+        g_FontCacheShards[i].Size = 0;
+        g_FontCacheShards[i].NumEntries = 0;
+    }
+
+    g_FontCacheSize = 0;
+    g_FontCacheNumEntries = 0;
+    RtlZeroMemory(&g_FontCacheStats, sizeof(g_FontCacheStats));
+}
+
 static void
 RemoveCachedEntry(PFONT_CACHE_ENTRY Entry)
 {
+    PFONT_CACHE_SHARD Shard = GetCacheShard(Entry->Face, Entry->Height);
+
     ASSERT_FREETYPE_LOCK_HELD();
 
     FT_Done_Glyph((FT_Glyph)Entry->BitmapGlyph);
     RemoveEntryList(&Entry->ListEntry);
-    ExFreePoolWithTag(Entry, TAG_FONT);
+    RemoveEntryList(&Entry->HashEntry);
+
+    ASSERT(Shard->Size >= Entry->Size && g_FontCacheSize >= Entry->Size);
+    Shard->Size -= Entry->Size;
+    Shard->NumEntries--;
+    g_FontCacheSize -= Entry->Size;
     g_FontCacheNumEntries--;
-    ASSERT(g_FontCacheNumEntries <= MAX_FONT_CACHE);
+
+    ExFreePoolWithTag(Entry, TAG_FONT);
 }
 
 static void
@@ -270,23 +339,64 @@ RemoveCacheEntries(FT_Face Face)
 {
     PLIST_ENTRY CurrentEntry, NextEntry;
     PFONT_CACHE_ENTRY FontEntry;
+    PFONT_CACHE_SHARD Shard;
+    ULONG i;
 
     ASSERT_FREETYPE_LOCK_HELD();
 
-    for (CurrentEntry = g_FontCacheListHead.Flink;
-         CurrentEntry != &g_FontCacheListHead;
-         CurrentEntry = NextEntry)
+    for (i = 0; i < FONT_CACHE_SHARDS; i++)
     {
-        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, ListEntry);
-        NextEntry = CurrentEntry->Flink;
+        Shard = &g_FontCacheShards[i];
 
-        if (FontEntry->Face == Face)
+        for (CurrentEntry = Shard->LruListHead.Flink;
+             CurrentEntry != &Shard->LruListHead;
+             CurrentEntry = NextEntry)
         {
-            RemoveCachedEntry(FontEntry);
+            FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, ListEntry);
+            NextEntry = CurrentEntry->Flink;
+
+            if (FontEntry->Face == Face)
+            {
+                RemoveCachedEntry(FontEntry);
+            }
         }
     }
 }
 
+static void
+TrimFontCache(PFONT_CACHE_ENTRY KeepEntry)
+{
+    PFONT_CACHE_SHARD Shard, LargestShard;
+    PFONT_CACHE_ENTRY OldEntry;
+    ULONG i;
+
+    ASSERT_FREETYPE_LOCK_HELD();
+
+    while (g_FontCacheSize > MAX_FONT_CACHE_BYTES)
+    {
+        /* Take from the shard using the most memory, so that a few big
+           glyphs don't push out all the small ones of the body text */
+        LargestShard = NULL;
+        for (i = 0; i < FONT_CACHE_SHARDS; i++)
+        {
+            Shard = &g_FontCacheShards[i];
+            if (IsListEmpty(&Shard->LruListHead))
+                continue;
+            if (Shard->LruListHead.Blink == &KeepEntry->ListEntry)
+                continue;
+            if (!LargestShard || Shard->Size > LargestShard->Size)
+                LargestShard = Shard;
+        }
+
+        if (!LargestShard)
+            break;
+
+        OldEntry = CONTAINING_RECORD(LargestShard->LruListHead.Blink, FONT_CACHE_ENTRY, ListEntry);
+        RemoveCachedEntry(OldEntry);
+        g_FontCacheStats.Evictions++;
+    }
+}
+
 static void SharedMem_Release(PSHARED_MEM Ptr)
 {
     ASSERT_FREETYPE_LOCK_HELD();
@@ -662,8 +772,7 @@ InitFontSupport(VOID)
     ULONG ulError;
 
     InitializeListHead(&g_FontListHead);
-    InitializeListHead(&g_FontCacheListHead);
-    g_FontCacheNumEntries = 0;
+    InitFontCache();
     /* Fast Mutexes must be allocated from non paged pool */
     g_FontListLock = ExAllocatePoolWithTag(NonPagedPool, sizeof(FAST_MUTEX), TAG_INTERNAL_SYNC);
     if (g_FontListLock == NULL)
@@ -3243,16 +3352,20 @@ ftGdiGlyphCacheGet(
     FT_Render_Mode RenderMode,
     PMATRIX pmx)
 {
-    PLIST_ENTRY CurrentEntry;
+    PFONT_CACHE_SHARD Shard;
+    PLIST_ENTRY Bucket, CurrentEntry;
     PFONT_CACHE_ENTRY FontEntry;
 
     ASSERT_FREETYPE_LOCK_HELD();
 
-    for (CurrentEntry = g_FontCacheListHead.Flink;
-         CurrentEntry != &g_FontCacheListHead;
+    Shard = GetCacheShard(Face, Height);
+    Bucket = GetCacheBucket(Shard, Face, GlyphIndex, Height, RenderMode);
+
+    for (CurrentEntry = Bucket->Flink;
+         CurrentEntry != Bucket;
          CurrentEntry = CurrentEntry->Flink)
     {
-        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, ListEntry);
+        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, HashEntry);
         if ((FontEntry->Face == Face) &&
             (FontEntry->GlyphIndex == GlyphIndex) &&
             (FontEntry->Height == Height) &&
@@ -3261,13 +3374,16 @@ ftGdiGlyphCacheGet(
             break;
     }
 
-    if (CurrentEntry == &g_FontCacheListHead)
+    if (CurrentEntry == Bucket)
     {
+        g_FontCacheStats.Misses++;
         return NULL;
     }
 
-    RemoveEntryList(CurrentEntry);
-    InsertHeadList(&g_FontCacheListHead, CurrentEntry);
+    g_FontCacheStats.Hits++;
+
+    RemoveEntryList(&FontEntry->ListEntry);
+    InsertHeadList(&Shard->LruListHead, &FontEntry->ListEntry);
     return FontEntry->BitmapGlyph;
 }
 
@@ -3327,6 +3443,7 @@ ftGdiGlyphCacheSet(
     PFONT_CACHE_ENTRY NewEntry;
     FT_Bitmap AlignedBitmap;
     FT_BitmapGlyph BitmapGlyph;
+    PFONT_CACHE_SHARD Shard;
 
     ASSERT_FREETYPE_LOCK_HELD();
 
@@ -3373,17 +3490,41 @@ ftGdiGlyphCacheSet(
     NewEntry->Height = Height;
     NewEntry->RenderMode = RenderMode;
     NewEntry->mxWorldToDevice = *pmx;
+    NewEntry->Size = sizeof(FONT_CACHE_ENTRY) + sizeof(FT_BitmapGlyphRec) +
+                     abs(BitmapGlyph->bitmap.pitch) * BitmapGlyph->bitmap.rows;
 
-    InsertHeadList(&g_FontCacheListHead, &NewEntry->ListEntry);
-    if (++g_FontCacheNumEntries > MAX_FONT_CACHE)
-    {
-        NewEntry = CONTAINING_RECORD(g_FontCacheListHead.Blink, FONT_CACHE_ENTRY, ListEntry);
-        RemoveCachedEntry(NewEntry);
-    }
+    Shard = GetCacheShard(Face, Height);
+    InsertHeadList(&Shard->LruListHead, &NewEntry->ListEntry);
+    InsertHeadList(GetCacheBucket(Shard, Face, GlyphIndex, Height, RenderMode),
+                   &NewEntry->HashEntry);
+    Shard->Size += NewEntry->Size;
+    Shard->NumEntries++;
+    g_FontCacheSize += NewEntry->Size;
+    g_FontCacheNumEntries++;
+
+    TrimFontCache(NewEntry);
 
     return BitmapGlyph;
 }
 
+VOID FASTCALL
+ftGdiDumpGlyphCache(VOID)
+{
+    ULONG i;
+
+    /* Called from the debugger too, so no locking */
+    DbgPrint("Glyph cache: %lu glyphs, %Iu bytes out of %lu\n",
+             g_FontCacheNumEntries, g_FontCacheSize, (ULONG)MAX_FONT_CACHE_BYTES);
+    DbgPrint("Hits: %lu, misses: %lu, evictions: %lu\n",
+             g_FontCacheStats.Hits, g_FontCacheStats.Misses, g_FontCacheStats.Evictions);
+
+    for (i = 0; i < FONT_CACHE_SHARDS; i++)
+    {
+        DbgPrint("Shard %lu: %lu glyphs, %Iu bytes\n",
+                 i, g_FontCacheShards[i].NumEntries, g_FontCacheShards[i].Size);
+    }
+}
+
 
 static unsigned int get_native_glyph_outline(FT_Outline *outline, unsigned int buflen, char *buf)
 {
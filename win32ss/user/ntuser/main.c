@@ -473,6 +473,7 @@ InitThreadCallback(PETHREAD Thread)
 
     InitializeListHead(&ptiCurrent->WindowListHead);
     InitializeListHead(&ptiCurrent->W32CallbackListHead);
+    InitializeListHead(&ptiCurrent->TimersReadyListHead);
     InitializeListHead(&ptiCurrent->PostedMessagesListHead);
     InitializeListHead(&ptiCurrent->SentMessagesListHead);
     InitializeListHead(&ptiCurrent->PtiLink);
@@ -14,7 +14,24 @@ DBG_DEFAULT_CHANNEL(UserTimer);
 /* GLOBALS *******************************************************************/
 
 static LIST_ENTRY TimersListHead;
-static LONG TimeLast = 0;
+
+/*
+ * Running timers hang off a hierarchical timer wheel. The first level has one
+ * slot per millisecond, each slot of the upper levels covers a whole turn of
+ * the level below, and timers cascade down as they get closer to expiring.
+ * Each tick only looks at the slots for the milliseconds that went by.
+ */
+#define TIMER_WHEEL_BITS   8
+#define TIMER_LEVEL_BITS   6
+#define TIMER_LEVELS       4
+#define TIMER_WHEEL_SIZE   (1 << TIMER_WHEEL_BITS)
+#define TIMER_LEVEL_SIZE   (1 << TIMER_LEVEL_BITS)
+#define TIMER_LEVEL_SHIFT(Level) (TIMER_WHEEL_BITS + (Level) * TIMER_LEVEL_BITS)
+
+static LIST_ENTRY TimerWheel[TIMER_WHEEL_SIZE];
+static LIST_ENTRY TimerLevels[TIMER_LEVELS][TIMER_LEVEL_SIZE];
+static ULONG TimerWheelTime;  // Next millisecond to be processed.
+static ULONG TimerWheelCount; // Timers in the wheel.
 
 /* Windows 2000 has room for 32768 window-less timers */
 #define NUM_WINDOW_LESS_TIMERS   32768
@@ -46,6 +63,88 @@ ERESOURCE TimerLock;
 
 
 /* FUNCTIONS *****************************************************************/
+static
+VOID
+FASTCALL
+InsertTimer(PTIMER pTmr)
+{
+  ULONG Expire = pTmr->tmExpire;
+  ULONG Delta = Expire - TimerWheelTime;
+  PLIST_ENTRY ListHead;
+  ULONG Level;
+
+  if ((LONG)Delta < 0)
+  {
+     /* Late already, run it with the next slot */
+     ListHead = &TimerWheel[TimerWheelTime & (TIMER_WHEEL_SIZE - 1)];
+  }
+  else if (Delta < TIMER_WHEEL_SIZE)
+  {
+     ListHead = &TimerWheel[Expire & (TIMER_WHEEL_SIZE - 1)];
+  }
+  else
+  {
+     for (Level = 0; Level < TIMER_LEVELS - 1; Level++)
+     {
+        if (Delta < (1UL << TIMER_LEVEL_SHIFT(Level + 1)))
+           break;
+     }
+     ListHead = &TimerLevels[Level][(Expire >> TIMER_LEVEL_SHIFT(Level)) & (TIMER_LEVEL_SIZE - 1)];
+  }
+
+  InsertTailList(ListHead, &pTmr->ptmrWheel);
+}
+
+static
+VOID
+FASTCALL
+StartTimer(PTIMER pTmr, ULONG Time)
+{
+  /* An empty wheel has nothing to catch up with */
+  if (TimerWheelCount++ == 0)
+     TimerWheelTime = Time;
+
+  pTmr->tmExpire = Time + pTmr->cmsRate;
+  InsertTimer(pTmr);
+}
+
+static
+VOID
+FASTCALL
+StopTimer(PTIMER pTmr)
+{
+  if (!IsListEmpty(&pTmr->ptmrWheel))
+  {
+     RemoveEntryList(&pTmr->ptmrWheel);
+     InitializeListHead(&pTmr->ptmrWheel);
+     TimerWheelCount--;
+  }
+}
+
+static
+VOID
+FASTCALL
+CascadeTimers(PLIST_ENTRY ListHead)
+{
+  LIST_ENTRY Timers;
+  PLIST_ENTRY pLE;
+
+  if (IsListEmpty(ListHead))
+     return;
+
+  /* Take them all out first, they may well land in the same slot again */
+  Timers = *ListHead;
+  Timers.Flink->Blink = &Timers;
+  Timers.Blink->Flink = &Timers;
+  InitializeListHead(ListHead);
+
+  while (!IsListEmpty(&Timers))
+  {
+     pLE = RemoveHeadList(&Timers);
+     InsertTimer(CONTAINING_RECORD(pLE, TIMER, ptmrWheel));
+  }
+}
+
 static
 PTIMER
 FASTCALL
@@ -58,6 +157,7 @@ CreateTimer(VOID)
   if (Ret)
   {
      Ret->head.h = Handle;
+     InitializeListHead(&Ret->ptmrWheel);
      InsertTailList(&TimersListHead, &Ret->ptmrList);
   }
 
@@ -74,6 +174,13 @@ RemoveTimer(PTIMER pTmr)
   {
      /* Set the flag, it will be removed when ready */
      RemoveEntryList(&pTmr->ptmrList);
+     StopTimer(pTmr);
+     if (pTmr->flags & TMRF_READY)
+     {
+        /* It will not be posted anymore */
+        RemoveEntryList(&pTmr->ptmrReady);
+        ClearMsgBitsMask(pTmr->pti, QS_TIMER);
+     }
      if ((pTmr->pWnd == NULL) && (!(pTmr->flags & TMRF_SYSTEM))) // System timers are reusable.
      {
         UINT_PTR IDEvent;
@@ -213,6 +320,7 @@ IntSetTimer( PWND Window,
   if ((Window) && (IDEvent == 0))
      Ret = 1;
 
+  TimerEnterExclusive();
   pTmr = FindTimer(Window, IDEvent, Type);
 
   if ((!pTmr) && (Window == NULL) && (!(Type & TMRF_SYSTEM)))
@@ -224,6 +332,7 @@ IntSetTimer( PWND Window,
       if (IDEvent == (UINT_PTR) -1)
       {
          IntUnlockWindowlessTimerBitmap();
+         TimerLeave();
          ERR("Unable to find a free window-less timer id\n");
          EngSetLastError(ERROR_NO_SYSTEM_RESOURCES);
          ASSERT(FALSE);
@@ -239,7 +348,11 @@ IntSetTimer( PWND Window,
   if (!pTmr)
   {
      pTmr = CreateTimer();
-     if (!pTmr) return 0;
+     if (!pTmr)
+     {
+        TimerLeave();
+        return 0;
+     }
 
      if (Window && (Type & TMRF_TIFROMWND))
         pTmr->pti = Window->head.pti->pEThread->Tcb.Win32Thread;
@@ -252,23 +365,27 @@ IntSetTimer( PWND Window,
      }
 
      pTmr->pWnd    = Window;
-     pTmr->cmsCountdown = Elapse;
      pTmr->cmsRate = Elapse;
      pTmr->pfn     = TimerFunc;
      pTmr->nID     = IDEvent;
-     pTmr->flags   = Type|TMRF_INIT;
+     pTmr->flags   = Type;
   }
   else
   {
-     pTmr->cmsCountdown = Elapse;
+     StopTimer(pTmr);
      pTmr->cmsRate = Elapse;
+     pTmr->flags &= ~TMRF_WAITING;
   }
 
+  StartTimer(pTmr, EngGetTickCount32());
+
   ASSERT(MasterTimer != NULL);
   // Start the timer thread!
   if (TimersListHead.Flink == TimersListHead.Blink) // There is only one timer
      KeSetTimer(MasterTimer, DueTime, NULL);
 
+  TimerLeave();
+
   return Ret;
 }
 
@@ -403,13 +520,11 @@ PostTimerMessages(PWND Window)
   pti = PsGetCurrentThreadWin32Thread();
 
   TimerEnterExclusive();
-  pLE = TimersListHead.Flink;
-  while(pLE != &TimersListHead)
+  pLE = pti->TimersReadyListHead.Flink;
+  while(pLE != &pti->TimersReadyListHead)
   {
-     pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
-     if ( (pTmr->flags & TMRF_READY) &&
-          (pTmr->pti == pti) &&
-          ((pTmr->pWnd == Window) || (Window == NULL)) )
+     pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrReady);
+     if ((pTmr->pWnd == Window) || (Window == NULL))
         {
            Msg.hwnd    = (pTmr->pWnd) ? pTmr->pWnd->head.h : 0;
            Msg.message = (pTmr->flags & TMRF_SYSTEM) ? WM_SYSTIMER : WM_TIMER;
@@ -420,16 +535,12 @@ PostTimerMessages(PWND Window)
            Msg.pt      = gpsi->ptCursor;
 
            MsqPostMessage(pti, &Msg, FALSE, (QS_POSTMESSAGE|QS_ALLPOSTMESSAGE), 0, 0);
+           // Leaving the ready list sends it to the back of it the next time,
+           // so it will not be called again in the next msg loop.
            pTmr->flags &= ~TMRF_READY;
+           RemoveEntryList(&pTmr->ptmrReady);
            ClearMsgBitsMask(pti, QS_TIMER);
            Hit = TRUE;
-           // Now move this entry to the end of the list so it will not be
-           // called again in the next msg loop.
-           if (pLE != &TimersListHead)
-           {
-              RemoveEntryList(&pTmr->ptmrList);
-              InsertTailList(&TimersListHead, &pTmr->ptmrList);
-           }
            break;
         }
 
@@ -446,74 +557,86 @@ FASTCALL
 ProcessTimers(VOID)
 {
   LARGE_INTEGER DueTime;
-  LONG Time;
+  LIST_ENTRY ExpiredListHead;
+  ULONG Time, Index, Level;
   PLIST_ENTRY pLE;
   PTIMER pTmr;
   LONG TimerCount = 0;
 
   TimerEnterExclusive();
-  pLE = TimersListHead.Flink;
   Time = EngGetTickCount32();
 
   DueTime.QuadPart = (LONGLONG)(-97656); // 1024hz .9765625 ms set to 10.0 ms
 
-  while(pLE != &TimersListHead)
+  InitializeListHead(&ExpiredListHead);
+
+  // Collect everything that expired since the last run.
+  while (TimerWheelCount && (LONG)(Time - TimerWheelTime) >= 0)
   {
-    pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
+    Index = TimerWheelTime & (TIMER_WHEEL_SIZE - 1);
+
+    // A full turn of the first level pulls the next slot of the levels above down.
+    if (Index == 0)
+    {
+       for (Level = 0; Level < TIMER_LEVELS; Level++)
+       {
+          Index = (TimerWheelTime >> TIMER_LEVEL_SHIFT(Level)) & (TIMER_LEVEL_SIZE - 1);
+          CascadeTimers(&TimerLevels[Level][Index]);
+          if (Index != 0) break;
+       }
+       Index = 0;
+    }
+
+    while (!IsListEmpty(&TimerWheel[Index]))
+    {
+       pLE = RemoveHeadList(&TimerWheel[Index]);
+       InsertTailList(&ExpiredListHead, pLE);
+    }
+
+    TimerWheelTime++;
+  }
+
+  while (!IsListEmpty(&ExpiredListHead))
+  {
+    // Anything a callback kills is taken off this list too.
+    pLE = RemoveHeadList(&ExpiredListHead);
+    InitializeListHead(pLE);
+    TimerWheelCount--;
+    pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrWheel);
     TimerCount++;
-    if (pTmr->flags & TMRF_WAITING)
+
+    ASSERT(pTmr->pti);
+    if ((pTmr->flags & TMRF_READY) || (pTmr->pti->TIF_flags & TIF_INCLEANUP))
     {
-       pLE = pTmr->ptmrList.Flink;
-       pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
+       StartTimer(pTmr, Time);
        continue;
     }
 
-    if (pTmr->flags & TMRF_INIT)
+    if (pTmr->flags & TMRF_ONESHOT)
+       pTmr->flags |= TMRF_WAITING;
+    else
+       StartTimer(pTmr, Time);
+
+    if (pTmr->flags & TMRF_RIT)
     {
-       pTmr->flags &= ~TMRF_INIT; // Skip this run.
+       // Hard coded call here, inside raw input thread.
+       pTmr->pfn(NULL, WM_SYSTIMER, pTmr->nID, (LPARAM)pTmr);
     }
     else
     {
-       if (pTmr->cmsCountdown < 0)
-       {
-          ASSERT(pTmr->pti);
-          if ((!(pTmr->flags & TMRF_READY)) && (!(pTmr->pti->TIF_flags & TIF_INCLEANUP)))
-          {
-             if (pTmr->flags & TMRF_ONESHOT)
-                pTmr->flags |= TMRF_WAITING;
-
-             if (pTmr->flags & TMRF_RIT)
-             {
-                // Hard coded call here, inside raw input thread.
-                pTmr->pfn(NULL, WM_SYSTIMER, pTmr->nID, (LPARAM)pTmr);
-             }
-             else
-             {
-                pTmr->flags |= TMRF_READY; // Set timer ready to be ran.
-                // Set thread message queue for this timer.
-                if (pTmr->pti)
-                {  // Wakeup thread
-                   pTmr->pti->cTimersReady++;
-                   ASSERT(pTmr->pti->pEventQueueServer != NULL);
-                   MsqWakeQueue(pTmr->pti, QS_TIMER, TRUE);
-                }
-             }
-          }
-          pTmr->cmsCountdown = pTmr->cmsRate;
-       }
-       else
-          pTmr->cmsCountdown -= Time - TimeLast;
+       pTmr->flags |= TMRF_READY; // Set timer ready to be ran.
+       InsertTailList(&pTmr->pti->TimersReadyListHead, &pTmr->ptmrReady);
+       // Wakeup thread
+       pTmr->pti->cTimersReady++;
+       ASSERT(pTmr->pti->pEventQueueServer != NULL);
+       MsqWakeQueue(pTmr->pti, QS_TIMER, TRUE);
     }
-
-    pLE = pLE->Flink;
   }
 
   // Restart the timer thread!
   ASSERT(MasterTimer != NULL);
   KeSetTimer(MasterTimer, DueTime, NULL);
 
-  TimeLast = Time;
-
   TimerLeave();
   TRACE("TimerCount = %d\n", TimerCount);
 }
@@ -593,7 +716,7 @@ NTSTATUS
 NTAPI
 InitTimerImpl(VOID)
 {
-   ULONG BitmapBytes;
+   ULONG BitmapBytes, Level, i;
 
    /* Allocate FAST_MUTEX from non paged pool */
    Mutex = ExAllocatePoolWithTag(NonPagedPool, sizeof(FAST_MUTEX), TAG_INTERNAL_SYNC);
@@ -621,6 +744,15 @@ InitTimerImpl(VOID)
    ExInitializeResourceLite(&TimerLock);
    InitializeListHead(&TimersListHead);
 
+   for (i = 0; i < TIMER_WHEEL_SIZE; i++)
+      InitializeListHead(&TimerWheel[i]);
+
+   for (Level = 0; Level < TIMER_LEVELS; Level++)
+   {
+      for (i = 0; i < TIMER_LEVEL_SIZE; i++)
+         InitializeListHead(&TimerLevels[Level][i]);
+   }
+
    return STATUS_SUCCESS;
 }
 
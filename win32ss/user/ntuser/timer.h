@@ -4,10 +4,12 @@ typedef struct _TIMER
 {
   HEAD           head;
   LIST_ENTRY     ptmrList;
+  LIST_ENTRY     ptmrWheel;    // Timer wheel slot, empty when not running.
+  LIST_ENTRY     ptmrReady;    // Thread ready list, when TMRF_READY is set.
   PTHREADINFO    pti;
   PWND           pWnd;         // hWnd
   UINT_PTR       nID;          // Specifies a nonzero timer identifier.
-  INT            cmsCountdown; // uElapse
+  ULONG          tmExpire;     // Tick count it expires at.
   INT            cmsRate;      // uElapse
   FLONG          flags;
   TIMERPROC      pfn;          // lpTimerFunc
@@ -148,6 +148,7 @@ typedef struct _THREADINFO
 
     LIST_ENTRY WindowListHead;
     LIST_ENTRY W32CallbackListHead;
+    LIST_ENTRY TimersReadyListHead;
     SINGLE_LIST_ENTRY  ReferencesList;
     ULONG cExclusiveLocks;
 #if DBG